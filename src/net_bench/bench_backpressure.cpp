@@ -0,0 +1,228 @@
+// @file bench_backpressure.cpp - Memory held for clients that stop reading
+// @author TPOC: contact@openfhe-crypto.org
+//
+// @copyright Copyright (c) 2020, 2023 Duality Technologies Inc.
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution. THIS SOFTWARE IS
+// PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+// IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+// EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// @section DESCRIPTION
+// A server sends a run of 1 MB messages to every client while none of
+// them are reading, the way a server feeding CTs to slow consumers would,
+// and prints how many were queued and refused, what GetSendStats()
+// reports, and the server's peak resident size. Once without send limits
+// and once with a per connection limit and a server wide budget. The
+// clients run in a process of their own, stopped while the server sends,
+// and each case runs in a fresh process.
+
+#include <getopt.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+
+#include <olc_net.h>
+
+enum class BenchMsgTypes : uint32_t {
+  Object,
+};
+
+class BenchServer : public olc::net::server_interface<BenchMsgTypes> {
+public:
+  BenchServer(uint16_t nPort)
+      : olc::net::server_interface<BenchMsgTypes>(nPort) {}
+
+  std::vector<std::shared_ptr<olc::net::connection<BenchMsgTypes>>>
+  GetClients() {
+    std::scoped_lock lock(m_muxClients);
+    return m_vClients;
+  }
+
+protected:
+  virtual bool
+  OnClientConnect(std::shared_ptr<olc::net::connection<BenchMsgTypes>> client) {
+    std::scoped_lock lock(m_muxClients);
+    m_vClients.push_back(client);
+    return true;
+  }
+
+  virtual void
+  OnMessage(std::shared_ptr<olc::net::connection<BenchMsgTypes>>,
+            olc::net::message<BenchMsgTypes> &) {}
+
+private:
+  std::mutex m_muxClients;
+  std::vector<std::shared_ptr<olc::net::connection<BenchMsgTypes>>> m_vClients;
+};
+
+class BenchClient : public olc::net::client_interface<BenchMsgTypes> {};
+
+// connects the clients once told the server is up, and keeps them
+// connected until told to go
+static void RunClients(uint16_t port, size_t nClients, int fdReady) {
+  char c;
+  if (read(fdReady, &c, 1) != 1) {
+    std::exit(EXIT_FAILURE);
+  }
+
+  std::vector<std::unique_ptr<BenchClient>> vClients;
+  for (size_t i = 0; i < nClients; i++) {
+    vClients.push_back(std::make_unique<BenchClient>());
+    if (!vClients.back()->Connect("127.0.0.1", port)) {
+      std::exit(EXIT_FAILURE);
+    }
+  }
+  if (read(fdReady, &c, 1) != 1) {
+    std::exit(EXIT_FAILURE);
+  }
+}
+
+// one run of sends, prints a CSV line
+static void RunCase(uint16_t port, size_t nClients, size_t nMessages,
+                    size_t nQueueLimit, size_t nBudget) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    std::exit(EXIT_FAILURE);
+  }
+
+  // fork before any threads are started here
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[1]);
+    RunClients(port, nClients, fds[0]);
+    std::exit(EXIT_SUCCESS);
+  }
+  close(fds[0]);
+
+  BenchServer server(port);
+  server.SetSendLimits(nQueueLimit, nBudget);
+  server.Start();
+  if (write(fds[1], "x", 1) != 1) {
+    std::exit(EXIT_FAILURE);
+  }
+  while (server.GetClients().size() < nClients) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  // the clients stop reading
+  kill(pid, SIGSTOP);
+
+  olc::net::message<BenchMsgTypes> msg;
+  msg.header.id = BenchMsgTypes::Object;
+  msg.body.assign(1 << 20, 'x');
+  msg.header.size = uint32_t(msg.size());
+
+  size_t nQueued = 0;
+  size_t nRefused = 0;
+  for (size_t i = 0; i < nMessages; i++) {
+    for (auto &client : server.GetClients()) {
+      if (server.MessageClient(client, msg)) {
+        nQueued++;
+      } else {
+        nRefused++;
+      }
+    }
+  }
+
+  // let the I/O thread write what it can before looking
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  olc::net::server_send_stats stats = server.GetSendStats();
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  std::cout << (nQueueLimit >> 20) << "," << (nBudget >> 20) << ","
+            << nClients << "," << nQueued << "," << nRefused << ","
+            << stats.nMessagesQueued << "," << (stats.nBytesQueued >> 20)
+            << "," << (stats.nMaxBytesQueued >> 20) << ","
+            << usage.ru_maxrss / 1024 << std::endl;
+
+  kill(pid, SIGCONT);
+  if (write(fds[1], "x", 1) != 1) {
+    std::exit(EXIT_FAILURE);
+  }
+  close(fds[1]);
+  int status = 0;
+  waitpid(pid, &status, 0);
+  server.Stop();
+}
+
+int main(int argc, char *argv[]) {
+  int opt;
+  uint16_t port(60128);
+  size_t nClients(20);
+  size_t nMessages(64);
+  size_t nQueueMB(8);
+  size_t nBudgetMB(64);
+
+  while ((opt = getopt(argc, argv, "p:c:n:q:b:h")) != -1) {
+    switch (opt) {
+    case 'p':
+      port = atoi(optarg);
+      break;
+    case 'c':
+      nClients = atoi(optarg);
+      break;
+    case 'n':
+      nMessages = atoi(optarg);
+      break;
+    case 'q':
+      nQueueMB = atoi(optarg);
+      break;
+    case 'b':
+      nBudgetMB = atoi(optarg);
+      break;
+    case 'h':
+    default: /* '?' */
+      std::cerr << "Usage: " << std::endl
+                << "arguments:" << std::endl
+                << "  -p port to listen on (default 60128)" << std::endl
+                << "  -c number of clients (default 20)" << std::endl
+                << "  -n 1 MB messages sent to each client (default 64)"
+                << std::endl
+                << "  -q MB each client may have queued (default 8)"
+                << std::endl
+                << "  -b MB all clients may have queued (default 64)"
+                << std::endl
+                << "  -h prints this message" << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  std::cout << "queue_limit_mb,budget_mb,clients,queued,refused,"
+               "messages_waiting,mb_waiting,max_mb_waiting,peak_rss_mb"
+            << std::endl;
+
+  for (bool bLimited : {false, true}) {
+    // a fresh process for each, ru_maxrss never goes down
+    pid_t pid = fork();
+    if (pid == 0) {
+      RunCase(port, nClients, nMessages, bLimited ? nQueueMB << 20 : 0,
+              bLimited ? nBudgetMB << 20 : 0);
+      std::exit(EXIT_SUCCESS);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,213 @@
+// @file bench_broadcast.cpp - Memory held by a broadcast to many clients
+// @author TPOC: contact@openfhe-crypto.org
+//
+// @copyright Copyright (c) 2020, 2023 Duality Technologies Inc.
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution. THIS SOFTWARE IS
+// PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+// IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+// EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// @section DESCRIPTION
+// A server sends one large object to every connected client, the way the
+// PRE server hands out its CryptoContext, and reports how many bytes of
+// message bodies it holds straight after the call, and its peak resident
+// size. Once with a MessageClient() per client, each of which copies the
+// body, and once with MessageAllClients(), which queues the one body on
+// every connection. The clients run in a process of their own, stopped
+// while the server sends, so nothing drains and their receive buffers
+// don't count. Each case runs in a fresh process.
+
+#include <getopt.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+
+#include <olc_net.h>
+
+enum class BenchMsgTypes : uint32_t {
+  Object,
+};
+
+class BenchServer : public olc::net::server_interface<BenchMsgTypes> {
+public:
+  BenchServer(uint16_t nPort)
+      : olc::net::server_interface<BenchMsgTypes>(nPort) {}
+
+  std::vector<std::shared_ptr<olc::net::connection<BenchMsgTypes>>>
+  GetClients() {
+    std::scoped_lock lock(m_muxClients);
+    return m_vClients;
+  }
+
+protected:
+  virtual bool
+  OnClientConnect(std::shared_ptr<olc::net::connection<BenchMsgTypes>> client) {
+    std::scoped_lock lock(m_muxClients);
+    m_vClients.push_back(client);
+    return true;
+  }
+
+  virtual void
+  OnMessage(std::shared_ptr<olc::net::connection<BenchMsgTypes>>,
+            olc::net::message<BenchMsgTypes> &) {}
+
+private:
+  std::mutex m_muxClients;
+  std::vector<std::shared_ptr<olc::net::connection<BenchMsgTypes>>> m_vClients;
+};
+
+class BenchClient : public olc::net::client_interface<BenchMsgTypes> {};
+
+// connects the clients once told the server is up, and waits for each to
+// receive the object
+static void RunClients(uint16_t port, size_t nClients, int fdReady) {
+  char c;
+  if (read(fdReady, &c, 1) != 1) {
+    std::exit(EXIT_FAILURE);
+  }
+
+  std::vector<std::unique_ptr<BenchClient>> vClients;
+  for (size_t i = 0; i < nClients; i++) {
+    vClients.push_back(std::make_unique<BenchClient>());
+    if (!vClients.back()->Connect("127.0.0.1", port)) {
+      std::exit(EXIT_FAILURE);
+    }
+  }
+  for (auto &client : vClients) {
+    client->Incoming().wait();
+    client->Incoming().pop_front();
+  }
+}
+
+// one broadcast, prints a CSV line
+static void RunCase(uint16_t port, size_t nClients, size_t nBytes,
+                    bool bShared) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    std::exit(EXIT_FAILURE);
+  }
+
+  // fork before any threads are started here
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[1]);
+    RunClients(port, nClients, fds[0]);
+    std::exit(EXIT_SUCCESS);
+  }
+  close(fds[0]);
+
+  BenchServer server(port);
+  server.Start();
+  if (write(fds[1], "x", 1) != 1) {
+    std::exit(EXIT_FAILURE);
+  }
+  close(fds[1]);
+  while (server.GetClients().size() < nClients) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  olc::net::message<BenchMsgTypes> msg;
+  msg.header.id = BenchMsgTypes::Object;
+  msg.body.assign(nBytes, 'x');
+  msg.header.size = uint32_t(msg.size());
+
+  // stop the clients reading for the moment, the way a slow client would,
+  // so what is queued for them stays queued
+  kill(pid, SIGSTOP);
+
+  auto &pool = olc::net::body_pool::instance();
+  uint64_t nBefore = pool.GetStats().nBytesInUse;
+  auto tStart = std::chrono::steady_clock::now();
+  if (bShared) {
+    server.MessageAllClients(msg);
+  } else {
+    for (auto &client : server.GetClients()) {
+      server.MessageClient(client, msg);
+    }
+  }
+  uint64_t nHeld = pool.GetStats().nBytesInUse - nBefore;
+  kill(pid, SIGCONT);
+
+  int status = 0;
+  waitpid(pid, &status, 0);
+  double dSeconds = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - tStart)
+                        .count();
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+    std::exit(EXIT_FAILURE);
+  }
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  std::cout << (bShared ? "shared" : "per_client") << "," << nClients << ","
+            << (nBytes >> 20) << "," << (nHeld >> 20) << ","
+            << usage.ru_maxrss / 1024 << "," << dSeconds << std::endl;
+
+  server.Stop();
+}
+
+int main(int argc, char *argv[]) {
+  int opt;
+  uint16_t port(60127);
+  size_t nClients(100);
+  size_t nMegabytes(10);
+
+  while ((opt = getopt(argc, argv, "p:c:m:h")) != -1) {
+    switch (opt) {
+    case 'p':
+      port = atoi(optarg);
+      break;
+    case 'c':
+      nClients = atoi(optarg);
+      break;
+    case 'm':
+      nMegabytes = atoi(optarg);
+      break;
+    case 'h':
+    default: /* '?' */
+      std::cerr << "Usage: " << std::endl
+                << "arguments:" << std::endl
+                << "  -p port to listen on (default 60127)" << std::endl
+                << "  -c number of clients (default 100)" << std::endl
+                << "  -m object size in MB (default 10)" << std::endl
+                << "  -h prints this message" << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  std::cout << "mode,clients,object_mb,pool_mb_in_use,peak_rss_mb,seconds"
+            << std::endl;
+
+  for (bool bShared : {false, true}) {
+    // a fresh process for each, ru_maxrss never goes down
+    pid_t pid = fork();
+    if (pid == 0) {
+      RunCase(port, nClients, nMegabytes << 20, bShared);
+      std::exit(EXIT_SUCCESS);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
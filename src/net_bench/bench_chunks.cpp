@@ -0,0 +1,187 @@
+// @file bench_chunks.cpp - Peak memory of sending one large object
+// @author TPOC: contact@openfhe-crypto.org
+//
+// @copyright Copyright (c) 2020, 2023 Duality Technologies Inc.
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution. THIS SOFTWARE IS
+// PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+// IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+// EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// @section DESCRIPTION
+// A client serializes one large object, a few KB at a time like
+// Serial::Serialize() does, and sends it to a server which reads it back
+// through message_istream. Once into a single message body, the way every
+// message used to go, and once through message_chunk_ostream. Each run is
+// done in its own process so the peak resident size it reports belongs to
+// that run alone; server and client share the process, as both ends hold
+// the object in the single message case.
+
+#include <getopt.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+
+#include <olc_net.h>
+
+enum class BenchMsgTypes : uint32_t {
+  ServerAccept,
+  Object,
+};
+
+class BenchServer : public olc::net::server_interface<BenchMsgTypes> {
+public:
+  BenchServer(uint16_t nPort)
+      : olc::net::server_interface<BenchMsgTypes>(nPort) {}
+
+  std::atomic<uint64_t> m_nBytes{0};
+  std::atomic<bool> m_bDone{false};
+
+protected:
+  virtual bool
+  OnClientConnect(std::shared_ptr<olc::net::connection<BenchMsgTypes>> client) {
+    olc::net::message<BenchMsgTypes> msg;
+    msg.header.id = BenchMsgTypes::ServerAccept;
+    client->Send(msg);
+    return true;
+  }
+
+  virtual void
+  OnMessage(std::shared_ptr<olc::net::connection<BenchMsgTypes>>,
+            olc::net::message<BenchMsgTypes> &msg) {
+    // read it back in small pieces, the way a deserializer would
+    olc::net::message_istream<BenchMsgTypes> is(msg);
+    std::vector<char> buf(4096);
+    while (is.read(buf.data(), buf.size()) || is.gcount() > 0) {
+      m_nBytes += is.gcount();
+    }
+    m_bDone = true;
+  }
+};
+
+class BenchClient : public olc::net::client_interface<BenchMsgTypes> {
+public:
+  void SendObject(size_t nBytes, bool bChunked, size_t nChunkSize) {
+    std::vector<char> piece(4096, 'x');
+    if (bChunked) {
+      olc::net::message_chunk_ostream<BenchMsgTypes> os(
+          *m_connection, BenchMsgTypes::Object, 0, nChunkSize);
+      WritePieces(os, piece, nBytes);
+      os.close();
+    } else {
+      olc::net::message<BenchMsgTypes> msg;
+      msg.header.id = BenchMsgTypes::Object;
+      olc::net::message_ostream<BenchMsgTypes> os(msg);
+      WritePieces(os, piece, nBytes);
+      Send(msg);
+    }
+  }
+
+private:
+  static void WritePieces(std::ostream &os, const std::vector<char> &piece,
+                          size_t nBytes) {
+    for (size_t n = 0; n < nBytes; n += piece.size()) {
+      os.write(piece.data(), std::min(piece.size(), nBytes - n));
+    }
+  }
+};
+
+// one send and receive, prints a CSV line
+static void RunCase(uint16_t port, size_t nBytes, bool bChunked,
+                    size_t nChunkSize) {
+  BenchServer server(port);
+  server.Start();
+  BenchClient client;
+  client.Connect("127.0.0.1", port);
+  client.Incoming().wait();
+  client.Incoming().pop_front();
+
+  auto tStart = std::chrono::steady_clock::now();
+  // the chunked sender waits for the socket, so it needs the server to be
+  // reading at the same time
+  std::thread sender(
+      [&]() { client.SendObject(nBytes, bChunked, nChunkSize); });
+  while (!server.m_bDone) {
+    server.Update(1, true);
+  }
+  sender.join();
+  double dSeconds = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - tStart)
+                        .count();
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  std::cout << (bChunked ? "chunked" : "single") << "," << (nBytes >> 20)
+            << "," << (bChunked ? nChunkSize >> 10 : 0) << ","
+            << server.m_nBytes << "," << dSeconds << ","
+            << double(nBytes >> 20) / dSeconds << ","
+            << usage.ru_maxrss / 1024 << std::endl;
+
+  client.Disconnect();
+  server.Stop();
+}
+
+int main(int argc, char *argv[]) {
+  int opt;
+  uint16_t port(60125);
+  size_t nMegabytes(256);
+  size_t nChunkSize(olc::net::default_chunk_size);
+
+  while ((opt = getopt(argc, argv, "p:m:c:h")) != -1) {
+    switch (opt) {
+    case 'p':
+      port = atoi(optarg);
+      break;
+    case 'm':
+      nMegabytes = atoi(optarg);
+      break;
+    case 'c':
+      nChunkSize = atoi(optarg);
+      break;
+    case 'h':
+    default: /* '?' */
+      std::cerr << "Usage: " << std::endl
+                << "arguments:" << std::endl
+                << "  -p port to listen on (default 60125)" << std::endl
+                << "  -m object size in MB (default 256)" << std::endl
+                << "  -c chunk size in bytes (default 1048576)" << std::endl
+                << "  -h prints this message" << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  std::cout << "mode,object_mb,chunk_kb,bytes_read,seconds,mb_per_s,"
+               "peak_rss_mb"
+            << std::endl;
+
+  for (bool bChunked : {false, true}) {
+    // a fresh process for each, ru_maxrss never goes down
+    pid_t pid = fork();
+    if (pid == 0) {
+      RunCase(port, nMegabytes << 20, bChunked, nChunkSize);
+      std::exit(EXIT_SUCCESS);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,170 @@
+// @file bench_delta.cpp - Wire size of delta encoded round 2 keys
+// @author TPOC: contact@openfhe-crypto.org
+//
+// @copyright Copyright (c) 2020, 2023 Duality Technologies Inc.
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution. THIS SOFTWARE IS
+// PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+// IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+// EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// @section DESCRIPTION
+// Builds byte images laid out like the serialized keys of the threshold
+// examples: a public key is a short preamble then the polynomials b and a,
+// an eval key a vector of a polynomials then a vector of b. The round 2
+// version of each keeps the preamble and the a part of its round 1
+// reference and has a fresh b. A fresh ciphertext shares nothing with its
+// reference. For each it prints the bytes that go on the wire with and
+// without delta encoding, and the time to encode on the sender and to
+// expand on the receiver, as CSV. The images are synthetic, not keys made
+// by OpenFHE, so the numbers estimate rather than measure the examples.
+
+#include <getopt.h>
+
+#include <chrono>
+#include <random>
+
+#include <olc_net.h>
+
+// a polynomial in RNS form: nRingDim coefficients in each of nTowers towers
+static std::vector<uint8_t> RandomPoly(std::mt19937_64 &rng, size_t nRingDim,
+                                       size_t nTowers) {
+  std::vector<uint8_t> v(nRingDim * nTowers * sizeof(uint64_t));
+  for (size_t i = 0; i < v.size(); i += sizeof(uint64_t)) {
+    uint64_t w = rng();
+    std::memcpy(v.data() + i, &w, sizeof(w));
+  }
+  return v;
+}
+
+static void Append(std::vector<uint8_t> &out, const std::vector<uint8_t> &v) {
+  out.insert(out.end(), v.begin(), v.end());
+}
+
+static double Ms(std::chrono::steady_clock::time_point t) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - t)
+      .count();
+}
+
+static void RunCase(const char *szName, const std::vector<uint8_t> &ref,
+                    const std::vector<uint8_t> &data, size_t nRepeats) {
+  olc::net::message_body enc, dec;
+  auto t = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < nRepeats; i++) {
+    enc = olc::net::delta_encode(ref, data);
+  }
+  double dEncode = Ms(t) / nRepeats;
+
+  t = std::chrono::steady_clock::now();
+  bool bOk = true;
+  for (size_t i = 0; i < nRepeats; i++) {
+    bOk = olc::net::delta_decode(ref, enc, dec) && bOk;
+  }
+  double dDecode = Ms(t) / nRepeats;
+  if (!bOk || !std::equal(dec.begin(), dec.end(), data.begin(), data.end())) {
+    std::cerr << szName << ": decoded bytes differ" << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+
+  // delta_compress() keeps the plain body when the delta is no smaller
+  size_t nWire = std::min(enc.size(), data.size());
+  std::cout << szName << "," << data.size() << "," << nWire << ","
+            << double(nWire) / double(data.size()) << "," << dEncode << ","
+            << dDecode << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  int opt;
+  size_t nRingDim(16384);
+  size_t nTowers(4);
+  size_t nDigits(3);
+  size_t nRepeats(5);
+
+  while ((opt = getopt(argc, argv, "n:l:k:r:h")) != -1) {
+    switch (opt) {
+    case 'n':
+      nRingDim = atoi(optarg);
+      break;
+    case 'l':
+      nTowers = atoi(optarg);
+      break;
+    case 'k':
+      nDigits = atoi(optarg);
+      break;
+    case 'r':
+      nRepeats = atoi(optarg);
+      break;
+    case 'h':
+    default: /* '?' */
+      std::cerr << "Usage: " << std::endl
+                << "arguments:" << std::endl
+                << "  -n ring dimension (default 16384)" << std::endl
+                << "  -l RNS towers per polynomial (default 4)" << std::endl
+                << "  -k polynomials per eval key vector (default 3)"
+                << std::endl
+                << "  -r repeats to average over (default 5)" << std::endl
+                << "  -h prints this message" << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  std::mt19937_64 rng(42);
+  // crypto context and key tag, identical in both keys
+  std::vector<uint8_t> preamble = RandomPoly(rng, 256, 1);
+
+  std::cout << "object,bytes,wire_bytes,ratio,encode_ms,expand_ms" << std::endl;
+
+  {
+    auto a = RandomPoly(rng, nRingDim, nTowers);
+    std::vector<uint8_t> rnd1, rnd2;
+    Append(rnd1, preamble);
+    Append(rnd1, RandomPoly(rng, nRingDim, nTowers));
+    Append(rnd1, a);
+    Append(rnd2, preamble);
+    Append(rnd2, RandomPoly(rng, nRingDim, nTowers));
+    Append(rnd2, a);
+    RunCase("Rnd2SharedKey", rnd1, rnd2, nRepeats);
+  }
+
+  {
+    std::vector<uint8_t> rnd1, rnd2;
+    Append(rnd1, preamble);
+    Append(rnd2, preamble);
+    for (size_t i = 0; i < nDigits; i++) {
+      auto a = RandomPoly(rng, nRingDim, nTowers);
+      Append(rnd1, a);
+      Append(rnd2, a);
+    }
+    for (size_t i = 0; i < nDigits; i++) {
+      Append(rnd1, RandomPoly(rng, nRingDim, nTowers));
+      Append(rnd2, RandomPoly(rng, nRingDim, nTowers));
+    }
+    RunCase("Rnd2EvalMultAB", rnd1, rnd2, nRepeats);
+  }
+
+  {
+    std::vector<uint8_t> ref, ct;
+    Append(ref, preamble);
+    Append(ref, RandomPoly(rng, nRingDim, nTowers));
+    Append(ref, RandomPoly(rng, nRingDim, nTowers));
+    Append(ct, preamble);
+    Append(ct, RandomPoly(rng, nRingDim, nTowers));
+    Append(ct, RandomPoly(rng, nRingDim, nTowers));
+    RunCase("FreshCiphertext", ref, ct, nRepeats);
+  }
+  return EXIT_SUCCESS;
+}
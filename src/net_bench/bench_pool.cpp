@@ -0,0 +1,184 @@
+// @file bench_pool.cpp - Heap allocations per message in a steady state
+// @author TPOC: contact@openfhe-crypto.org
+//
+// @copyright Copyright (c) 2020, 2023 Duality Technologies Inc.
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution. THIS SOFTWARE IS
+// PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+// IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+// EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// @section DESCRIPTION
+// A client sends messages of one size to a server, which echoes each of
+// them back. After a warm up round, every call to the global operator new
+// in the process is counted while a second round runs, and divided by the
+// number of messages; the body_pool counters show where the bodies came
+// from. The whole round trip is covered: reading the message on the server,
+// queuing it for OnMessage, sending the echo, and the same on the client.
+
+#include <getopt.h>
+
+#include <cstdlib>
+#include <new>
+
+#include <olc_net.h>
+
+static std::atomic<uint64_t> g_nHeapAllocs{0};
+
+// noinline keeps the compiler from pairing an inlined new with free()
+__attribute__((noinline)) void *operator new(size_t nBytes) {
+  g_nHeapAllocs.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(nBytes ? nBytes : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+  std::free(p);
+}
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept {
+  std::free(p);
+}
+
+enum class BenchMsgTypes : uint32_t {
+  ServerAccept,
+  Echo,
+};
+
+class BenchServer : public olc::net::server_interface<BenchMsgTypes> {
+public:
+  BenchServer(uint16_t nPort)
+      : olc::net::server_interface<BenchMsgTypes>(nPort) {}
+
+  // messages echoed so far, Update() runs on the main thread
+  size_t m_nMessages = 0;
+
+protected:
+  virtual bool
+  OnClientConnect(std::shared_ptr<olc::net::connection<BenchMsgTypes>> client) {
+    olc::net::message<BenchMsgTypes> msg;
+    msg.header.id = BenchMsgTypes::ServerAccept;
+    client->Send(msg);
+    return true;
+  }
+
+  virtual void
+  OnMessage(std::shared_ptr<olc::net::connection<BenchMsgTypes>> client,
+            olc::net::message<BenchMsgTypes> &msg) {
+    client->Send(msg);
+    m_nMessages++;
+  }
+};
+
+class BenchClient : public olc::net::client_interface<BenchMsgTypes> {};
+
+// sends nMessages, at most nWindow of them unanswered at a time. Waits
+// for the server while it has messages to echo, for the client otherwise,
+// rather than spin on both.
+static void RunRound(BenchServer &server, BenchClient &client,
+                     const olc::net::message<BenchMsgTypes> &msg,
+                     size_t nMessages, size_t nWindow) {
+  size_t nSent = 0;
+  size_t nEchoed = 0;
+  size_t nHandled = server.m_nMessages;
+  while (nEchoed < nMessages) {
+    while (nSent < nMessages && nSent - nEchoed < nWindow) {
+      client.Send(msg);
+      nSent++;
+    }
+    if (server.m_nMessages - nHandled < nSent) {
+      server.Update(-1, true);
+    } else {
+      client.Incoming().wait();
+    }
+    while (!client.Incoming().empty()) {
+      client.Incoming().pop_front();
+      nEchoed++;
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  int opt;
+  uint16_t port(60126);
+  size_t nWindow(64);
+
+  while ((opt = getopt(argc, argv, "p:w:h")) != -1) {
+    switch (opt) {
+    case 'p':
+      port = atoi(optarg);
+      break;
+    case 'w':
+      nWindow = atoi(optarg);
+      break;
+    case 'h':
+    default: /* '?' */
+      std::cerr << "Usage: " << std::endl
+                << "arguments:" << std::endl
+                << "  -p port to listen on (default 60126)" << std::endl
+                << "  -w messages in flight (default 64)" << std::endl
+                << "  -h prints this message" << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  std::vector<std::pair<size_t, size_t>> cases{
+      {0, 20000}, {64, 20000}, {4096, 20000}, {65536, 4000}, {1 << 20, 400}};
+
+  std::cout << "msg_bytes,messages,heap_allocs_per_msg,pool_allocs_per_msg,"
+               "pool_heap_allocs,pool_reserved_kb"
+            << std::endl;
+
+  for (auto &c : cases) {
+    size_t nBytes = c.first;
+    size_t nMessages = c.second;
+
+    BenchServer server(port);
+    server.Start();
+    BenchClient client;
+    client.Connect("127.0.0.1", port);
+    client.Incoming().wait();
+    client.Incoming().pop_front();
+
+    olc::net::message<BenchMsgTypes> msg;
+    msg.header.id = BenchMsgTypes::Echo;
+    msg.body.resize(nBytes);
+    msg.header.size = msg.size();
+
+    // warm up, so the pool and the queues reach their working size
+    RunRound(server, client, msg, nMessages, nWindow);
+
+    uint64_t nHeapStart = g_nHeapAllocs.load();
+    olc::net::body_pool_stats statsStart =
+        olc::net::body_pool::instance().GetStats();
+    RunRound(server, client, msg, nMessages, nWindow);
+    uint64_t nHeap = g_nHeapAllocs.load() - nHeapStart;
+    olc::net::body_pool_stats stats =
+        olc::net::body_pool::instance().GetStats();
+
+    std::cout << nBytes << "," << nMessages << ","
+              << double(nHeap) / double(nMessages) << ","
+              << double(stats.nAllocs - statsStart.nAllocs) /
+                     double(nMessages)
+              << "," << stats.nHeapAllocs - statsStart.nHeapAllocs << ","
+              << stats.nBytesReserved / 1024 << std::endl;
+
+    client.Disconnect();
+    server.Stop();
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+// @file bench_queue.cpp - Microbenchmark of the olc_net incoming message
+// queues
+// @author TPOC: contact@openfhe-crypto.org
+//
+// @copyright Copyright (c) 2020, 2023 Duality Technologies Inc.
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution. THIS SOFTWARE IS
+// PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+// IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+// EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// @section DESCRIPTION
+// Compares tsqueue (mutex per push/pop) with mpsc_queue (unbounded, lock free,
+// futex blocking) as the incoming queue of a server. N producer threads stand
+// in for connections pushing owned_message objects, the main thread drains
+// the queue the same way server_interface::Update(-1, true) does.
+
+#include <getopt.h>
+
+#include <olc_net.h>
+
+enum class BenchMsgTypes : uint32_t {
+  Ack,
+};
+
+using OwnedMsg = olc::net::owned_message<BenchMsgTypes>;
+
+template <typename Queue>
+double RunOnce(Queue &q, unsigned int nProducers, size_t nMessages) {
+  size_t nPerProducer = nMessages / nProducers;
+  size_t nTotal = nPerProducer * nProducers;
+
+  auto start = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> producers;
+  for (unsigned int p = 0; p < nProducers; p++) {
+    producers.emplace_back([&q, nPerProducer]() {
+      for (size_t i = 0; i < nPerProducer; i++) {
+        OwnedMsg msg;
+        msg.msg.header.id = BenchMsgTypes::Ack;
+        q.push_back(std::move(msg));
+      }
+    });
+  }
+
+  // consumer, same shape as server_interface::Update(-1, true)
+  size_t nReceived = 0;
+  while (nReceived < nTotal) {
+    q.wait();
+    while (!q.empty()) {
+      auto msg = q.pop_front();
+      nReceived++;
+    }
+  }
+
+  auto stop = std::chrono::steady_clock::now();
+  for (auto &t : producers) {
+    t.join();
+  }
+
+  double sec = std::chrono::duration<double>(stop - start).count();
+  return double(nTotal) / sec;
+}
+
+int main(int argc, char *argv[]) {
+  int opt;
+  size_t nMessages(1 << 20);
+  unsigned int nRepeats(3);
+
+  while ((opt = getopt(argc, argv, "n:r:h")) != -1) {
+    switch (opt) {
+    case 'n':
+      nMessages = std::stoul(optarg);
+      break;
+    case 'r':
+      nRepeats = std::stoul(optarg);
+      break;
+    case 'h':
+    default: /* '?' */
+      std::cerr << "Usage: " << std::endl
+                << "arguments:" << std::endl
+                << "  -n messages per run (default 1048576)" << std::endl
+                << "  -r repeats, best run is reported (default 3)"
+                << std::endl
+                << "  -h prints this message" << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  std::cout << "queue,producers,messages,Mmsg_per_sec" << std::endl;
+  for (unsigned int nProducers : {1U, 8U, 64U}) {
+    double best = 0;
+    for (unsigned int r = 0; r < nRepeats; r++) {
+      olc::net::tsqueue<OwnedMsg> q;
+      best = std::max(best, RunOnce(q, nProducers, nMessages));
+    }
+    std::cout << "tsqueue," << nProducers << "," << nMessages << ","
+              << best / 1e6 << std::endl;
+
+    best = 0;
+    for (unsigned int r = 0; r < nRepeats; r++) {
+      olc::net::mpsc_queue<OwnedMsg> q;
+      best = std::max(best, RunOnce(q, nProducers, nMessages));
+    }
+    std::cout << "mpsc_queue," << nProducers << "," << nMessages << ","
+              << best / 1e6 << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,167 @@
+// @file bench_throughput.cpp - Socket throughput of olc_net server_interface
+// against the number of I/O threads
+// @author TPOC: contact@openfhe-crypto.org
+//
+// @copyright Copyright (c) 2020, 2023 Duality Technologies Inc.
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution. THIS SOFTWARE IS
+// PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+// IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+// EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// @section DESCRIPTION
+// Several clients upload large messages (think eval keys) to a server at the
+// same time. The run is repeated with 1 .. N threads running the server's
+// io_context, and reports the aggregate receive rate for each, so the scaling
+// of the I/O thread pool can be seen.
+
+#include <getopt.h>
+
+#include <olc_net.h>
+
+enum class BenchMsgTypes : uint32_t {
+  ServerAccept,
+  Payload,
+};
+
+class BenchServer : public olc::net::server_interface<BenchMsgTypes> {
+public:
+  BenchServer(uint16_t nPort, size_t nThreads)
+      : olc::net::server_interface<BenchMsgTypes>(nPort, nThreads) {}
+
+  size_t m_nMessages = 0;
+  size_t m_nBytes = 0;
+
+protected:
+  virtual bool
+  OnClientConnect(std::shared_ptr<olc::net::connection<BenchMsgTypes>> client) {
+    olc::net::message<BenchMsgTypes> msg;
+    msg.header.id = BenchMsgTypes::ServerAccept;
+    client->Send(msg);
+    return true;
+  }
+
+  virtual void
+  OnMessage(std::shared_ptr<olc::net::connection<BenchMsgTypes>>,
+            olc::net::message<BenchMsgTypes> &msg) {
+    m_nMessages++;
+    m_nBytes += msg.size();
+  }
+};
+
+class BenchClient : public olc::net::client_interface<BenchMsgTypes> {};
+
+double RunOnce(uint16_t port, size_t nThreads, unsigned int nClients,
+               size_t nMessages, size_t nBytes) {
+  BenchServer server(port, nThreads);
+  server.Start();
+
+  std::vector<std::unique_ptr<BenchClient>> clients;
+  for (unsigned int i = 0; i < nClients; i++) {
+    clients.push_back(std::make_unique<BenchClient>());
+    clients.back()->Connect("127.0.0.1", port);
+  }
+
+  // wait until every client has been accepted
+  for (auto &c : clients) {
+    c->Incoming().wait();
+    c->Incoming().pop_front();
+  }
+
+  olc::net::message<BenchMsgTypes> msg;
+  msg.header.id = BenchMsgTypes::Payload;
+  msg.body.resize(nBytes);
+  msg.header.size = msg.size();
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t m = 0; m < nMessages; m++) {
+    for (auto &c : clients) {
+      c->Send(msg);
+    }
+  }
+
+  size_t nExpected = nMessages * nClients;
+  while (server.m_nMessages < nExpected) {
+    server.Update(-1, true);
+  }
+  auto stop = std::chrono::steady_clock::now();
+
+  for (auto &c : clients) {
+    c->Disconnect();
+  }
+  server.Stop();
+
+  double sec = std::chrono::duration<double>(stop - start).count();
+  return double(server.m_nBytes) / sec;
+}
+
+int main(int argc, char *argv[]) {
+  int opt;
+  uint16_t port(60123);
+  size_t nMaxThreads(std::max(1U, std::thread::hardware_concurrency()));
+  unsigned int nClients(8);
+  size_t nMessages(64);
+  size_t nBytes(1 << 20);
+
+  while ((opt = getopt(argc, argv, "p:t:c:m:s:h")) != -1) {
+    switch (opt) {
+    case 'p':
+      port = atoi(optarg);
+      break;
+    case 't':
+      nMaxThreads = std::stoul(optarg);
+      break;
+    case 'c':
+      nClients = std::stoul(optarg);
+      break;
+    case 'm':
+      nMessages = std::stoul(optarg);
+      break;
+    case 's':
+      nBytes = std::stoul(optarg);
+      break;
+    case 'h':
+    default: /* '?' */
+      std::cerr << "Usage: " << std::endl
+                << "arguments:" << std::endl
+                << "  -p port to listen on (default 60123)" << std::endl
+                << "  -t largest number of server I/O threads (default: "
+                   "number of cores)"
+                << std::endl
+                << "  -c number of clients (default 8)" << std::endl
+                << "  -m messages per client (default 64)" << std::endl
+                << "  -s bytes per message (default 1048576)" << std::endl
+                << "  -h prints this message" << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  std::vector<std::pair<size_t, double>> results;
+  for (size_t nThreads = 1; nThreads <= nMaxThreads; nThreads *= 2) {
+    results.emplace_back(
+        nThreads, RunOnce(port, nThreads, nClients, nMessages, nBytes));
+    if (nThreads < nMaxThreads && nThreads * 2 > nMaxThreads) {
+      nThreads = nMaxThreads / 2; // always finish on nMaxThreads
+    }
+  }
+
+  std::cout << "io_threads,clients,msg_bytes,MB_per_sec" << std::endl;
+  for (auto &r : results) {
+    std::cout << r.first << "," << nClients << "," << nBytes << ","
+              << r.second / (1 << 20) << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
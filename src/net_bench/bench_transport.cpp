@@ -0,0 +1,225 @@
+// @file bench_transport.cpp - Latency and throughput of the TCP, Unix socket
+// and shared memory transports
+// @author TPOC: contact@openfhe-crypto.org
+//
+// @copyright Copyright (c) 2020, 2023 Duality Technologies Inc.
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution. THIS SOFTWARE IS
+// PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+// IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+// EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// @section DESCRIPTION
+// A client on the same machine talks to a server in another process over
+// each transport in turn, with the message sizes the PRE demo moves around.
+// Latency is the median round trip of one message echoed back by the
+// server, throughput is the rate at which a stream of messages is taken in
+// by the server, counted once the server has echoed a final ping sent
+// after them.
+
+#include <getopt.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include <olc_net.h>
+
+enum class BenchMsgTypes : uint32_t {
+  ServerAccept,
+  Ping,
+  Payload,
+};
+
+class BenchServer : public olc::net::server_interface<BenchMsgTypes> {
+public:
+  BenchServer(uint16_t nPort)
+      : olc::net::server_interface<BenchMsgTypes>(nPort) {}
+
+protected:
+  virtual bool
+  OnClientConnect(std::shared_ptr<olc::net::connection<BenchMsgTypes>> client) {
+    olc::net::message<BenchMsgTypes> msg;
+    msg.header.id = BenchMsgTypes::ServerAccept;
+    client->Send(msg);
+    return true;
+  }
+
+  virtual void
+  OnMessage(std::shared_ptr<olc::net::connection<BenchMsgTypes>> client,
+            olc::net::message<BenchMsgTypes> &msg) {
+    if (msg.header.id == BenchMsgTypes::Ping) {
+      client->SendWait(std::move(msg));
+    }
+  }
+};
+
+class BenchClient : public olc::net::client_interface<BenchMsgTypes> {};
+
+// runs the server until killed, says when it is listening
+static void RunServer(uint16_t port, const std::string &sUnix,
+                      const std::string &sShm, int fdReady) {
+  BenchServer server(port);
+  if (!server.Listen("unix:" + sUnix) || !server.Listen("shm:" + sShm) ||
+      !server.Start()) {
+    std::exit(EXIT_FAILURE);
+  }
+  if (write(fdReady, "x", 1) != 1) {
+    std::exit(EXIT_FAILURE);
+  }
+  while (1) {
+    server.Update(-1, true);
+  }
+}
+
+static olc::net::message<BenchMsgTypes> Recv(BenchClient &client) {
+  client.Incoming().wait();
+  return client.Incoming().pop_front().msg;
+}
+
+// median round trip in microseconds
+static double Latency(BenchClient &client, size_t nBytes, size_t nRounds) {
+  olc::net::message<BenchMsgTypes> msg;
+  msg.header.id = BenchMsgTypes::Ping;
+  msg.body.resize(nBytes);
+  msg.header.size = msg.size();
+
+  std::vector<double> vTimes;
+  for (size_t i = 0; i < nRounds; i++) {
+    auto start = std::chrono::steady_clock::now();
+    client.Send(msg);
+    Recv(client);
+    auto stop = std::chrono::steady_clock::now();
+    vTimes.push_back(std::chrono::duration<double, std::micro>(stop - start)
+                         .count());
+  }
+  std::sort(vTimes.begin(), vTimes.end());
+  return vTimes[vTimes.size() / 2];
+}
+
+// MB per second taken in by the server
+static double Throughput(BenchClient &client, size_t nBytes,
+                         size_t nTotalBytes) {
+  olc::net::shared_message<BenchMsgTypes> msg([&] {
+    olc::net::message<BenchMsgTypes> m;
+    m.header.id = BenchMsgTypes::Payload;
+    m.body.resize(nBytes);
+    m.header.size = m.size();
+    return m;
+  }());
+  olc::net::message<BenchMsgTypes> ping;
+  ping.header.id = BenchMsgTypes::Ping;
+
+  size_t nMessages = std::max<size_t>(1, nTotalBytes / nBytes);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < nMessages; i++) {
+    client.Send(msg);
+  }
+  client.Send(ping);
+  Recv(client);
+  auto stop = std::chrono::steady_clock::now();
+
+  double sec = std::chrono::duration<double>(stop - start).count();
+  return double(nMessages * nBytes) / sec / (1 << 20);
+}
+
+int main(int argc, char *argv[]) {
+  int opt;
+  uint16_t port(60123);
+  size_t nRounds(200);
+  size_t nTotalMB(256);
+  std::vector<size_t> vSizes{1 << 10, 256 << 10, 1 << 20};
+
+  while ((opt = getopt(argc, argv, "p:r:m:s:h")) != -1) {
+    switch (opt) {
+    case 'p':
+      port = atoi(optarg);
+      break;
+    case 'r':
+      nRounds = std::stoul(optarg);
+      break;
+    case 'm':
+      nTotalMB = std::stoul(optarg);
+      break;
+    case 's':
+      vSizes = {std::stoul(optarg)};
+      break;
+    case 'h':
+    default: /* '?' */
+      std::cerr << "Usage: " << std::endl
+                << "arguments:" << std::endl
+                << "  -p port to listen on (default 60123)" << std::endl
+                << "  -r round trips timed per size (default 200)"
+                << std::endl
+                << "  -m MB streamed per size (default 256)" << std::endl
+                << "  -s bytes per message (default 1 KB, 256 KB and 1 MB)"
+                << std::endl
+                << "  -h prints this message" << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  std::string sBase = "/tmp/bench_transport." + std::to_string(getpid());
+  std::string sUnix = sBase + ".sock";
+  std::string sShm = sBase + ".shm";
+
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return EXIT_FAILURE;
+  }
+
+  // fork before any threads are started here
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    RunServer(port, sUnix, sShm, fds[1]);
+  }
+  close(fds[1]);
+  char c;
+  if (read(fds[0], &c, 1) != 1) {
+    return EXIT_FAILURE;
+  }
+
+  std::vector<std::string> vAddresses{"127.0.0.1", "unix:" + sUnix,
+                                      "shm:" + sShm};
+  std::vector<std::string> vNames{"tcp", "unix", "shm"};
+
+  std::cout << "transport,msg_bytes,latency_us,MB_per_sec" << std::endl;
+  for (size_t t = 0; t < vAddresses.size(); t++) {
+    BenchClient client;
+    if (!client.Connect(vAddresses[t], port)) {
+      kill(pid, SIGTERM);
+      return EXIT_FAILURE;
+    }
+    Recv(client);
+
+    for (size_t nBytes : vSizes) {
+      double us = Latency(client, nBytes, nRounds);
+      double mbs = Throughput(client, nBytes, nTotalMB << 20);
+      std::cout << vNames[t] << "," << nBytes << "," << us << "," << mbs
+                << std::endl;
+    }
+    client.Disconnect();
+  }
+
+  kill(pid, SIGTERM);
+  waitpid(pid, nullptr, 0);
+  unlink(sUnix.c_str());
+  unlink(sShm.c_str());
+  return EXIT_SUCCESS;
+}
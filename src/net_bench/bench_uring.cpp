@@ -0,0 +1,300 @@
+// @file bench_uring.cpp - The io_uring backend against asio's reactor for
+// large key uploads and small acks
+// @author TPOC: contact@openfhe-crypto.org
+//
+// @copyright Copyright (c) 2020, 2023 Duality Technologies Inc.
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution. THIS SOFTWARE IS
+// PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+// IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+// EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// @section DESCRIPTION
+// A client talks to a server in another process over TCP and a Unix
+// socket, first with both ends on asio's reactor and then with both on the
+// io_uring backend. Two kinds of traffic are timed: large messages the size
+// of an eval key sent one after another, each acked by the server, and
+// small messages echoed back one at a time, the shape of the acks and
+// requests the demos exchange. CPU is what the client and the server
+// together spent, per message.
+
+#include <getopt.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+#include <olc_net.h>
+
+enum class BenchMsgTypes : uint32_t {
+  ServerAccept,
+  Ping,
+  Payload,
+  Ack,
+};
+
+class BenchServer : public olc::net::server_interface<BenchMsgTypes> {
+public:
+  BenchServer(uint16_t nPort)
+      : olc::net::server_interface<BenchMsgTypes>(nPort) {}
+
+protected:
+  virtual bool
+  OnClientConnect(std::shared_ptr<olc::net::connection<BenchMsgTypes>> client) {
+    olc::net::message<BenchMsgTypes> msg;
+    msg.header.id = BenchMsgTypes::ServerAccept;
+    client->Send(msg);
+    return true;
+  }
+
+  virtual void
+  OnMessage(std::shared_ptr<olc::net::connection<BenchMsgTypes>> client,
+            olc::net::message<BenchMsgTypes> &msg) {
+    if (msg.header.id == BenchMsgTypes::Ping) {
+      client->SendWait(std::move(msg));
+    } else if (msg.header.id == BenchMsgTypes::Payload) {
+      olc::net::message<BenchMsgTypes> ack;
+      ack.header.id = BenchMsgTypes::Ack;
+      client->Send(ack);
+    }
+  }
+};
+
+class BenchClient : public olc::net::client_interface<BenchMsgTypes> {
+public:
+  // reads and writes the ring has done, through fixed buffers or not
+  void UringStats(uint64_t &nFixed, uint64_t &nPlain) const {
+    nFixed = nPlain = 0;
+    if (m_pUring) {
+      m_pUring->GetStats(nFixed, nPlain);
+    }
+  }
+};
+
+// runs the server until killed, says when it is listening
+static void RunServer(uint16_t port, const std::string &sUnix, bool bUring,
+                      int fdReady) {
+  BenchServer server(port);
+  if (bUring && !server.EnableIoUring()) {
+    std::exit(EXIT_FAILURE);
+  }
+  if (!server.Listen("unix:" + sUnix) || !server.Start()) {
+    std::exit(EXIT_FAILURE);
+  }
+  if (write(fdReady, "x", 1) != 1) {
+    std::exit(EXIT_FAILURE);
+  }
+  while (1) {
+    server.Update(-1, true);
+  }
+}
+
+static olc::net::message<BenchMsgTypes> Recv(BenchClient &client) {
+  client.Incoming().wait();
+  return client.Incoming().pop_front().msg;
+}
+
+// user and system time of this process so far, in seconds
+static double SelfCpu() {
+  rusage ru{};
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec +
+         (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+// the same for another process, from /proc
+static double ProcCpu(pid_t pid) {
+  std::ifstream f("/proc/" + std::to_string(pid) + "/stat");
+  std::string s((std::istreambuf_iterator<char>(f)),
+                std::istreambuf_iterator<char>());
+  // the fields after the command name, which may hold spaces
+  std::istringstream is(s.substr(s.rfind(')') + 2));
+  std::string sField;
+  unsigned long nUser(0), nSys(0);
+  for (int i = 3; i <= 15 && is >> sField; i++) {
+    if (i == 14) {
+      nUser = std::stoul(sField);
+    } else if (i == 15) {
+      nSys = std::stoul(sField);
+    }
+  }
+  return double(nUser + nSys) / sysconf(_SC_CLK_TCK);
+}
+
+struct Result {
+  size_t nMessages = 0;
+  double sec = 0;
+  double cpu = 0;
+};
+
+// nMessages of nBytes sent back to back, done once every one is acked
+static Result Upload(BenchClient &client, pid_t pid, size_t nBytes,
+                     size_t nMessages) {
+  olc::net::shared_message<BenchMsgTypes> msg([&] {
+    olc::net::message<BenchMsgTypes> m;
+    m.header.id = BenchMsgTypes::Payload;
+    m.body.resize(nBytes);
+    m.header.size = m.size();
+    return m;
+  }());
+
+  Result r;
+  r.nMessages = nMessages;
+  double cpu0 = SelfCpu() + ProcCpu(pid);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < nMessages; i++) {
+    client.Send(msg);
+  }
+  for (size_t i = 0; i < nMessages; i++) {
+    Recv(client);
+  }
+  auto stop = std::chrono::steady_clock::now();
+  r.sec = std::chrono::duration<double>(stop - start).count();
+  r.cpu = SelfCpu() + ProcCpu(pid) - cpu0;
+  return r;
+}
+
+// nMessages of nBytes, each echoed back before the next is sent
+static Result PingPong(BenchClient &client, pid_t pid, size_t nBytes,
+                       size_t nMessages) {
+  olc::net::message<BenchMsgTypes> msg;
+  msg.header.id = BenchMsgTypes::Ping;
+  msg.body.resize(nBytes);
+  msg.header.size = msg.size();
+
+  Result r;
+  r.nMessages = nMessages;
+  double cpu0 = SelfCpu() + ProcCpu(pid);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < nMessages; i++) {
+    client.Send(msg);
+    Recv(client);
+  }
+  auto stop = std::chrono::steady_clock::now();
+  r.sec = std::chrono::duration<double>(stop - start).count();
+  r.cpu = SelfCpu() + ProcCpu(pid) - cpu0;
+  return r;
+}
+
+int main(int argc, char *argv[]) {
+  int opt;
+  uint16_t port(60133);
+  size_t nLarge(4 << 20);
+  size_t nLargeCount(128);
+  size_t nSmall(64);
+  size_t nSmallCount(20000);
+
+  while ((opt = getopt(argc, argv, "p:l:n:s:r:h")) != -1) {
+    switch (opt) {
+    case 'p':
+      port = atoi(optarg);
+      break;
+    case 'l':
+      nLarge = std::stoul(optarg);
+      break;
+    case 'n':
+      nLargeCount = std::stoul(optarg);
+      break;
+    case 's':
+      nSmall = std::stoul(optarg);
+      break;
+    case 'r':
+      nSmallCount = std::stoul(optarg);
+      break;
+    case 'h':
+    default: /* '?' */
+      std::cerr << "Usage: " << std::endl
+                << "arguments:" << std::endl
+                << "  -p first port to listen on (default 60133)" << std::endl
+                << "  -l bytes per large message (default 4 MB)" << std::endl
+                << "  -n large messages sent per run (default 128)"
+                << std::endl
+                << "  -s bytes per small message (default 64)" << std::endl
+                << "  -r small round trips per run (default 20000)"
+                << std::endl
+                << "  -h prints this message" << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  std::cout << "backend,transport,traffic,msg_bytes,msgs_per_sec,MB_per_sec,"
+               "cpu_us_per_msg,fixed_ops,plain_ops"
+            << std::endl;
+  for (bool bUring : {false, true}) {
+    std::string sUnix = "/tmp/bench_uring." + std::to_string(getpid()) +
+                        (bUring ? ".uring" : ".reactor") + ".sock";
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+      return EXIT_FAILURE;
+    }
+
+    // fork before any threads are started here, the clients of the
+    // previous pass have all been joined
+    pid_t pid = fork();
+    if (pid == 0) {
+      close(fds[0]);
+      RunServer(port, sUnix, bUring, fds[1]);
+    }
+    close(fds[1]);
+    char c;
+    if (read(fds[0], &c, 1) != 1) {
+      std::cerr << (bUring ? "io_uring" : "reactor")
+                << " server did not start" << std::endl;
+      waitpid(pid, nullptr, 0);
+      return EXIT_FAILURE;
+    }
+    close(fds[0]);
+
+    std::vector<std::string> vAddresses{"127.0.0.1", "unix:" + sUnix};
+    std::vector<std::string> vNames{"tcp", "unix"};
+    for (size_t t = 0; t < vAddresses.size(); t++) {
+      BenchClient client;
+      if ((bUring && !client.EnableIoUring()) ||
+          !client.Connect(vAddresses[t], port)) {
+        kill(pid, SIGTERM);
+        return EXIT_FAILURE;
+      }
+      Recv(client);
+
+      for (bool bLarge : {true, false}) {
+        size_t nBytes = bLarge ? nLarge : nSmall;
+        uint64_t nFixed0, nPlain0, nFixed1, nPlain1;
+        client.UringStats(nFixed0, nPlain0);
+        Result r = bLarge ? Upload(client, pid, nBytes, nLargeCount)
+                          : PingPong(client, pid, nBytes, nSmallCount);
+        client.UringStats(nFixed1, nPlain1);
+
+        std::cout << (bUring ? "io_uring" : "reactor") << "," << vNames[t]
+                  << "," << (bLarge ? "upload" : "pingpong") << "," << nBytes
+                  << "," << r.nMessages / r.sec << ","
+                  << double(r.nMessages * nBytes) / r.sec / (1 << 20) << ","
+                  << r.cpu * 1e6 / r.nMessages << "," << nFixed1 - nFixed0
+                  << "," << nPlain1 - nPlain0 << std::endl;
+      }
+      client.Disconnect();
+    }
+
+    kill(pid, SIGTERM);
+    waitpid(pid, nullptr, 0);
+    unlink(sUnix.c_str());
+  }
+  return EXIT_SUCCESS;
+}
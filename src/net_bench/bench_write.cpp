@@ -0,0 +1,133 @@
+// @file bench_write.cpp - Socket writes per message sent by olc_net
+// @author TPOC: contact@openfhe-crypto.org
+//
+// @copyright Copyright (c) 2020, 2023 Duality Technologies Inc.
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution. THIS SOFTWARE IS
+// PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+// IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+// EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// @section DESCRIPTION
+// A client sends a burst of messages of one size to a server, and the
+// connection's counters report how many write_some() calls, i.e. sendmsg()
+// syscalls, that took per message. For comparison it also prints what the
+// previous write path would have needed: one write for the header and one
+// for each 64 KB of body, for every message.
+
+#include <getopt.h>
+
+#include <olc_net.h>
+
+enum class BenchMsgTypes : uint32_t {
+  ServerAccept,
+  Payload,
+};
+
+class BenchServer : public olc::net::server_interface<BenchMsgTypes> {
+public:
+  BenchServer(uint16_t nPort)
+      : olc::net::server_interface<BenchMsgTypes>(nPort) {}
+
+  size_t m_nMessages = 0;
+
+protected:
+  virtual bool
+  OnClientConnect(std::shared_ptr<olc::net::connection<BenchMsgTypes>> client) {
+    olc::net::message<BenchMsgTypes> msg;
+    msg.header.id = BenchMsgTypes::ServerAccept;
+    client->Send(msg);
+    return true;
+  }
+
+  virtual void
+  OnMessage(std::shared_ptr<olc::net::connection<BenchMsgTypes>>,
+            olc::net::message<BenchMsgTypes> &) {
+    m_nMessages++;
+  }
+};
+
+class BenchClient : public olc::net::client_interface<BenchMsgTypes> {
+public:
+  const olc::net::connection_stats &GetStats() const {
+    return m_connection->GetStats();
+  }
+};
+
+int main(int argc, char *argv[]) {
+  int opt;
+  uint16_t port(60124);
+
+  while ((opt = getopt(argc, argv, "p:h")) != -1) {
+    switch (opt) {
+    case 'p':
+      port = atoi(optarg);
+      break;
+    case 'h':
+    default: /* '?' */
+      std::cerr << "Usage: " << std::endl
+                << "arguments:" << std::endl
+                << "  -p port to listen on (default 60124)" << std::endl
+                << "  -h prints this message" << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  // message body size and number of messages in the burst: acks and nacks,
+  // small vectors, ciphertexts and eval keys
+  std::vector<std::pair<size_t, size_t>> cases{
+      {0, 10000}, {64, 10000}, {4096, 4096}, {65536, 1024}, {1 << 20, 64}};
+
+  std::cout << "msg_bytes,messages,write_calls,writes_per_msg,"
+               "legacy_writes_per_msg"
+            << std::endl;
+
+  for (auto &c : cases) {
+    size_t nBytes = c.first;
+    size_t nMessages = c.second;
+
+    BenchServer server(port);
+    server.Start();
+    BenchClient client;
+    client.Connect("127.0.0.1", port);
+    client.Incoming().wait();
+    client.Incoming().pop_front();
+
+    olc::net::message<BenchMsgTypes> msg;
+    msg.header.id = BenchMsgTypes::Payload;
+    msg.body.resize(nBytes);
+    msg.header.size = msg.size();
+    for (size_t i = 0; i < nMessages; i++) {
+      client.Send(msg);
+    }
+    while (server.m_nMessages < nMessages) {
+      server.Update(-1, true);
+    }
+
+    uint64_t nWrites = client.GetStats().nWriteCalls;
+    uint64_t nSent = client.GetStats().nMessagesSent;
+    // header, then the body in 64 KB pieces
+    size_t nLegacy = 1 + (nBytes + 65535) / 65536;
+
+    std::cout << nBytes << "," << nSent << "," << nWrites << ","
+              << double(nWrites) / double(nSent) << "," << nLegacy
+              << std::endl;
+
+    client.Disconnect();
+    server.Stop();
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,118 @@
+/*
+	Bounded queue of message chunks
+
+	A message sent with message_chunk_ostream arrives as a run of fixed size
+	chunks. The receiving connection hands the message to its owner as soon
+	as the first chunk is in, and keeps pushing the chunks that follow into
+	one of these. The handler reads them through message_istream while they
+	are still arriving, so neither side ever holds the whole object.
+
+	When the queue is full the connection stops reading from the socket and
+	leaves a resume function behind, which the reader calls once it has
+	made room. That keeps the memory used per message down to a few chunks
+	however large the object is.
+
+	Based on the asio connection objects from olc_net thanks to
+	David Barr, aka javidx9, (c)OneLoneCoder 2019, 2020
+*/
+
+#pragma once
+
+#include <condition_variable>
+
+#include "net_common.h"
+#include "net_pool.h"
+
+namespace olc
+{
+	namespace net
+	{
+		// Size of the chunks message_chunk_ostream sends unless told otherwise
+		constexpr size_t default_chunk_size = 1 << 20;
+
+		class chunk_queue
+		{
+		public:
+			explicit chunk_queue(size_t nMaxChunks = 4)
+				: m_nMaxChunks(std::max<size_t>(nMaxChunks, 1))
+			{}
+
+			chunk_queue(const chunk_queue&) = delete;
+
+			// The message was dropped before it was read to the end. If reading
+			// was paused on our account, the connection still needs setting off.
+			virtual ~chunk_queue()
+			{
+				if (m_fnResume)
+					m_fnResume();
+			}
+
+		public:
+			// Producer side, called on the connection's strand. Returns false when
+			// the queue is now full, in which case fnResume is called, from the
+			// reader's thread, once there is room again.
+			bool push(message_body&& chunk, bool bLast, std::function<void()> fnResume)
+			{
+				std::scoped_lock lock(m_mux);
+				m_deqChunks.push_back(std::move(chunk));
+				m_bLast = bLast;
+				m_cv.notify_one();
+
+				if (bLast || m_deqChunks.size() < m_nMaxChunks)
+					return true;
+
+				m_fnResume = std::move(fnResume);
+				return false;
+			}
+
+			// Consumer side. Waits for the next chunk, returns false at the end of
+			// the message, or when the connection went away part way through.
+			bool pop(message_body& chunk)
+			{
+				std::function<void()> fnResume;
+				{
+					std::unique_lock<std::mutex> ul(m_mux);
+					m_cv.wait(ul, [this]() { return !m_deqChunks.empty() || m_bLast || m_bClosed; });
+					if (m_deqChunks.empty())
+						return false;
+
+					chunk = std::move(m_deqChunks.front());
+					m_deqChunks.pop_front();
+					fnResume = std::move(m_fnResume);
+					m_fnResume = nullptr;
+				}
+
+				// Let the connection carry on reading
+				if (fnResume)
+					fnResume();
+				return true;
+			}
+
+			// The connection has failed or is being destroyed. Wakes the reader,
+			// who sees the message end early.
+			void close()
+			{
+				std::scoped_lock lock(m_mux);
+				m_bClosed = true;
+				m_fnResume = nullptr;
+				m_cv.notify_all();
+			}
+
+			// True if the message was cut short
+			bool failed() const
+			{
+				std::scoped_lock lock(m_mux);
+				return m_bClosed && !m_bLast;
+			}
+
+		private:
+			mutable std::mutex m_mux;
+			std::condition_variable m_cv;
+			std::deque<message_body> m_deqChunks;
+			size_t m_nMaxChunks;
+			bool m_bLast = false;
+			bool m_bClosed = false;
+			std::function<void()> m_fnResume;
+		};
+	}
+}
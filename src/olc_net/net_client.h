@@ -61,11 +61,23 @@ namespace olc
 {
 	namespace net
 	{
-		template <typename T>
+		// QueueIn is the type of the incoming message queue, see server_interface
+		template <typename T, typename QueueIn = tsqueue<owned_message<T>>>
 		class client_interface
 		{
+		public:
+			// Takes the reply to a request, see Request()
+			using reply_handler = std::function<void(message<T>&&)>;
+
 		public:
 			client_interface() 
+				: m_pOwnContext(std::make_unique<boost::asio::io_context>()), m_context(*m_pOwnContext)
+			{}
+
+			// A client that does its I/O on runtime's threads rather than a
+			// thread of its own, see client_runtime. runtime must outlive it.
+			explicit client_interface(client_runtime& runtime)
+				: m_context(runtime.GetContext()), m_pUring(runtime.GetUring())
 			{}
 
 			virtual ~client_interface()
@@ -75,23 +87,60 @@ namespace olc
 			}
 
 		public:
-			// Connect to server with hostname/ip-address and port
+			// Moves the connection's reads and writes from asio's reactor to an
+			// io_uring, see net_uring.h. Call before Connect(). Returns false,
+			// and leaves things as they were, if the kernel won't give us one.
+			// A client on a client_runtime gets the runtime's ring, if it has
+			// one, without calling this.
+			bool EnableIoUring()
+			{
+				m_pUring = uring_backend::create(m_context);
+				return m_pUring != nullptr;
+			}
+
+			// Connect to server with hostname/ip-address and port. A host of
+			// "unix:<path>" or "shm:<path>" connects to a server on this machine
+			// listening there instead, see server_interface::Listen(), and the
+			// port is ignored.
 			bool Connect(const std::string& host, const uint16_t port)
 			{
 				try
 				{
-					// Resolve hostname/ip-address into tangiable physical address
-					boost::asio::ip::tcp::resolver resolver(m_context);
-					boost::asio::ip::tcp::resolver::results_type endpoints = resolver.resolve(host, std::to_string(port));
+					std::string sPath;
+					transport t = parse_address(host, sPath);
+					if (t != transport::tcp)
+					{
+						// Local connections are made here and now
+						connection_stream stream = connect_local(m_context, t, sPath);
+						stream.use_uring(m_pUring);
+						m_connection = std::make_shared<connection<T>>(connection<T>::owner::client, m_context, std::move(stream), m_router);
+						m_connection->SetOnClosed([this]() { DropPendingRequests(); });
+						m_connection->StartListening();
+					}
+					else
+					{
+						// Resolve hostname/ip-address into tangiable physical address
+						boost::asio::ip::tcp::resolver resolver(m_context);
+						boost::asio::ip::tcp::resolver::results_type endpoints = resolver.resolve(host, std::to_string(port));
 
-					// Create connection
-					m_connection = std::make_unique<connection<T>>(connection<T>::owner::client, m_context, boost::asio::ip::tcp::socket(m_context), m_qMessagesIn);
+						// Create connection
+						connection_socket socket(boost::asio::make_strand(m_context));
+						connection_stream stream(std::move(socket));
+						stream.use_uring(m_pUring);
+						m_connection = std::make_shared<connection<T>>(connection<T>::owner::client, m_context, std::move(stream), m_router);
+						m_connection->SetOnClosed([this]() { DropPendingRequests(); });
 					
-					// Tell the connection object to connect to server
-					m_connection->ConnectToServer(endpoints);
+						// Tell the connection object to connect to server
+						m_connection->ConnectToServer(endpoints);
+					}
 
-					// Start Context Thread
-					thrContext = std::thread([this]() { m_context.run(); });
+					// Start Context Thread, unless a runtime's threads run it. It
+					// runs until Disconnect(), even if the connection drops.
+					if (m_pOwnContext)
+					{
+						m_work.emplace(boost::asio::make_work_guard(m_context));
+						thrContext = std::thread([this]() { m_context.run(); });
+					}
 				}
 				catch (std::exception& e)
 				{
@@ -104,21 +153,27 @@ namespace olc
 			// Disconnect from server
 			void Disconnect()
 			{
-				// If connection exists, and it's connected then...
-				if(IsConnected())
+				// If connection exists then close it, and wait until it will
+				// no longer call back into this client
+				if (m_connection)
+					m_connection->DisconnectWait();
+
+				// Done with the asio context too, if it is ours...
+				if (m_pOwnContext)
 				{
-					// ...disconnect from server gracefully
-					m_connection->Disconnect();
+					m_work.reset();
+					m_context.stop();
+					// ...and its thread
+					if (thrContext.joinable())
+						thrContext.join();
 				}
 
-				// Either way, we're also done with the asio context...				
-				m_context.stop();
-				// ...and its thread
-				if (thrContext.joinable())
-					thrContext.join();
+				// Let go of the connection object, handlers still queued for it
+				// keep it alive until they have run
+				m_connection.reset();
 
-				// Destroy the connection object
-				m_connection.release();
+				// No more replies will come
+				DropPendingRequests();
 			}
 
 			// Check if client is actually connected to a server
@@ -131,30 +186,165 @@ namespace olc
 			}
 
 		public:
-			// Send message to server
-			void Send(const message<T>& msg)
+			// Send message to server, returns false if it was not queued
+			bool Send(const message<T>& msg)
+			{
+				return IsConnected() && m_connection->Send(msg);
+			}
+
+			// As above, the body is shared rather than copied
+			bool Send(const shared_message<T>& msg)
 			{
-				if (IsConnected())
-					 m_connection->Send(msg);
+				return IsConnected() && m_connection->Send(msg);
+			}
+
+			// Sends msg as a request, numbered in header.correlation so the
+			// server's reply, which carries the number back, can be told apart
+			// from the replies to other requests. Any number of requests may be
+			// out at once, and their replies may come back in any order.
+			//
+			// Without fnOnReply the reply arrives in Incoming() like any other
+			// message. With it the reply is handed to fnOnReply instead, on the
+			// client's I/O thread, so it must be quick and must not wait for
+			// more from the server, such as the rest of a chunked message.
+			// Fulfilling a promise or queuing the message is about right.
+			//
+			// Returns the request's number, or 0 if it was not sent.
+			uint32_t Request(message<T> msg, reply_handler fnOnReply = nullptr)
+			{
+				return Request(shared_message<T>(std::move(msg)), std::move(fnOnReply));
+			}
+
+			// As above, with a body that can be sent again, in this request or
+			// others, without being copied. Only the header is numbered.
+			uint32_t Request(shared_message<T> msg, reply_handler fnOnReply = nullptr)
+			{
+				if (!IsConnected())
+					return 0;
+
+				// Numbers run on past 0, which is for messages that aren't requests
+				uint32_t nCorrelation;
+				do
+					nCorrelation = m_nNextCorrelation.fetch_add(1, std::memory_order_relaxed);
+				while (nCorrelation == 0);
+
+				msg.header.correlation = nCorrelation;
+				{
+					std::scoped_lock lock(m_muxPending);
+					m_mapPending.emplace(nCorrelation, std::move(fnOnReply));
+				}
+
+				if (!m_connection->Send(std::move(msg)))
+				{
+					std::scoped_lock lock(m_muxPending);
+					m_mapPending.erase(nCorrelation);
+					return 0;
+				}
+				return nCorrelation;
+			}
+
+			// As Request(), but the reply is delivered through the future
+			// returned, so a client can be written as a straight run of steps
+			// that each wait for their reply, e.g.
+			//
+			//		olc::net::message<PreMsgTypes> msg;
+			//		msg.header.id = PreMsgTypes::RequestCC;
+			//		auto reply = client.RequestAsync(msg).get();
+			//
+			// get() returns as soon as the reply is in, and throws if the
+			// request could not be sent or the connection closed first. Other
+			// messages from the server still arrive in Incoming().
+			std::future<message<T>> RequestAsync(message<T> msg)
+			{
+				// The handler has to be copyable, the promise is not
+				auto pPromise = std::make_shared<std::promise<message<T>>>();
+				std::future<message<T>> f = pPromise->get_future();
+				if (Request(std::move(msg), [pPromise](message<T>&& reply) { pPromise->set_value(std::move(reply)); }) == 0)
+					pPromise->set_exception(std::make_exception_ptr(std::runtime_error("request not sent")));
+				return f;
+			}
+
+			// Requests sent that have not had their reply yet
+			size_t GetPendingRequests()
+			{
+				std::scoped_lock lock(m_muxPending);
+				return m_mapPending.size();
 			}
 
 			// Retrieve queue of messages from server
-			tsqueue<owned_message<T>>& Incoming()
+			QueueIn& Incoming()
 			{ 
 				return m_qMessagesIn;
 			}
 
 		protected:
-			// asio context handles the data transfer...
-			boost::asio::io_context m_context;
-			// ...but needs a thread of its own to execute its work commands
+			// asio context handles the data transfer, our own or a runtime's...
+			std::unique_ptr<boost::asio::io_context> m_pOwnContext;
+			boost::asio::io_context& m_context;
+			// ...through an io_uring if EnableIoUring() was called
+			std::shared_ptr<uring_backend> m_pUring;
+			// ...but needs a thread of its own to execute its work commands,
+			// kept busy between Connect() and Disconnect()
 			std::thread thrContext;
+			std::optional<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> m_work;
 			// The client has a single instance of a "connection" object, which handles data transfer
-			std::unique_ptr<connection<T>> m_connection;
+			std::shared_ptr<connection<T>> m_connection;
 			
+		private:
+			// Called on the I/O thread for every message that arrives. A reply
+			// to a request is taken off the pending list, and goes to its
+			// handler if it has one.
+			void RouteIncoming(owned_message<T>&& msg)
+			{
+				uint32_t nCorrelation = msg.msg.header.correlation;
+				if (nCorrelation != 0)
+				{
+					reply_handler fnOnReply;
+					{
+						std::scoped_lock lock(m_muxPending);
+						auto it = m_mapPending.find(nCorrelation);
+						if (it != m_mapPending.end())
+						{
+							fnOnReply = std::move(it->second);
+							m_mapPending.erase(it);
+						}
+					}
+					if (fnOnReply)
+					{
+						fnOnReply(std::move(msg.msg));
+						return;
+					}
+				}
+				m_qMessagesIn.push_back(std::move(msg));
+			}
+
+			// Called when no more replies can come. Dropping the handlers of
+			// the requests still waiting breaks the promises of RequestAsync().
+			void DropPendingRequests()
+			{
+				std::unordered_map<uint32_t, reply_handler> mapPending;
+				{
+					std::scoped_lock lock(m_muxPending);
+					mapPending.swap(m_mapPending);
+				}
+			}
+
+			// Stands in for the incoming queue when the connection is made
+			struct router
+			{
+				client_interface* pClient;
+				void push_back(owned_message<T>&& msg) { pClient->RouteIncoming(std::move(msg)); }
+			};
+
 		private:
 			// This is the thread safe queue of incoming messages from server
-			tsqueue<owned_message<T>> m_qMessagesIn;
+			QueueIn m_qMessagesIn;
+			router m_router{ this };
+
+			// Requests waiting for their reply, by number
+			std::mutex m_muxPending;
+			std::unordered_map<uint32_t, reply_handler> m_mapPending;
+			std::atomic<uint32_t> m_nNextCorrelation{ 1 };
 		};
 	}
 }
@@ -59,13 +59,18 @@
 #include <memory>
 #include <thread>
 #include <mutex>
+#include <shared_mutex>
 #include <deque>
+#include <unordered_map>
 #include <optional>
 #include <vector>
 #include <iostream>
 #include <algorithm>
 #include <chrono>
 #include <cstdint>
+#include <functional>
+#include <future>
+#include <atomic>
 
 #ifdef _WIN32
 #define _WIN32_WINNT 0x0A00
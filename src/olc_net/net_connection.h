@@ -59,12 +59,83 @@
 #include "net_common.h"
 #include "net_tsqueue.h"
 #include "net_message.h"
+#include "net_chunks.h"
+#include "net_transport.h"
 
 
 namespace olc
 {
 	namespace net
 	{
+		// What a connection has sent so far. Written on the connection's strand,
+		// safe to read from any thread.
+		struct connection_stats
+		{
+			std::atomic<uint64_t> nMessagesSent{ 0 };
+			std::atomic<uint64_t> nBytesSent{ 0 };
+			// write_some calls, i.e. sendmsg() syscalls, on the socket
+			std::atomic<uint64_t> nWriteCalls{ 0 };
+			// Send() calls turned away because the queue was full
+			std::atomic<uint64_t> nSendsRefused{ 0 };
+		};
+
+		// Bytes waiting to be sent across a group of connections, e.g. all of a
+		// server's, held to a limit. A body shared by several connections is
+		// counted once for each, so the budget errs on the safe side.
+		class send_budget
+		{
+		public:
+			// A limit of 0 means no limit
+			explicit send_budget(size_t nLimit = 0)
+				: m_nLimit(nLimit)
+			{}
+
+			void set_limit(size_t nLimit)
+			{
+				m_nLimit.store(nLimit, std::memory_order_relaxed);
+			}
+
+			size_t limit() const
+			{
+				return m_nLimit.load(std::memory_order_relaxed);
+			}
+
+			size_t used() const
+			{
+				return m_nUsed.load(std::memory_order_relaxed);
+			}
+
+			// Takes nBytes out of the budget, unless that would overspend it.
+			// While nothing is queued anywhere anything goes, otherwise a
+			// message larger than the whole budget could never be sent.
+			bool try_acquire(size_t nBytes)
+			{
+				size_t nUsed = m_nUsed.load(std::memory_order_relaxed);
+				do
+				{
+					size_t nLimit = m_nLimit.load(std::memory_order_relaxed);
+					if (nLimit > 0 && nUsed > 0 && nUsed + nBytes > nLimit)
+						return false;
+				} while (!m_nUsed.compare_exchange_weak(nUsed, nUsed + nBytes));
+				return true;
+			}
+
+			void release(size_t nBytes)
+			{
+				m_nUsed.fetch_sub(nBytes);
+			}
+
+		private:
+			std::atomic<size_t> m_nLimit{ 0 };
+			std::atomic<size_t> m_nUsed{ 0 };
+		};
+
+		// Every connection's socket is created on its own strand, and asio runs
+		// a completion handler on the executor of the object that started the
+		// operation. So all of a connection's reads, writes and posted work are
+		// serialized, even when several threads are running the io_context.
+		// Each of those handlers holds a reference to the connection, so it
+		// lives until the last one has run, whoever else lets go of it.
 		template<typename T>
 		class connection : public std::enable_shared_from_this<connection<T>>
 		{
@@ -78,16 +149,30 @@ namespace olc
 			};
 
 		public:
-			// Constructor: Specify Owner, connect to context, transfer the socket
-			//				Provide reference to incoming message queue
-			connection(owner parent, boost::asio::io_context& asioContext, boost::asio::ip::tcp::socket socket, tsqueue<owned_message<T>>& qIn)
-				: m_asioContext(asioContext), m_socket(std::move(socket)), m_qMessagesIn(qIn)
+			// Constructor: Specify Owner, connect to context, transfer the stream
+			//				Provide reference to incoming message queue. Any queue with
+			//				a push_back(owned_message<T>&&) will do, e.g. tsqueue or
+			//				mpsc_queue, so the owner picks the queue type. A server
+			//				passes the ID it gives the client, a client leaves it 0.
+			template<typename QueueIn>
+			connection(owner parent, boost::asio::io_context& asioContext, connection_stream stream, QueueIn& qIn, uint32_t uid = 0)
+				: m_asioContext(asioContext), m_socket(std::move(stream)),
+				  m_fnPushIn([&qIn](owned_message<T>&& msg) { qIn.push_back(std::move(msg)); })
 			{
 				m_nOwnerType = parent;
+				id = uid;
 			}
 
 			virtual ~connection()
-			{}
+			{
+				// Don't leave a reader waiting for chunks that will never come
+				if (auto pChunks = m_wpChunksIn.lock())
+					pChunks->close();
+
+				// Whatever was never sent no longer counts against the budget
+				if (m_pSendBudget)
+					m_pSendBudget->release(m_nBytesQueued.load());
+			}
 
 			// This ID is used system wide - its how clients will understand other clients
 			// exist across the whole system.
@@ -96,6 +181,83 @@ namespace olc
 				return id;
 			}
 
+			// Counters for the data sent on this connection
+			const connection_stats& GetStats() const
+			{
+				return m_stats;
+			}
+
+			// Bytes passed to Send() that have not been written to the socket yet
+			size_t GetQueuedBytes() const
+			{
+				return m_nBytesQueued.load(std::memory_order_relaxed);
+			}
+
+			// Messages passed to Send() that have not been written yet
+			size_t GetQueuedMessages() const
+			{
+				return m_nMessagesQueued.load(std::memory_order_relaxed);
+			}
+
+			// Bounds the outgoing queue. Send() refuses a message that would take
+			// more than nBytes, headers included, into the queue, and one that
+			// would overspend pBudget if given. A message always goes onto an
+			// empty queue, however large. 0 and nullptr are no limit, which is
+			// the default. Set this before the connection starts sending.
+			void SetSendLimits(size_t nBytes, std::shared_ptr<send_budget> pBudget = nullptr)
+			{
+				m_nSendLimit = nBytes;
+				m_pSendBudget = std::move(pBudget);
+			}
+
+			// Blocks until no more than nBytes are waiting to be sent, or the
+			// connection has closed. Never call this on the connection's own
+			// strand, that is where the sending happens.
+			void WaitForQueuedBelow(size_t nBytes)
+			{
+				std::unique_lock<std::mutex> ul(m_muxDrain);
+				m_nDrainWaiters++;
+				while (m_nBytesQueued.load() > nBytes && !m_bStopped && IsConnected())
+					m_cvDrain.wait_for(ul, std::chrono::milliseconds(100));
+				m_nDrainWaiters--;
+			}
+
+			// While one of these is alive, whatever the thread that made it sends
+			// on conn is a reply to the request numbered nCorrelation, and is
+			// stamped with that number unless it already carries one. The server
+			// wraps each OnMessage() call in one, so handlers need not copy the
+			// number across themselves, except for replies sent later on.
+			class reply_scope
+			{
+			public:
+				reply_scope(const connection* conn, uint32_t nCorrelation)
+					: m_pPrevConn(s_pReplyConn), m_nPrevCorrelation(s_nReplyCorrelation)
+				{
+					s_pReplyConn = conn;
+					s_nReplyCorrelation = nCorrelation;
+				}
+
+				~reply_scope()
+				{
+					s_pReplyConn = m_pPrevConn;
+					s_nReplyCorrelation = m_nPrevCorrelation;
+				}
+
+				reply_scope(const reply_scope&) = delete;
+				reply_scope& operator=(const reply_scope&) = delete;
+
+			private:
+				const connection* m_pPrevConn;
+				uint32_t m_nPrevCorrelation;
+			};
+
+			// message_chunk_ostream holds this while it sends, so the chunks of
+			// two large messages never interleave on the wire
+			std::unique_lock<std::mutex> LockChunkedSend()
+			{
+				return std::unique_lock<std::mutex>(m_muxChunksOut);
+			}
+
 		public:
 			void ConnectToClient(uint32_t uid = 0)
 			{
@@ -104,7 +266,10 @@ namespace olc
 					if (m_socket.is_open())
 					{
 						id = uid;
-						ReadHeader();
+
+						// Start reading on the connection's strand, a Send() may
+						// already be running there
+						boost::asio::post(m_socket.get_executor(), [this, self = this->shared_from_this()]() { ReadHeader(); });
 					}
 				}
 			}
@@ -114,9 +279,15 @@ namespace olc
 				// Only clients can connect to servers
 				if (m_nOwnerType == owner::client)
 				{
+					// The socket is not tied to one protocol, so the resolved
+					// tcp endpoints are handed over as generic ones
+					std::vector<stream_protocol::endpoint> vEndpoints;
+					for (const auto& entry : endpoints)
+						vEndpoints.emplace_back(entry.endpoint());
+
 					// Request asio attempts to connect to an endpoint
-					boost::asio::async_connect(m_socket, endpoints,
-						[this](std::error_code ec, boost::asio::ip::tcp::endpoint endpoint)
+					boost::asio::async_connect(m_socket.socket(), vEndpoints,
+						[this, self = this->shared_from_this()](std::error_code ec, const stream_protocol::endpoint&)
 						{
 							if (!ec)
 							{
@@ -130,7 +301,49 @@ namespace olc
 			void Disconnect()
 			{
 				if (IsConnected())
-					boost::asio::post(m_asioContext, [this]() { m_socket.close(); });
+					boost::asio::post(m_socket.get_executor(), [this, self = this->shared_from_this()]() { CloseSocket(); });
+			}
+
+			// As Disconnect(), but returns once the connection has closed. From
+			// then on it pushes nothing more to its owner's incoming queue, nor
+			// calls back, so the owner may go even while the connection's last
+			// handlers, which keep it alive, are still queued. Something other
+			// than the caller must be running the connection's context.
+			void DisconnectWait()
+			{
+				if (m_socket.get_executor().running_in_this_thread())
+				{
+					CloseSocket();
+					m_socket.wait_idle();
+					return;
+				}
+
+				std::promise<void> closed;
+				boost::asio::post(m_socket.get_executor(),
+					[this, self = this->shared_from_this(), &closed]()
+					{
+						CloseSocket();
+						closed.set_value();
+					});
+				closed.get_future().wait();
+				m_socket.wait_idle();
+			}
+
+			// Closes the connection from outside its strand, once nothing is
+			// running its context any more, e.g. after its threads have been
+			// joined. Reads and writes the kernel still holds finish first.
+			// Anyone waiting for the send queue to drain, or for the next
+			// chunk of an upload, is let go, nothing will drain it now.
+			void CloseStopped()
+			{
+				{
+					std::scoped_lock lock(m_muxDrain);
+					m_bStopped = true;
+					m_cvDrain.notify_all();
+				}
+				CloseIncomingChunks();
+				CloseSocket();
+				m_socket.wait_idle();
 			}
 
 			bool IsConnected() const
@@ -138,19 +351,138 @@ namespace olc
 				return m_socket.is_open();
 			}
 
-			// Prime the connection to wait for incoming messages
+			// fnOnClosed is called once, on the connection's strand, when the
+			// connection closes for whatever reason. Set it before the
+			// connection starts.
+			void SetOnClosed(std::function<void()> fnOnClosed)
+			{
+				m_fnOnClosed = std::move(fnOnClosed);
+			}
+
+			// Prime the connection to wait for incoming messages, for a client
+			// whose stream was connected before it was handed over
 			void StartListening()
 			{
-				
+				if (m_nOwnerType == owner::client && m_socket.is_open())
+					boost::asio::post(m_socket.get_executor(), [this, self = this->shared_from_this()]() { ReadHeader(); });
 			}
 
 		public:
 			// ASYNC - Send a message, connections are one-to-one so no need to specifiy
-			// the target, for a client, the target is the server and vice versa
-			void Send(const message<T>& msg)
+			// the target, for a client, the target is the server and vice versa.
+			// The body is copied once, the caller keeps msg. Returns false if the
+			// message was not queued, because the connection is closed or its
+			// send limits would be exceeded, see SetSendLimits().
+			bool Send(const message<T>& msg)
+			{
+				return Send(shared_message<T>(msg));
+			}
+
+			// As above, but the body is moved into the outgoing queue rather
+			// than copied, worth it for a large body
+			bool Send(message<T>&& msg)
+			{
+				return Send(shared_message<T>(std::move(msg)));
+			}
+
+			// As above, sharing a body that may also be queued on other
+			// connections. Nothing is copied.
+			bool Send(shared_message<T> msg)
+			{
+				size_t nBytes = sizeof(message_header<T>) + msg.size();
+				if (!IsConnected() || !ReserveSend(nBytes))
+				{
+					m_stats.nSendsRefused.fetch_add(1, std::memory_order_relaxed);
+					return false;
+				}
+
+				QueueSend(std::move(msg));
+				return true;
+			}
+
+			// Like Send(), but rather than refuse a message when the queue is full
+			// it waits for room. Returns false only if the connection closed
+			// first. Never call this on one of the threads running the
+			// io_context, the queue drains there.
+			bool SendWait(const message<T>& msg)
+			{
+				return SendWait(shared_message<T>(msg));
+			}
+
+			bool SendWait(message<T>&& msg)
 			{
-				boost::asio::post(m_asioContext,
-					[this, msg]()
+				return SendWait(shared_message<T>(std::move(msg)));
+			}
+
+			bool SendWait(shared_message<T> msg)
+			{
+				size_t nBytes = sizeof(message_header<T>) + msg.size();
+				if (!IsConnected())
+					return false;
+
+				if (!ReserveSend(nBytes))
+				{
+					// Our own writes wake us, room freed up on other connections
+					// sharing the budget is only noticed on the next poll
+					std::unique_lock<std::mutex> ul(m_muxDrain);
+					m_nDrainWaiters++;
+					bool bReserved = false;
+					while (!m_bStopped && IsConnected() && !(bReserved = ReserveSend(nBytes)))
+						m_cvDrain.wait_for(ul, std::chrono::milliseconds(10));
+					m_nDrainWaiters--;
+					if (!bReserved)
+						return false;
+				}
+
+				QueueSend(std::move(msg));
+				return true;
+			}
+
+		private:
+			// Counts nBytes against the connection's limit and the budget, or
+			// leaves both untouched and returns false
+			bool ReserveSend(size_t nBytes)
+			{
+				size_t nQueued = m_nBytesQueued.load();
+				do
+				{
+					if (m_nSendLimit > 0 && nQueued > 0 && nQueued + nBytes > m_nSendLimit)
+						return false;
+				} while (!m_nBytesQueued.compare_exchange_weak(nQueued, nQueued + nBytes));
+
+				if (m_pSendBudget && !m_pSendBudget->try_acquire(nBytes))
+				{
+					m_nBytesQueued.fetch_sub(nBytes);
+					return false;
+				}
+				return true;
+			}
+
+			// Gives back what ReserveSend() took, once the bytes are written or
+			// thrown away
+			void ReleaseSend(size_t nMessages, size_t nBytes)
+			{
+				m_nMessagesQueued.fetch_sub(nMessages);
+				m_nBytesQueued.fetch_sub(nBytes);
+				if (m_pSendBudget)
+					m_pSendBudget->release(nBytes);
+
+				// Wake anyone waiting for the queue to drain
+				if (m_nDrainWaiters.load() > 0)
+				{
+					std::scoped_lock lock(m_muxDrain);
+					m_cvDrain.notify_all();
+				}
+			}
+
+			void QueueSend(shared_message<T>&& msg)
+			{
+				if (s_pReplyConn == this && msg.header.correlation == 0)
+					msg.header.correlation = s_nReplyCorrelation;
+
+				m_nMessagesQueued.fetch_add(1);
+				boost::asio::post(m_socket.get_executor(),
+					pooled_handler([this, self = this->shared_from_this(), msg = std::move(msg)]() mutable
 					{
 						// If the queue has a message in it, then we must 
 						// assume that it is in the process of asynchronously being written.
@@ -158,49 +490,73 @@ namespace olc
 						// were available to be written, then start the process of writing the
 						// message at the front of the queue.
 						bool bWritingMessage = !m_qMessagesOut.empty();
-						m_qMessagesOut.push_back(msg);
+						m_qMessagesOut.push_back(std::move(msg));
 						if (!bWritingMessage)
 						{
-							WriteHeader();
+							WriteMessages();
 						}
-					});
+					}));
 			}
 
+			// ASYNC - Prime context to write what is waiting in the outgoing queue
+			void WriteMessages()
+			{
+				// If this function is called, we know the outgoing message queue must have
+				// at least one message to send. Rather than a write for the header and
+				// another for the body, point a list of buffers at the headers and bodies
+				// of as many queued messages as we can take, so a burst of small acks
+				// goes out in a single gathered write. Nothing is copied, and the deque
+				// keeps these elements where they are while more are pushed on the back.
+				m_vWriteBuffers.clear();
+				m_nMessagesInFlight = 0;
+				m_nBytesInFlight = 0;
+				for (auto& msg : m_qMessagesOut)
+				{
+					if (m_nMessagesInFlight == nMaxMessagesPerWrite)
+						break;
 
+					m_vWriteBuffers.push_back(boost::asio::buffer(&msg.header, sizeof(message_header<T>)));
+					if (msg.body)
+						m_vWriteBuffers.push_back(boost::asio::buffer(msg.body->data(), msg.body->size()));
 
-		private:
-			// ASYNC - Prime context to write a message header
-			void WriteHeader()
-			{
-				// If this function is called, we know the outgoing message queue must have 
-				// at least one message to send. So allocate a transmission buffer to hold
-				// the message, and issue the work - asio, send these bytes
-				boost::asio::async_write(m_socket, boost::asio::buffer(&m_qMessagesOut.front().header, sizeof(message_header<T>)),
-					[this](std::error_code ec, std::size_t length)
+					m_nBytesInFlight += sizeof(message_header<T>) + msg.size();
+					m_nMessagesInFlight++;
+				}
+
+				// asio keeps a copy of the buffer sequence in the write operation,
+				// hand it a view rather than have it copy the vector
+				boost::asio::async_write(m_socket, write_buffers{ m_vWriteBuffers.data(), m_vWriteBuffers.data() + m_vWriteBuffers.size() },
+					[this](const std::error_code& ec, std::size_t nSent) -> std::size_t
+					{
+						// asio asks this before every write_some on the socket, and once
+						// more when it is finished. Counting here gives the number of
+						// syscalls, and returning what is left lifts the 64 KB a call
+						// limit of transfer_all(), so a big body goes out in as few
+						// writes as the kernel allows.
+						if (ec || nSent == m_nBytesInFlight)
+							return 0;
+						m_stats.nWriteCalls.fetch_add(1, std::memory_order_relaxed);
+						return m_nBytesInFlight - nSent;
+					},
+					pooled_handler([this, self = this->shared_from_this()](std::error_code ec, std::size_t length)
 					{
 						// asio has now sent the bytes - if there was a problem
 						// an error would be available...
 						if (!ec)
 						{
-							// ... no error, so check if the message header just sent also
-							// has a message body...
-							if (m_qMessagesOut.front().body.size() > 0)
-							{
-								// ...it does, so issue the task to write the body bytes
-								WriteBody();
-							}
-							else
-							{
-								// ...it didnt, so we are done with this message. Remove it from 
-								// the outgoing message queue
+							// ... no error, so we are done with these messages. Remove
+							// them from the outgoing message queue
+							m_stats.nMessagesSent.fetch_add(m_nMessagesInFlight, std::memory_order_relaxed);
+							m_stats.nBytesSent.fetch_add(length, std::memory_order_relaxed);
+							for (size_t i = 0; i < m_nMessagesInFlight; i++)
 								m_qMessagesOut.pop_front();
+							ReleaseSend(m_nMessagesInFlight, length);
 
-								// If the queue is not empty, there are more messages to send, so
-								// make this happen by issuing the task to send the next header.
-								if (!m_qMessagesOut.empty())
-								{
-									WriteHeader();
-								}
+							// If the queue is not empty, more messages were sent while we
+							// were writing, so make this happen by issuing the next write.
+							if (!m_qMessagesOut.empty())
+							{
+								WriteMessages();
 							}
 						}
 						else
@@ -209,41 +565,18 @@ namespace olc
 							// for now simply assume the connection has died by closing the
 							// socket. When a future attempt to write to this client fails due
 							// to the closed socket, it will be tidied up.
-							std::cout << "[" << id << "]: Write Header Fail, closing Socket.\n";
-							m_socket.close();
+							std::cout << "[" << id << "]: Write Fail, closing Socket.\n";
+							CloseSocket();
+
+							// Nothing queued will be sent now, free it up for others
+							size_t nBytes = 0;
+							for (auto& msg : m_qMessagesOut)
+								nBytes += sizeof(message_header<T>) + msg.size();
+							size_t nMessages = m_qMessagesOut.size();
+							m_qMessagesOut.clear();
+							ReleaseSend(nMessages, nBytes);
 						}
-					});
-			}
-
-			// ASYNC - Prime context to write a message body
-			void WriteBody()
-			{
-				// If this function is called, a header has just been sent, and that header
-				// indicated a body existed for this message. Fill a transmission buffer
-				// with the body data, and send it!
-				boost::asio::async_write(m_socket, boost::asio::buffer(m_qMessagesOut.front().body.data(), m_qMessagesOut.front().body.size()),
-					[this](std::error_code ec, std::size_t length)
-					{
-						if (!ec)
-						{
-							// Sending was successful, so we are done with the message
-							// and remove it from the queue
-							m_qMessagesOut.pop_front();
-
-							// If the queue still has messages in it, then issue the task to 
-							// send the next messages' header.
-							if (!m_qMessagesOut.empty())
-							{
-								WriteHeader();
-							}
-						}
-						else
-						{
-							// Sending failed, see WriteHeader() equivalent for description :P
-							std::cout << "[" << id << "]: Write Body Fail, closing Socket.\n";
-							m_socket.close();
-						}
-					});
+					}));
 			}
 
 			// ASYNC - Prime context ready to read a message header
@@ -255,7 +588,7 @@ namespace olc
 				// we will construct the message in a "temporary" message object as it's 
 				// convenient to work with.
 				boost::asio::async_read(m_socket, boost::asio::buffer(&m_msgTemporaryIn.header, sizeof(message_header<T>)),
-					[this](std::error_code ec, std::size_t length)
+					pooled_handler([this, self = this->shared_from_this()](std::error_code ec, std::size_t)
 					{						
 						if (!ec)
 						{
@@ -280,9 +613,10 @@ namespace olc
 							// Reading form the client went wrong, most likely a disconnect
 							// has occurred. Close the socket and let the system tidy it up later.
 							std::cout << "[" << id << "]: Read Header Fail, closing Socket.\n";
-							m_socket.close();
+							CloseIncomingChunks();
+							CloseSocket();
 						}
-					});
+					}));
 			}
 
 			// ASYNC - Prime context ready to read a message body
@@ -292,7 +626,15 @@ namespace olc
 				// request we read a body, The space for that body has already been allocated
 				// in the temporary message object, so just wait for the bytes to arrive...
 				boost::asio::async_read(m_socket, boost::asio::buffer(m_msgTemporaryIn.body.data(), m_msgTemporaryIn.body.size()),
-					[this](std::error_code ec, std::size_t length)
+					[this](const std::error_code& ec, std::size_t nRead) -> std::size_t
+					{
+						// As for writes, ask for all that is left rather than 64 KB at
+						// a time. Over io_uring that makes the body a single read.
+						if (ec || nRead == m_msgTemporaryIn.body.size())
+							return 0;
+						return m_msgTemporaryIn.body.size() - nRead;
+					},
+					pooled_handler([this, self = this->shared_from_this()](std::error_code ec, std::size_t)
 					{						
 						if (!ec)
 						{
@@ -304,20 +646,25 @@ namespace olc
 						{
 							// As above!
 							std::cout << "[" << id << "]: Read Body Fail, closing socket.\n";
-							m_socket.close();
+							CloseIncomingChunks();
+							CloseSocket();
 						}
-					});
+					}));
 			}
 
 			// Once a full message is received, add it to the incoming queue
 			void AddToIncomingMessageQueue()
-			{				
-				// Shove it in queue, converting it to an "owned message", by initialising
-				// with the a shared pointer from this connection object
-				if(m_nOwnerType == owner::server)
-					m_qMessagesIn.push_back({ this->shared_from_this(), m_msgTemporaryIn });
-				else
-					m_qMessagesIn.push_back({ nullptr, m_msgTemporaryIn });
+			{
+				// Chunks of a large message go to whoever is reading that message
+				if (m_msgTemporaryIn.header.flags & message_flags::chunk)
+				{
+					AddToIncomingChunks();
+					return;
+				}
+
+				// The body is moved rather than copied, ReadHeader() will size a fresh one.
+				PushIncoming(std::move(m_msgTemporaryIn));
+				m_msgTemporaryIn.body.clear();
 
 				// We must now prime the asio context to receive the next message. It 
 				// wil just sit and wait for bytes to arrive, and the message construction
@@ -325,19 +672,155 @@ namespace olc
 				ReadHeader();
 			}
 
+			// A chunk of a large message has been read
+			void AddToIncomingChunks()
+			{
+				const message_header<T>& header = m_msgTemporaryIn.header;
+				bool bLast = header.flags & message_flags::chunk_last;
+
+				if (!m_bChunksIn)
+				{
+					// First chunk - hand the message over now, its handler reads the
+					// rest of the chunks while they arrive. Only the message keeps
+					// the queue alive, so if the handler drops it unread the rest
+					// of the chunks are simply thrown away.
+					auto pChunks = std::make_shared<chunk_queue>(nMaxChunksBuffered);
+					m_wpChunksIn = pChunks;
+					m_bChunksIn = true;
+					m_nChunkBytesIn = 0;
+
+					message<T> msg;
+					msg.header = header;
+					msg.header.size = 0;
+					msg.chunks = std::move(pChunks);
+					PushIncoming(std::move(msg));
+				}
+
+				// The sender keeps a running total, if ours differs we have lost
+				// our place in the stream and cannot recover
+				m_nChunkBytesIn += header.size;
+				if (header.total != m_nChunkBytesIn)
+				{
+					std::cout << "[" << id << "]: Chunk out of sequence, closing socket.\n";
+					CloseIncomingChunks();
+					CloseSocket();
+					return;
+				}
+
+				bool bRoom = true;
+				if (auto pChunks = m_wpChunksIn.lock())
+				{
+					bRoom = pChunks->push(std::move(m_msgTemporaryIn.body), bLast,
+						[wpSelf = this->weak_from_this()]()
+						{
+							if (auto self = wpSelf.lock())
+								boost::asio::post(self->m_socket.get_executor(), [self]() { self->ReadHeader(); });
+						});
+				}
+				m_msgTemporaryIn.body.clear();
+				if (bLast)
+					m_bChunksIn = false;
+
+				// Carry on reading, unless the reader has fallen behind, then it
+				// sets us going again once it has made room
+				if (bRoom)
+					ReadHeader();
+			}
+
+			// Closes the stream and says so, only ever on the strand
+			void CloseSocket()
+			{
+				m_socket.close();
+				if (m_fnOnClosed && !m_bClosed)
+					m_fnOnClosed();
+				m_bClosed = true;
+			}
+
+			void CloseIncomingChunks()
+			{
+				if (auto pChunks = m_wpChunksIn.lock())
+					pChunks->close();
+				m_wpChunksIn.reset();
+				m_bChunksIn = false;
+			}
+
+			// Shove it in queue, converting it to an "owned message", by initialising
+			// with the a shared pointer from this connection object
+			void PushIncoming(message<T>&& msg)
+			{
+				// A read that finished just before the close, the owner may
+				// have gone, see DisconnectWait()
+				if (m_bClosed)
+					return;
+
+				if (m_nOwnerType == owner::server)
+					m_fnPushIn({ this->shared_from_this(), std::move(msg) });
+				else
+					m_fnPushIn({ nullptr, std::move(msg) });
+			}
+
 		protected:
 			// This context is shared with the whole asio instance
 			boost::asio::io_context& m_asioContext;
 
-			// Each connection has a unique socket to a remote 
-			boost::asio::ip::tcp::socket m_socket;
+			// Each connection has a unique stream to a remote, a socket or shared
+			// memory. Its executor is the connection's strand.
+			connection_stream m_socket;
 
 			// This queue holds all messages to be sent to the remote side
-			// of this connection
-			tsqueue<message<T>> m_qMessagesOut;
-
-			// This references the incoming queue of the parent object
-			tsqueue<owned_message<T>>& m_qMessagesIn;
+			// of this connection. It is only touched on the connection's
+			// strand, so it needs no lock. Bodies may be shared with the queues
+			// of other connections.
+			std::deque<shared_message<T>, body_allocator<shared_message<T>>> m_qMessagesOut;
+
+			// The gathered write in progress covers the first m_nMessagesInFlight
+			// messages of m_qMessagesOut
+			static constexpr size_t nMaxMessagesPerWrite = 32;
+			std::vector<boost::asio::const_buffer> m_vWriteBuffers;
+
+			// Buffer sequence over m_vWriteBuffers, cheap to copy
+			struct write_buffers
+			{
+				using value_type = boost::asio::const_buffer;
+				using const_iterator = const boost::asio::const_buffer*;
+				const_iterator pBegin;
+				const_iterator pEnd;
+				const_iterator begin() const { return pBegin; }
+				const_iterator end() const { return pEnd; }
+			};
+			size_t m_nMessagesInFlight = 0;
+			size_t m_nBytesInFlight = 0;
+
+			connection_stats m_stats;
+
+			// Bytes and messages queued by Send() and not yet written, the
+			// limits on them, and a way to wait for them to go
+			std::atomic<size_t> m_nBytesQueued{ 0 };
+			std::atomic<size_t> m_nMessagesQueued{ 0 };
+			size_t m_nSendLimit = 0;
+			std::shared_ptr<send_budget> m_pSendBudget;
+			std::atomic<int> m_nDrainWaiters{ 0 };
+			std::atomic<bool> m_bStopped{ false };
+			std::mutex m_muxDrain;
+			std::condition_variable m_cvDrain;
+
+			// The innermost reply_scope on this thread
+			static inline thread_local const connection* s_pReplyConn = nullptr;
+			static inline thread_local uint32_t s_nReplyCorrelation = 0;
+
+			// Sending and receiving messages in chunks
+			static constexpr size_t nMaxChunksBuffered = 4;
+			std::mutex m_muxChunksOut;
+			std::weak_ptr<chunk_queue> m_wpChunksIn;
+			bool m_bChunksIn = false;
+			uint64_t m_nChunkBytesIn = 0;
+
+			// This pushes onto the incoming queue of the parent object
+			std::function<void(owned_message<T>&&)> m_fnPushIn;
+
+			// Told when the connection closes, see SetOnClosed()
+			std::function<void()> m_fnOnClosed;
+			bool m_bClosed = false;
 
 			// Incoming messages are constructed asynchronously, so we will
 			// store the part assembled message here, until it is ready
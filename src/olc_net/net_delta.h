@@ -0,0 +1,273 @@
+/*
+	Delta encoding of a message body against bytes both ends already hold
+
+	Several objects exchanged during threshold key generation share large
+	parts with an object sent earlier. A party's round 2 public key has the
+	same uniformly random "a" polynomial as the round 1 public key it was
+	built on, and the joint eval mult key keeps the "a" vector of the round 1
+	eval mult key. That half of the message is already on the receiver's side.
+
+	delta_compress() rewrites a body as literal bytes plus copies out of a
+	reference, here the serialized earlier object, and marks the header so
+	delta_expand() on the other side knows to rebuild it from its own copy
+	of that reference. Matches are found on 64 byte blocks of the reference
+	with a rolling hash, the way rsync does, so nothing needs to know where
+	the polynomials sit inside the serialized bytes. The encoding carries a
+	hash of the original body, a receiver whose reference differs from the
+	sender's finds out instead of deserializing garbage.
+
+	Based on the asio connection objects from olc_net thanks to
+	David Barr, aka javidx9, (c)OneLoneCoder 2019, 2020
+*/
+
+#pragma once
+
+#include <cstring>
+
+#include "net_common.h"
+#include "net_message.h"
+
+namespace olc
+{
+	namespace net
+	{
+		namespace detail
+		{
+			// Matches shorter than a block are not worth a copy op
+			constexpr size_t delta_block = 64;
+			constexpr uint64_t delta_mul = 0x100000001b3ull;
+
+			inline void put_varint(message_body& out, uint64_t n)
+			{
+				while (n >= 0x80)
+				{
+					out.push_back(uint8_t(n) | 0x80);
+					n >>= 7;
+				}
+				out.push_back(uint8_t(n));
+			}
+
+			inline bool get_varint(const uint8_t*& p, const uint8_t* pEnd, uint64_t& n)
+			{
+				n = 0;
+				for (int shift = 0; p < pEnd && shift < 64; shift += 7)
+				{
+					uint8_t b = *p++;
+					n |= uint64_t(b & 0x7f) << shift;
+					if (!(b & 0x80))
+						return true;
+				}
+				return false;
+			}
+
+			// Hash of a whole body, to check the rebuilt one
+			inline uint64_t delta_checksum(const uint8_t* p, size_t n)
+			{
+				uint64_t h = 0xcbf29ce484222325ull ^ n;
+				size_t i = 0;
+				for (; i + 8 <= n; i += 8)
+				{
+					uint64_t w;
+					std::memcpy(&w, p + i, 8);
+					h = (h ^ w) * delta_mul;
+					h ^= h >> 29;
+				}
+				for (; i < n; i++)
+					h = (h ^ p[i]) * delta_mul;
+				return h;
+			}
+
+			// Rabin-Karp hash of one block, rolled a byte at a time while scanning
+			inline uint64_t block_hash(const uint8_t* p)
+			{
+				uint64_t h = 0;
+				for (size_t i = 0; i < delta_block; i++)
+					h = h * delta_mul + p[i];
+				return h;
+			}
+		}
+
+		// Encodes data as copies out of ref plus literal runs. The result is
+		// only smaller than data when the two have long runs in common.
+		//
+		//	varint size of data, 8 byte checksum of data, then ops of
+		//	varint (length << 1 | 1), varint offset in ref	- copy
+		//	varint (length << 1), length bytes				- literal
+		template <typename Ref, typename Data>
+		message_body delta_encode(const Ref& ref, const Data& data)
+		{
+			using namespace detail;
+
+			message_body out;
+			out.reserve(data.size() / 2 + 16);
+			put_varint(out, data.size());
+			uint64_t nCheck = delta_checksum(data.data(), data.size());
+			for (int i = 0; i < 8; i++)
+				out.push_back(uint8_t(nCheck >> (8 * i)));
+
+			auto emit_literal = [&](size_t nFrom, size_t nTo)
+			{
+				if (nTo > nFrom)
+				{
+					put_varint(out, uint64_t(nTo - nFrom) << 1);
+					out.insert(out.end(), data.begin() + nFrom, data.begin() + nTo);
+				}
+			};
+
+			if (ref.size() < delta_block || data.size() < delta_block)
+			{
+				emit_literal(0, data.size());
+				return out;
+			}
+
+			// Index the reference on block boundaries, first occurrence wins. Most
+			// windows of a fresh polynomial match nothing, a bitmap in front of
+			// the map turns those away without a lookup.
+			std::unordered_map<uint64_t, size_t> mapBlocks;
+			mapBlocks.reserve(ref.size() / delta_block);
+			size_t nBits = 64;
+			while (nBits < 8 * (ref.size() / delta_block))
+				nBits <<= 1;
+			std::vector<uint64_t> vFilter(nBits / 64);
+			for (size_t r = 0; r + delta_block <= ref.size(); r += delta_block)
+			{
+				uint64_t hBlock = block_hash(ref.data() + r);
+				mapBlocks.emplace(hBlock, r);
+				size_t nBit = (hBlock >> 17) & (nBits - 1);
+				vFilter[nBit / 64] |= uint64_t(1) << (nBit % 64);
+			}
+
+			// Multiplier to drop the byte leaving the window
+			uint64_t nOut = 1;
+			for (size_t i = 1; i < delta_block; i++)
+				nOut *= delta_mul;
+
+			size_t nLiteral = 0;
+			size_t i = 0;
+			uint64_t h = block_hash(data.data());
+			while (i + delta_block <= data.size())
+			{
+				size_t nBit = (h >> 17) & (nBits - 1);
+				auto it = (vFilter[nBit / 64] >> (nBit % 64)) & 1 ? mapBlocks.find(h) : mapBlocks.end();
+				if (it != mapBlocks.end() &&
+					std::memcmp(ref.data() + it->second, data.data() + i, delta_block) == 0)
+				{
+					size_t r = it->second;
+					size_t nStart = i;
+
+					// Grow the match both ways as far as the bytes agree
+					while (nStart > nLiteral && r > 0 && data[nStart - 1] == ref[r - 1])
+					{
+						nStart--;
+						r--;
+					}
+					size_t nEnd = i + delta_block;
+					size_t rEnd = it->second + delta_block;
+					while (nEnd < data.size() && rEnd < ref.size() && data[nEnd] == ref[rEnd])
+					{
+						nEnd++;
+						rEnd++;
+					}
+
+					emit_literal(nLiteral, nStart);
+					put_varint(out, (uint64_t(nEnd - nStart) << 1) | 1);
+					put_varint(out, r);
+
+					nLiteral = i = nEnd;
+					if (i + delta_block <= data.size())
+						h = block_hash(data.data() + i);
+					continue;
+				}
+
+				// Slide the window on by a byte
+				if (i + delta_block < data.size())
+					h = (h - data[i] * nOut) * delta_mul + data[i + delta_block];
+				i++;
+			}
+			emit_literal(nLiteral, data.size());
+			return out;
+		}
+
+		// Rebuilds data from the output of delta_encode() and the same ref.
+		// Returns false if the encoding is damaged or ref is not the one it
+		// was made against.
+		template <typename Ref, typename Enc, typename Data>
+		bool delta_decode(const Ref& ref, const Enc& enc, Data& data)
+		{
+			using namespace detail;
+
+			const uint8_t* p = enc.data();
+			const uint8_t* pEnd = p + enc.size();
+			uint64_t nSize = 0;
+			if (!get_varint(p, pEnd, nSize) || pEnd - p < 8)
+				return false;
+			uint64_t nCheck = 0;
+			for (int i = 0; i < 8; i++)
+				nCheck |= uint64_t(*p++) << (8 * i);
+
+			// Don't trust the size for more than the two inputs could make
+			data.clear();
+			data.reserve(std::min<uint64_t>(nSize, ref.size() + enc.size()));
+			while (p < pEnd)
+			{
+				uint64_t nOp = 0;
+				if (!get_varint(p, pEnd, nOp))
+					return false;
+				uint64_t nLength = nOp >> 1;
+				if (nLength > nSize - data.size())
+					return false;
+
+				if (nOp & 1)
+				{
+					uint64_t r = 0;
+					if (!get_varint(p, pEnd, r) || r > ref.size() || nLength > ref.size() - r)
+						return false;
+					data.insert(data.end(), ref.begin() + r, ref.begin() + r + nLength);
+				}
+				else
+				{
+					if (nLength > uint64_t(pEnd - p))
+						return false;
+					data.insert(data.end(), p, p + nLength);
+					p += nLength;
+				}
+			}
+
+			return data.size() == nSize && delta_checksum(data.data(), data.size()) == nCheck;
+		}
+
+		// Replaces the body of msg with its delta against ref, if that is any
+		// smaller. Returns true if it did.
+		template <typename T, typename Ref>
+		bool delta_compress(message<T>& msg, const Ref& ref)
+		{
+			message_body enc = delta_encode(ref, msg.body);
+			if (enc.size() >= msg.body.size())
+				return false;
+
+			msg.body.swap(enc);
+			msg.header.size = uint32_t(msg.body.size());
+			msg.header.flags |= message_flags::delta;
+			return true;
+		}
+
+		// Undoes delta_compress(), using the receiver's copy of ref. A message
+		// that was not delta encoded is left as it is. Returns false if the
+		// body could not be rebuilt.
+		template <typename T, typename Ref>
+		bool delta_expand(message<T>& msg, const Ref& ref)
+		{
+			if (!(msg.header.flags & message_flags::delta))
+				return true;
+
+			message_body data;
+			if (!delta_decode(ref, msg.body, data))
+				return false;
+
+			msg.body.swap(data);
+			msg.header.size = uint32_t(msg.body.size());
+			msg.header.flags &= ~message_flags::delta;
+			return true;
+		}
+	}
+}
@@ -56,6 +56,7 @@
 
 #pragma once
 #include "net_common.h"
+#include "net_pool.h"
 
 namespace olc
 {
@@ -63,6 +64,20 @@ namespace olc
 	{
 		///[OLC_HEADERIFYIER] START "MESSAGE"
 
+		// Bits of message_header::flags
+		struct message_flags
+		{
+			// The frame is one chunk of a larger message, see message_chunk_ostream
+			static constexpr uint32_t chunk = 0x1;
+			// ...and it is the last one
+			static constexpr uint32_t chunk_last = 0x2;
+			// The body is a delta against an object both ends hold, see net_delta.h
+			static constexpr uint32_t delta = 0x4;
+			// Never sent. A server queues an empty message with it when a
+			// client's connection closes, see server_interface::Update().
+			static constexpr uint32_t closed = 0x8;
+		};
+
 		// Message Header is sent at start of all messages. The template allows us
 		// to use "enum class" to ensure that the messages are valid at compile time
 		template <typename T>
@@ -70,9 +85,17 @@ namespace olc
 		{
 			T id{};
 			unsigned int SubType_ID = 0; //sequence number of the ciphertext for exchanging multiple ciphertexts
-			uint32_t size = 0;
+			uint32_t size = 0; // bytes in this frame's body
+			uint32_t flags = 0;
+			// Set by client_interface::Request() and carried back on the reply,
+			// so a client can have many requests out at once. 0 otherwise.
+			uint32_t correlation = 0;
+			uint64_t total = 0; // for chunks, bytes of the whole message sent so far
 		};
 
+		// A message that arrives in chunks is read from one of these
+		class chunk_queue;
+
 		// Message Body contains a header and a std::vector, containing raw bytes
 		// of infomation. This way the message can be variable length, but the size
 		// in the header must be updated.
@@ -81,7 +104,11 @@ namespace olc
 		{
 			// Header & Body vector
 			message_header<T> header{};
-		    std::vector<uint8_t> body;
+		    message_body body;
+
+			// Set instead of body for a message that is still arriving in chunks,
+			// message_istream reads it transparently
+			std::shared_ptr<chunk_queue> chunks;
 
 			// returns size of entire message packet in bytes
 			size_t size() const
@@ -172,6 +199,41 @@ namespace olc
 		};
 
 
+		// A message as it waits to be sent. The body is held by reference count
+		// and never changes once it is here, so a body broadcast to many clients,
+		// or sent again later, is one allocation however many connections have
+		// it queued. Every connection::Send() queues one of these.
+		template <typename T>
+		struct shared_message
+		{
+			message_header<T> header{};
+			// Null for a message without a body
+			std::shared_ptr<const message_body> body;
+
+			shared_message() = default;
+
+			// Copies the body of msg, once
+			explicit shared_message(const message<T>& msg)
+				: header(msg.header)
+			{
+				if (!msg.body.empty())
+					body = std::allocate_shared<message_body>(body_allocator<message_body>(), msg.body);
+			}
+
+			// Takes the body of msg over without copying it
+			explicit shared_message(message<T>&& msg)
+				: header(msg.header)
+			{
+				if (!msg.body.empty())
+					body = std::allocate_shared<message_body>(body_allocator<message_body>(), std::move(msg.body));
+			}
+
+			size_t size() const
+			{
+				return body ? body->size() : 0;
+			}
+		};
+
 		// An "owned" message is identical to a regular message, but it is associated with
 		// a connection. On a server, the owner would be the client that sent the message, 
 		// on a client the owner would be the server.
@@ -0,0 +1,230 @@
+/*
+	Lock-free multi-producer / single-consumer queue
+
+	A drop-in alternative to tsqueue for the incoming message queue of a
+	server or client. Any number of connection threads may push, exactly one
+	thread (the one calling Update() or draining Incoming()) may pop.
+
+	The queue is the well known unbounded list of Dmitry Vyukov: a push
+	links a new node in with a single atomic exchange of the tail and never
+	waits, whatever the consumer is doing, so the I/O threads that push can
+	never be held up by a slow Update(). A pop takes no atomic
+	read-modify-write at all. The price is a heap node per item, and a
+	queue that grows for as long as the consumer falls behind, the same as
+	tsqueue. The consumer blocks on an empty queue with a futex on Linux
+	and a condition variable elsewhere, and a push only pays for a wake up
+	when the consumer is actually asleep.
+
+	Based on the asio connection objects from olc_net thanks to
+	David Barr, aka javidx9, (c)OneLoneCoder 2019, 2020
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <new>
+
+#include "net_common.h"
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <climits>
+#endif
+
+namespace olc
+{
+	namespace net
+	{
+		namespace detail
+		{
+			// A 32 bit word that threads can sleep on until it changes. On Linux
+			// this maps directly onto futex(2), so waiting and waking cost one
+			// syscall each and nothing at all when there are no sleepers.
+			class wait_word
+			{
+			public:
+				uint32_t load() const
+				{
+					return m_nWord.load(std::memory_order_acquire);
+				}
+
+				// Bump the word and wake everyone sleeping on the old value
+				void notify_all()
+				{
+					m_nWord.fetch_add(1, std::memory_order_seq_cst);
+#ifdef __linux__
+					syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_nWord), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#else
+					std::scoped_lock lock(m_mux);
+					m_cv.notify_all();
+#endif
+				}
+
+				// Sleep for as long as the word still holds nExpected
+				void wait(uint32_t nExpected)
+				{
+#ifdef __linux__
+					syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_nWord), FUTEX_WAIT_PRIVATE, nExpected, nullptr, nullptr, 0);
+#else
+					std::unique_lock<std::mutex> ul(m_mux);
+					m_cv.wait(ul, [&]() { return m_nWord.load(std::memory_order_acquire) != nExpected; });
+#endif
+				}
+
+			private:
+				std::atomic<uint32_t> m_nWord{ 0 };
+#ifndef __linux__
+				std::mutex m_mux;
+				std::condition_variable m_cv;
+#endif
+			};
+
+			// Keep producer and consumer indices out of each other's cache lines
+			constexpr size_t cache_line = 64;
+		}
+
+		template<typename T>
+		class mpsc_queue
+		{
+		public:
+			mpsc_queue()
+			{
+				m_pHead = new node;
+				m_pTail.store(m_pHead, std::memory_order_relaxed);
+			}
+
+			mpsc_queue(const mpsc_queue<T>&) = delete;
+
+			virtual ~mpsc_queue()
+			{
+				clear();
+				delete m_pHead;
+			}
+
+		public:
+			// Adds an item to back of Queue. Never waits, and is safe to call
+			// from any number of threads at once.
+			void push_back(const T& item)
+			{
+				emplace_back(item);
+			}
+
+			void push_back(T&& item)
+			{
+				emplace_back(std::move(item));
+			}
+
+			// Removes and returns item from front of Queue. Consumer only. Like
+			// tsqueue the caller is expected to have checked empty() first, if
+			// it has not this waits for an item to arrive.
+			T pop_front()
+			{
+				std::optional<T> t;
+				while (!(t = try_pop()))
+					wait();
+				return std::move(*t);
+			}
+
+			// Returns the item at front of Queue without removing it. Consumer only.
+			const T& front()
+			{
+				while (empty())
+					wait();
+				return *m_pHead->pNext.load(std::memory_order_acquire)->ptr();
+			}
+
+			// Returns true if Queue has no items. A push that has swapped the
+			// tail but not yet linked its node counts as not there yet.
+			bool empty() const
+			{
+				return m_pHead->pNext.load(std::memory_order_acquire) == nullptr;
+			}
+
+			// Returns number of items in Queue, only a snapshot while producers run
+			size_t count() const
+			{
+				return m_nCount.load(std::memory_order_relaxed);
+			}
+
+			// Clears Queue. Consumer only.
+			void clear()
+			{
+				while (try_pop())
+				{
+				}
+			}
+
+			// Blocks the consumer until there is at least one item
+			void wait()
+			{
+				while (empty())
+				{
+					uint32_t nEpoch = m_wNotEmpty.load();
+					m_bConsumerWaiting.store(true, std::memory_order_seq_cst);
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+					if (empty())
+						m_wNotEmpty.wait(nEpoch);
+					else
+						m_bConsumerWaiting.store(false, std::memory_order_relaxed);
+				}
+			}
+
+		private:
+			// The consumer's m_pHead is a spent node whose item, if any, has
+			// been taken; the front of the queue is the node after it
+			struct node
+			{
+				std::atomic<node*> pNext{ nullptr };
+				alignas(T) unsigned char storage[sizeof(T)];
+
+				T* ptr() { return std::launder(reinterpret_cast<T*>(storage)); }
+			};
+
+			template<typename U>
+			void emplace_back(U&& item)
+			{
+				node* pNode = new node;
+				new (pNode->storage) T(std::forward<U>(item));
+				m_nCount.fetch_add(1, std::memory_order_relaxed);
+
+				// Claim the tail, then link the old one to us. Until the link
+				// is made the consumer sees the queue end at the old tail.
+				node* pPrev = m_pTail.exchange(pNode, std::memory_order_acq_rel);
+				pPrev->pNext.store(pNode, std::memory_order_release);
+
+				// Only pay for a wake up if the consumer is actually asleep, and
+				// clear the flag so the pushes that follow don't pay for it again
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (m_bConsumerWaiting.load(std::memory_order_relaxed) &&
+					m_bConsumerWaiting.exchange(false, std::memory_order_acq_rel))
+					m_wNotEmpty.notify_all();
+			}
+
+			std::optional<T> try_pop()
+			{
+				node* pNext = m_pHead->pNext.load(std::memory_order_acquire);
+				if (!pNext)
+					return std::nullopt;
+
+				// pNext becomes the spent head once its item is moved out
+				std::optional<T> t(std::move(*pNext->ptr()));
+				pNext->ptr()->~T();
+				delete m_pHead;
+				m_pHead = pNext;
+				m_nCount.fetch_sub(1, std::memory_order_relaxed);
+				return t;
+			}
+
+		protected:
+			alignas(detail::cache_line) std::atomic<node*> m_pTail{ nullptr };
+			alignas(detail::cache_line) node* m_pHead = nullptr;
+			std::atomic<size_t> m_nCount{ 0 };
+
+			alignas(detail::cache_line) detail::wait_word m_wNotEmpty;
+			std::atomic<bool> m_bConsumerWaiting{ false };
+		};
+	}
+}
@@ -0,0 +1,329 @@
+/*
+	Stream adapters over olc::net::message bodies
+
+	Serial::Serialize() and Serial::Deserialize() work on std::ostream and
+	std::istream. These adapters let them write straight into, and read
+	straight out of, the body vector of a message, so there is no
+	intermediate std::string or std::stringstream on the wire path.
+
+	For objects too large to hold comfortably in one body, such as eval key
+	maps, message_chunk_ostream sends the serialized bytes as a run of fixed
+	size chunks while they are produced, and message_istream on the other
+	side reads them as they arrive.
+
+	Based on the asio connection objects from olc_net thanks to
+	David Barr, aka javidx9, (c)OneLoneCoder 2019, 2020
+*/
+
+#pragma once
+
+#include <istream>
+#include <ostream>
+#include <streambuf>
+
+#include "net_common.h"
+#include "net_message.h"
+#include "net_chunks.h"
+#include "net_connection.h"
+
+namespace olc
+{
+	namespace net
+	{
+		// A write-only streambuf that appends every byte it is given to the end
+		// of a message body, keeping the header size in step. It is unbuffered
+		// on purpose: the body vector is always exactly the bytes written so far,
+		// so the message can be sent as soon as serialization returns.
+		template <typename T>
+		class message_ostreambuf : public std::streambuf
+		{
+		public:
+			explicit message_ostreambuf(message<T>& msg)
+				: m_msg(msg)
+			{}
+
+		protected:
+			std::streamsize xsputn(const char* s, std::streamsize n) override
+			{
+				// Cache the current end of the body, this is where the data goes
+				size_t i = m_msg.body.size();
+
+				// Grow the body, the vector amortises the reallocations for us
+				m_msg.body.resize(i + size_t(n));
+				std::memcpy(m_msg.body.data() + i, s, size_t(n));
+
+				m_msg.header.size = uint32_t(m_msg.size());
+				return n;
+			}
+
+			int_type overflow(int_type ch) override
+			{
+				if (traits_type::eq_int_type(ch, traits_type::eof()))
+					return traits_type::not_eof(ch);
+
+				m_msg.body.push_back(uint8_t(traits_type::to_char_type(ch)));
+				m_msg.header.size = uint32_t(m_msg.size());
+				return ch;
+			}
+
+		private:
+			message<T>& m_msg;
+		};
+
+		// std::ostream that serializes into the body of a message, e.g.
+		//
+		//		olc::net::message<MsgTypes> msg;
+		//		msg.header.id = MsgTypes::SendCT;
+		//		olc::net::message_ostream<MsgTypes> os(msg);
+		//		Serial::Serialize(ct, os, SerType::BINARY);
+		//		client->Send(msg);
+		template <typename T>
+		class message_ostream : public std::ostream
+		{
+		public:
+			// nReserve lets the caller pre-size the body when it knows roughly
+			// how large the serialized object will be
+			explicit message_ostream(message<T>& msg, size_t nReserve = 0)
+				: std::ostream(nullptr), m_buf(msg)
+			{
+				if (nReserve > 0)
+					msg.body.reserve(msg.body.size() + nReserve);
+				rdbuf(&m_buf);
+			}
+
+		private:
+			message_ostreambuf<T> m_buf;
+		};
+
+		// A read-only streambuf that is a view over a message body. Nothing is
+		// copied, the get area points directly at the received bytes, so the
+		// message must outlive any stream reading from it.
+		//
+		// A message still arriving in chunks is read one chunk at a time
+		// instead, waiting for each as needed. Only the current chunk is held,
+		// and such a stream can only tell its position, not seek.
+		template <typename T>
+		class message_istreambuf : public std::streambuf
+		{
+		public:
+			explicit message_istreambuf(const message<T>& msg)
+				: m_pChunks(msg.chunks)
+			{
+				if (m_pChunks)
+					return;
+
+				// streambuf wants non-const pointers but never writes through
+				// the get area, so dropping the const here is safe
+				char* p = reinterpret_cast<char*>(const_cast<uint8_t*>(msg.body.data()));
+				setg(p, p, p + msg.body.size());
+			}
+
+		protected:
+			int_type underflow() override
+			{
+				if (!m_pChunks)
+					return traits_type::eof();
+
+				// Done with this chunk, wait for the next one with something in it
+				m_nChunkOffset += egptr() - eback();
+				while (m_pChunks->pop(m_vChunk))
+				{
+					if (m_vChunk.empty())
+						continue;
+
+					char* p = reinterpret_cast<char*>(m_vChunk.data());
+					setg(p, p, p + m_vChunk.size());
+					return traits_type::to_int_type(*gptr());
+				}
+				return traits_type::eof();
+			}
+
+			std::streamsize showmanyc() override
+			{
+				return egptr() - gptr();
+			}
+
+			pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+				std::ios_base::openmode which = std::ios_base::in) override
+			{
+				if (!(which & std::ios_base::in))
+					return pos_type(off_type(-1));
+
+				if (m_pChunks)
+				{
+					if (off == 0 && dir == std::ios_base::cur)
+						return pos_type(off_type(m_nChunkOffset + (gptr() - eback())));
+					return pos_type(off_type(-1));
+				}
+
+				off_type base = 0;
+				if (dir == std::ios_base::cur)
+					base = gptr() - eback();
+				else if (dir == std::ios_base::end)
+					base = egptr() - eback();
+
+				off_type pos = base + off;
+				if (pos < 0 || pos > egptr() - eback())
+					return pos_type(off_type(-1));
+
+				setg(eback(), eback() + pos, egptr());
+				return pos_type(pos);
+			}
+
+			pos_type seekpos(pos_type pos,
+				std::ios_base::openmode which = std::ios_base::in) override
+			{
+				return seekoff(off_type(pos), std::ios_base::beg, which);
+			}
+
+		private:
+			std::shared_ptr<chunk_queue> m_pChunks;
+			message_body m_vChunk;
+			uint64_t m_nChunkOffset = 0;
+		};
+
+		// std::istream that deserializes straight out of a received message.
+		// Every Recv* handler uses this in place of building an istringstream
+		// from a copy of the body, e.g.
+		//
+		//		olc::net::message_istream<MsgTypes> is(msg);
+		//		Serial::Deserialize(ct, is, SerType::BINARY);
+		template <typename T>
+		class message_istream : public std::istream
+		{
+		public:
+			explicit message_istream(const message<T>& msg)
+				: std::istream(nullptr), m_buf(msg)
+			{
+				rdbuf(&m_buf);
+			}
+
+		private:
+			message_istreambuf<T> m_buf;
+		};
+
+		// A write-only streambuf that cuts what is written into chunks of a fixed
+		// size, and sends each one on a connection as soon as it fills up. It
+		// waits for the connection to catch up when a few chunks are already
+		// queued, so a slow socket doesn't let the whole object pile up here.
+		template <typename T>
+		class message_chunk_ostreambuf : public std::streambuf
+		{
+		public:
+			message_chunk_ostreambuf(connection<T>& conn, const message_header<T>& header, size_t nChunkSize)
+				: m_conn(conn), m_lock(conn.LockChunkedSend()), m_header(header),
+				  m_nChunkSize(std::max<size_t>(nChunkSize, 1))
+			{
+				NewChunk();
+			}
+
+			// Sends whatever is left as the last chunk, which may be empty
+			void finish()
+			{
+				if (m_bFinished)
+					return;
+				SendChunk(true);
+				m_bFinished = true;
+				m_lock.unlock();
+			}
+
+		protected:
+			int_type overflow(int_type ch) override
+			{
+				if (m_bFinished)
+					return traits_type::eof();
+
+				SendChunk(false);
+				if (!traits_type::eq_int_type(ch, traits_type::eof()))
+				{
+					*pptr() = traits_type::to_char_type(ch);
+					pbump(1);
+				}
+				return traits_type::not_eof(ch);
+			}
+
+		private:
+			void NewChunk()
+			{
+				m_vChunk.resize(m_nChunkSize);
+				char* p = reinterpret_cast<char*>(m_vChunk.data());
+				setp(p, p + m_vChunk.size());
+			}
+
+			void SendChunk(bool bLast)
+			{
+				message<T> msg;
+				msg.header = m_header;
+				msg.header.flags = message_flags::chunk | (bLast ? message_flags::chunk_last : 0);
+
+				// Hand the buffer itself over, and start a new one
+				m_vChunk.resize(pptr() - pbase());
+				msg.body.swap(m_vChunk);
+				msg.header.size = uint32_t(msg.body.size());
+				m_nTotal += msg.body.size();
+				msg.header.total = m_nTotal;
+
+				// A chunk can't be dropped without breaking the message, so wait
+				// for room if the connection has send limits
+				m_conn.WaitForQueuedBelow(nMaxChunksQueued * m_nChunkSize);
+				m_conn.SendWait(std::move(msg));
+				if (!bLast)
+					NewChunk();
+			}
+
+			static constexpr size_t nMaxChunksQueued = 4;
+
+			connection<T>& m_conn;
+			std::unique_lock<std::mutex> m_lock;
+			message_header<T> m_header;
+			size_t m_nChunkSize;
+			message_body m_vChunk;
+			uint64_t m_nTotal = 0;
+			bool m_bFinished = false;
+		};
+
+		// std::ostream that sends what is serialized into it as a chunked
+		// message, e.g.
+		//
+		//		olc::net::message_chunk_ostream<MsgTypes> os(*client, MsgTypes::SendKeys);
+		//		Serial::Serialize(evalSumKeys, os, SerType::BINARY);
+		//		os.close();
+		//
+		// The receiver handles it like any other message, message_istream
+		// reads the chunks as they come. Only one chunked message at a time
+		// is sent on a connection, others wait for close().
+		template <typename T>
+		class message_chunk_ostream : public std::ostream
+		{
+		public:
+			message_chunk_ostream(connection<T>& conn, T id, unsigned int nSubType = 0,
+				size_t nChunkSize = default_chunk_size)
+				: std::ostream(nullptr), m_buf(conn, MakeHeader(id, nSubType), nChunkSize)
+			{
+				rdbuf(&m_buf);
+			}
+
+			virtual ~message_chunk_ostream()
+			{
+				close();
+			}
+
+			// Sends the last chunk, nothing more can be written after this
+			void close()
+			{
+				m_buf.finish();
+			}
+
+		private:
+			static message_header<T> MakeHeader(T id, unsigned int nSubType)
+			{
+				message_header<T> header;
+				header.id = id;
+				header.SubType_ID = nSubType;
+				return header;
+			}
+
+			message_chunk_ostreambuf<T> m_buf;
+		};
+	}
+}
@@ -0,0 +1,366 @@
+/*
+	Pooled storage for message bodies
+
+	Every message owns a body vector that used to come from, and go back
+	to, the general heap: once for each message read off a socket, again for
+	each copy queued for sending, and several times over while a body grows
+	during serialization. body_pool keeps freed buffers in size classes, the
+	powers of two from 64 bytes to 1 MB, and hands them out again, so once a
+	server has seen its working set of message sizes it stops touching the
+	heap. Buffers up to 64 KB are carved from 1 MB arenas, larger ones are
+	allocated one at a time the first time their class runs dry. Bodies
+	beyond the largest class are passed straight through, rounding them up
+	to a power of two would nearly double them.
+
+	The pool does not keep its peak size for good. A buffer from the heap
+	goes back to it when its class, or the pool as a whole, already caches
+	as much as set_cache_limits() allows, and trim() hands cached buffers
+	back until the pool is under a watermark. A server trims from Update().
+	Arena memory is kept.
+
+	body_allocator plugs the pool into std::vector, and message_body is the
+	vector type message<T>::body uses. The allocator also leaves new bytes
+	uninitialised on resize(), a receive buffer is about to be overwritten
+	by the socket and has no need to be zeroed first. pooled_handler gives a
+	connection's asio handlers the same allocator.
+
+	The arenas are also what the io_uring backend registers with the kernel
+	as fixed buffers, see net_uring.h.
+
+	Based on the asio connection objects from olc_net thanks to
+	David Barr, aka javidx9, (c)OneLoneCoder 2019, 2020
+*/
+
+#pragma once
+
+#include "net_common.h"
+
+namespace olc
+{
+	namespace net
+	{
+		// Snapshot of body_pool activity since the process started
+		struct body_pool_stats
+		{
+			uint64_t nAllocs = 0;		// buffers handed out
+			uint64_t nFrees = 0;		// buffers given back
+			uint64_t nHeapAllocs = 0;	// times the pool itself went to the heap
+			uint64_t nOversize = 0;		// buffers too large to pool
+			uint64_t nBytesInUse = 0;	// class sized bytes handed out and not yet back
+			uint64_t nBytesCached = 0;	// bytes sitting in the free lists
+			uint64_t nBytesReserved = 0;// bytes the pool holds from the heap
+		};
+
+		class body_pool
+		{
+		public:
+			static constexpr size_t nMinClassBits = 6;	// 64 B
+			static constexpr size_t nMaxClassBits = 20;	// 1 MB
+			static constexpr size_t nArenaClassBits = 16;	// carve up to 64 KB from arenas
+			static constexpr size_t nArenaSize = size_t(1) << 20;
+			static constexpr size_t nDefaultClassCacheLimit = size_t(8) << 20;
+			static constexpr size_t nDefaultCacheLimit = size_t(64) << 20;
+
+			// One pool for the whole process. It is never destroyed, so bodies
+			// freed during static destruction still have somewhere to go.
+			static body_pool& instance()
+			{
+				static body_pool* pPool = new body_pool();
+				return *pPool;
+			}
+
+			body_pool(const body_pool&) = delete;
+
+		public:
+			void* allocate(size_t nBytes)
+			{
+				m_nAllocs.fetch_add(1, std::memory_order_relaxed);
+				size_t nClass = class_of(nBytes);
+				if (nClass >= nClasses)
+				{
+					m_nOversize.fetch_add(1, std::memory_order_relaxed);
+					m_nHeapAllocs.fetch_add(1, std::memory_order_relaxed);
+					return ::operator new(nBytes);
+				}
+
+				size_t nClassBytes = class_bytes(nClass);
+				m_nBytesInUse.fetch_add(nClassBytes, std::memory_order_relaxed);
+
+				size_class& sc = m_classes[nClass];
+				{
+					std::scoped_lock lock(sc.mux);
+					if (sc.pFree)
+					{
+						free_block* p = sc.pFree;
+						sc.pFree = p->pNext;
+						sc.nCached -= nClassBytes;
+						m_nBytesCached.fetch_sub(nClassBytes, std::memory_order_relaxed);
+						return p;
+					}
+				}
+
+				// Class is empty, get a new buffer for it
+				if (nClass + nMinClassBits <= nArenaClassBits)
+					return carve(nClassBytes);
+
+				m_nHeapAllocs.fetch_add(1, std::memory_order_relaxed);
+				m_nBytesReserved.fetch_add(nClassBytes, std::memory_order_relaxed);
+				return ::operator new(nClassBytes);
+			}
+
+			void deallocate(void* p, size_t nBytes)
+			{
+				if (!p)
+					return;
+
+				m_nFrees.fetch_add(1, std::memory_order_relaxed);
+				size_t nClass = class_of(nBytes);
+				if (nClass >= nClasses)
+				{
+					::operator delete(p);
+					return;
+				}
+
+				size_t nClassBytes = class_bytes(nClass);
+				m_nBytesInUse.fetch_sub(nClassBytes, std::memory_order_relaxed);
+
+				// Arena buffers always go back on their list, a heap buffer only
+				// while the caches have room for it
+				bool bArena = nClass + nMinClassBits <= nArenaClassBits;
+				size_class& sc = m_classes[nClass];
+				{
+					std::scoped_lock lock(sc.mux);
+					if (bArena || (sc.nCached + nClassBytes <= m_nClassCacheLimit.load(std::memory_order_relaxed) &&
+						m_nBytesCached.load(std::memory_order_relaxed) + nClassBytes <= m_nCacheLimit.load(std::memory_order_relaxed)))
+					{
+						free_block* pBlock = static_cast<free_block*>(p);
+						pBlock->pNext = sc.pFree;
+						sc.pFree = pBlock;
+						sc.nCached += nClassBytes;
+						m_nBytesCached.fetch_add(nClassBytes, std::memory_order_relaxed);
+						return;
+					}
+				}
+
+				::operator delete(p);
+				m_nBytesReserved.fetch_sub(nClassBytes, std::memory_order_relaxed);
+			}
+
+			// Most a class from the heap may cache, and most the pool as a
+			// whole may cache, in bytes. Buffers freed beyond either go back
+			// to the heap.
+			void set_cache_limits(size_t nPerClass, size_t nTotal)
+			{
+				m_nClassCacheLimit.store(nPerClass, std::memory_order_relaxed);
+				m_nCacheLimit.store(nTotal, std::memory_order_relaxed);
+			}
+
+			// Gives cached buffers too big for the arenas back to the heap,
+			// largest first, until no more than nWatermark bytes are cached or
+			// only arena memory is left. Cheap when already below it.
+			void trim(size_t nWatermark)
+			{
+				for (size_t nClass = nClasses; nClass-- > nArenaClassBits - nMinClassBits + 1;)
+				{
+					if (m_nBytesCached.load(std::memory_order_relaxed) <= nWatermark)
+						return;
+
+					size_class& sc = m_classes[nClass];
+					size_t nClassBytes = class_bytes(nClass);
+					free_block* p = nullptr;
+					{
+						std::scoped_lock lock(sc.mux);
+						while (sc.pFree && m_nBytesCached.load(std::memory_order_relaxed) > nWatermark)
+						{
+							free_block* pBlock = sc.pFree;
+							sc.pFree = pBlock->pNext;
+							sc.nCached -= nClassBytes;
+							m_nBytesCached.fetch_sub(nClassBytes, std::memory_order_relaxed);
+							pBlock->pNext = p;
+							p = pBlock;
+						}
+					}
+					while (p)
+					{
+						free_block* pNext = p->pNext;
+						::operator delete(p);
+						m_nBytesReserved.fetch_sub(nClassBytes, std::memory_order_relaxed);
+						p = pNext;
+					}
+				}
+			}
+
+			// Gives every cached buffer too big for the arenas back to the
+			// heap, e.g. after a burst of large messages
+			void release_cached()
+			{
+				trim(0);
+			}
+
+			// Number of arenas carved so far. Arenas are never given back, so
+			// an arena's index and address stay valid for the whole run.
+			size_t GetArenaCount() const
+			{
+				return m_nArenas.load(std::memory_order_acquire);
+			}
+
+			// Start of arena nIndex, which must be below GetArenaCount(). Each
+			// is nArenaSize bytes long.
+			uint8_t* GetArena(size_t nIndex)
+			{
+				std::scoped_lock lock(m_muxArena);
+				return m_vArenas[nIndex];
+			}
+
+			body_pool_stats GetStats() const
+			{
+				body_pool_stats s;
+				s.nAllocs = m_nAllocs.load(std::memory_order_relaxed);
+				s.nFrees = m_nFrees.load(std::memory_order_relaxed);
+				s.nHeapAllocs = m_nHeapAllocs.load(std::memory_order_relaxed);
+				s.nOversize = m_nOversize.load(std::memory_order_relaxed);
+				s.nBytesInUse = m_nBytesInUse.load(std::memory_order_relaxed);
+				s.nBytesCached = m_nBytesCached.load(std::memory_order_relaxed);
+				s.nBytesReserved = m_nBytesReserved.load(std::memory_order_relaxed);
+				return s;
+			}
+
+		private:
+			body_pool() = default;
+
+			static constexpr size_t nClasses = nMaxClassBits - nMinClassBits + 1;
+
+			struct free_block
+			{
+				free_block* pNext;
+			};
+
+			struct size_class
+			{
+				std::mutex mux;
+				free_block* pFree = nullptr;
+				size_t nCached = 0;
+			};
+
+			static size_t class_of(size_t nBytes)
+			{
+				size_t nClass = 0;
+				while ((size_t(1) << (nClass + nMinClassBits)) < nBytes)
+					nClass++;
+				return nClass;
+			}
+
+			static size_t class_bytes(size_t nClass)
+			{
+				return size_t(1) << (nClass + nMinClassBits);
+			}
+
+			// Cuts a small buffer off the current arena, starting a new one when
+			// it runs out. What is left of the old arena is not reused.
+			void* carve(size_t nBytes)
+			{
+				std::scoped_lock lock(m_muxArena);
+				if (m_nArenaLeft < nBytes)
+				{
+					m_pArena = static_cast<uint8_t*>(::operator new(nArenaSize));
+					m_nArenaLeft = nArenaSize;
+					m_vArenas.push_back(m_pArena);
+					m_nArenas.store(m_vArenas.size(), std::memory_order_release);
+					m_nHeapAllocs.fetch_add(1, std::memory_order_relaxed);
+					m_nBytesReserved.fetch_add(nArenaSize, std::memory_order_relaxed);
+				}
+				void* p = m_pArena;
+				m_pArena += nBytes;
+				m_nArenaLeft -= nBytes;
+				return p;
+			}
+
+			size_class m_classes[nClasses];
+
+			std::mutex m_muxArena;
+			uint8_t* m_pArena = nullptr;
+			size_t m_nArenaLeft = 0;
+			std::vector<uint8_t*> m_vArenas;
+			std::atomic<size_t> m_nArenas{ 0 };
+
+			std::atomic<size_t> m_nClassCacheLimit{ nDefaultClassCacheLimit };
+			std::atomic<size_t> m_nCacheLimit{ nDefaultCacheLimit };
+
+			std::atomic<uint64_t> m_nAllocs{ 0 };
+			std::atomic<uint64_t> m_nFrees{ 0 };
+			std::atomic<uint64_t> m_nHeapAllocs{ 0 };
+			std::atomic<uint64_t> m_nOversize{ 0 };
+			std::atomic<uint64_t> m_nBytesInUse{ 0 };
+			std::atomic<uint64_t> m_nBytesCached{ 0 };
+			std::atomic<uint64_t> m_nBytesReserved{ 0 };
+		};
+
+		// std::allocator replacement that draws from body_pool
+		template <typename U>
+		struct body_allocator
+		{
+			using value_type = U;
+
+			body_allocator() = default;
+			template <typename V>
+			body_allocator(const body_allocator<V>&) {}
+
+			U* allocate(size_t n)
+			{
+				return static_cast<U*>(body_pool::instance().allocate(n * sizeof(U)));
+			}
+
+			void deallocate(U* p, size_t n)
+			{
+				body_pool::instance().deallocate(p, n * sizeof(U));
+			}
+
+			// Default rather than value initialise, so resize() doesn't zero
+			template <typename V, typename... Args>
+			void construct(V* p, Args&&... args)
+			{
+				if constexpr (sizeof...(Args) == 0)
+					::new (static_cast<void*>(p)) V;
+				else
+					::new (static_cast<void*>(p)) V(std::forward<Args>(args)...);
+			}
+
+			template <typename V>
+			bool operator==(const body_allocator<V>&) const { return true; }
+			template <typename V>
+			bool operator!=(const body_allocator<V>&) const { return false; }
+		};
+
+		using message_body = std::vector<uint8_t, body_allocator<uint8_t>>;
+
+		// Wraps an asio completion handler so the memory asio needs for the
+		// operation comes from body_pool too. asio recycles that memory itself
+		// only on the thread that freed it, and only a couple of blocks at
+		// that, which misses for a Send() from the application's thread or
+		// several writes in flight.
+		template <typename Handler>
+		class pooled_handler
+		{
+		public:
+			using allocator_type = body_allocator<void>;
+
+			explicit pooled_handler(Handler h)
+				: m_handler(std::move(h))
+			{}
+
+			allocator_type get_allocator() const noexcept
+			{
+				return allocator_type();
+			}
+
+			template <typename... Args>
+			void operator()(Args&&... args)
+			{
+				m_handler(std::forward<Args>(args)...);
+			}
+
+		private:
+			Handler m_handler;
+		};
+	}
+}
@@ -0,0 +1,130 @@
+/*
+	The server's connections, by client ID
+
+	The server used to keep its clients in a deque. Finding the one with a
+	given ID meant walking all of them, and so did dropping one that had
+	gone. A server answering one party out of thousands paid for every
+	other party each time.
+
+	connection_registry keeps them in a hash map keyed by the ID the server
+	hands out in ConnectToClient(), so finding, messaging and removing one
+	client is a lookup. Lookups and sends to every client only read the map
+	and take the lock shared, so I/O threads and message handlers don't
+	queue behind each other; adding and removing clients take it alone.
+
+	A server that runs its handlers on a worker pool files each client's
+	handler strand here too. The strand outlives the client's removal, a
+	send that finds the client gone may remove it while its last messages
+	still wait, and goes once the server has handled the message saying
+	the connection closed, which is always the client's last.
+
+	Based on the asio connection objects from olc_net thanks to
+	David Barr, aka javidx9, (c)OneLoneCoder 2019, 2020
+*/
+
+#pragma once
+
+#include "net_common.h"
+#include "net_connection.h"
+
+namespace olc
+{
+	namespace net
+	{
+		template <typename T>
+		class connection_registry
+		{
+		public:
+			// Keeps one client's messages in order on the server's worker pool
+			using handler_strand = boost::asio::strand<boost::asio::thread_pool::executor_type>;
+
+			// Files client under nID, with the strand its messages are handled
+			// on if the server has workers. Returns false, and leaves the
+			// registry as it was, if that ID is taken.
+			bool Add(uint32_t nID, std::shared_ptr<connection<T>> client, std::optional<handler_strand> strand = std::nullopt)
+			{
+				std::unique_lock lock(m_mux);
+				if (!m_mapConnections.emplace(nID, std::move(client)).second)
+					return false;
+				if (strand)
+					m_mapStrands.insert_or_assign(nID, std::move(*strand));
+				return true;
+			}
+
+			// The client with this ID, nullptr if there is none
+			std::shared_ptr<connection<T>> Find(uint32_t nID) const
+			{
+				std::shared_lock lock(m_mux);
+				auto it = m_mapConnections.find(nID);
+				return it == m_mapConnections.end() ? nullptr : it->second;
+			}
+
+			// The handler strand of the client with this ID, none if it was
+			// added without one or RemoveStrand() has been called for it
+			std::optional<handler_strand> FindStrand(uint32_t nID) const
+			{
+				std::shared_lock lock(m_mux);
+				auto it = m_mapStrands.find(nID);
+				if (it == m_mapStrands.end())
+					return std::nullopt;
+				return it->second;
+			}
+
+			// Forgets the handler strand of the client with this ID, once the
+			// last of its messages is handled. Handlers already posted to the
+			// strand keep it going until they are done.
+			void RemoveStrand(uint32_t nID)
+			{
+				std::unique_lock lock(m_mux);
+				m_mapStrands.erase(nID);
+			}
+
+			// Takes the client with this ID out. Returns it, or nullptr if it
+			// was not there, e.g. because another thread removed it first.
+			std::shared_ptr<connection<T>> Remove(uint32_t nID)
+			{
+				std::unique_lock lock(m_mux);
+				auto it = m_mapConnections.find(nID);
+				if (it == m_mapConnections.end())
+					return nullptr;
+				std::shared_ptr<connection<T>> client = std::move(it->second);
+				m_mapConnections.erase(it);
+				return client;
+			}
+
+			// Calls fn(client) for every client, in no particular order. The
+			// registry is locked shared meanwhile, so fn must not Add() or
+			// Remove(); collect the clients instead and do it afterwards.
+			template <typename Fn>
+			void ForEach(Fn&& fn) const
+			{
+				std::shared_lock lock(m_mux);
+				for (const auto& [nID, client] : m_mapConnections)
+					fn(client);
+			}
+
+			size_t Size() const
+			{
+				std::shared_lock lock(m_mux);
+				return m_mapConnections.size();
+			}
+
+			void Clear()
+			{
+				// Destroy the connections outside the lock, their destructors
+				// may wait for the socket to finish
+				std::unordered_map<uint32_t, std::shared_ptr<connection<T>>> mapConnections;
+				{
+					std::unique_lock lock(m_mux);
+					mapConnections.swap(m_mapConnections);
+					m_mapStrands.clear();
+				}
+			}
+
+		private:
+			mutable std::shared_mutex m_mux;
+			std::unordered_map<uint32_t, std::shared_ptr<connection<T>>> m_mapConnections;
+			std::unordered_map<uint32_t, handler_strand> m_mapStrands;
+		};
+	}
+}
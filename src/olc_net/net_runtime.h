@@ -0,0 +1,83 @@
+/*
+	An io_context and threads that many clients share
+
+	Every client_interface used to come with an io_context and a thread to
+	run it. That suits a program that is one party of a protocol, but a
+	load generator standing in for thousands of producers then needs
+	thousands of threads, and spends its time switching between them rather
+	than driving the server.
+
+	A client_runtime is one io_context run by a few threads. Clients built
+	on one make their connections in its context, so their reads and
+	writes are spread over its threads however many clients there are.
+	Each connection still has its own strand, so one client's messages are
+	handled in order, as before. The runtime must outlive its clients.
+
+	Based on the asio connection objects from olc_net thanks to
+	David Barr, aka javidx9, (c)OneLoneCoder 2019, 2020
+*/
+
+#pragma once
+
+#include "net_common.h"
+#include "net_uring.h"
+
+namespace olc
+{
+	namespace net
+	{
+		class client_runtime
+		{
+		public:
+			// Starts nThreads threads running the context straight away. They
+			// keep running, with or without clients, until the runtime goes.
+			explicit client_runtime(size_t nThreads = 1)
+				: m_work(boost::asio::make_work_guard(m_context))
+			{
+				for (size_t i = 0; i < std::max<size_t>(nThreads, 1); i++)
+					m_threads.emplace_back([this]() { m_context.run(); });
+			}
+
+			client_runtime(const client_runtime&) = delete;
+			client_runtime& operator=(const client_runtime&) = delete;
+
+			~client_runtime()
+			{
+				m_work.reset();
+				m_context.stop();
+				for (auto& t : m_threads)
+					if (t.joinable()) t.join();
+			}
+
+			// Clients made after this do their I/O through one io_uring for the
+			// whole runtime, see client_interface::EnableIoUring().
+			// Call before making any clients.
+			bool EnableIoUring()
+			{
+				m_pUring = uring_backend::create(m_context);
+				return m_pUring != nullptr;
+			}
+
+			boost::asio::io_context& GetContext()
+			{
+				return m_context;
+			}
+
+			std::shared_ptr<uring_backend> GetUring() const
+			{
+				return m_pUring;
+			}
+
+			size_t GetThreadCount() const
+			{
+				return m_threads.size();
+			}
+
+		private:
+			boost::asio::io_context m_context;
+			boost::asio::executor_work_guard<boost::asio::io_context::executor_type> m_work;
+			std::shared_ptr<uring_backend> m_pUring;
+			std::vector<std::thread> m_threads;
+		};
+	}
+}
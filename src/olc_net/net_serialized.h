@@ -0,0 +1,123 @@
+/*
+	A stored object kept together with the message that carries it
+
+	A server hands the same stored object, a key another party sent or a
+	ciphertext, to every client that asks for it, and used to serialize it
+	again for each request. serialized keeps the object and its wire form
+	side by side: the message is made once, when the object is stored, and
+	every reply after that shares its body, see shared_message. Storing a
+	new object replaces both at once, so the bytes never go stale.
+
+	Encode is the application's serializer, called as
+	Encode()(obj, std::ostream&), which keeps olc_net free of any one
+	serialization library.
+
+	Like the object it holds, a serialized is not thread safe, keep it
+	under whatever lock guarded the object. The message it hands out may be
+	sent from anywhere, its body is never changed once made.
+
+	Based on the asio connection objects from olc_net thanks to
+	David Barr, aka javidx9, (c)OneLoneCoder 2019, 2020
+*/
+
+#pragma once
+
+#include "net_common.h"
+#include "net_message.h"
+#include "net_msgstream.h"
+#include "net_delta.h"
+
+namespace olc
+{
+	namespace net
+	{
+		template <typename T, typename Obj, typename Encode>
+		class serialized
+		{
+		public:
+			serialized() = default;
+
+			// Stores obj, serialized into the body of a message with this id
+			void Set(Obj obj, T id)
+			{
+				message<T> msg;
+				{
+					message_ostream<T> os(msg);
+					Encode()(obj, os);
+				}
+				msg.header.id = id;
+				Set(std::move(obj), std::move(msg));
+			}
+
+			// Stores obj with a message already made for it, such as the one it
+			// arrived in, so it need not be serialized again. The header is kept
+			// but for the correlation, as each reply carries its own request's.
+			// The body must be obj serialized, not a delta. A message that came
+			// in chunks has no body of its own, so obj is serialized after all.
+			void Set(Obj obj, message<T>&& msg)
+			{
+				if (msg.chunks)
+				{
+					Set(std::move(obj), msg.header.id);
+					return;
+				}
+
+				msg.header.correlation = 0;
+				m_obj = std::move(obj);
+				m_msg = shared_message<T>(std::move(msg));
+				m_bSet = true;
+			}
+
+			// Sends the stored object from now on as a delta against ref, when
+			// that is any smaller, see delta_compress(). The receiver needs ref.
+			// Returns true if it did.
+			template <typename Ref>
+			bool DeltaCompress(const Ref& ref)
+			{
+				message<T> msg;
+				msg.header = m_msg.header;
+				msg.body = Bytes();
+				if (!delta_compress(msg, ref))
+					return false;
+				m_msg = shared_message<T>(std::move(msg));
+				return true;
+			}
+
+			void Reset()
+			{
+				m_obj = Obj();
+				m_msg = shared_message<T>();
+				m_bSet = false;
+			}
+
+			bool IsSet() const
+			{
+				return m_bSet;
+			}
+
+			const Obj& Get() const
+			{
+				return m_obj;
+			}
+
+			// The message to send, copies share its body
+			const shared_message<T>& Message() const
+			{
+				return m_msg;
+			}
+
+			// The serialized object, empty if nothing is stored. After a
+			// DeltaCompress() these are the delta encoded bytes.
+			const message_body& Bytes() const
+			{
+				static const message_body empty;
+				return m_msg.body ? *m_msg.body : empty;
+			}
+
+		private:
+			Obj m_obj{};
+			shared_message<T> m_msg;
+			bool m_bSet = false;
+		};
+	}
+}
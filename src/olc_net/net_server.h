@@ -58,20 +58,49 @@
 
 #include "net_common.h"
 #include "net_tsqueue.h"
+#include "net_mpscqueue.h"
 #include "net_message.h"
 #include "net_connection.h"
+#include "net_registry.h"
 
 namespace olc
 {
 	namespace net
 	{
-		template<typename T>
+		// Snapshot of what a server has waiting to be sent, see GetSendStats()
+		struct server_send_stats
+		{
+			size_t nConnections = 0;
+			size_t nMessagesQueued = 0;		// across all connections
+			size_t nBytesQueued = 0;		// across all connections, headers included
+			size_t nMaxBytesQueued = 0;		// on the most backed up connection
+			size_t nBudgetUsed = 0;			// as counted against the budget
+			size_t nBudget = 0;				// 0 for none
+			uint64_t nSendsRefused = 0;		// by the connections still open
+		};
+
+		// QueueIn is the type of the incoming message queue. The default tsqueue
+		// takes a lock per push and pop, mpsc_queue<owned_message<T>> is a lock-free
+		// alternative for servers with many busy connections. Neither is bounded,
+		// a push from an I/O thread never waits for Update().
+		template<typename T, typename QueueIn = tsqueue<owned_message<T>>>
 		class server_interface
 		{
 		public:
-			// Create a server, ready to listen on specified port
-			server_interface(uint16_t port)
-				: m_asioAcceptor(m_asioContext, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), port))
+			// Create a server, ready to listen on specified port. nThreads is the
+			// number of threads that run the asio context, i.e. do the socket
+			// I/O for all the clients. Each connection is pinned to its own strand
+			// so its handlers never run concurrently, whatever nThreads is.
+			//
+			// nWorkers selects how OnMessage() is called. With 0, the default,
+			// Update() calls it directly, one message at a time. Otherwise
+			// Update() hands each message to a pool of nWorkers threads: the
+			// messages of one client are still handled one after the other, in
+			// the order they arrived, but different clients are handled in
+			// parallel, so the server's own state must then be synchronized.
+			server_interface(uint16_t port, size_t nThreads = 1, size_t nWorkers = 0)
+				: m_asioAcceptor(m_asioContext, stream_protocol::endpoint(boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), port))),
+				  m_nContextThreads(std::max<size_t>(nThreads, 1)), m_nWorkerThreads(nWorkers)
 			{
 
 			}
@@ -82,6 +111,79 @@ namespace olc
 				Stop();
 			}
 
+			// Caps the memory held by messages waiting to be sent. No connection
+			// queues more than nPerConnection bytes, and all of them together no
+			// more than nTotal, 0 being no limit, which is the default. Past the
+			// limit Send() and MessageClient() refuse the message and return
+			// false, SendWait() waits for the queue to drain. Call before Start().
+			void SetSendLimits(size_t nPerConnection, size_t nTotal)
+			{
+				m_nSendLimit = nPerConnection;
+				m_pSendBudget->set_limit(nTotal);
+			}
+
+			// Update() hands the body_pool's cached buffers back to the heap
+			// whenever it holds more than nBytes of them, so a burst of large
+			// messages does not leave the server at its peak size for good
+			void SetPoolWatermark(size_t nBytes)
+			{
+				m_nPoolWatermark = nBytes;
+			}
+
+			// Moves the connections' reads and writes from asio's reactor to an
+			// io_uring, see net_uring.h. Call before Start(). Returns false, and
+			// leaves things as they were, if the kernel won't give us one.
+			bool EnableIoUring()
+			{
+				m_pUring = uring_backend::create(m_asioContext);
+				return m_pUring != nullptr;
+			}
+
+			// Queue depth and bytes waiting, summed over the connections
+			server_send_stats GetSendStats()
+			{
+				server_send_stats s;
+				s.nBudgetUsed = m_pSendBudget->used();
+				s.nBudget = m_pSendBudget->limit();
+
+				m_connections.ForEach([&s](const std::shared_ptr<connection<T>>& client)
+					{
+						s.nConnections++;
+						s.nMessagesQueued += client->GetQueuedMessages();
+						size_t nBytes = client->GetQueuedBytes();
+						s.nBytesQueued += nBytes;
+						s.nMaxBytesQueued = std::max(s.nMaxBytesQueued, nBytes);
+						s.nSendsRefused += client->GetStats().nSendsRefused.load(std::memory_order_relaxed);
+					});
+				return s;
+			}
+
+			// Also accept clients on a local address, "unix:<path>" for an AF_UNIX
+			// socket or "shm:<path>" for shared memory set up over one at that
+			// path. Can be called more than once, before Start().
+			bool Listen(const std::string& sAddress)
+			{
+				std::string sPath;
+				transport t = parse_address(sAddress, sPath);
+				if (t == transport::tcp)
+				{
+					std::cerr << "[SERVER] Not a local address: " << sAddress << "\n";
+					return false;
+				}
+
+				try
+				{
+					m_vListeners.push_back(std::make_unique<listener>(
+						listener{ listen_local(m_asioContext, sPath), t, sPath, sAddress }));
+				}
+				catch (std::exception& e)
+				{
+					std::cerr << "[SERVER] Exception: " << e.what() << "\n";
+					return false;
+				}
+				return true;
+			}
+
 			// Starts the server!
 			bool Start()
 			{
@@ -92,10 +194,17 @@ namespace olc
 					// from exiting immediately. Since this is a server, we 
 					// want it primed ready to handle clients trying to
 					// connect.
-					WaitForClientConnection();
+					WaitForClientConnection(m_asioAcceptor, transport::tcp, "tcp");
+					for (auto& pListener : m_vListeners)
+						WaitForClientConnection(pListener->acceptor, pListener->type, pListener->sAddress);
+
+					// Start the message handlers, if they are not run by Update()
+					if (m_nWorkerThreads > 0)
+						m_pWorkers = std::make_unique<boost::asio::thread_pool>(m_nWorkerThreads);
 
-					// Launch the asio context in its own thread
-					m_threadContext = std::thread([this]() { m_asioContext.run(); });
+					// Launch the asio context in its own pool of threads
+					for (size_t i = 0; i < m_nContextThreads; i++)
+						m_threadsContext.emplace_back([this]() { m_asioContext.run(); });
 				}
 				catch (std::exception& e)
 				{
@@ -104,7 +213,10 @@ namespace olc
 					return false;
 				}
 
-				std::cout << "[SERVER] Started!\n";
+				std::cout << "[SERVER] Started! (" << m_nContextThreads << " I/O threads";
+				if (m_nWorkerThreads > 0)
+					std::cout << ", " << m_nWorkerThreads << " handler threads";
+				std::cout << ")\n";
 				return true;
 			}
 
@@ -114,53 +226,68 @@ namespace olc
 				// Request the context to close
 				m_asioContext.stop();
 
-				// Tidy up the context thread
-				if (m_threadContext.joinable()) m_threadContext.join();
+				// Tidy up the context threads
+				for (auto& t : m_threadsContext)
+					if (t.joinable()) t.join();
+				m_threadsContext.clear();
+
+				// Close the connections here, nothing else runs the context now.
+				// It comes before joining the workers, a handler waiting for a
+				// send queue to drain or for the next chunk of an upload would
+				// otherwise wait forever.
+				m_connections.ForEach([](const std::shared_ptr<connection<T>>& client) { client->CloseStopped(); });
+
+				// Let the handlers that are already queued finish. A derived
+				// server that uses workers should call Stop() from its own
+				// destructor, so they never run on a half destroyed object.
+				if (m_pWorkers)
+					m_pWorkers->join();
+
+				// Drop the connections while the context is still alive. The
+				// handlers still queued in it hold on to some until it goes, so
+				// do messages never taken off the incoming queue. The registry
+				// holds the handler strands too, which belong to the pool, so
+				// this comes before the pool goes.
+				m_connections.Clear();
+				m_qMessagesIn.clear();
+				m_pWorkers.reset();
+				m_pUring.reset();
+
+				// Take the local sockets out of the file system
+				for (auto& pListener : m_vListeners)
+				{
+					boost::system::error_code ec;
+					pListener->acceptor.close(ec);
+					::unlink(pListener->sPath.c_str());
+				}
+				m_vListeners.clear();
 
 				// Inform someone, anybody, if they care...
 				std::cout << "[SERVER] Stopped!\n";
 			}
 
 			// ASYNC - Instruct asio to wait for connection
-			void WaitForClientConnection()
+			void WaitForClientConnection(connection_acceptor& acceptor, transport t, const std::string& sFrom)
 			{
 				// Prime context with an instruction to wait until a socket connects. This
 				// is the purpose of an "acceptor" object. It will provide a unique socket
 				// for each incoming connection attempt
-				m_asioAcceptor.async_accept(
-					[this](std::error_code ec, boost::asio::ip::tcp::socket socket)
+				acceptor.async_accept(boost::asio::make_strand(m_asioContext),
+					[this, &acceptor, t, sFrom](std::error_code ec, connection_socket socket)
 					{
 						// Triggered by incoming connection request
 						if (!ec)
 						{
-							// Display some useful(?) information
-							std::cout << "[SERVER]: New Connection: " << socket.remote_endpoint() << "\n";
-
-							// Create a new connection to handle this client 
-							std::shared_ptr<connection<T>> newconn = 
-								std::make_shared<connection<T>>(connection<T>::owner::server, 
-									m_asioContext, std::move(socket), m_qMessagesIn);
-							
-							
-
-							// Give the user server a chance to deny connection
-							if (OnClientConnect(newconn))
-							{								
-								// Connection allowed, so add to container of new connections
-								m_deqConnections.push_back(std::move(newconn));
-
-								// And very important! Issue a task to the connection's
-								// asio context to sit and wait for bytes to arrive!
-								m_deqConnections.back()->ConnectToClient(nIDCounter++);
-
-								std::cout << "[" << m_deqConnections.back()->GetID() << "]: Connection Approved\n";
+							if (t == transport::shm)
+							{
+								AcceptShm(std::move(socket), sFrom);
 							}
 							else
 							{
-								std::cout << "[-----]: Connection Denied\n";
-
-								// Connection will go out of scope with no pending tasks, so will
-								// get destroyed automagically due to the wonder of smart pointers
+								// Display some useful(?) information
+								boost::system::error_code ecEndpoint;
+								auto endpoint = socket.remote_endpoint(ecEndpoint);
+								AddClient(std::move(socket), t == transport::tcp && !ecEndpoint ? describe_endpoint(endpoint) : sFrom);
 							}
 						}
 						else
@@ -171,67 +298,177 @@ namespace olc
 
 						// Prime the asio context with more work - again simply wait for
 						// another connection...
-						WaitForClientConnection();
+						WaitForClientConnection(acceptor, t, sFrom);
 					});
 			}
 
-			// Send a message to a specific client
-			void MessageClient(std::shared_ptr<connection<T>> client, const message<T>& msg)
+			// A shared memory client sends the file holding the rings as soon as
+			// it has connected. Wait for it without holding up other accepts.
+			void AcceptShm(connection_socket socket, const std::string& sFrom)
+			{
+				auto pSocket = std::make_shared<connection_socket>(std::move(socket));
+				pSocket->async_wait(connection_socket::wait_read,
+					[this, pSocket, sFrom](std::error_code ec)
+					{
+						if (ec)
+							return;
+
+						try
+						{
+							int nFd = detail::recv_fd(pSocket->native_handle());
+							if (nFd < 0)
+								throw std::runtime_error("no shared memory file from client");
+							auto pShm = detail::shm_mapping::open(nFd);
+							AddClient(connection_stream(std::move(*pSocket), std::move(pShm), true), sFrom);
+						}
+						catch (std::exception& e)
+						{
+							std::cout << "[SERVER] Shared memory setup failed: " << e.what() << "\n";
+						}
+					});
+			}
+
+			void AddClient(connection_stream stream, const std::string& sFrom)
+			{
+				std::cout << "[SERVER]: New Connection: " << sFrom << "\n";
+
+				if (m_pUring)
+					stream.use_uring(m_pUring);
+
+				// Create a new connection to handle this client. It is numbered
+				// already, so OnClientConnect can tell the client its ID
+				uint32_t nID = nIDCounter++;
+				std::shared_ptr<connection<T>> newconn = 
+					std::make_shared<connection<T>>(connection<T>::owner::server, 
+						m_asioContext, std::move(stream), m_qMessagesIn, nID);
+				newconn->SetSendLimits(m_nSendLimit, m_pSendBudget);
+
+				// Give the user server a chance to deny connection
+				if (OnClientConnect(newconn))
+				{								
+					// Connection allowed, so file it under its ID before it can
+					// send anything a handler might want to answer by ID, along
+					// with the strand its messages are handled on
+					std::optional<typename connection_registry<T>::handler_strand> strand;
+					if (m_pWorkers)
+						strand.emplace(boost::asio::make_strand(m_pWorkers->get_executor()));
+					m_connections.Add(nID, newconn, std::move(strand));
+
+					// Once the connection closes, Update() removes the client
+					// after the messages it sent before, rather than waiting
+					// for a send to it to fail
+					newconn->SetOnClosed([this, wpConn = std::weak_ptr<connection<T>>(newconn)]()
+						{
+							owned_message<T> msg;
+							msg.remote = wpConn.lock();
+							msg.msg.header.flags = message_flags::closed;
+							if (msg.remote)
+								m_qMessagesIn.push_back(std::move(msg));
+						});
+
+					// And very important! Issue a task to the connection's
+					// asio context to sit and wait for bytes to arrive!
+					newconn->ConnectToClient(nID);
+
+					std::cout << "[" << nID << "]: Connection Approved\n";
+				}
+				else
+				{
+					std::cout << "[-----]: Connection Denied\n";
+
+					// Connection will go out of scope with no pending tasks, so will
+					// get destroyed automagically due to the wonder of smart pointers
+				}
+			}
+
+			// Send a message to a specific client. Returns false if it was not
+			// queued, because the client has gone or its queue is full.
+			bool MessageClient(std::shared_ptr<connection<T>> client, const message<T>& msg)
+			{
+				return MessageClient(std::move(client), shared_message<T>(msg));
+			}
+
+			// As above, with a body that can be sent again, or to other clients,
+			// without being copied
+			bool MessageClient(std::shared_ptr<connection<T>> client, const shared_message<T>& msg)
 			{
 				// Check client is legitimate...
 				if (client && client->IsConnected())
 				{
 					// ...and post the message via the connection
-					client->Send(msg);
+					return client->Send(msg);
 				}
 				else
 				{
 					// If we cant communicate with client then we may as 
-					// well remove the client - let the server know, it may
-					// be tracking it somehow
-					OnClientDisconnect(client);
+					// well remove the client
+					if (client)
+						RemoveClient(client->GetID());
+					return false;
+				}
+			}
 
-					// Off you go now, bye bye!
-					client.reset();
+			// Send a message to the client with this ID. Returns false if there
+			// is no such client or the message was not queued.
+			bool MessageClient(uint32_t nID, const message<T>& msg)
+			{
+				return MessageClient(nID, shared_message<T>(msg));
+			}
 
-					// Then physically remove it from the container
-					m_deqConnections.erase(
-						std::remove(m_deqConnections.begin(), m_deqConnections.end(), client), m_deqConnections.end());
-				}
+			bool MessageClient(uint32_t nID, const shared_message<T>& msg)
+			{
+				std::shared_ptr<connection<T>> client = m_connections.Find(nID);
+				if (!client)
+					return false;
+				return MessageClient(std::move(client), msg);
+			}
+
+			// The client with this ID, nullptr if it has gone or never was
+			std::shared_ptr<connection<T>> GetClient(uint32_t nID) const
+			{
+				return m_connections.Find(nID);
+			}
+
+			// Number of clients, including any that have dropped but not yet
+			// been noticed by a send
+			size_t GetClientCount() const
+			{
+				return m_connections.Size();
 			}
 			
 			// Send message to all clients
 			void MessageAllClients(const message<T>& msg, std::shared_ptr<connection<T>> pIgnoreClient = nullptr)
 			{
-				bool bInvalidClientExists = false;
+				// Every client's queue shares the one copy of the body
+				MessageAllClients(shared_message<T>(msg), pIgnoreClient);
+			}
 
-				// Iterate through all clients in container
-				for (auto& client : m_deqConnections)
-				{
-					// Check client is connected...
-					if (client && client->IsConnected())
-					{
-						// ..it is!
-						if(client != pIgnoreClient)
-							client->Send(msg);
-					}
-					else
+			void MessageAllClients(const shared_message<T>& msg, std::shared_ptr<connection<T>> pIgnoreClient = nullptr)
+			{
+				std::vector<uint32_t> vInvalidClients;
+
+				// Iterate through all clients in the registry
+				m_connections.ForEach([&](const std::shared_ptr<connection<T>>& client)
 					{
-						// The client couldnt be contacted, so assume it has
-						// disconnected.
-						OnClientDisconnect(client);
-						client.reset();
-
-						// Set this flag to then remove dead clients from container
-						bInvalidClientExists = true;
-					}
-				}
+						// Check client is connected...
+						if (client->IsConnected())
+						{
+							// ..it is!
+							if (client != pIgnoreClient)
+								client->Send(msg);
+						}
+						else
+						{
+							// The client couldnt be contacted, so assume it has
+							// disconnected.
+							vInvalidClients.push_back(client->GetID());
+						}
+					});
 
-				// Remove dead clients, all in one go - this way, we dont invalidate the
-				// container as we iterated through it.
-				if (bInvalidClientExists)
-					m_deqConnections.erase(
-						std::remove(m_deqConnections.begin(), m_deqConnections.end(), nullptr), m_deqConnections.end());
+				// Remove dead clients, all in one go once the registry is no
+				// longer being walked
+				for (uint32_t nID : vInvalidClients)
+					RemoveClient(nID);
 			}
 
 			// Force server to respond to incoming messages
@@ -247,11 +484,66 @@ namespace olc
 					// Grab the front message
 					auto msg = m_qMessagesIn.pop_front();
 
-					// Pass to message handler
-					OnMessage(msg.remote, msg.msg);
+					// Pass to message handler, here or on the worker pool
+					if (m_pWorkers)
+						DispatchMessage(std::move(msg));
+					else
+						HandleMessage(msg);
 
 					nMessageCount++;
 				}
+
+				body_pool::instance().trim(m_nPoolWatermark);
+			}
+
+		private:
+			// Drops a client from the registry and lets the server know, it may
+			// be tracking it somehow. Only whoever actually removes it tells,
+			// so a client that two sends find dead is reported once.
+			void RemoveClient(uint32_t nID)
+			{
+				std::shared_ptr<connection<T>> client = m_connections.Remove(nID);
+				if (client)
+					OnClientDisconnect(client);
+			}
+
+			// Queue a message on the handler strand of the client it came from.
+			// The registry keeps the strand until the message saying the
+			// client's connection closed, its last, has been handled, even if a
+			// failed send removed the client before, so every message of one
+			// client runs on the same strand.
+			void DispatchMessage(owned_message<T>&& msg)
+			{
+				std::optional<typename connection_registry<T>::handler_strand> strand =
+					m_connections.FindStrand(msg.remote->GetID());
+				if (!strand)
+				{
+					// Only a connection that was never filed has none, and
+					// nothing else of it can be queued
+					strand.emplace(boost::asio::make_strand(m_pWorkers->get_executor()));
+				}
+
+				boost::asio::post(*strand,
+					[this, msg = std::move(msg)]() mutable
+					{
+						HandleMessage(msg);
+					});
+			}
+
+			// What the handler sends back to the client answers this message.
+			// The message queued when the client's connection closed removes
+			// it instead.
+			void HandleMessage(owned_message<T>& msg)
+			{
+				if (msg.msg.header.flags & message_flags::closed)
+				{
+					RemoveClient(msg.remote->GetID());
+					m_connections.RemoveStrand(msg.remote->GetID());
+					return;
+				}
+
+				typename connection<T>::reply_scope scope(msg.remote.get(), msg.msg.header.correlation);
+				OnMessage(msg.remote, msg.msg);
 			}
 
 		protected:
@@ -259,19 +551,20 @@ namespace olc
 			// customised functionality
 
 			// Called when a client connects, you can veto the connection by returning false
-			virtual bool OnClientConnect(std::shared_ptr<connection<T>> client)
+			virtual bool OnClientConnect(std::shared_ptr<connection<T>> /*client*/)
 			{
 				return false;
 			}
 
-			// Called when a client appears to have disconnected
-			virtual void OnClientDisconnect(std::shared_ptr<connection<T>> client)
+			// Called once a client has gone, after the messages it sent before
+			// its connection closed, or when a send finds it gone first
+			virtual void OnClientDisconnect(std::shared_ptr<connection<T>> /*client*/)
 			{
 
 			}
 
 			// Called when a message arrives
-			virtual void OnMessage(std::shared_ptr<connection<T>> client, message<T>& msg)
+			virtual void OnMessage(std::shared_ptr<connection<T>> /*client*/, message<T>& /*msg*/)
 			{
 
 			}
@@ -279,20 +572,49 @@ namespace olc
 
 		protected:
 			// Thread Safe Queue for incoming message packets
-			tsqueue<owned_message<T>> m_qMessagesIn;
+			QueueIn m_qMessagesIn;
 
-			// Container of active validated connections
-			std::deque<std::shared_ptr<connection<T>>> m_deqConnections;
+			// Active validated connections, by ID
+			connection_registry<T> m_connections;
 
 			// Order of declaration is important - it is also the order of initialisation
 			boost::asio::io_context m_asioContext;
-			std::thread m_threadContext;
+			std::vector<std::thread> m_threadsContext;
 
 			// These things need an asio context
-			boost::asio::ip::tcp::acceptor m_asioAcceptor; // Handles new incoming connection attempts...
+			connection_acceptor m_asioAcceptor; // Handles new incoming connection attempts...
 
-			// Clients will be identified in the "wider system" via an ID
-			uint32_t nIDCounter = 10000;
+			// ...and these on local addresses, see Listen()
+			struct listener
+			{
+				connection_acceptor acceptor;
+				transport type;
+				std::string sPath;
+				std::string sAddress;
+			};
+			std::vector<std::unique_ptr<listener>> m_vListeners;
+
+			// Set by EnableIoUring(), otherwise the reactor does the I/O
+			std::shared_ptr<uring_backend> m_pUring;
+
+			// Clients will be identified in the "wider system" via an ID,
+			// handed out by accept handlers that may run at once
+			std::atomic<uint32_t> nIDCounter{ 10000 };
+
+			// Limits on what each connection, and all of them, may queue to send
+			size_t m_nSendLimit = 0;
+			std::shared_ptr<send_budget> m_pSendBudget = std::make_shared<send_budget>();
+
+			// What Update() trims the body_pool's cache down to
+			size_t m_nPoolWatermark = size_t(16) << 20;
+
+			// Number of threads running m_asioContext
+			size_t m_nContextThreads = 1;
+
+			// Worker pool that runs OnMessage() when m_nWorkerThreads > 0. Each
+			// client's strand on it lives in m_connections.
+			size_t m_nWorkerThreads = 0;
+			std::unique_ptr<boost::asio::thread_pool> m_pWorkers;
 		};
 	}
 }
@@ -0,0 +1,120 @@
+/*
+	Requests parked until what they ask for exists
+
+	A client that asks a server for something the server doesn't hold yet,
+	a ciphertext another party hasn't sent or a key that hasn't been made,
+	used to get a Nack back, sleep and ask again. The answer then arrived up
+	to a whole retry interval after the data did, and every retry cost a
+	round trip.
+
+	subscriptions lets the server keep such a request instead. Subscribe()
+	files the request's header under a key naming the missing resource,
+	and when the resource turns up Notify() hands each waiting request back
+	to the server, with the reply scope of the original request open, so
+	the answer is sent at once and carries the request's correlation number.
+	The client sees nothing but a slower reply.
+
+	Subscribe() must be called under the same lock the server holds while it
+	checks for the resource, and the resource made available under that lock
+	before Notify() is called. Then a request either sees the resource or is
+	in the table by the time Notify() looks, and no wakeup is lost.
+
+	Based on the asio connection objects from olc_net thanks to
+	David Barr, aka javidx9, (c)OneLoneCoder 2019, 2020
+*/
+
+#pragma once
+
+#include "net_common.h"
+#include "net_message.h"
+#include "net_connection.h"
+
+namespace olc
+{
+	namespace net
+	{
+		template <typename T, typename Key = T>
+		class subscriptions
+		{
+		public:
+			struct subscriber
+			{
+				std::weak_ptr<connection<T>> client;
+				message_header<T> request;
+			};
+
+		public:
+			// Parks a request until Notify(key). Only the header is kept, a request
+			// for data has no body worth holding on to. Subscribers whose client
+			// has gone since are dropped on the way.
+			void Subscribe(const Key& key, const std::shared_ptr<connection<T>>& client, const message_header<T>& request)
+			{
+				std::scoped_lock lock(m_mux);
+				auto& vWaiting = m_mapWaiting[key];
+				vWaiting.erase(std::remove_if(vWaiting.begin(), vWaiting.end(),
+					[](const subscriber& s)
+					{
+						auto c = s.client.lock();
+						return !c || !c->IsConnected();
+					}), vWaiting.end());
+				vWaiting.push_back({ client, request });
+			}
+
+			// Takes every request waiting on key out of the table and calls
+			// fnAnswer(client, request) for each one whose client is still
+			// connected, in the order they came. The request is rebuilt from its
+			// header with an empty body. fnAnswer may Subscribe() again, the table
+			// is not locked while it runs. Returns how many were answered.
+			template <typename Fn>
+			size_t Notify(const Key& key, Fn&& fnAnswer)
+			{
+				std::vector<subscriber> vWaiting;
+				{
+					std::scoped_lock lock(m_mux);
+					auto it = m_mapWaiting.find(key);
+					if (it == m_mapWaiting.end())
+						return 0;
+					vWaiting.swap(it->second);
+					m_mapWaiting.erase(it);
+				}
+
+				size_t nAnswered = 0;
+				for (auto& s : vWaiting)
+				{
+					std::shared_ptr<connection<T>> client = s.client.lock();
+					if (!client || !client->IsConnected())
+						continue;
+
+					message<T> msg;
+					msg.header = s.request;
+					msg.header.size = 0;
+					msg.header.total = 0;
+					typename connection<T>::reply_scope scope(client.get(), s.request.correlation);
+					fnAnswer(client, msg);
+					nAnswered++;
+				}
+				return nAnswered;
+			}
+
+			// Number of requests parked on key
+			size_t Waiting(const Key& key) const
+			{
+				std::scoped_lock lock(m_mux);
+				auto it = m_mapWaiting.find(key);
+				return it == m_mapWaiting.end() ? 0 : it->second.size();
+			}
+
+			// Forgets every parked request, e.g. when the data they wait on
+			// will never come
+			void Clear()
+			{
+				std::scoped_lock lock(m_mux);
+				m_mapWaiting.clear();
+			}
+
+		private:
+			mutable std::mutex m_mux;
+			std::unordered_map<Key, std::vector<subscriber>> m_mapWaiting;
+		};
+	}
+}
@@ -0,0 +1,805 @@
+/*
+	Transports a connection can run over
+
+	Every connection used to be a TCP socket, even between processes on the
+	same host talking over loopback. A connection now runs over a
+	connection_stream, which is one of
+
+	- a TCP socket, as before.
+	- an AF_UNIX stream socket, for processes on the same host. The kernel
+	  hands the bytes across without going through the TCP/IP stack.
+	- a pair of byte rings in shared memory, set up over an AF_UNIX socket.
+	  Each side copies straight into the other's view of the rings, and the
+	  socket only carries a one byte doorbell when the other side has gone
+	  to sleep waiting for data or for room. A busy connection makes next to
+	  no syscalls at all.
+
+	A TCP or AF_UNIX stream can also hand its reads and writes to an
+	io_uring in place of asio's reactor, see net_uring.h.
+
+	Sockets use asio's generic stream protocol, so a TCP and an AF_UNIX
+	socket have the same type, and one server can accept on several
+	transports at once. Local addresses are written "unix:<path>" and
+	"shm:<path>", the path being where the AF_UNIX socket lives. Anything
+	else is taken as a TCP host.
+
+	Based on the asio connection objects from olc_net thanks to
+	David Barr, aka javidx9, (c)OneLoneCoder 2019, 2020
+*/
+
+#pragma once
+
+#include <array>
+#include <cstring>
+#include <sstream>
+
+#include "net_common.h"
+#include "net_pool.h"
+#include "net_uring.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace olc
+{
+	namespace net
+	{
+		// The strand each connection's socket runs on. Naming its type in the
+		// socket, rather than the default type-erased any_io_executor, matters:
+		// a strand is too big for any_io_executor's inline storage, and asio
+		// copies the executor several times for every read and write, each copy
+		// a trip to the heap.
+		using connection_strand = boost::asio::strand<boost::asio::io_context::executor_type>;
+		using stream_protocol = boost::asio::generic::stream_protocol;
+		using connection_socket = boost::asio::basic_stream_socket<stream_protocol, connection_strand>;
+		using connection_acceptor = boost::asio::basic_socket_acceptor<stream_protocol>;
+
+		enum class transport
+		{
+			tcp,
+			unix_socket,
+			shm
+		};
+
+		// Bytes in each direction of a shared memory connection
+		constexpr size_t default_shm_ring_size = size_t(4) << 20;
+
+		// Splits "unix:<path>" or "shm:<path>" into its transport and path.
+		// Anything else is a TCP host, and is left as it is.
+		inline transport parse_address(const std::string& sAddress, std::string& sPath)
+		{
+			if (sAddress.rfind("unix:", 0) == 0)
+			{
+				sPath = sAddress.substr(5);
+				return transport::unix_socket;
+			}
+			if (sAddress.rfind("shm:", 0) == 0)
+			{
+				sPath = sAddress.substr(4);
+				return transport::shm;
+			}
+			sPath = sAddress;
+			return transport::tcp;
+		}
+
+		// Something to print for the far end of a socket
+		inline std::string describe_endpoint(const stream_protocol::endpoint& ep)
+		{
+			int nFamily = ep.protocol().family();
+			if (nFamily == AF_INET || nFamily == AF_INET6)
+			{
+				boost::asio::ip::tcp::endpoint tcpEp;
+				std::memcpy(tcpEp.data(), ep.data(), ep.size());
+				tcpEp.resize(ep.size());
+				std::ostringstream os;
+				os << tcpEp;
+				return os.str();
+			}
+			return "local";
+		}
+
+		namespace detail
+		{
+			// One direction of a shared memory connection. Head and tail count
+			// every byte ever written and read, so they never wrap, and each
+			// is only ever stored to by one side. Both live in memory the
+			// other side can write, so neither is trusted.
+			struct shm_ring_header
+			{
+				alignas(64) std::atomic<uint64_t> nHead{ 0 };
+				alignas(64) std::atomic<uint64_t> nTail{ 0 };
+				alignas(64) std::atomic<uint32_t> bReaderWaiting{ 0 };
+				alignas(64) std::atomic<uint32_t> bWriterWaiting{ 0 };
+			};
+
+			static_assert(std::atomic<uint64_t>::is_always_lock_free,
+				"shared memory rings need address free atomics");
+
+			class shm_ring
+			{
+			public:
+				shm_ring() = default;
+
+				shm_ring(shm_ring_header* pHeader, uint8_t* pData, size_t nCapacity)
+					: m_pHeader(pHeader), m_pData(pData), m_nCapacity(nCapacity)
+				{}
+
+				// Consumer side. Copies as much into buffers as the ring holds,
+				// returns the bytes copied. Sets ec if the indices say the ring
+				// holds more than it can.
+				template <typename MutableBuffers>
+				size_t read(const MutableBuffers& buffers, boost::system::error_code& ec)
+				{
+					uint64_t nTail = m_pHeader->nTail.load(std::memory_order_relaxed);
+					uint64_t nUsed = m_pHeader->nHead.load(std::memory_order_acquire) - nTail;
+					if (nUsed > m_nCapacity)
+					{
+						ec = boost::system::errc::make_error_code(boost::system::errc::protocol_error);
+						return 0;
+					}
+					if (nUsed == 0)
+						return 0;
+
+					size_t nOffset = size_t(nTail & (m_nCapacity - 1));
+					size_t nFirst = std::min(size_t(nUsed), m_nCapacity - nOffset);
+					std::array<boost::asio::const_buffer, 2> ring{
+						boost::asio::const_buffer(m_pData + nOffset, nFirst),
+						boost::asio::const_buffer(m_pData, size_t(nUsed) - nFirst) };
+					size_t n = boost::asio::buffer_copy(buffers, ring);
+					m_pHeader->nTail.store(nTail + n, std::memory_order_release);
+					return n;
+				}
+
+				// Producer side. Copies as much of buffers as there is room for,
+				// returns the bytes copied. Sets ec if the indices say the ring
+				// holds more than it can.
+				template <typename ConstBuffers>
+				size_t write(const ConstBuffers& buffers, boost::system::error_code& ec)
+				{
+					uint64_t nHead = m_pHeader->nHead.load(std::memory_order_relaxed);
+					uint64_t nUsed = nHead - m_pHeader->nTail.load(std::memory_order_acquire);
+					if (nUsed > m_nCapacity)
+					{
+						ec = boost::system::errc::make_error_code(boost::system::errc::protocol_error);
+						return 0;
+					}
+					size_t nFree = m_nCapacity - size_t(nUsed);
+					if (nFree == 0)
+						return 0;
+
+					size_t nOffset = size_t(nHead & (m_nCapacity - 1));
+					size_t nFirst = std::min(nFree, m_nCapacity - nOffset);
+					std::array<boost::asio::mutable_buffer, 2> ring{
+						boost::asio::mutable_buffer(m_pData + nOffset, nFirst),
+						boost::asio::mutable_buffer(m_pData, nFree - nFirst) };
+					size_t n = boost::asio::buffer_copy(ring, buffers);
+					m_pHeader->nHead.store(nHead + n, std::memory_order_release);
+					return n;
+				}
+
+				// A side that found nothing to do raises its flag and then looks
+				// again before sleeping. The other side moves its index and then
+				// looks at the flag, so one of the two always sees the other.
+				void set_waiting(bool bReader)
+				{
+					flag(bReader).store(1, std::memory_order_seq_cst);
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+				}
+
+				void clear_waiting(bool bReader)
+				{
+					flag(bReader).store(0, std::memory_order_relaxed);
+				}
+
+				// True, once, if the reader or the writer is asleep and needs
+				// a doorbell
+				bool take_waiting(bool bReader)
+				{
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+					std::atomic<uint32_t>& f = flag(bReader);
+					return f.load(std::memory_order_relaxed) && f.exchange(0, std::memory_order_acq_rel);
+				}
+
+			private:
+				std::atomic<uint32_t>& flag(bool bReader)
+				{
+					return bReader ? m_pHeader->bReaderWaiting : m_pHeader->bWriterWaiting;
+				}
+
+				shm_ring_header* m_pHeader = nullptr;
+				uint8_t* m_pData = nullptr;
+				size_t m_nCapacity = 0;
+			};
+
+			// The two rings of a connection, in one memory file the client
+			// creates and passes to the server over the AF_UNIX socket. The
+			// file is sealed against resizing, or the client could shrink it
+			// under the server's mapping.
+			class shm_mapping
+			{
+			public:
+				// Makes a new mapping with rings of nCapacity bytes, rounded up
+				// to a power of two. Throws on failure.
+				static std::unique_ptr<shm_mapping> create(size_t nCapacity)
+				{
+					size_t n = 4096;
+					while (n < nCapacity)
+						n <<= 1;
+
+#ifdef __linux__
+					int nFd = memfd_create("olc_net_shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#else
+					int nFd = -1;
+					errno = ENOSYS;
+#endif
+					if (nFd < 0)
+						throw std::system_error(errno, std::generic_category(), "memfd_create");
+					if (ftruncate(nFd, off_t(nHeaderBytes + 2 * n)) != 0)
+					{
+						int nErr = errno;
+						close(nFd);
+						throw std::system_error(nErr, std::generic_category(), "ftruncate");
+					}
+					if (fcntl(nFd, F_ADD_SEALS, nSizeSeals) != 0)
+					{
+						int nErr = errno;
+						close(nFd);
+						throw std::system_error(nErr, std::generic_category(), "F_ADD_SEALS");
+					}
+
+					auto pMapping = std::unique_ptr<shm_mapping>(new shm_mapping(nFd, nHeaderBytes + 2 * n));
+					layout* pLayout = new (pMapping->m_pBase) layout();
+					pLayout->nCapacity = n;
+					pLayout->nMagic = nMagic;
+					pMapping->Attach();
+					return pMapping;
+				}
+
+				// Maps a memory file made by create() on the other side, taking
+				// ownership of nFd. Throws if it is not one.
+				static std::unique_ptr<shm_mapping> open(int nFd)
+				{
+#ifdef __linux__
+					int nSeals = fcntl(nFd, F_GET_SEALS);
+#else
+					int nSeals = -1;
+#endif
+					if (nSeals < 0 || (nSeals & nSizeSeals) != nSizeSeals)
+					{
+						close(nFd);
+						throw std::runtime_error("shared memory file can still be resized");
+					}
+
+					struct stat st;
+					if (fstat(nFd, &st) != 0 || size_t(st.st_size) < nHeaderBytes)
+					{
+						close(nFd);
+						throw std::runtime_error("shared memory file too small");
+					}
+
+					auto pMapping = std::unique_ptr<shm_mapping>(new shm_mapping(nFd, size_t(st.st_size)));
+					const layout* pLayout = static_cast<const layout*>(pMapping->m_pBase);
+					size_t n = size_t(pLayout->nCapacity);
+					if (pLayout->nMagic != nMagic || n == 0 || (n & (n - 1)) != 0 ||
+						nHeaderBytes + 2 * n != pMapping->m_nSize)
+						throw std::runtime_error("not an olc_net shared memory file");
+					pMapping->Attach();
+					return pMapping;
+				}
+
+				~shm_mapping()
+				{
+					munmap(m_pBase, m_nSize);
+					close(m_nFd);
+				}
+
+				int fd() const
+				{
+					return m_nFd;
+				}
+
+				// Client to server ring, and server to client ring
+				shm_ring& upstream() { return m_rings[0]; }
+				shm_ring& downstream() { return m_rings[1]; }
+
+			private:
+				static constexpr uint64_t nMagic = 0x6873742d636c6f31ull;
+#ifdef __linux__
+				static constexpr int nSizeSeals = F_SEAL_SHRINK | F_SEAL_GROW;
+#else
+				static constexpr int nSizeSeals = 0;
+#endif
+
+				struct layout
+				{
+					uint64_t nMagic = 0;
+					uint64_t nCapacity = 0;
+					shm_ring_header rings[2];
+				};
+
+				// Ring data starts on a page of its own
+				static constexpr size_t nHeaderBytes = (sizeof(layout) + 4095) & ~size_t(4095);
+
+				shm_mapping(int nFd, size_t nSize)
+					: m_nFd(nFd), m_nSize(nSize)
+				{
+					m_pBase = mmap(nullptr, nSize, PROT_READ | PROT_WRITE, MAP_SHARED, nFd, 0);
+					if (m_pBase == MAP_FAILED)
+					{
+						int nErr = errno;
+						close(nFd);
+						throw std::system_error(nErr, std::generic_category(), "mmap");
+					}
+				}
+
+				void Attach()
+				{
+					layout* pLayout = static_cast<layout*>(m_pBase);
+					size_t n = size_t(pLayout->nCapacity);
+					uint8_t* pData = static_cast<uint8_t*>(m_pBase) + nHeaderBytes;
+					m_rings[0] = shm_ring(&pLayout->rings[0], pData, n);
+					m_rings[1] = shm_ring(&pLayout->rings[1], pData + n, n);
+				}
+
+				int m_nFd = -1;
+				void* m_pBase = nullptr;
+				size_t m_nSize = 0;
+				shm_ring m_rings[2];
+			};
+
+			// Passes a file descriptor over an AF_UNIX socket, with one byte
+			// of data for it to travel with
+			inline bool send_fd(int nSocket, int nFd)
+			{
+				char c = 0;
+				iovec iov{ &c, 1 };
+				alignas(cmsghdr) char aControl[CMSG_SPACE(sizeof(int))] = {};
+				msghdr msg{};
+				msg.msg_iov = &iov;
+				msg.msg_iovlen = 1;
+				msg.msg_control = aControl;
+				msg.msg_controllen = sizeof(aControl);
+				cmsghdr* pCmsg = CMSG_FIRSTHDR(&msg);
+				pCmsg->cmsg_level = SOL_SOCKET;
+				pCmsg->cmsg_type = SCM_RIGHTS;
+				pCmsg->cmsg_len = CMSG_LEN(sizeof(int));
+				std::memcpy(CMSG_DATA(pCmsg), &nFd, sizeof(int));
+				return sendmsg(nSocket, &msg, MSG_NOSIGNAL) == 1;
+			}
+
+			// Receives what send_fd() sent, or returns -1
+			inline int recv_fd(int nSocket)
+			{
+				char c = 0;
+				iovec iov{ &c, 1 };
+				alignas(cmsghdr) char aControl[CMSG_SPACE(sizeof(int))] = {};
+				msghdr msg{};
+				msg.msg_iov = &iov;
+				msg.msg_iovlen = 1;
+				msg.msg_control = aControl;
+				msg.msg_controllen = sizeof(aControl);
+				if (recvmsg(nSocket, &msg, MSG_CMSG_CLOEXEC) != 1)
+					return -1;
+				cmsghdr* pCmsg = CMSG_FIRSTHDR(&msg);
+				if (!pCmsg || pCmsg->cmsg_level != SOL_SOCKET || pCmsg->cmsg_type != SCM_RIGHTS)
+					return -1;
+				int nFd = -1;
+				std::memcpy(&nFd, CMSG_DATA(pCmsg), sizeof(int));
+				return nFd;
+			}
+		}
+
+		// What a connection reads and writes through. asio's async_read() and
+		// async_write() drive it like any other stream. Over a socket every
+		// call goes straight to the socket, over shared memory the bytes go
+		// through the rings and the socket only carries doorbells. Like the
+		// socket it must only be used on its strand.
+		class connection_stream
+		{
+		public:
+			using executor_type = connection_strand;
+
+			connection_stream(connection_socket socket)
+				: m_socket(std::move(socket))
+			{}
+
+			// Shared memory stream over an AF_UNIX socket whose peer holds the
+			// same mapping. bServer says which ring is ours to read.
+			connection_stream(connection_socket socket, std::unique_ptr<detail::shm_mapping> pShm, bool bServer)
+				: m_socket(std::move(socket)), m_pShm(std::move(pShm))
+			{
+				m_ringIn = bServer ? m_pShm->upstream() : m_pShm->downstream();
+				m_ringOut = bServer ? m_pShm->downstream() : m_pShm->upstream();
+			}
+
+			connection_stream(connection_stream&&) = default;
+
+			// The kernel may still be writing into a buffer of ours
+			~connection_stream()
+			{
+				if (m_pUringInFlight && m_pUringInFlight->load() > 0)
+				{
+					::shutdown(m_socket.native_handle(), SHUT_RDWR);
+					m_pUring->wait_idle(*m_pUringInFlight);
+				}
+			}
+
+			// Sends reads and writes through pUring from now on. Has no effect
+			// on a shared memory stream, which barely makes syscalls anyway.
+			void use_uring(std::shared_ptr<uring_backend> pUring)
+			{
+				if (m_pShm || !pUring)
+					return;
+				m_pUring = std::move(pUring);
+				m_pUringInFlight = std::make_unique<std::atomic<int>>(0);
+			}
+
+			bool uses_uring() const
+			{
+				return m_pUring != nullptr;
+			}
+
+			// Waits for the kernel to finish the reads and writes it still
+			// holds, after close() has ended them. Their handlers are posted
+			// meanwhile, whether or not anything is running the context.
+			void wait_idle()
+			{
+				if (m_pUringInFlight && m_pUringInFlight->load() > 0)
+					m_pUring->wait_idle(*m_pUringInFlight);
+			}
+
+			executor_type get_executor() noexcept
+			{
+				return m_socket.get_executor();
+			}
+
+			connection_socket& socket()
+			{
+				return m_socket;
+			}
+
+			bool is_open() const
+			{
+				return m_socket.is_open();
+			}
+
+			// Anything waiting on the stream completes with operation_aborted
+			void close()
+			{
+				// A read or write in the ring holds on to the socket, closing
+				// the descriptor alone would not end it
+				if (m_pUring && m_socket.is_open())
+					::shutdown(m_socket.native_handle(), SHUT_RDWR);
+				boost::system::error_code ec;
+				m_socket.close(ec);
+			}
+
+			template <typename MutableBuffers, typename Handler>
+			void async_read_some(const MutableBuffers& buffers, Handler&& handler)
+			{
+				if (m_pUring)
+					StartUringOp<true, boost::asio::mutable_buffer>(buffers, std::forward<Handler>(handler));
+				else if (!m_pShm)
+					m_socket.async_read_some(buffers, std::forward<Handler>(handler));
+				else
+					StartShmOp(m_pReadOp, MakeOp<true>(buffers, std::forward<Handler>(handler)));
+			}
+
+			template <typename ConstBuffers, typename Handler>
+			void async_write_some(const ConstBuffers& buffers, Handler&& handler)
+			{
+				if (m_pUring)
+					StartUringOp<false, boost::asio::const_buffer>(buffers, std::forward<Handler>(handler));
+				else if (!m_pShm)
+					m_socket.async_write_some(buffers, std::forward<Handler>(handler));
+				else
+					StartShmOp(m_pWriteOp, MakeOp<false>(buffers, std::forward<Handler>(handler)));
+			}
+
+		private:
+			// A read or write on the rings that could not finish straight away
+			struct shm_op
+			{
+				// Moves what it can, returns true once it has completed
+				virtual bool perform(connection_stream& s) = 0;
+				virtual void fail(connection_stream& s, const boost::system::error_code& ec) = 0;
+				virtual void destroy() = 0;
+
+			protected:
+				~shm_op() = default;
+			};
+
+			struct op_deleter
+			{
+				void operator()(shm_op* p) const { p->destroy(); }
+			};
+
+			using op_ptr = std::unique_ptr<shm_op, op_deleter>;
+
+			template <bool bRead, typename Buffers, typename Handler>
+			struct shm_op_impl : shm_op
+			{
+				shm_op_impl(const Buffers& b, Handler h)
+					: buffers(b), handler(std::move(h))
+				{}
+
+				bool perform(connection_stream& s) override
+				{
+					if (boost::asio::buffer_size(buffers) == 0)
+					{
+						complete(s, boost::system::error_code(), 0);
+						return true;
+					}
+
+					// A peer that corrupts the indices has broken the protocol,
+					// the connection fails as it would on a socket error
+					detail::shm_ring& ring = bRead ? s.m_ringIn : s.m_ringOut;
+					boost::system::error_code ec;
+					size_t n = Move(ring, ec);
+					if (n == 0 && !ec)
+					{
+						// Nothing to do, say we are waiting and look once more
+						ring.set_waiting(bRead);
+						n = Move(ring, ec);
+						if (n == 0 && !ec)
+						{
+							if (!s.m_bPeerClosed)
+								return false;
+							complete(s, bRead ? boost::system::error_code(boost::asio::error::eof)
+								: boost::system::error_code(boost::asio::error::broken_pipe), 0);
+							return true;
+						}
+						ring.clear_waiting(bRead);
+					}
+					if (ec)
+					{
+						complete(s, ec, 0);
+						return true;
+					}
+
+					// The other side may be asleep waiting for what we just did
+					if (ring.take_waiting(!bRead))
+						s.RingDoorbell();
+					complete(s, boost::system::error_code(), n);
+					return true;
+				}
+
+				void fail(connection_stream& s, const boost::system::error_code& ec) override
+				{
+					complete(s, ec, 0);
+				}
+
+				void destroy() override
+				{
+					this->~shm_op_impl();
+					body_pool::instance().deallocate(this, sizeof(*this));
+				}
+
+				size_t Move(detail::shm_ring& ring, boost::system::error_code& ec)
+				{
+					if constexpr (bRead)
+						return ring.read(buffers, ec);
+					else
+						return ring.write(buffers, ec);
+				}
+
+				// Never calls the handler from inside the initiating call
+				void complete(connection_stream& s, const boost::system::error_code& ec, size_t n)
+				{
+					auto ex = boost::asio::get_associated_executor(handler, s.get_executor());
+					boost::asio::post(ex, pooled_handler(
+						[h = std::move(handler), ec, n]() mutable { h(ec, n); }));
+				}
+
+				Buffers buffers;
+				Handler handler;
+			};
+
+			template <bool bRead, typename Buffers, typename Handler>
+			static op_ptr MakeOp(const Buffers& buffers, Handler&& handler)
+			{
+				using op = shm_op_impl<bRead, Buffers, std::decay_t<Handler>>;
+				void* p = body_pool::instance().allocate(sizeof(op));
+				return op_ptr(new (p) op(buffers, std::forward<Handler>(handler)));
+			}
+
+			void StartShmOp(op_ptr& slot, op_ptr pOp)
+			{
+				if (!is_open())
+				{
+					pOp->fail(*this, boost::asio::error::bad_descriptor);
+					return;
+				}
+				if (pOp->perform(*this))
+					return;
+
+				// Wait for the other side to ring
+				slot = std::move(pOp);
+				ArmDoorbell();
+			}
+
+			void ArmDoorbell()
+			{
+				if (m_bDoorbellArmed)
+					return;
+				m_bDoorbellArmed = true;
+				m_socket.async_read_some(boost::asio::buffer(m_aDoorbell),
+					pooled_handler([this](const boost::system::error_code& ec, std::size_t)
+					{
+						OnDoorbell(ec);
+					}));
+			}
+
+			void OnDoorbell(const boost::system::error_code& ec)
+			{
+				m_bDoorbellArmed = false;
+
+				// An error means the peer has gone, or we closed the socket. A
+				// reader still gets whatever is left in the ring.
+				if (ec)
+					m_bPeerClosed = true;
+				bool bAborted = ec == boost::asio::error::operation_aborted || !is_open();
+
+				for (op_ptr* pSlot : { &m_pReadOp, &m_pWriteOp })
+				{
+					if (!*pSlot)
+						continue;
+					if (bAborted)
+					{
+						(*pSlot)->fail(*this, boost::asio::error::operation_aborted);
+						pSlot->reset();
+					}
+					else if ((*pSlot)->perform(*this))
+						pSlot->reset();
+				}
+
+				if ((m_pReadOp || m_pWriteOp) && !m_bPeerClosed)
+					ArmDoorbell();
+			}
+
+			// Any byte will do, if the socket is full there are doorbells
+			// enough waiting already
+			void RingDoorbell()
+			{
+				char c = 0;
+				::send(m_socket.native_handle(), &c, 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+			}
+
+			// A read or write on the ring. It owns the handler until the
+			// kernel is done, and never touches the stream after that.
+			template <bool bRead, typename Handler>
+			struct uring_op_impl : uring_op
+			{
+				using executor_t = boost::asio::associated_executor_t<Handler, executor_type>;
+
+				uring_op_impl(Handler h, executor_t ex, std::atomic<int>* pInFlight)
+					: handler(std::move(h)), executor(std::move(ex)), pInFlight(pInFlight)
+				{}
+
+				void complete(int nResult) override
+				{
+					boost::system::error_code ec;
+					size_t n = 0;
+					if (nResult == -ECANCELED)
+						ec = boost::asio::error::operation_aborted;
+					else if (nResult < 0)
+						ec = boost::system::error_code(-nResult, boost::system::system_category());
+					else if (nResult == 0)
+						ec = bRead ? boost::system::error_code(boost::asio::error::eof)
+							: boost::system::error_code(boost::asio::error::broken_pipe);
+					else
+						n = size_t(nResult);
+
+					Handler h = std::move(handler);
+					executor_t ex = std::move(executor);
+					std::atomic<int>* p = pInFlight;
+					this->~uring_op_impl();
+					body_pool::instance().deallocate(this, sizeof(*this));
+
+					boost::asio::post(ex, pooled_handler([h = std::move(h), ec, n]() mutable { h(ec, n); }));
+					p->fetch_sub(1);
+				}
+
+				Handler handler;
+				executor_t executor;
+				std::atomic<int>* pInFlight;
+			};
+
+			template <bool bRead, typename Buffer, typename Buffers, typename Handler>
+			void StartUringOp(const Buffers& buffers, Handler&& handler)
+			{
+				using handler_t = std::decay_t<Handler>;
+				using op = uring_op_impl<bRead, handler_t>;
+				auto ex = boost::asio::get_associated_executor(handler, get_executor());
+
+				auto fnPost = [&](const boost::system::error_code& ec)
+				{
+					boost::asio::post(ex, pooled_handler(
+						[h = std::forward<Handler>(handler), ec]() mutable { h(ec, 0); }));
+				};
+
+				if (!is_open())
+				{
+					fnPost(boost::asio::error::bad_descriptor);
+					return;
+				}
+
+				void* p = body_pool::instance().allocate(sizeof(op));
+				op* pOp = new (p) op(std::forward<Handler>(handler), ex, m_pUringInFlight.get());
+				pOp->nFd = m_socket.native_handle();
+				pOp->bRead = bRead;
+
+				// A write_some may take fewer buffers than it is given
+				for (auto it = boost::asio::buffer_sequence_begin(buffers);
+					it != boost::asio::buffer_sequence_end(buffers) && pOp->nIov < uring_op::nMaxIov; ++it)
+				{
+					Buffer b(*it);
+					if (b.size() == 0)
+						continue;
+					pOp->aIov[pOp->nIov].iov_base = const_cast<void*>(static_cast<const void*>(b.data()));
+					pOp->aIov[pOp->nIov].iov_len = b.size();
+					pOp->nIov++;
+				}
+
+				// Nothing to move, or the ring has failed
+				bool bEmpty = pOp->nIov == 0;
+				m_pUringInFlight->fetch_add(1);
+				if (bEmpty || !m_pUring->submit(pOp))
+				{
+					m_pUringInFlight->fetch_sub(1);
+					handler_t h = std::move(pOp->handler);
+					pOp->~op();
+					body_pool::instance().deallocate(p, sizeof(op));
+					boost::asio::post(ex, pooled_handler(
+						[h = std::move(h), bEmpty]() mutable
+						{
+							h(bEmpty ? boost::system::error_code() : boost::system::error_code(boost::asio::error::fault), 0);
+						}));
+				}
+			}
+
+			connection_socket m_socket;
+
+			std::shared_ptr<uring_backend> m_pUring;
+			std::unique_ptr<std::atomic<int>> m_pUringInFlight;
+
+			std::unique_ptr<detail::shm_mapping> m_pShm;
+			detail::shm_ring m_ringIn;
+			detail::shm_ring m_ringOut;
+			op_ptr m_pReadOp;
+			op_ptr m_pWriteOp;
+			bool m_bDoorbellArmed = false;
+			bool m_bPeerClosed = false;
+			std::array<uint8_t, 64> m_aDoorbell{};
+		};
+
+		// Connects a stream to a server listening on an AF_UNIX socket at
+		// sPath, over the socket itself or over shared memory set up through
+		// it. Throws on failure.
+		inline connection_stream connect_local(boost::asio::io_context& context, transport t,
+			const std::string& sPath, size_t nRingSize = default_shm_ring_size)
+		{
+			connection_socket socket(boost::asio::make_strand(context));
+			socket.connect(stream_protocol::endpoint(boost::asio::local::stream_protocol::endpoint(sPath)));
+			if (t != transport::shm)
+				return connection_stream(std::move(socket));
+
+			auto pShm = detail::shm_mapping::create(nRingSize);
+			if (!detail::send_fd(socket.native_handle(), pShm->fd()))
+				throw std::system_error(errno, std::generic_category(), "send_fd");
+			return connection_stream(std::move(socket), std::move(pShm), false);
+		}
+
+		// Listens on an AF_UNIX socket at sPath, replacing any left behind by
+		// an earlier run
+		inline connection_acceptor listen_local(boost::asio::io_context& context, const std::string& sPath)
+		{
+			::unlink(sPath.c_str());
+			return connection_acceptor(context,
+				stream_protocol::endpoint(boost::asio::local::stream_protocol::endpoint(sPath)));
+		}
+	}
+}
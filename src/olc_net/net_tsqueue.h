@@ -57,6 +57,7 @@
 #pragma once
 
 #include "net_common.h"
+#include "net_pool.h"
 
 namespace olc
 {
@@ -106,8 +107,22 @@ namespace olc
 			// Adds an item to back of Queue
 			void push_back(const T& item)
 			{
-				std::scoped_lock lock(muxQueue);
-				deqQueue.emplace_back(std::move(item));
+				{
+					std::scoped_lock lock(muxQueue);
+					deqQueue.emplace_back(std::move(item));
+				}
+
+				std::unique_lock<std::mutex> ul(muxBlocking);
+				cvBlocking.notify_one();
+			}
+
+			// Adds an item to back of Queue, taking ownership of it
+			void push_back(T&& item)
+			{
+				{
+					std::scoped_lock lock(muxQueue);
+					deqQueue.emplace_back(std::move(item));
+				}
 
 				std::unique_lock<std::mutex> ul(muxBlocking);
 				cvBlocking.notify_one();
@@ -116,8 +131,10 @@ namespace olc
 			// Adds an item to front of Queue
 			void push_front(const T& item)
 			{
-				std::scoped_lock lock(muxQueue);
-				deqQueue.emplace_front(std::move(item));
+				{
+					std::scoped_lock lock(muxQueue);
+					deqQueue.emplace_front(std::move(item));
+				}
 
 				std::unique_lock<std::mutex> ul(muxBlocking);
 				cvBlocking.notify_one();
@@ -144,18 +161,19 @@ namespace olc
 				deqQueue.clear();
 			}
 
+			// Blocks until there is at least one item. The emptiness check is made
+			// while holding muxBlocking, and pushers only notify after taking it,
+			// so a push cannot slip in between the check and the wait.
 			void wait()
 			{
-				while (empty())
-				{
-					std::unique_lock<std::mutex> ul(muxBlocking);
-					cvBlocking.wait(ul);
-				}
+				std::unique_lock<std::mutex> ul(muxBlocking);
+				cvBlocking.wait(ul, [this]() { return !empty(); });
 			}
 
 		protected:
 			std::mutex muxQueue;
-			std::deque<T> deqQueue;
+			// Node blocks come from body_pool, like the bodies they hold
+			std::deque<T, body_allocator<T>> deqQueue;
 			std::condition_variable cvBlocking;
 			std::mutex muxBlocking;
 		};
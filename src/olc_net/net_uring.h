@@ -0,0 +1,393 @@
+/*
+	io_uring backend for socket reads and writes
+
+	asio's reactor moves a large message a socket buffer at a time: a read()
+	for whatever has arrived, then EAGAIN, then back to epoll_wait() for the
+	next wakeup. A multi megabyte key costs hundreds of syscalls at each end,
+	and a server with many connections spends a good part of its CPU there.
+
+	uring_backend hands reads and writes to the kernel through an io_uring
+	instead. A read asks for the whole buffer with MSG_WAITALL and a write
+	sends every buffer it is given, so one submission moves one message, and
+	completions for all connections come back through a single eventfd that
+	asio watches. Buffers that lie in one of body_pool's arenas, which is
+	where every body up to 64 KB lives, are registered with the ring, and
+	reads and writes of them skip pinning the pages on every call.
+
+	This talks to the kernel directly rather than through liburing, which
+	the build does not otherwise need, and asio's own io_uring support,
+	which needs Boost 1.78. Where io_uring is missing or not permitted,
+	create() returns nullptr and connections stay on the reactor.
+
+	Based on the asio connection objects from olc_net thanks to
+	David Barr, aka javidx9, (c)OneLoneCoder 2019, 2020
+*/
+
+#pragma once
+
+#include <map>
+
+#include "net_common.h"
+#include "net_pool.h"
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define OLC_NET_HAS_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace olc
+{
+	namespace net
+	{
+		// One read or write handed to the ring. Whoever reaps its completion
+		// calls complete() with the byte count or a negated errno, on no
+		// particular thread, so complete() should only post the handler on.
+		struct uring_op
+		{
+			static constexpr unsigned nMaxIov = 64;
+
+			int nFd = -1;
+			bool bRead = false;
+			unsigned nIov = 0;
+			iovec aIov[nMaxIov];
+			msghdr msg{};
+
+			virtual void complete(int nResult) = 0;
+
+		protected:
+			~uring_op() = default;
+		};
+
+#ifdef OLC_NET_HAS_IO_URING
+		class uring_backend : public std::enable_shared_from_this<uring_backend>
+		{
+		public:
+			// Fixed buffer slots, one per arena, so up to 1 GB of arenas
+			static constexpr unsigned nFixedSlots = 1024;
+
+			// A ring whose completions are picked up by context, or nullptr
+			// if this kernel won't give us one
+			static std::shared_ptr<uring_backend> create(boost::asio::io_context& context, unsigned nEntries = 256)
+			{
+				std::shared_ptr<uring_backend> p(new uring_backend(context));
+				if (!p->Setup(nEntries))
+					return nullptr;
+				p->WaitForCompletions();
+				return p;
+			}
+
+			uring_backend(const uring_backend&) = delete;
+
+			~uring_backend()
+			{
+				// The eventfd belongs to m_eventfd, which closes it
+				if (m_pSqes)
+					::munmap(m_pSqes, m_nSqesSize);
+				if (m_pRing)
+					::munmap(m_pRing, m_nRingSize);
+				if (m_nRingFd >= 0)
+					::close(m_nRingFd);
+			}
+
+		public:
+			// Hands pOp to the kernel. Returns false if the ring has failed, in
+			// which case pOp is left untouched.
+			bool submit(uring_op* pOp)
+			{
+				std::scoped_lock lock(m_mux);
+
+				io_uring_sqe sqe{};
+				sqe.fd = pOp->nFd;
+				sqe.user_data = reinterpret_cast<uint64_t>(pOp);
+
+				uint16_t nFixed = 0;
+				if (pOp->nIov == 1 && FindFixed(pOp->aIov[0], nFixed))
+				{
+					// read()/write() on a stream socket, at its current position
+					sqe.opcode = pOp->bRead ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+					sqe.addr = reinterpret_cast<uint64_t>(pOp->aIov[0].iov_base);
+					sqe.len = uint32_t(pOp->aIov[0].iov_len);
+					sqe.off = uint64_t(-1);
+					sqe.buf_index = nFixed;
+				}
+				else if (pOp->nIov == 1)
+				{
+					sqe.opcode = pOp->bRead ? IORING_OP_RECV : IORING_OP_SEND;
+					sqe.addr = reinterpret_cast<uint64_t>(pOp->aIov[0].iov_base);
+					sqe.len = uint32_t(pOp->aIov[0].iov_len);
+					sqe.msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+				}
+				else
+				{
+					pOp->msg = msghdr{};
+					pOp->msg.msg_iov = pOp->aIov;
+					pOp->msg.msg_iovlen = pOp->nIov;
+					sqe.opcode = pOp->bRead ? IORING_OP_RECVMSG : IORING_OP_SENDMSG;
+					sqe.addr = reinterpret_cast<uint64_t>(&pOp->msg);
+					sqe.len = 1;
+					sqe.msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+				}
+
+				// We submit as we go, so the queue only holds this entry
+				unsigned nTail = *m_pSqTail;
+				unsigned nIndex = nTail & *m_pSqMask;
+				m_pSqes[nIndex] = sqe;
+				m_pSqArray[nIndex] = nIndex;
+				__atomic_store_n(m_pSqTail, nTail + 1, __ATOMIC_RELEASE);
+
+				while (true)
+				{
+					int n = Enter(1, 0, 0);
+					if (n >= 0)
+						return true;
+					if (errno == EINTR)
+						continue;
+					if (errno == EBUSY || errno == EAGAIN)
+					{
+						// Completions have backed up, make room and try again
+						Reap();
+						continue;
+					}
+
+					// Take the entry back, nothing else can have queued behind it
+					__atomic_store_n(m_pSqTail, nTail, __ATOMIC_RELEASE);
+					return false;
+				}
+			}
+
+			// Waits until nInFlight drops to zero, reaping completions for
+			// everyone meanwhile. A stream calls this before it goes away, so
+			// the kernel is done with its buffers.
+			void wait_idle(const std::atomic<int>& nInFlight)
+			{
+				std::scoped_lock lock(m_mux);
+				while (true)
+				{
+					Reap();
+					if (nInFlight.load() == 0)
+						return;
+					if (Enter(0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+						return;
+				}
+			}
+
+			// How often a read or write went through a registered buffer,
+			// and how often not
+			void GetStats(uint64_t& nFixed, uint64_t& nPlain) const
+			{
+				nFixed = m_nFixedOps.load(std::memory_order_relaxed);
+				nPlain = m_nPlainOps.load(std::memory_order_relaxed);
+			}
+
+		private:
+			explicit uring_backend(boost::asio::io_context& context)
+				: m_eventfd(context)
+			{}
+
+			int Enter(unsigned nSubmit, unsigned nMinComplete, unsigned nFlags)
+			{
+				return int(::syscall(SYS_io_uring_enter, m_nRingFd, nSubmit, nMinComplete, nFlags, nullptr, 0));
+			}
+
+			int Register(unsigned nOpcode, void* pArg, unsigned nArgs)
+			{
+				return int(::syscall(SYS_io_uring_register, m_nRingFd, nOpcode, pArg, nArgs));
+			}
+
+			bool Setup(unsigned nEntries)
+			{
+				// Every connection keeps a read in the ring, so let completions
+				// far outnumber submissions
+				io_uring_params params{};
+				params.flags = IORING_SETUP_CQSIZE;
+				params.cq_entries = nEntries * 16;
+				m_nRingFd = int(::syscall(SYS_io_uring_setup, nEntries, &params));
+				if (m_nRingFd < 0)
+					return false;
+
+				// Older kernels map the two rings separately, we only bother
+				// with the single mapping, and want completions never dropped
+				if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_NODROP))
+					return false;
+
+				m_nRingSize = std::max<size_t>(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+					params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+				void* pRing = ::mmap(nullptr, m_nRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+					m_nRingFd, IORING_OFF_SQ_RING);
+				if (pRing == MAP_FAILED)
+					return false;
+				m_pRing = static_cast<uint8_t*>(pRing);
+
+				m_nSqesSize = params.sq_entries * sizeof(io_uring_sqe);
+				void* pSqes = ::mmap(nullptr, m_nSqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+					m_nRingFd, IORING_OFF_SQES);
+				if (pSqes == MAP_FAILED)
+					return false;
+				m_pSqes = static_cast<io_uring_sqe*>(pSqes);
+
+				m_pSqTail = reinterpret_cast<unsigned*>(m_pRing + params.sq_off.tail);
+				m_pSqMask = reinterpret_cast<unsigned*>(m_pRing + params.sq_off.ring_mask);
+				m_pSqArray = reinterpret_cast<unsigned*>(m_pRing + params.sq_off.array);
+				m_pCqHead = reinterpret_cast<unsigned*>(m_pRing + params.cq_off.head);
+				m_pCqTail = reinterpret_cast<unsigned*>(m_pRing + params.cq_off.tail);
+				m_pCqMask = reinterpret_cast<unsigned*>(m_pRing + params.cq_off.ring_mask);
+				m_pSqFlags = reinterpret_cast<unsigned*>(m_pRing + params.sq_off.flags);
+				m_pCqes = reinterpret_cast<io_uring_cqe*>(m_pRing + params.cq_off.cqes);
+
+				// Completions ring the eventfd, which asio watches for us
+				int nEventFd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+				if (nEventFd < 0)
+					return false;
+				m_eventfd.assign(nEventFd);
+				if (Register(IORING_REGISTER_EVENTFD, &nEventFd, 1) < 0)
+					return false;
+
+				// An empty table for the arenas to be added to as they appear.
+				// Without it everything still works, just without fixed buffers.
+				io_uring_rsrc_register reg{};
+				reg.nr = nFixedSlots;
+				reg.flags = IORING_RSRC_REGISTER_SPARSE;
+				m_bFixed = Register(IORING_REGISTER_BUFFERS2, &reg, sizeof(reg)) >= 0;
+				return true;
+			}
+
+			void WaitForCompletions()
+			{
+				std::weak_ptr<uring_backend> pWeak = weak_from_this();
+				m_eventfd.async_read_some(boost::asio::buffer(&m_nEventCount, sizeof(m_nEventCount)),
+					[pWeak](const boost::system::error_code& ec, std::size_t)
+					{
+						auto pThis = pWeak.lock();
+						if (!pThis || ec == boost::asio::error::operation_aborted)
+							return;
+						{
+							std::scoped_lock lock(pThis->m_mux);
+							pThis->Reap();
+						}
+						pThis->WaitForCompletions();
+					});
+			}
+
+			// Called holding m_mux
+			void Reap()
+			{
+				unsigned nHead = *m_pCqHead;
+				while (true)
+				{
+					unsigned nTail = __atomic_load_n(m_pCqTail, __ATOMIC_ACQUIRE);
+					if (nHead == nTail)
+					{
+						// Completions that found the queue full wait in the kernel,
+						// and don't ring the eventfd again, until we ask for them
+						if (!(__atomic_load_n(m_pSqFlags, __ATOMIC_ACQUIRE) & IORING_SQ_CQ_OVERFLOW))
+							return;
+						Enter(0, 0, IORING_ENTER_GETEVENTS);
+						if (__atomic_load_n(m_pCqTail, __ATOMIC_ACQUIRE) == nHead)
+							return;
+						continue;
+					}
+
+					const io_uring_cqe& cqe = m_pCqes[nHead & *m_pCqMask];
+					uring_op* pOp = reinterpret_cast<uring_op*>(cqe.user_data);
+					int nResult = cqe.res;
+					nHead++;
+					__atomic_store_n(m_pCqHead, nHead, __ATOMIC_RELEASE);
+					if (pOp)
+						pOp->complete(nResult);
+				}
+			}
+
+			// Looks up the arena holding iov, registering any arenas body_pool
+			// has carved since last time. Called holding m_mux.
+			bool FindFixed(const iovec& iov, uint16_t& nIndex)
+			{
+				if (!m_bFixed)
+				{
+					m_nPlainOps.fetch_add(1, std::memory_order_relaxed);
+					return false;
+				}
+
+				body_pool& pool = body_pool::instance();
+				size_t nArenas = std::min<size_t>(pool.GetArenaCount(), nFixedSlots);
+				while (m_nRegistered < nArenas)
+				{
+					uint8_t* pArena = pool.GetArena(m_nRegistered);
+					iovec arena{ pArena, body_pool::nArenaSize };
+					io_uring_rsrc_update2 update{};
+					update.offset = m_nRegistered;
+					update.data = reinterpret_cast<uint64_t>(&arena);
+					update.nr = 1;
+					if (Register(IORING_REGISTER_BUFFERS_UPDATE, &update, sizeof(update)) < 0)
+					{
+						// Most likely RLIMIT_MEMLOCK, carry on with what we have
+						nArenas = m_nRegistered;
+						break;
+					}
+					m_mapArenas.emplace(reinterpret_cast<uintptr_t>(pArena), uint16_t(m_nRegistered));
+					m_nRegistered++;
+				}
+
+				uintptr_t p = reinterpret_cast<uintptr_t>(iov.iov_base);
+				auto it = m_mapArenas.upper_bound(p);
+				if (it != m_mapArenas.begin())
+				{
+					--it;
+					if (p + iov.iov_len <= it->first + body_pool::nArenaSize)
+					{
+						nIndex = it->second;
+						m_nFixedOps.fetch_add(1, std::memory_order_relaxed);
+						return true;
+					}
+				}
+				m_nPlainOps.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+
+			std::mutex m_mux;
+			int m_nRingFd = -1;
+			uint8_t* m_pRing = nullptr;
+			size_t m_nRingSize = 0;
+			io_uring_sqe* m_pSqes = nullptr;
+			size_t m_nSqesSize = 0;
+			unsigned* m_pSqTail = nullptr;
+			unsigned* m_pSqMask = nullptr;
+			unsigned* m_pSqArray = nullptr;
+			unsigned* m_pCqHead = nullptr;
+			unsigned* m_pCqTail = nullptr;
+			unsigned* m_pCqMask = nullptr;
+			unsigned* m_pSqFlags = nullptr;
+			io_uring_cqe* m_pCqes = nullptr;
+
+			boost::asio::posix::stream_descriptor m_eventfd;
+			uint64_t m_nEventCount = 0;
+
+			bool m_bFixed = false;
+			size_t m_nRegistered = 0;
+			std::map<uintptr_t, uint16_t> m_mapArenas;
+			std::atomic<uint64_t> m_nFixedOps{ 0 };
+			std::atomic<uint64_t> m_nPlainOps{ 0 };
+		};
+#else
+		// No io_uring on this platform, connections stay on the reactor
+		class uring_backend
+		{
+		public:
+			static std::shared_ptr<uring_backend> create(boost::asio::io_context&, unsigned = 256)
+			{
+				return nullptr;
+			}
+
+			bool submit(uring_op*) { return false; }
+			void wait_idle(const std::atomic<int>&) {}
+			void GetStats(uint64_t& nFixed, uint64_t& nPlain) const { nFixed = nPlain = 0; }
+		};
+#endif
+	}
+}
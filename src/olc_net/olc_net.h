@@ -57,8 +57,19 @@
 #pragma once
 
 #include "net_common.h"
+#include "net_pool.h"
+#include "net_uring.h"
 #include "net_tsqueue.h"
+#include "net_mpscqueue.h"
 #include "net_message.h"
+#include "net_transport.h"
+#include "net_chunks.h"
+#include "net_msgstream.h"
+#include "net_delta.h"
+#include "net_subscriptions.h"
+#include "net_serialized.h"
+#include "net_registry.h"
+#include "net_runtime.h"
 #include "net_client.h"
 #include "net_server.h"
 #include "net_connection.h"
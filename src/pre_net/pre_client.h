@@ -6,14 +6,61 @@
 // common to both Producers and Consumers
 class PreCommonClient : public olc::net::client_interface<PreMsgTypes> {
 public:
+  // a client of its own, or one of many sharing a client_runtime
+  using olc::net::client_interface<PreMsgTypes>::client_interface;
+
   OPENFHE_DEBUG_FLAG(false); // set to true to turn on OPENFHE_DEBUG()
                              // statements
 
-  void RequestCC(void) {
+  // every request hands back the server's answer, an ack or nack for the
+  // Send*() calls, as a future
+  using Reply = std::future<olc::net::message<PreMsgTypes>>;
+
+  // waits for the server to accept the connection
+  void AwaitAccept(void) {
+    Incoming().wait();
+    auto msg = Incoming().pop_front().msg;
+    if (msg.header.id != PreMsgTypes::ServerAccept) {
+      std::cerr << "Client: expected ServerAccept, got " << msg.header.id
+                << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+    if (msg.body.size() >= sizeof(m_nPartyID)) {
+      msg >> m_nPartyID;
+    }
+    OPENFHE_DEBUG("Server Accepted Connection as [" << m_nPartyID << "]");
+  }
+
+  // the ID the server keeps this client's keys and data under, which a
+  // consumer can name to get a particular producer's. 0 until accepted.
+  uint32_t GetPartyID(void) const { return m_nPartyID; }
+
+  // waits for a reply, there is no going on without one
+  olc::net::message<PreMsgTypes> Await(Reply reply) {
+    try {
+      return reply.get();
+    } catch (const std::exception &e) {
+      std::cerr << "Client: no reply from server: " << e.what() << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  // as above, when the reply can only be one thing
+  olc::net::message<PreMsgTypes> Await(Reply reply, PreMsgTypes id) {
+    auto msg = Await(std::move(reply));
+    if (msg.header.id != id) {
+      std::cerr << "Client: expected " << id << ", got " << msg.header.id
+                << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+    return msg;
+  }
+
+  Reply RequestCC(void) {
     olc::net::message<PreMsgTypes> msg;
     OPENFHE_DEBUG("Client: Requesting CC");
     msg.header.id = PreMsgTypes::RequestCC;
-    Send(msg);
+    return RequestAsync(std::move(msg));
   }
 
   CC RecvCC(olc::net::message<PreMsgTypes> &msg) {
@@ -23,11 +70,9 @@ public:
     OPENFHE_DEBUG("Client: read CC of " << msgSize << " bytes");
     OPENFHE_DEBUG("Client: msg.size() " << msg.size());
     OPENFHE_DEBUG("Client: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("Client istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<PreMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("Client: Deserialize");
     Serial::Deserialize(cc, is, SerType::BINARY);
 
@@ -35,47 +80,48 @@ public:
     assert(is.good());
     return cc;
   }
+
+private:
+  uint32_t m_nPartyID = 0;
 };
 
 // producer client methods
 class PreProducerClient : public PreCommonClient {
 
 public:
+  using PreCommonClient::PreCommonClient;
+
   OPENFHE_DEBUG_FLAG(false); // set to true to turn on OPENFHE_DEBUG()
                              // statements
 
-  void SendPrivateKey(KPair &kp) {
-    std::string s;
-    std::ostringstream os(s);
+  Reply SendPrivateKey(KPair &kp) {
+    olc::net::message<PreMsgTypes> msg;
     OPENFHE_DEBUG("Producer: serializing secret key");
+    olc::net::message_ostream<PreMsgTypes> os(msg);
     Serial::Serialize(kp.secretKey, os, SerType::BINARY);
     OPENFHE_DEBUG("Producer: done");
-    olc::net::message<PreMsgTypes> msg;
     msg.header.id = PreMsgTypes::SendPrivateKey;
-    msg << os.str();
     OPENFHE_DEBUG("Producer: final msg.body.size " << msg.body.size());
     OPENFHE_DEBUG("Producer: final msg.size " << msg.size());
-    Send(msg);
+    return RequestAsync(std::move(msg));
   }
 
-  void SendCT(CT &ct) {
+  Reply SendCT(CT &ct) {
     OPENFHE_DEBUG("Producer: serializing CT");
-    std::string s;
-    std::ostringstream os(s);
-    Serial::Serialize(ct, os, SerType::BINARY);
     olc::net::message<PreMsgTypes> msg;
+    olc::net::message_ostream<PreMsgTypes> os(msg);
+    Serial::Serialize(ct, os, SerType::BINARY);
     msg.header.id = PreMsgTypes::SendCT;
-    msg << os.str();
     OPENFHE_DEBUG("Producer: final msg.body.size " << msg.body.size());
     OPENFHE_DEBUG("Producer: final msg.size " << msg.size());
-    Send(msg);
+    return RequestAsync(std::move(msg));
   }
 
-  void RequestVecInt(void) {
+  Reply RequestVecInt(void) {
     olc::net::message<PreMsgTypes> msg;
     OPENFHE_DEBUG("Producer: Requesting VecInt");
     msg.header.id = PreMsgTypes::RequestVecInt;
-    Send(msg);
+    return RequestAsync(std::move(msg));
   }
   vecInt RecvVecInt(olc::net::message<PreMsgTypes> &msg) {
     unsigned int msgSize(msg.body.size());
@@ -83,11 +129,9 @@ public:
     OPENFHE_DEBUG("Producer: read vecInt of " << msgSize << " bytes");
     OPENFHE_DEBUG("Producer: msg.size() " << msg.size());
     OPENFHE_DEBUG("Producer: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("Producer istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<PreMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("Producer: Deserialize");
     vecInt vi; // create the vector
     Serial::Deserialize(vi, is, SerType::BINARY);
@@ -107,26 +151,31 @@ public:
 // consumer client methods
 class PreConsumerClient : public PreCommonClient {
 public:
+  using PreCommonClient::PreCommonClient;
+
   OPENFHE_DEBUG_FLAG(false); // set to true to turn on OPENFHE_DEBUG()
                              // statements
 
-  void SendPublicKey(KPair &kp) {
-    std::string s;
-    std::ostringstream os(s);
+  Reply SendPublicKey(KPair &kp) {
+    olc::net::message<PreMsgTypes> msg;
     OPENFHE_DEBUG("Consumer: serializing public key");
+    olc::net::message_ostream<PreMsgTypes> os(msg);
     Serial::Serialize(kp.publicKey, os, SerType::BINARY);
-    olc::net::message<PreMsgTypes> msg;
     msg.header.id = PreMsgTypes::SendPublicKey;
-    msg << os.str();
     OPENFHE_DEBUG("Consumer: final msg.body.size " << msg.body.size());
     OPENFHE_DEBUG("Consumer: final msg.size " << msg.size());
-    Send(msg);
+    return RequestAsync(std::move(msg));
   }
 
-  void RequestReEncryptionKey(void) {
+  // from producer nProducer, or by default the producer the server pairs
+  // this consumer with, the one that last sent it a private key
+  Reply RequestReEncryptionKey(uint32_t nProducer = 0) {
     olc::net::message<PreMsgTypes> msg;
     msg.header.id = PreMsgTypes::RequestReEncryptionKey;
-    Send(msg);
+    if (nProducer != 0) {
+      msg << nProducer;
+    }
+    return RequestAsync(std::move(msg));
   }
 
   EvKey RecvReencryptionKey(olc::net::message<PreMsgTypes> &msg) {
@@ -135,19 +184,21 @@ public:
     OPENFHE_DEBUG("CLIENT: read CC of " << msgSize << " bytes");
     OPENFHE_DEBUG("Client: msg.size() " << msg.size());
     OPENFHE_DEBUG("Client: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("CLIENT istringstream.str.size(): " << is.str().size());
-    // NOTE Deserialize needs a basic_istream<char>
+    // read the body in place, no copy is made
+    olc::net::message_istream<PreMsgTypes> is(msg);
     OPENFHE_DEBUG("CLIENT: Deserialize");
     Serial::Deserialize(reencKey, is, SerType::BINARY);
     return reencKey;
   }
 
-  void RequestCT(void) {
+  // as RequestReEncryptionKey()
+  Reply RequestCT(uint32_t nProducer = 0) {
     olc::net::message<PreMsgTypes> msg;
     msg.header.id = PreMsgTypes::RequestCT;
-    Send(msg);
+    if (nProducer != 0) {
+      msg << nProducer;
+    }
+    return RequestAsync(std::move(msg));
   }
 
   CT RecvCT(olc::net::message<PreMsgTypes> &msg) {
@@ -156,27 +207,44 @@ public:
     OPENFHE_DEBUG("CLIENT: read CT of " << msgSize << " bytes");
     OPENFHE_DEBUG("Client: msg.size() " << msg.size());
     OPENFHE_DEBUG("Client: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("CLIENT istringstream.str.size(): " << is.str().size());
-    // NOTE Deserialize needs a basic_istream<char>
+    // read the body in place, no copy is made
+    olc::net::message_istream<PreMsgTypes> is(msg);
     OPENFHE_DEBUG("CLIENT: Deserialize");
     Serial::Deserialize(ct, is, SerType::BINARY);
     return ct;
   }
 
-  void SendVecInt(vecInt &vi) {
+  // the producer's CTs, re-encrypted for this consumer by the server
+  Reply RequestReEncryptedCT(uint32_t nProducer = 0) {
+    olc::net::message<PreMsgTypes> msg;
+    msg.header.id = PreMsgTypes::RequestReEncryptedCT;
+    if (nProducer != 0) {
+      msg << nProducer;
+    }
+    return RequestAsync(std::move(msg));
+  }
+
+  // oldest first
+  std::vector<CT> RecvReEncryptedCTs(olc::net::message<PreMsgTypes> &msg) {
+    std::vector<CT> vCTs;
+    OPENFHE_DEBUG("CLIENT: read CTs of " << msg.body.size() << " bytes");
+    // read the body in place, no copy is made
+    olc::net::message_istream<PreMsgTypes> is(msg);
+    OPENFHE_DEBUG("CLIENT: Deserialize");
+    Serial::Deserialize(vCTs, is, SerType::BINARY);
+    return vCTs;
+  }
+
+  Reply SendVecInt(vecInt &vi) {
     OPENFHE_DEBUG("Consumer: serializing vecInt");
-    std::string s;
-    std::ostringstream os(s);
-    Serial::Serialize(vi, os, SerType::BINARY);
     olc::net::message<PreMsgTypes> msg;
+    olc::net::message_ostream<PreMsgTypes> os(msg);
+    Serial::Serialize(vi, os, SerType::BINARY);
     msg.header.id = PreMsgTypes::SendVecInt;
-    msg << os.str();
     OPENFHE_DEBUG("Consumer: final msg.body.size " << msg.body.size());
     OPENFHE_DEBUG("Consumer: final msg.size " << msg.size());
     OPENFHE_DEBUG("Consumer: sending vecInt " << msg.size() << " bytes");
-    Send(msg);
+    return RequestAsync(std::move(msg));
   }
 
   void DisconnectConsumer(void) {
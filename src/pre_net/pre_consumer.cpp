@@ -53,15 +53,6 @@ using namespace lbcrypto;
  * requires inputs
  */
 
-enum class ConsumerStates : uint64_t {
-  GetMessage,
-  RequestCC,
-  GenKeys,
-  RequestReEncryptionKey,
-  RequestCT,
-  GenReencryption,
-};
-
 int main(int argc, char *argv[]) {
   ////////////////////////////////////////////////////////////
   // Set-up of parameters
@@ -70,8 +61,10 @@ int main(int argc, char *argv[]) {
   std::string myName(""); // name of client to run
   uint32_t port(0);
   std::string hostName(""); // name of server host
+  uint32_t producerID(0);    // 0 lets the server pick the producer
+  bool serverReEncrypt(false); // have the server re-encrypt the CT
 
-  while ((opt = getopt(argc, argv, "i:n:p:h")) != -1) {
+  while ((opt = getopt(argc, argv, "i:n:p:r:sh")) != -1) {
     switch (opt) {
     case 'i':
       hostName = optarg;
@@ -85,6 +78,12 @@ int main(int argc, char *argv[]) {
       port = atoi(optarg);
       std::cout << "host port " << port << std::endl;
       break;
+    case 'r':
+      producerID = std::stoul(optarg);
+      break;
+    case 's':
+      serverReEncrypt = true;
+      break;
     case 'h':
     default: /* '?' */
       std::cerr << "Usage: " << std::endl
@@ -92,6 +91,12 @@ int main(int argc, char *argv[]) {
                 << "  -n name of the consumer client" << std::endl
                 << "  -i IP or hostname of the server" << std::endl
                 << "  -p port of the server" << std::endl
+                << "  -r ID of the producer to get the CT from (default "
+                   "the one that last sent its key)"
+                << std::endl
+                << "  -s have the server re-encrypt the CT rather than "
+                   "asking it for the reencryption key"
+                << std::endl
                 << "  -h prints this message" << std::endl;
       std::exit(EXIT_FAILURE);
     }
@@ -112,10 +117,6 @@ int main(int argc, char *argv[]) {
     exit(EXIT_FAILURE);
   }
 
-  bool done = false;
-
-  ConsumerStates state(ConsumerStates::GetMessage); // simple state machine
-
   CC clientCC;
   KPair keyPair;
   PT pt;
@@ -125,182 +126,121 @@ int main(int argc, char *argv[]) {
   unsigned int ringsize(0U);
   unsigned int plaintextModulus(0U);
   vecInt vShorts; // our vector of shorts (must be stored as int64_t)
-  vecInt unpackedConsumer(0);
   TimeVar t; // time benchmarking variable
 
   OPENFHE_DEBUG_FLAG(false); // turns on and off OPENFHE_DEBUG() statements
-  while (!done) {
-    if (c.IsConnected()) {
-      // client executes a state
-      switch (state) { // sequence of states that producer executes
-      case ConsumerStates::GetMessage:
-        // client tests for a response from the server
-        if (!c.Incoming().empty()) {
-          auto msg = c.Incoming().pop_front().msg;
-
-          switch (msg.header.id) {
-          case PreMsgTypes::ServerAccept:
-            // Server has responded to the Connect()
-            OPENFHE_DEBUG("Server Accepted Connection");
-            state = ConsumerStates::RequestCC;
-            break;
-
-          case PreMsgTypes::SendCC:
-            PROFILELOG(myName << ": reading crypto context from server");
-            TIC(t);
-            clientCC = c.RecvCC(msg);
-            PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
-            state = ConsumerStates::GenKeys;
-            break;
-
-          case PreMsgTypes::SendReEncryptionKey:
-            PROFILELOG(myName << ": reading reencryption key from server");
-            TIC(t);
-            reencryptionKey = c.RecvReencryptionKey(msg);
-            PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
-            state = ConsumerStates::RequestCT;
-            break;
-
-          case PreMsgTypes::NackReEncryptionKey:
-            // Server has responded to a SendReEncryptionKey witg a NAC, retry
-            OPENFHE_DEBUG("Server NackReEncryptionKey");
-            nap(1000); // sleep for a second and retry.
-            state = ConsumerStates::RequestReEncryptionKey;
-            break;
-
-          case PreMsgTypes::AckPublicKey:
-            // Server has responded to a sendPublicKey
-            OPENFHE_DEBUG("Server Accepted PublicKey");
-            state = ConsumerStates::RequestReEncryptionKey;
-            break;
-
-          case PreMsgTypes::AckVecInt:
-            // Server has responded to a sendVecInt
-            OPENFHE_DEBUG("Server Accepted VecInt");
-            state = ConsumerStates::GetMessage;
-            break;
-
-          case PreMsgTypes::SendCT:
-            PROFILELOG(myName << ": reading CT from server");
-            TIC(t);
-            producerCT = c.RecvCT(msg);
-            PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
-            state = ConsumerStates::GenReencryption;
-            break;
-
-          case PreMsgTypes::NackCT:
-            // Server has responded to a SendCT with a NAC, retry
-            OPENFHE_DEBUG("Server NackCT");
-            nap(1000); // sleep for a second and retry.
-            state = ConsumerStates::RequestCT;
-            break;
-
-          default:
-            PROFILELOG(myName << ": received unhandled message from Server "
-                              << msg.header.id);
-          }
-        } // end isEmpty -- could sleep here
-        break;
-
-      case ConsumerStates::RequestCC: // first step
-        TIC(t);
-        PROFILELOG(myName << ": Requesting CC");
-        c.RequestCC(); // request the CC from the server.
-        PROFILELOG(myName << ":elapsed time " << TOC_MS(t) << "msec.");
-        state = ConsumerStates::GetMessage;
-        break;
 
-      case ConsumerStates::GenKeys:
-        // we have received the CC from the server
-        // next step is to generate keys and send the private key to server
-        PROFILELOG(myName << ": Generating keys");
-        TIC(t);
-        keyPair = clientCC->KeyGen();
-        PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
-
-        if (!keyPair.good()) {
-          std::cerr << myName << " Key generation failed!" << std::endl;
-          std::exit(EXIT_FAILURE);
-        }
-
-        PROFILELOG(myName << ": Serializing and sending public key");
-        TIC(t);
-        c.SendPublicKey(keyPair);
-        PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
-
-        ringsize = clientCC->GetRingDimension();
-        plaintextModulus =
-            clientCC->GetCryptoParameters()->GetPlaintextModulus();
-        PROFILELOG(myName << ": plaintext modulus is :" << plaintextModulus);
-
-        if (plaintextModulus < 65536) {
-          std::cerr << "error, code is designed for plaintextModulus>65536, "
-                       "modulus is "
-                    << plaintextModulus << std::endl;
-          std::exit(EXIT_FAILURE);
-        }
-
-        PROFILELOG(myName << ": can decrypt " << ringsize * 2
-                          << " bytes of data");
-        state = ConsumerStates::GetMessage;
-        break;
-
-      case ConsumerStates::RequestReEncryptionKey:
-        TIC(t);
-        PROFILELOG(myName << ": Requesting ReEncryptionKey");
-        c.RequestReEncryptionKey();
-        PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
-        state = ConsumerStates::GetMessage;
-        break;
-
-      case ConsumerStates::RequestCT:
-        TIC(t);
-        PROFILELOG(myName << ": Requesting CT");
-        c.RequestCT(); // request the CT from the server.
-        PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
-        state = ConsumerStates::GetMessage;
-        break;
-      case ConsumerStates::GenReencryption:
-        PROFILELOG(myName << ": got CT");
-        PROFILELOG(myName << ": reecrypt the data with reencryption key");
-        TIC(t);
-        auto reencCT = clientCC->ReEncrypt(producerCT, reencryptionKey);
-        PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
-
-        PROFILELOG(myName << ": decrypt the result with my key");
-        PT consumerPT;
-        TIC(t);
-        clientCC->Decrypt(keyPair.secretKey, reencCT, &consumerPT);
+  // the consumer runs through its steps in turn, each waits for the
+  // server's reply to the last and goes on as soon as it is in
+  c.AwaitAccept();
+
+  // first step, get the CC from the server
+  TIC(t);
+  PROFILELOG(myName << ": Requesting CC");
+  auto msg = c.Await(c.RequestCC(), PreMsgTypes::SendCC);
+  PROFILELOG(myName << ": reading crypto context from server");
+  clientCC = c.RecvCC(msg);
+  PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
+
+  // next step is to generate keys and send the public key to server
+  PROFILELOG(myName << ": Generating keys");
+  TIC(t);
+  keyPair = clientCC->KeyGen();
+  PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
+
+  if (!keyPair.good()) {
+    std::cerr << myName << " Key generation failed!" << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
 
-        consumerPT->SetLength(ringsize); // note this could be something alice
-        // sets and sents to consumer
-        PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
+  PROFILELOG(myName << ": Serializing and sending public key");
+  TIC(t);
+  auto ackPublicKey = c.SendPublicKey(keyPair);
+  PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
 
-        vecInt unpackedConsumer = consumerPT->GetPackedValue();
-        PROFILELOG(myName << ": unpacking to length "
-                          << consumerPT->GetLength());
-        PROFILELOG(myName << ": output vecInt is length: "
-                          << unpackedConsumer.size());
+  ringsize = clientCC->GetRingDimension();
+  plaintextModulus = clientCC->GetCryptoParameters()->GetPlaintextModulus();
+  PROFILELOG(myName << ": plaintext modulus is :" << plaintextModulus);
 
-        // note OpenFHE assumes that plaintext is in the range of -p/2..p/2
-        // to recover 0...q simply add q if the unpacked value is negative
-        for (unsigned int j = 0; j < unpackedConsumer.size(); j++) {
-          if (unpackedConsumer[j] < 0)
-            unpackedConsumer[j] += plaintextModulus;
-        }
-        PROFILELOG(myName << ": sending data to server for validation");
-        c.SendVecInt(unpackedConsumer);
-        nap(2000); // sleep to let the server catch up
-        // consumer is done
-        PROFILELOG(myName << ": Execution Completed.");
-        c.DisconnectConsumer();
-        done = true;
-        break;
-      } // switch state
+  if (plaintextModulus < 65536) {
+    std::cerr << "error, code is designed for plaintextModulus>65536, "
+                 "modulus is "
+              << plaintextModulus << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
 
-    } // IsConnected()
+  PROFILELOG(myName << ": can decrypt " << ringsize * 2 << " bytes of data");
+  c.Await(std::move(ackPublicKey), PreMsgTypes::AckPublicKey);
+  OPENFHE_DEBUG("Server Accepted PublicKey");
+
+  // the server has no reencryption key until the producer has sent its
+  // private key, nor a CT until the producer has sent that. It holds on to
+  // each request until it can answer, so ask for both at once.
+  CT reencCT;
+  if (serverReEncrypt) {
+    // the server does the re-encryption, and the key never leaves it
+    TIC(t);
+    PROFILELOG(myName << ": Requesting ReEncryptedCT");
+    msg = c.Await(c.RequestReEncryptedCT(producerID),
+                  PreMsgTypes::SendReEncryptedCT);
+    PROFILELOG(myName << ": reading reencrypted CTs from server");
+    auto reencCTs = c.RecvReEncryptedCTs(msg);
+    if (reencCTs.empty()) {
+      PROFILELOG(myName << ": server sent no CT. Exiting");
+      exit(EXIT_FAILURE);
+    }
+    reencCT = reencCTs.back(); // the producer's latest
+    PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
+  } else {
+    TIC(t);
+    PROFILELOG(myName << ": Requesting ReEncryptionKey and CT");
+    auto replyReencryptionKey = c.RequestReEncryptionKey(producerID);
+    auto replyCT = c.RequestCT(producerID);
+
+    msg = c.Await(std::move(replyReencryptionKey),
+                  PreMsgTypes::SendReEncryptionKey);
+    PROFILELOG(myName << ": reading reencryption key from server");
+    reencryptionKey = c.RecvReencryptionKey(msg);
+
+    msg = c.Await(std::move(replyCT), PreMsgTypes::SendCT);
+    PROFILELOG(myName << ": reading CT from server");
+    producerCT = c.RecvCT(msg);
+    PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
+
+    PROFILELOG(myName << ": got CT");
+    PROFILELOG(myName << ": reecrypt the data with reencryption key");
+    TIC(t);
+    reencCT = clientCC->ReEncrypt(producerCT, reencryptionKey);
+    PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
+  }
 
-  } // while !done
+  PROFILELOG(myName << ": decrypt the result with my key");
+  PT consumerPT;
+  TIC(t);
+  clientCC->Decrypt(keyPair.secretKey, reencCT, &consumerPT);
+
+  consumerPT->SetLength(ringsize); // note this could be something alice
+  // sets and sents to consumer
+  PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
+
+  vecInt unpackedConsumer = consumerPT->GetPackedValue();
+  PROFILELOG(myName << ": unpacking to length " << consumerPT->GetLength());
+  PROFILELOG(myName << ": output vecInt is length: "
+                    << unpackedConsumer.size());
+
+  // note OpenFHE assumes that plaintext is in the range of -p/2..p/2
+  // to recover 0...q simply add q if the unpacked value is negative
+  for (unsigned int j = 0; j < unpackedConsumer.size(); j++) {
+    if (unpackedConsumer[j] < 0)
+      unpackedConsumer[j] += plaintextModulus;
+  }
+  PROFILELOG(myName << ": sending data to server for validation");
+  // wait for the server to take it before saying goodbye
+  c.Await(c.SendVecInt(unpackedConsumer), PreMsgTypes::AckVecInt);
+  OPENFHE_DEBUG("Server Accepted VecInt");
+  // consumer is done
+  PROFILELOG(myName << ": Execution Completed.");
+  c.DisconnectConsumer();
 
   ////////////////////////////////////////////////////////////
   // Done
@@ -0,0 +1,134 @@
+#ifndef PRE_KEYSTORE_H
+#define PRE_KEYSTORE_H
+
+#include <deque>
+#include <numeric>
+
+#include "pre_utils.h"
+
+// What the server holds for one party, a producer or a consumer, keyed by
+// the party's client ID. The sizes are those of the serialized objects as
+// they arrived, the best measure of what each party costs the server
+// without walking OpenFHE's objects.
+struct PreParty {
+  // a producer's
+  PrivKey privateKey;
+  size_t nPrivateKeyBytes = 0;
+  uint64_t nPrivateKeySerial = 0; // which key this is of all the server got
+  std::deque<Serialized<CT>> qCTs; // oldest first, at most kMaxCTs
+  std::deque<size_t> qCTBytes;
+  Serialized<vecInt> vecIntBack; // sent back by the producer's consumer
+  size_t nVecIntBytes = 0;
+
+  // a consumer's
+  PubKey publicKey;
+  size_t nPublicKeyBytes = 0;
+  uint64_t nPublicKeyHash = 0; // of the key as serialized
+  std::shared_ptr<const std::string> pPublicKeyBytes; // the key as serialized
+  uint32_t nProducer = 0; // whose keys and CT it gets, 0 for none yet
+
+  static constexpr size_t kMaxCTs = 64;
+
+  // keeps ct as the newest CT, forgetting the oldest when there are too many
+  void PushCT(Serialized<CT> ct, size_t nBytes) {
+    qCTs.push_back(std::move(ct));
+    qCTBytes.push_back(nBytes);
+    if (qCTs.size() > kMaxCTs) {
+      qCTs.pop_front();
+      qCTBytes.pop_front();
+    }
+  }
+
+  size_t Bytes() const {
+    return nPrivateKeyBytes +
+           std::accumulate(qCTBytes.begin(), qCTBytes.end(), size_t(0)) +
+           nVecIntBytes + nPublicKeyBytes;
+  }
+};
+
+// The parties of a PreServer, spread over shards by ID. Each shard has a
+// lock and a hash map of its own, so parties in different shards never
+// contend, and finding one costs the same however many there are.
+//
+// The functions passed to Update() and Find() run under the party's shard
+// lock, which makes checking for an object and parking a request for it
+// one step; they must not call back into the keystore.
+class PreKeystore {
+public:
+  explicit PreKeystore(size_t nShards = 64) : m_vShards(nShards) {}
+
+  // calls fn(PreParty&) for party nID, adding the party if it is new
+  template <typename Fn> void Update(uint32_t nID, Fn &&fn) {
+    Shard &shard = ShardOf(nID);
+    std::scoped_lock lock(shard.mux);
+    PreParty &party = shard.mapParties[nID];
+    size_t nBefore = party.Bytes();
+    fn(party);
+    m_nBytes += party.Bytes() - nBefore; // wraps around when it shrinks
+  }
+
+  // as above, for a party already here. Returns false, without calling
+  // fn, if there is none.
+  template <typename Fn> bool Find(uint32_t nID, Fn &&fn) {
+    Shard &shard = ShardOf(nID);
+    std::scoped_lock lock(shard.mux);
+    auto it = shard.mapParties.find(nID);
+    if (it == shard.mapParties.end()) {
+      return false;
+    }
+    size_t nBefore = it->second.Bytes();
+    fn(it->second);
+    m_nBytes += it->second.Bytes() - nBefore;
+    return true;
+  }
+
+  // forgets party nID and everything it sent. The keys are freed outside
+  // the lock.
+  bool Erase(uint32_t nID) {
+    PreParty party;
+    {
+      Shard &shard = ShardOf(nID);
+      std::scoped_lock lock(shard.mux);
+      auto it = shard.mapParties.find(nID);
+      if (it == shard.mapParties.end()) {
+        return false;
+      }
+      party = std::move(it->second);
+      shard.mapParties.erase(it);
+    }
+    m_nBytes -= party.Bytes();
+    return true;
+  }
+
+  // bytes held for party nID, 0 if it is unknown
+  size_t Bytes(uint32_t nID) {
+    size_t nBytes = 0;
+    Find(nID, [&](PreParty &party) { nBytes = party.Bytes(); });
+    return nBytes;
+  }
+
+  // bytes held for all parties
+  size_t Bytes() const { return m_nBytes; }
+
+  size_t Size() const {
+    size_t nParties = 0;
+    for (const Shard &shard : m_vShards) {
+      std::scoped_lock lock(shard.mux);
+      nParties += shard.mapParties.size();
+    }
+    return nParties;
+  }
+
+private:
+  struct Shard {
+    mutable std::mutex mux;
+    std::unordered_map<uint32_t, PreParty> mapParties;
+  };
+
+  Shard &ShardOf(uint32_t nID) { return m_vShards[nID % m_vShards.size()]; }
+
+  std::vector<Shard> m_vShards;
+  std::atomic<size_t> m_nBytes{0};
+};
+
+#endif // PRE_KEYSTORE_H
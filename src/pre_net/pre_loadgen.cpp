@@ -0,0 +1,427 @@
+// @file pre_loadgen.cpp - Load generator for the Proxy Re-Encryption server
+// @author TPOC: contact@openfhe-crypto.org
+//
+// @copyright Copyright (c) 2020, 2023 Duality Technologies Inc.
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution. THIS SOFTWARE IS
+// PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+// IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+// EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// @section DESCRIPTION
+// Drives a pre_server with many producers and consumers at once, each
+// running the demo clients' steps over and over: a producer requests the
+// CC and sends its private key and a CT, a consumer requests the CC,
+// sends its public key, requests a re-encryption key and sends back a
+// vecInt. All the simulated clients share a few I/O threads through an
+// olc::net::client_runtime, and each runs its steps as a chain of
+// replies, so thousands of them need no more threads than that.
+//
+// The keys, CT and vecInt are made once, from the server's own CC, and
+// serialized once; every client sends the same bodies. What is measured
+// is the server, not the generator's crypto.
+//
+// Reports, per request type, how many were answered, the rate, and the
+// p50, p99 and p999 latency from sending the request to its reply, as
+// CSV or JSON.
+
+#include <getopt.h>
+
+#include <condition_variable>
+#include <fstream>
+#include <map>
+
+#include "openfhe.h"
+#include "pre_utils.h"
+
+#include "pre_client.h"
+
+using namespace lbcrypto;
+
+// one request a client makes, and the reply that answers it
+struct Step {
+  olc::net::shared_message<PreMsgTypes> request;
+  PreMsgTypes reply;
+};
+
+// a request with no body
+static olc::net::shared_message<PreMsgTypes> MakeRequest(PreMsgTypes id) {
+  olc::net::message<PreMsgTypes> msg;
+  msg.header.id = id;
+  return olc::net::shared_message<PreMsgTypes>(std::move(msg));
+}
+
+// a request carrying obj, serialized once for every client to send
+template <typename Obj>
+static olc::net::shared_message<PreMsgTypes> MakeRequest(PreMsgTypes id,
+                                                     const Obj &obj) {
+  olc::net::message<PreMsgTypes> msg;
+  {
+    olc::net::message_ostream<PreMsgTypes> os(msg);
+    Serial::Serialize(obj, os, SerType::BINARY);
+  }
+  msg.header.id = id;
+  return olc::net::shared_message<PreMsgTypes>(std::move(msg));
+}
+
+// a simulated producer or consumer. Each reply sends the next request
+// from the client's I/O thread, so the client needs no thread of its own.
+class LoadClient : public PreCommonClient {
+public:
+  LoadClient(olc::net::client_runtime &runtime, const std::vector<Step> &vSteps)
+      : PreCommonClient(runtime), m_vSteps(vSteps),
+        m_vLatencies(vSteps.size()) {}
+
+  // runs through the steps nRounds times, then calls fnDone
+  void Start(size_t nRounds, std::function<void()> fnDone) {
+    m_nRounds = nRounds;
+    m_fnDone = std::move(fnDone);
+    Next();
+  }
+
+  bool Done() const { return m_bDone; }
+  size_t Errors() const { return m_nErrors; }
+
+  // milliseconds from request to reply, for each step
+  const std::vector<std::vector<double>> &Latencies() const {
+    return m_vLatencies;
+  }
+
+private:
+  void Next() {
+    if (m_nStep == m_vSteps.size()) {
+      m_nStep = 0;
+      m_nRound++;
+    }
+    if (m_nRound == m_nRounds) {
+      Finish();
+      return;
+    }
+
+    m_start = std::chrono::steady_clock::now();
+    uint32_t nRequest =
+        olc::net::client_interface<PreMsgTypes>::Request(
+            m_vSteps[m_nStep].request,
+            [this](olc::net::message<PreMsgTypes> &&reply) { OnReply(reply); });
+    if (nRequest == 0) {
+      m_nErrors++;
+      Finish();
+    }
+  }
+
+  void OnReply(const olc::net::message<PreMsgTypes> &reply) {
+    auto stop = std::chrono::steady_clock::now();
+    m_vLatencies[m_nStep].push_back(
+        std::chrono::duration<double, std::milli>(stop - m_start).count());
+    if (reply.header.id != m_vSteps[m_nStep].reply) {
+      m_nErrors++;
+    }
+    m_nStep++;
+    Next();
+  }
+
+  void Finish() {
+    m_bDone = true;
+    m_fnDone();
+  }
+
+  const std::vector<Step> &m_vSteps;
+  std::vector<std::vector<double>> m_vLatencies;
+  std::function<void()> m_fnDone;
+  size_t m_nRounds = 0;
+  size_t m_nRound = 0;
+  size_t m_nStep = 0;
+  std::atomic<size_t> m_nErrors{0};
+  std::atomic<bool> m_bDone{false};
+  std::chrono::steady_clock::time_point m_start;
+};
+
+// latencies of one request type over every client
+struct Result {
+  std::string sName;
+  std::vector<double> vLatencies;
+
+  // nearest rank percentile, p in [0, 1]
+  double Percentile(double p) const {
+    if (vLatencies.empty()) {
+      return 0;
+    }
+    size_t i = size_t(std::ceil(p * vLatencies.size()));
+    return vLatencies[std::min(std::max<size_t>(i, 1), vLatencies.size()) - 1];
+  }
+};
+
+static void WriteCSV(std::ostream &os, const std::vector<Result> &vResults,
+                     double sec) {
+  os << "message,count,ops_per_sec,p50_ms,p99_ms,p999_ms,max_ms" << std::endl;
+  for (const auto &r : vResults) {
+    os << r.sName << "," << r.vLatencies.size() << ","
+       << r.vLatencies.size() / sec << "," << r.Percentile(0.5) << ","
+       << r.Percentile(0.99) << "," << r.Percentile(0.999) << ","
+       << r.Percentile(1) << std::endl;
+  }
+}
+
+static void WriteJSON(std::ostream &os, const std::vector<Result> &vResults,
+                      double sec, size_t nProducers, size_t nConsumers,
+                      size_t nRounds, size_t nThreads, size_t nErrors) {
+  os << "{" << std::endl
+     << "  \"producers\": " << nProducers << "," << std::endl
+     << "  \"consumers\": " << nConsumers << "," << std::endl
+     << "  \"rounds\": " << nRounds << "," << std::endl
+     << "  \"threads\": " << nThreads << "," << std::endl
+     << "  \"seconds\": " << sec << "," << std::endl
+     << "  \"errors\": " << nErrors << "," << std::endl
+     << "  \"messages\": [" << std::endl;
+  for (size_t i = 0; i < vResults.size(); i++) {
+    const Result &r = vResults[i];
+    os << "    {\"message\": \"" << r.sName
+       << "\", \"count\": " << r.vLatencies.size()
+       << ", \"ops_per_sec\": " << r.vLatencies.size() / sec
+       << ", \"p50_ms\": " << r.Percentile(0.5)
+       << ", \"p99_ms\": " << r.Percentile(0.99)
+       << ", \"p999_ms\": " << r.Percentile(0.999)
+       << ", \"max_ms\": " << r.Percentile(1) << "}"
+       << (i + 1 < vResults.size() ? "," : "") << std::endl;
+  }
+  os << "  ]" << std::endl << "}" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  ////////////////////////////////////////////////////////////
+  // Set-up of parameters
+  ////////////////////////////////////////////////////////////
+  int opt;
+  uint32_t port(0);
+  std::string hostName(""); // name of server host
+  size_t nProducers(1);
+  size_t nConsumers(2);
+  size_t nRounds(10);
+  size_t nThreads(2);
+  bool bJSON(false);
+  bool bIoUring(false);
+  std::string sOutput("");
+
+  while ((opt = getopt(argc, argv, "i:p:P:C:r:t:f:o:uh")) != -1) {
+    switch (opt) {
+    case 'i':
+      hostName = optarg;
+      break;
+    case 'p':
+      port = atoi(optarg);
+      break;
+    case 'P':
+      nProducers = std::stoul(optarg);
+      break;
+    case 'C':
+      nConsumers = std::stoul(optarg);
+      break;
+    case 'r':
+      nRounds = std::stoul(optarg);
+      break;
+    case 't':
+      nThreads = std::stoul(optarg);
+      break;
+    case 'f':
+      bJSON = std::string(optarg) == "json";
+      break;
+    case 'o':
+      sOutput = optarg;
+      break;
+    case 'u':
+      bIoUring = true;
+      break;
+    case 'h':
+    default: /* '?' */
+      std::cerr << "Usage: " << std::endl
+                << "arguments:" << std::endl
+                << "  -i IP or hostname of the server" << std::endl
+                << "  -p port of the server" << std::endl
+                << "  -P number of producers (default 1)" << std::endl
+                << "  -C number of consumers (default 2)" << std::endl
+                << "  -r rounds of its steps each client runs (default 10)"
+                << std::endl
+                << "  -t number of I/O threads for all the clients "
+                   "(default 2)"
+                << std::endl
+                << "  -f output format, csv or json (default csv)"
+                << std::endl
+                << "  -o file to write the results to (default stdout)"
+                << std::endl
+                << "  -u do socket I/O through io_uring where the kernel "
+                   "allows it"
+                << std::endl
+                << "  -h prints this message" << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  // verify inputs
+  if (hostName.empty() || port == 0) {
+    std::cerr << "server and port must be specified " << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  ////////////////////////////////////////////////////////////
+  // Make what the clients will send, once
+  ////////////////////////////////////////////////////////////
+  std::cerr << "preparing keys and ciphertext" << std::endl;
+  CC clientCC;
+  {
+    PreProducerClient setup;
+    if (!setup.Connect(hostName, port)) {
+      exit(EXIT_FAILURE);
+    }
+    setup.AwaitAccept();
+    auto msg = setup.Await(setup.RequestCC(), PreMsgTypes::SendCC);
+    clientCC = setup.RecvCC(msg);
+  }
+
+  KPair producerKeys = clientCC->KeyGen();
+  KPair consumerKeys = clientCC->KeyGen();
+  if (!producerKeys.good() || !consumerKeys.good()) {
+    std::cerr << "Key generation failed!" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  unsigned int ringsize = clientCC->GetRingDimension();
+  vecInt vShorts;
+  for (unsigned int i = 0; i < ringsize; i++) {
+    vShorts.push_back(std::rand() % 65536);
+  }
+  PT pt = clientCC->MakePackedPlaintext(vShorts);
+  CT ct = clientCC->Encrypt(producerKeys.publicKey, pt);
+
+  std::vector<Step> vProducerSteps{
+      {MakeRequest(PreMsgTypes::RequestCC), PreMsgTypes::SendCC},
+      {MakeRequest(PreMsgTypes::SendPrivateKey, producerKeys.secretKey),
+       PreMsgTypes::AckPrivateKey},
+      {MakeRequest(PreMsgTypes::SendCT, ct), PreMsgTypes::AckCT},
+  };
+  std::vector<Step> vConsumerSteps{
+      {MakeRequest(PreMsgTypes::RequestCC), PreMsgTypes::SendCC},
+      {MakeRequest(PreMsgTypes::SendPublicKey, consumerKeys.publicKey),
+       PreMsgTypes::AckPublicKey},
+      {MakeRequest(PreMsgTypes::RequestReEncryptionKey),
+       PreMsgTypes::SendReEncryptionKey},
+      {MakeRequest(PreMsgTypes::SendVecInt, vShorts), PreMsgTypes::AckVecInt},
+  };
+
+  ////////////////////////////////////////////////////////////
+  // Connect everyone, then let them go at once
+  ////////////////////////////////////////////////////////////
+  olc::net::client_runtime runtime(nThreads);
+  if (bIoUring && !runtime.EnableIoUring()) {
+    std::cerr << "io_uring not available, using the reactor" << std::endl;
+  }
+
+  std::cerr << "connecting " << nProducers << " producers and " << nConsumers
+            << " consumers" << std::endl;
+  std::vector<std::unique_ptr<LoadClient>> vClients;
+  for (size_t i = 0; i < nProducers + nConsumers; i++) {
+    vClients.push_back(std::make_unique<LoadClient>(
+        runtime, i < nProducers ? vProducerSteps : vConsumerSteps));
+    if (!vClients.back()->Connect(hostName, port)) {
+      exit(EXIT_FAILURE);
+    }
+  }
+  for (auto &c : vClients) {
+    c->AwaitAccept();
+  }
+
+  std::mutex muxDone;
+  std::condition_variable cvDone;
+  size_t nDone(0);
+  auto start = std::chrono::steady_clock::now();
+  for (auto &c : vClients) {
+    c->Start(nRounds, [&]() {
+      std::scoped_lock lock(muxDone);
+      nDone++;
+      cvDone.notify_one();
+    });
+  }
+
+  // a client whose connection drops never hears its last reply, so stop
+  // waiting for it once it has gone
+  {
+    std::unique_lock lock(muxDone);
+    while (nDone < vClients.size()) {
+      cvDone.wait_for(lock, std::chrono::milliseconds(200));
+      size_t nLost = std::count_if(
+          vClients.begin(), vClients.end(),
+          [](auto &c) { return !c->Done() && !c->IsConnected(); });
+      if (nLost > 0 && nDone + nLost == vClients.size()) {
+        std::cerr << nLost << " clients lost their connection" << std::endl;
+        break;
+      }
+    }
+  }
+  auto stop = std::chrono::steady_clock::now();
+  double sec = std::chrono::duration<double>(stop - start).count();
+
+  for (auto &c : vClients) {
+    c->Disconnect();
+  }
+
+  ////////////////////////////////////////////////////////////
+  // Report
+  ////////////////////////////////////////////////////////////
+  std::map<PreMsgTypes, Result> mapResults;
+  Result all{"all", {}};
+  size_t nErrors(0);
+  for (size_t i = 0; i < vClients.size(); i++) {
+    const auto &vSteps = i < nProducers ? vProducerSteps : vConsumerSteps;
+    const auto &vLatencies = vClients[i]->Latencies();
+    for (size_t s = 0; s < vSteps.size(); s++) {
+      PreMsgTypes id = vSteps[s].request.header.id;
+      Result &r = mapResults[id];
+      r.sName = PreMsgNames[static_cast<uint32_t>(id)];
+      r.vLatencies.insert(r.vLatencies.end(), vLatencies[s].begin(),
+                          vLatencies[s].end());
+      all.vLatencies.insert(all.vLatencies.end(), vLatencies[s].begin(),
+                            vLatencies[s].end());
+    }
+    nErrors += vClients[i]->Errors();
+  }
+
+  std::vector<Result> vResults;
+  for (auto &[id, r] : mapResults) {
+    vResults.push_back(std::move(r));
+  }
+  vResults.push_back(std::move(all));
+  for (auto &r : vResults) {
+    std::sort(r.vLatencies.begin(), r.vLatencies.end());
+  }
+
+  std::ofstream file;
+  if (!sOutput.empty()) {
+    file.open(sOutput);
+  }
+  std::ostream &os = sOutput.empty() ? std::cout : file;
+  if (bJSON) {
+    WriteJSON(os, vResults, sec, nProducers, nConsumers, nRounds, nThreads,
+              nErrors);
+  } else {
+    WriteCSV(os, vResults, sec);
+  }
+
+  std::cerr << "ran for " << sec << " seconds, " << nErrors
+            << " unexpected replies" << std::endl;
+  if (nErrors > 0) {
+    exit(EXIT_FAILURE);
+  }
+  exit(EXIT_SUCCESS);
+}
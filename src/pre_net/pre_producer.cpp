@@ -53,15 +53,6 @@ using namespace lbcrypto;
  * requires inputs
  */
 
-enum class ProducerStates : uint64_t {
-  GetMessage,
-  RequestCC,
-  GenKeys,
-  GenCT,
-  RequestVecInt,
-  Verify,
-};
-
 int main(int argc, char *argv[]) {
   ////////////////////////////////////////////////////////////
   // Set-up of parameters
@@ -112,10 +103,7 @@ int main(int argc, char *argv[]) {
     exit(EXIT_FAILURE);
   }
 
-  bool done = false;
   bool good = true;
-  // producer is a simple state machine, set initial state
-  ProducerStates state(ProducerStates::GetMessage);
 
   CC clientCC;
   KPair keyPair;
@@ -130,186 +118,114 @@ int main(int argc, char *argv[]) {
 
   OPENFHE_DEBUG_FLAG(false); // Turns on and off OPENFHE_DEBUG() statements
 
-  while (!done) {
-    if (c.IsConnected()) {
-
-      switch (state) { // sequence of states that producer executes
-      case ProducerStates::GetMessage:
-        // client tests for a response from the server
-        if (!c.Incoming().empty()) {
-          auto msg = c.Incoming().pop_front().msg;
-
-          switch (msg.header.id) {
-          case PreMsgTypes::ServerAccept:
-            // Server has responded to the Connect()
-            OPENFHE_DEBUG("Server Accepted Connection");
-            state = ProducerStates::RequestCC;
-            break;
-
-          case PreMsgTypes::SendCC:
-            PROFILELOG(myName << ": reading crypto context from server");
-            TIC(t);
-            clientCC = c.RecvCC(msg);
-            PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
-            state = ProducerStates::GenKeys;
-            break;
-
-          case PreMsgTypes::AckPrivateKey:
-            // Server has responded to a sendPrivateKey
-            OPENFHE_DEBUG("Server Accepted PrivateKey");
-            state = ProducerStates::GenCT;
-            break;
-
-          case PreMsgTypes::AckCT:
-            // Server has responded to a sendCT
-            OPENFHE_DEBUG("Server Accepted CT");
-            state = ProducerStates::RequestVecInt;
-            break;
-
-          case PreMsgTypes::SendVecInt:
-
-            PROFILELOG(myName << ": reading vecInt from server");
-            TIC(t);
-            unpackedConsumer = c.RecvVecInt(msg);
-            PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
-            state = ProducerStates::Verify;
-            break;
-
-          case PreMsgTypes::NackVecInt:
-            // Server has responded to a SendVecInt with a NAC, retry
-            OPENFHE_DEBUG("Server NackVecInt");
-            nap(1000); // sleep for a second and retry.
-            state = ProducerStates::RequestVecInt;
-            break;
-
-          default:
-            PROFILELOG(myName << ": received unhandled message from Server "
-                              << msg.header.id);
-          }
-        } // end isEmpty -- could sleep here
-        break;
-
-      case ProducerStates::RequestCC: // first step
-        TIC(t);
-        PROFILELOG(myName << ": Requesting CC");
-        c.RequestCC(); // request the CC from the server.
-        PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
-        state = ProducerStates::GetMessage;
-        break;
-
-      case ProducerStates::GenKeys: // if have received the CC from the server
-        // then generate keys and send the private key to server
-        PROFILELOG(myName << ": Generating keys");
-        TIC(t);
-        keyPair = clientCC->KeyGen();
-        PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
-
-        if (!keyPair.good()) {
-          std::cerr << myName << " Key generation failed!" << std::endl;
-          std::exit(EXIT_FAILURE);
-        }
-
-        PROFILELOG(myName << ": Serializing and sending private key");
-        TIC(t);
-        c.SendPrivateKey(keyPair);
-        PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
-        state = ProducerStates::GetMessage;
-
-        break;
-
-      case ProducerStates::GenCT: // if we have sent the private key to the
-        // server generate and send CT
-        ringsize = clientCC->GetRingDimension();
-        plaintextModulus =
-            clientCC->GetCryptoParameters()->GetPlaintextModulus();
-        PROFILELOG(myName << ": plaintext modulus is :" << plaintextModulus);
-
-        if (plaintextModulus < 65536) {
-          std::cerr << "error, code is designed for plaintextModulus>65536, "
-                       "modulus is "
-                    << plaintextModulus << std::endl;
-          std::exit(EXIT_FAILURE);
-        }
-        PROFILELOG(myName << ": can encrypt " << ringsize * 2
-                          << " bytes of data");
-        nShort = ringsize;
-        PROFILELOG(myName << ": encrypting data, length " << nShort);
-        TIC(t);
-
-        // we selected a plaintext modulus for the common
-        // cryptocontext so that we could encode source data as a
-        // packed vector of shorts ringsize elements long
-        for (size_t i = 0; i < nShort;
-             i++) { // generate a random array of shorts
-          vShorts.push_back(std::rand() % 65536);
-        }
-
-        // pack them into a packed plaintext (vector encryption)
-        pt = clientCC->MakePackedPlaintext(vShorts);
-
-        ct = clientCC->Encrypt(keyPair.publicKey, pt); // Encrypt
-        PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
-        PROFILELOG(myName << ": sending CT to server");
-        c.SendCT(ct);
-        state = ProducerStates::GetMessage;
-        break;
-
-      case ProducerStates::RequestVecInt: // CT sent, ask for vecInt in return
-        TIC(t);
-        PROFILELOG(myName << ": Requesting VecInt");
-        c.RequestVecInt(); // request the VecInt from the server.
-        PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
-        state = ProducerStates::GetMessage;
-        break;
-
-      case ProducerStates::Verify: // got vecInt, verify it
-        PROFILELOG(myName << ": got verification");
-
-        // producer's final verification.
-        PROFILELOG(myName << ": decrypting my data as a check");
-        // self Decryption of producer's Ciphertext for testing
-        TIC(t);
-        PT ptDec;
-        clientCC->Decrypt(keyPair.secretKey, ct, &ptDec);
-
-        ptDec->SetLength(pt->GetLength()); // need to reset the length
-        // unpack the plaintext data into vecInts
-        vecInt unpackedOriginalProducer = pt->GetPackedValue();
-        vecInt unpackedEncryptedProducer = ptDec->GetPackedValue();
-
-        // note OpenFHE assumes that plaintext is in the range of -p/2..p/2
-        // to recover 0...q simply add q if the unpacked value is negative
-        for (unsigned int j = 0; j < pt->GetLength(); j++) {
-          if (unpackedEncryptedProducer[j] < 0)
-            unpackedEncryptedProducer[j] += plaintextModulus;
-        }
-
-        // verify result
-        PROFILELOG(myName << ": verifying ");
-        // compare all results for correctness and return good=true if correct
-        for (unsigned int j = 0; j < unpackedConsumer.size(); j++) {
-          if ((unpackedOriginalProducer[j] != unpackedEncryptedProducer[j]) ||
-              (unpackedOriginalProducer[j] != unpackedConsumer[j])) {
-            std::cout << j << ", " << unpackedOriginalProducer[j] << ", "
-                      << unpackedEncryptedProducer[j] << ", "
-                      << unpackedConsumer[j] << std::endl;
-            good = false;
-          }
-        }
-        // producer is done
-        PROFILELOG(myName << ": Execution Completed.");
-        c.DisconnectProducer();
-
-        done = true;
-        break;
-
-      } // switch state
+  // the producer runs through its steps in turn, each waits for the
+  // server's reply to the last and goes on as soon as it is in
+  c.AwaitAccept();
+  PROFILELOG(myName << ": Connected as producer " << c.GetPartyID());
+
+  // first step, get the CC from the server
+  TIC(t);
+  PROFILELOG(myName << ": Requesting CC");
+  auto msg = c.Await(c.RequestCC(), PreMsgTypes::SendCC);
+  PROFILELOG(myName << ": reading crypto context from server");
+  clientCC = c.RecvCC(msg);
+  PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
+
+  // then generate keys and send the private key to server
+  PROFILELOG(myName << ": Generating keys");
+  TIC(t);
+  keyPair = clientCC->KeyGen();
+  PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
+
+  if (!keyPair.good()) {
+    std::cerr << myName << " Key generation failed!" << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
 
-    } // IsConnected()
+  PROFILELOG(myName << ": Serializing and sending private key");
+  TIC(t);
+  c.Await(c.SendPrivateKey(keyPair), PreMsgTypes::AckPrivateKey);
+  PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
+  OPENFHE_DEBUG("Server Accepted PrivateKey");
+
+  // generate and send CT
+  ringsize = clientCC->GetRingDimension();
+  plaintextModulus = clientCC->GetCryptoParameters()->GetPlaintextModulus();
+  PROFILELOG(myName << ": plaintext modulus is :" << plaintextModulus);
+
+  if (plaintextModulus < 65536) {
+    std::cerr << "error, code is designed for plaintextModulus>65536, "
+                 "modulus is "
+              << plaintextModulus << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+  PROFILELOG(myName << ": can encrypt " << ringsize * 2 << " bytes of data");
+  nShort = ringsize;
+  PROFILELOG(myName << ": encrypting data, length " << nShort);
+  TIC(t);
+
+  // we selected a plaintext modulus for the common
+  // cryptocontext so that we could encode source data as a
+  // packed vector of shorts ringsize elements long
+  for (size_t i = 0; i < nShort; i++) { // generate a random array of shorts
+    vShorts.push_back(std::rand() % 65536);
+  }
 
-    nap(100); // take a 100 msec pause
+  // pack them into a packed plaintext (vector encryption)
+  pt = clientCC->MakePackedPlaintext(vShorts);
+
+  ct = clientCC->Encrypt(keyPair.publicKey, pt); // Encrypt
+  PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
+  PROFILELOG(myName << ": sending CT to server");
+  c.Await(c.SendCT(ct), PreMsgTypes::AckCT);
+  OPENFHE_DEBUG("Server Accepted CT");
+
+  // CT sent, ask for vecInt in return. The server has none until the
+  // consumer has sent it, it holds on to the request until then.
+  TIC(t);
+  PROFILELOG(myName << ": Requesting VecInt");
+  msg = c.Await(c.RequestVecInt(), PreMsgTypes::SendVecInt);
+  PROFILELOG(myName << ": reading vecInt from server");
+  unpackedConsumer = c.RecvVecInt(msg);
+  PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
+
+  // got vecInt, verify it
+  PROFILELOG(myName << ": got verification");
+
+  // producer's final verification.
+  PROFILELOG(myName << ": decrypting my data as a check");
+  // self Decryption of producer's Ciphertext for testing
+  TIC(t);
+  PT ptDec;
+  clientCC->Decrypt(keyPair.secretKey, ct, &ptDec);
+
+  ptDec->SetLength(pt->GetLength()); // need to reset the length
+  // unpack the plaintext data into vecInts
+  vecInt unpackedOriginalProducer = pt->GetPackedValue();
+  vecInt unpackedEncryptedProducer = ptDec->GetPackedValue();
+
+  // note OpenFHE assumes that plaintext is in the range of -p/2..p/2
+  // to recover 0...q simply add q if the unpacked value is negative
+  for (unsigned int j = 0; j < pt->GetLength(); j++) {
+    if (unpackedEncryptedProducer[j] < 0)
+      unpackedEncryptedProducer[j] += plaintextModulus;
+  }
 
-  } // while !done
+  // verify result
+  PROFILELOG(myName << ": verifying ");
+  // compare all results for correctness and return good=true if correct
+  for (unsigned int j = 0; j < unpackedConsumer.size(); j++) {
+    if ((unpackedOriginalProducer[j] != unpackedEncryptedProducer[j]) ||
+        (unpackedOriginalProducer[j] != unpackedConsumer[j])) {
+      std::cout << j << ", " << unpackedOriginalProducer[j] << ", "
+                << unpackedEncryptedProducer[j] << ", " << unpackedConsumer[j]
+                << std::endl;
+      good = false;
+    }
+  }
+  // producer is done
+  PROFILELOG(myName << ": Execution Completed.");
+  c.DisconnectProducer();
   if (good) {
     std::cout << myName << ": PRE passes" << std::endl;
   } else {
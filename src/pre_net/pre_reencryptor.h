@@ -0,0 +1,107 @@
+#ifndef PRE_REENCRYPTOR_H
+#define PRE_REENCRYPTOR_H
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <thread>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+
+#include "pre_utils.h"
+
+// Re-encrypts batches of ciphertexts on a pool of threads of its own, one
+// task per CT, so a batch spreads over every core and batches for
+// different consumers share them. ReEncrypt itself may also be run in
+// parallel by OpenFHE's OpenMP loops; with a pool as wide as the machine,
+// OMP_NUM_THREADS=1 keeps the two from oversubscribing the cores.
+class PreReEncryptor {
+public:
+  using Done = std::function<void(std::vector<CT>)>;
+
+  struct Stats {
+    uint64_t nCTs;
+    uint64_t nBatches;
+    double busySec; // summed over the threads
+    size_t nThreads;
+  };
+
+  // nThreads 0 for one per core
+  explicit PreReEncryptor(CC cc, size_t nThreads = 0)
+      : m_cc(cc), m_nThreads(nThreads ? nThreads
+                                      : std::max<size_t>(
+                                            std::thread::hardware_concurrency(),
+                                            1)),
+        m_pool(m_nThreads) {}
+
+  // lets the batches under way finish
+  ~PreReEncryptor() { m_pool.join(); }
+
+  // Re-encrypts every CT in vCTs with reencryptionKey, then calls fnDone
+  // with the results, in the same order, on one of the pool's threads
+  void ReEncryptAsync(std::vector<CT> vCTs, EvKey reencryptionKey,
+                      Done fnDone) {
+    m_nBatches++;
+    if (vCTs.empty()) {
+      boost::asio::post(m_pool, [fnDone = std::move(fnDone)]() { fnDone({}); });
+      return;
+    }
+
+    auto pBatch = std::make_shared<Batch>();
+    pBatch->vIn = std::move(vCTs);
+    pBatch->vOut.resize(pBatch->vIn.size());
+    pBatch->reencryptionKey = reencryptionKey;
+    pBatch->nLeft = pBatch->vIn.size();
+    pBatch->fnDone = std::move(fnDone);
+    for (size_t i = 0; i < pBatch->vIn.size(); i++) {
+      boost::asio::post(m_pool, [this, pBatch, i]() {
+        auto start = std::chrono::steady_clock::now();
+        pBatch->vOut[i] =
+            m_cc->ReEncrypt(pBatch->vIn[i], pBatch->reencryptionKey);
+        m_nBusyNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+        m_nCTs++;
+        if (--pBatch->nLeft == 0) {
+          pBatch->fnDone(std::move(pBatch->vOut));
+        }
+      });
+    }
+  }
+
+  // as above, waiting for the results
+  std::vector<CT> ReEncrypt(std::vector<CT> vCTs, EvKey reencryptionKey) {
+    // shared, as the pool thread may still be in set_value() when this
+    // returns
+    auto pPromise = std::make_shared<std::promise<std::vector<CT>>>();
+    auto future = pPromise->get_future();
+    ReEncryptAsync(std::move(vCTs), reencryptionKey,
+                   [pPromise](std::vector<CT> vResults) {
+                     pPromise->set_value(std::move(vResults));
+                   });
+    return future.get();
+  }
+
+  Stats GetStats() const {
+    return {m_nCTs, m_nBatches, m_nBusyNs / 1e9, m_nThreads};
+  }
+
+private:
+  struct Batch {
+    std::vector<CT> vIn;
+    std::vector<CT> vOut;
+    EvKey reencryptionKey;
+    std::atomic<size_t> nLeft;
+    Done fnDone;
+  };
+
+  CC m_cc;
+  size_t m_nThreads;
+  boost::asio::thread_pool m_pool;
+  std::atomic<uint64_t> m_nCTs{0};
+  std::atomic<uint64_t> m_nBatches{0};
+  std::atomic<uint64_t> m_nBusyNs{0};
+};
+
+#endif // PRE_REENCRYPTOR_H
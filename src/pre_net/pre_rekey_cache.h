@@ -0,0 +1,142 @@
+#ifndef PRE_REKEY_CACHE_H
+#define PRE_REKEY_CACHE_H
+
+#include <list>
+
+#include "pre_utils.h"
+
+// Re-encryption keys already made, with the reply that carries each one
+// serialized, so a pair asking again costs neither a ReKeyGen nor a
+// Serialize. Entries are keyed by the producer, the private key it had
+// when the entry was made, and a hash of the consumer's public key as it
+// arrived. The hash only picks the slot: each entry keeps the key's bytes,
+// and Find() hands the entry out only if they match the key asked about,
+// so two keys with the same hash never share a re-encryption key. A new
+// key on either side so never finds an old entry, and Invalidate() drops a
+// producer's entries at once rather than waiting for them to be evicted.
+// The least recently used entry goes when the cache is full.
+class PreReKeyCache {
+public:
+  struct Key {
+    uint32_t nProducer;
+    uint64_t nPrivateKeySerial; // numbers each private key the server gets
+    uint64_t nPublicKeyHash;
+
+    bool operator==(const Key &other) const {
+      return nProducer == other.nProducer &&
+             nPrivateKeySerial == other.nPrivateKeySerial &&
+             nPublicKeyHash == other.nPublicKeyHash;
+    }
+  };
+
+  struct Entry {
+    EvKey reencryptionKey;
+    olc::net::shared_message<PreMsgTypes> reply; // SendReEncryptionKey
+    // the consumer's public key it was made for, as serialized
+    std::shared_ptr<const std::string> pPublicKeyBytes;
+  };
+
+  struct Stats {
+    uint64_t nHits;
+    uint64_t nMisses;
+    uint64_t nEvictions;     // to make room
+    uint64_t nInvalidations; // by Invalidate()
+    size_t nEntries;
+  };
+
+  // a capacity of 0 keeps nothing
+  explicit PreReKeyCache(size_t nCapacity = 1024) : m_nCapacity(nCapacity) {}
+
+  // the entry for key made for the public key serialized as
+  // sPublicKeyBytes, now the most recently used, or nullptr
+  std::shared_ptr<const Entry> Find(const Key &key,
+                                    const std::string &sPublicKeyBytes) {
+    std::scoped_lock lock(m_mux);
+    auto it = m_mapEntries.find(key);
+    if (it == m_mapEntries.end() ||
+        !it->second->second->pPublicKeyBytes ||
+        *it->second->second->pPublicKeyBytes != sPublicKeyBytes) {
+      m_stats.nMisses++;
+      return nullptr;
+    }
+    m_stats.nHits++;
+    m_lstEntries.splice(m_lstEntries.begin(), m_lstEntries, it->second);
+    return it->second->second;
+  }
+
+  void Insert(const Key &key, std::shared_ptr<const Entry> pEntry) {
+    std::shared_ptr<const Entry> pEvicted; // freed outside the lock
+    std::scoped_lock lock(m_mux);
+    if (m_nCapacity == 0) {
+      return;
+    }
+    auto it = m_mapEntries.find(key);
+    if (it != m_mapEntries.end()) {
+      it->second->second = std::move(pEntry);
+      m_lstEntries.splice(m_lstEntries.begin(), m_lstEntries, it->second);
+      return;
+    }
+    if (m_mapEntries.size() == m_nCapacity) {
+      pEvicted = std::move(m_lstEntries.back().second);
+      m_mapEntries.erase(m_lstEntries.back().first);
+      m_lstEntries.pop_back();
+      m_stats.nEvictions++;
+    }
+    m_lstEntries.emplace_front(key, std::move(pEntry));
+    m_mapEntries.emplace(key, m_lstEntries.begin());
+  }
+
+  // drops every entry made for producer nProducer
+  void Invalidate(uint32_t nProducer) {
+    std::list<std::pair<Key, std::shared_ptr<const Entry>>> lstDropped;
+    std::scoped_lock lock(m_mux);
+    for (auto it = m_lstEntries.begin(); it != m_lstEntries.end();) {
+      auto next = std::next(it);
+      if (it->first.nProducer == nProducer) {
+        m_mapEntries.erase(it->first);
+        lstDropped.splice(lstDropped.end(), m_lstEntries, it);
+        m_stats.nInvalidations++;
+      }
+      it = next;
+    }
+  }
+
+  // shrinks the cache at once if it holds more than nCapacity
+  void SetCapacity(size_t nCapacity) {
+    std::list<std::pair<Key, std::shared_ptr<const Entry>>> lstDropped;
+    std::scoped_lock lock(m_mux);
+    m_nCapacity = nCapacity;
+    while (m_mapEntries.size() > m_nCapacity) {
+      m_mapEntries.erase(m_lstEntries.back().first);
+      lstDropped.splice(lstDropped.begin(), m_lstEntries,
+                        std::prev(m_lstEntries.end()));
+      m_stats.nEvictions++;
+    }
+  }
+
+  Stats GetStats() const {
+    std::scoped_lock lock(m_mux);
+    Stats stats = m_stats;
+    stats.nEntries = m_mapEntries.size();
+    return stats;
+  }
+
+private:
+  struct KeyHash {
+    size_t operator()(const Key &key) const {
+      return std::hash<uint64_t>()(key.nPublicKeyHash ^
+                                   (key.nPrivateKeySerial << 32) ^
+                                   key.nProducer);
+    }
+  };
+
+  mutable std::mutex m_mux;
+  size_t m_nCapacity;
+  // most recently used first
+  std::list<std::pair<Key, std::shared_ptr<const Entry>>> m_lstEntries;
+  std::unordered_map<Key, decltype(m_lstEntries)::iterator, KeyHash>
+      m_mapEntries;
+  Stats m_stats{};
+};
+
+#endif // PRE_REKEY_CACHE_H
@@ -55,18 +55,72 @@ int main(int argc, char *argv[]) {
   ////////////////////////////////////////////////////////////
   int opt;
   uint32_t port(0);
+  size_t nThreads(1);
+  size_t nWorkers(0);
+  size_t nQueueMB(0);
+  size_t nBudgetMB(0);
+  std::vector<std::string> vListen;
+  bool bIoUring(false);
+  size_t nReKeys(1024);
+  size_t nReEncryptThreads(0);
 
-  while ((opt = getopt(argc, argv, "p:h")) != -1) {
+  while ((opt = getopt(argc, argv, "p:t:w:q:b:l:uk:e:h")) != -1) {
     switch (opt) {
     case 'p':
       port = atoi(optarg);
       std::cout << "host port " << port << std::endl;
       break;
+    case 't':
+      nThreads = std::stoul(optarg);
+      break;
+    case 'w':
+      nWorkers = std::stoul(optarg);
+      break;
+    case 'q':
+      nQueueMB = std::stoul(optarg);
+      break;
+    case 'b':
+      nBudgetMB = std::stoul(optarg);
+      break;
+    case 'l':
+      vListen.push_back(optarg);
+      break;
+    case 'u':
+      bIoUring = true;
+      break;
+    case 'k':
+      nReKeys = std::stoul(optarg);
+      break;
+    case 'e':
+      nReEncryptThreads = std::stoul(optarg);
+      break;
     case 'h':
     default: /* '?' */
       std::cerr << "Usage: " << std::endl
                 << "arguments:" << std::endl
                 << "  -p port of the server" << std::endl
+                << "  -t number of I/O threads (default 1)" << std::endl
+                << "  -w number of message handler threads (default 0, "
+                   "handle messages on the main thread)"
+                << std::endl
+                << "  -q MB each client may have queued to send (default 0, "
+                   "no limit)"
+                << std::endl
+                << "  -b MB all clients may have queued to send (default 0, "
+                   "no limit)"
+                << std::endl
+                << "  -l also listen on a local address, unix:<path> or "
+                   "shm:<path>, may be repeated"
+                << std::endl
+                << "  -u do socket I/O through io_uring where the kernel "
+                   "allows it"
+                << std::endl
+                << "  -k reencryption keys to keep for pairs that ask again "
+                   "(default 1024, 0 for none)"
+                << std::endl
+                << "  -e threads re-encrypting CTs for consumers that ask "
+                   "for them (default one per core)"
+                << std::endl
                 << "  -h prints this message" << std::endl;
       std::exit(EXIT_FAILURE);
     }
@@ -80,7 +134,18 @@ int main(int argc, char *argv[]) {
 
   PROFILELOG("SERVER: Initializing");
 
-  PreServer server(port);
+  PreServer server(port, nThreads, nWorkers);
+  server.SetSendLimits(nQueueMB << 20, nBudgetMB << 20);
+  server.SetReKeyCacheCapacity(nReKeys);
+  server.SetReEncryptThreads(nReEncryptThreads);
+  if (bIoUring && !server.EnableIoUring()) {
+    std::cerr << "io_uring not available, using the reactor" << std::endl;
+  }
+  for (const auto &sAddress : vListen) {
+    if (!server.Listen(sAddress)) {
+      exit(EXIT_FAILURE);
+    }
+  }
   server.Start();
 
   while (1) {
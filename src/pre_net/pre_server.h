@@ -1,6 +1,9 @@
 #ifndef PRE_SERVER_H
 #define PRE_SERVER_H
 
+#include "pre_keystore.h"
+#include "pre_reencryptor.h"
+#include "pre_rekey_cache.h"
 #include "pre_utils.h"
 
 // based on asio connection objects from olc_net thanks to
@@ -10,24 +13,46 @@ class PreServer : public olc::net::server_interface<PreMsgTypes> {
 public:
   OPENFHE_DEBUG_FLAG(false);
 
-  PreServer(uint16_t nPort)
-      : olc::net::server_interface<PreMsgTypes>(nPort),
-        m_producerPrivateKeyReceived(false), m_producerCTReceived(false),
-        m_consumerVecIntReceived(false) {
+  PreServer(uint16_t nPort, size_t nThreads = 1, size_t nWorkers = 0)
+      : olc::net::server_interface<PreMsgTypes>(nPort, nThreads, nWorkers) {
     // initialize CC and data structures.
     OPENFHE_DEBUG("[SERVER]: Initialize CC");
     ;
     InitializeCC();
+    m_pReEncryptor = std::make_unique<PreReEncryptor>(m_serverCC);
+  }
+
+  // handlers may still be running on the worker pool
+  virtual ~PreServer() { Stop(); }
+
+  // how many re-encryption keys are kept for pairs that ask again, 0 for
+  // none
+  void SetReKeyCacheCapacity(size_t nEntries) {
+    m_rekeyCache.SetCapacity(nEntries);
+  }
+
+  PreReKeyCache::Stats GetReKeyCacheStats() const {
+    return m_rekeyCache.GetStats();
+  }
+
+  // how many threads re-encrypt CTs for RequestReEncryptedCT, 0 for one
+  // per core. Call before Start().
+  void SetReEncryptThreads(size_t nThreads) {
+    m_pReEncryptor = std::make_unique<PreReEncryptor>(m_serverCC, nThreads);
+  }
+
+  PreReEncryptor::Stats GetReEncryptStats() const {
+    return m_pReEncryptor->GetStats();
   }
 
 protected:
   virtual bool
   OnClientConnect(std::shared_ptr<olc::net::connection<PreMsgTypes>> client) {
-    // add client to the data structures
-    // AddClientToDS(client->GetID);
+    // the accept carries the client's ID, the name other parties know it by
     std::cout << "[SERVER]: Adding client\n";
     olc::net::message<PreMsgTypes> msg;
     msg.header.id = PreMsgTypes::ServerAccept;
+    msg << client->GetID();
     OPENFHE_DEBUG("[SERVER]: sending accept");
     client->Send(msg);
     OPENFHE_DEBUG("[SERVER]: done");
@@ -37,60 +62,95 @@ protected:
   // Called when a client appears to have disconnected
   virtual void OnClientDisconnect(
       std::shared_ptr<olc::net::connection<PreMsgTypes>> client) {
-    std::cout << "Removing client [" << client->GetID() << "]\n";
+    std::cout << "Removing client [" << client->GetID() << "], "
+              << m_keystore.Bytes(client->GetID()) << " bytes held\n";
+    RemoveParty(client->GetID());
+    PreReKeyCache::Stats stats = m_rekeyCache.GetStats();
+    std::cout << "[SERVER] reencryption key cache: " << stats.nHits
+              << " hits, " << stats.nMisses << " misses, " << stats.nEntries
+              << " entries\n";
+    PreReEncryptor::Stats reencrypt = m_pReEncryptor->GetStats();
+    if (reencrypt.nCTs != 0) {
+      std::cout << "[SERVER] reencrypted " << reencrypt.nCTs << " CTs in "
+                << reencrypt.nBatches << " batches on " << reencrypt.nThreads
+                << " threads\n";
+    }
   }
 
-  // Called when a message arrives
+  // Called when a message arrives. Replies go out with SendWait(), so with
+  // send limits set a handler waits for a slow client's queue to drain
+  // rather than drop the reply. A request for something not received yet
+  // is parked in m_waiting and answered as soon as it arrives, instead of
+  // being nacked for the client to ask again later.
+  //
+  // Every party's keys and data are kept apart in m_keystore under its
+  // client ID. A consumer gets its re-encryption key and CT from the
+  // producer whose ID its request carries, or else from the producer that
+  // last sent a private key, and stays with that producer from then on.
+  // Instead of the key and the CT, a consumer may ask the server to
+  // re-encrypt the producer's CTs for it with RequestReEncryptedCT.
   virtual void
   OnMessage(std::shared_ptr<olc::net::connection<PreMsgTypes>> client,
             olc::net::message<PreMsgTypes> &msg) {
+    uint32_t nID = client->GetID();
     switch (msg.header.id) {
     case PreMsgTypes::RequestCC:
-      std::cout << "[" << client->GetID() << "]: RequestCC\n";
+      std::cout << "[" << nID << "]: RequestCC\n";
       SendClientCC(client); // this queues next task
       break;
     case PreMsgTypes::SendPrivateKey:
 
-      std::cout << "[" << client->GetID() << "]: SendPrivateKey\n";
-      // receive private key from this client, store it in data structure with
+      std::cout << "[" << nID << "]: SendPrivateKey\n";
+      // receive private key from this client, store it in the keystore with
       // this client as key
       RecvClientPrivateKey(client, msg);
       {
         // send acknowledgement
         olc::net::message<PreMsgTypes> ackMsg;
         ackMsg.header.id = PreMsgTypes::AckPrivateKey;
-        client->Send(ackMsg);
+        client->SendWait(ackMsg);
       }
+      // consumers of this producer, then those waiting for any producer,
+      // which this one now is
+      m_waiting.Notify(WaitKey(PreMsgTypes::RequestReEncryptionKey, nID),
+                       [this](auto waiter, auto &request) {
+                         SendClientReEncryptionKey(waiter, request);
+                       });
+      m_waiting.Notify(WaitKey(PreMsgTypes::RequestReEncryptionKey, 0),
+                       [this](auto waiter, auto &request) {
+                         SendClientReEncryptionKey(waiter, request);
+                       });
+      m_waiting.Notify(WaitKey(PreMsgTypes::RequestCT, 0),
+                       [this](auto waiter, auto &request) {
+                         SendClientCT(waiter, request);
+                       });
+      NotifyReEncryptedCT(nID);
+      NotifyReEncryptedCT(0);
       break;
 
     case PreMsgTypes::SendPublicKey:
 
-      std::cout << "[" << client->GetID() << "]: SendPublicKey\n";
-      // receive the public key from this client, generate a re-encryption key
-      // todo, have consumer ID producer that they want a re-encryption key to..
-      // store the reencryption key in a data structure with the producer
-      // consumer as the key.
-      // create a channel for the producer consumer pair.
-      // send reencryption key.
-
+      std::cout << "[" << nID << "]: SendPublicKey\n";
+      // receive the public key from this client and keep it, the
+      // re-encryption key is made from it once the consumer asks for it
       RecvClientPublicKey(client, msg);
       {
         // send acknowledgement
         olc::net::message<PreMsgTypes> ackMsg;
         ackMsg.header.id = PreMsgTypes::AckPublicKey;
-        client->Send(ackMsg);
+        client->SendWait(ackMsg);
       }
       break;
     case PreMsgTypes::RequestReEncryptionKey:
 
-      std::cout << "[" << client->GetID() << "]: RequestReEncryptionKey\n";
-      SendClientReEncryptionKey(client); // this queues next task
+      std::cout << "[" << nID << "]: RequestReEncryptionKey\n";
+      SendClientReEncryptionKey(client, msg); // this queues next task
 
       break;
 
     case PreMsgTypes::SendCT:
 
-      std::cout << "[" << client->GetID() << "]: SendCT\n";
+      std::cout << "[" << nID << "]: SendCT\n";
       // receive ciphertext
       //  store it in the producer's data structure.
       RecvClientCT(client, msg);
@@ -98,54 +158,68 @@ protected:
         // send acknowledgement
         olc::net::message<PreMsgTypes> ackMsg;
         ackMsg.header.id = PreMsgTypes::AckCT;
-        client->Send(ackMsg);
+        client->SendWait(ackMsg);
       }
+      m_waiting.Notify(WaitKey(PreMsgTypes::RequestCT, nID),
+                       [this](auto waiter, auto &request) {
+                         SendClientCT(waiter, request);
+                       });
+      NotifyReEncryptedCT(nID);
       break;
 
     case PreMsgTypes::RequestCT:
-      std::cout << "[" << client->GetID() << "]: RecvCT\n";
+      std::cout << "[" << nID << "]: RecvCT\n";
       // find the producer for this consumer
       // send the ciphertext if it exists.
-      SendClientCT(client);
+      SendClientCT(client, msg);
+      break;
+
+    case PreMsgTypes::RequestReEncryptedCT:
+      std::cout << "[" << nID << "]: RequestReEncryptedCT\n";
+      // re-encrypt the producer's CTs for this consumer on the
+      // re-encryption pool, the reply goes out from there
+      SendClientReEncryptedCTs(client, msg);
       break;
 
     case PreMsgTypes::SendVecInt:
-      std::cout << "[" << client->GetID() << "]: RecvVecInt\n";
+      std::cout << "[" << nID << "]: RecvVecInt\n";
       // receive checkvector from consumer,
       // store it in the appropriate producer's data structure
-      RecvClientVecInt(client, msg);
       {
+        uint32_t nProducer = RecvClientVecInt(client, msg);
         // send acknowledgement
         olc::net::message<PreMsgTypes> ackMsg;
         ackMsg.header.id = PreMsgTypes::AckVecInt;
-        client->Send(ackMsg);
+        client->SendWait(ackMsg);
+        m_waiting.Notify(WaitKey(PreMsgTypes::RequestVecInt, nProducer),
+                         [this](auto waiter, auto &request) {
+                           SendClientVecInt(waiter, request.header);
+                         });
       }
       break;
 
     case PreMsgTypes::RequestVecInt:
-      std::cout << "[" << client->GetID() << "]: SendVecInt\n";
+      std::cout << "[" << nID << "]: SendVecInt\n";
       // send the vector if it exists.
-      // if it does not exist , loop until it does exist....
-      SendClientVecInt(client);
+      // if it does not exist, the request waits until it does
+      SendClientVecInt(client, msg.header);
       break;
 
     case PreMsgTypes::DisconnectProducer:
-      std::cout << "[" << client->GetID() << "]: DisconnectProducer\n";
+      std::cout << "[" << nID << "]: DisconnectProducer\n";
       // clear all producer data structures
-      m_producerCTReceived = false;
-      m_producerPrivateKeyReceived = false;
+      RemoveParty(nID);
       break;
 
     case PreMsgTypes::DisconnectConsumer:
-      std::cout << "[" << client->GetID() << "]: DisconnectConsumer\n";
+      std::cout << "[" << nID << "]: DisconnectConsumer\n";
       // clear all consumer data structures
-      m_consumerVecIntReceived = false;
-
+      RemoveParty(nID);
       break;
 
       // need to handle all cases or complier complains with -Werror=switch
     default:
-      std::cout << "[" << client->GetID() << "]: unprocessed message\n";
+      std::cout << "[" << nID << "]: unprocessed message\n";
     }
   }
 
@@ -169,213 +243,510 @@ protected:
     m_serverCC->Enable(PRE);
 
     PROFILELOG("[SERVER]: elapsed time " << TOC_MS(t) << "msec.");
+
+    // the context does not change from here on, so it is serialized once
+    // and every RequestCC is answered with the same body
+    olc::net::message<PreMsgTypes> msg;
+    {
+      olc::net::message_ostream<PreMsgTypes> os(msg);
+      Serial::Serialize(m_serverCC, os, SerType::BINARY);
+    }
+    msg.header.id = PreMsgTypes::SendCC;
+    m_ccReply = olc::net::shared_message<PreMsgTypes>(std::move(msg));
   }
 
   void SendClientCC(std::shared_ptr<olc::net::connection<PreMsgTypes>> client) {
-    std::string s;
-    std::ostringstream os(s);
     OPENFHE_DEBUG("[SERVER]: sending cryptocontext to [" << client->GetID()
                                                          << "]:");
-    Serial::Serialize(m_serverCC, os, SerType::BINARY);
-
-    olc::net::message<PreMsgTypes> msg;
-    msg.header.id = PreMsgTypes::SendCC;
-    msg << os.str(); // push the string onto the message.
-
-    client->Send(msg);
+    // the body made by InitializeCC is shared, not copied
+    client->SendWait(m_ccReply);
   }
   void RecvClientPrivateKey(
       std::shared_ptr<olc::net::connection<PreMsgTypes>> client,
       olc::net::message<PreMsgTypes> &msg) {
     // receive the private key from this client,
-    // and store it in the data structure
-    // note a more complex server could store the key in a
-    // data structure indexed by the client->GetID()
+    // and store it in the keystore under the client->GetID()
     unsigned int msgSize(msg.body.size());
 
     OPENFHE_DEBUG("[SERVER] read privatekey of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<PreMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
-    Serial::Deserialize(m_producerPrivateKey, is, SerType::BINARY);
-    m_producerPrivateKeyReceived = true;
+    PrivKey privateKey;
+    {
+      // OpenFHE's context registry is not thread safe
+      std::scoped_lock lock(m_muxDeserialize);
+      Serial::Deserialize(privateKey, is, SerType::BINARY);
+    }
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
+    m_keystore.Update(client->GetID(), [&](PreParty &party) {
+      party.privateKey = privateKey;
+      party.nPrivateKeyBytes = msgSize;
+      party.nPrivateKeySerial = ++m_nPrivateKeySerials;
+    });
+    // keys made from the producer's last private key are no use now
+    m_rekeyCache.Invalidate(client->GetID());
+    {
+      std::scoped_lock lock(m_muxLatest);
+      m_nLatestProducer = client->GetID();
+    }
   }
 
   void
   RecvClientPublicKey(std::shared_ptr<olc::net::connection<PreMsgTypes>> client,
                       olc::net::message<PreMsgTypes> &msg) {
-    // receive the private key from this client,
-    // and store it in the data structure
-    // note a more complex server could store the key in a
-    // data structure indexed by the client->GetID()
+    // receive the public key from this client,
+    // and store it in the keystore under the client->GetID()
     unsigned int msgSize(msg.body.size());
 
-    OPENFHE_DEBUG("[SERVER] read privatekey of " << msgSize << " bytes");
+    OPENFHE_DEBUG("[SERVER] read publickey of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // the same key serializes the same, so its bytes identify it to the
+    // re-encryption key cache
+    auto pPublicKeyBytes = std::make_shared<const std::string>(
+        reinterpret_cast<const char *>(msg.body.data()), msg.body.size());
+    uint64_t nPublicKeyHash = std::hash<std::string>()(*pPublicKeyBytes);
+    // read the body in place, no copy is made
+    olc::net::message_istream<PreMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
-    Serial::Deserialize(m_consumerPublicKey, is, SerType::BINARY);
+    PubKey publicKey;
+    {
+      // OpenFHE's context registry is not thread safe
+      std::scoped_lock lock(m_muxDeserialize);
+      Serial::Deserialize(publicKey, is, SerType::BINARY);
+    }
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
+    m_keystore.Update(client->GetID(), [&](PreParty &party) {
+      party.publicKey = publicKey;
+      party.nPublicKeyBytes = msgSize;
+      party.nPublicKeyHash = nPublicKeyHash;
+      party.pPublicKeyBytes = pPublicKeyBytes;
+    });
   }
-  void SendClientReEncryptionKey(
-      std::shared_ptr<olc::net::connection<PreMsgTypes>> client) {
 
-    olc::net::message<PreMsgTypes> msg;
-    // if the PrivateKey does not yet exist, send a Nack
-    if (!m_producerPrivateKeyReceived) {
-      std::cout << "[SERVER] sending NackReEncryptionKey to ["
-                << client->GetID() << "]:\n";
-      msg.header.id = PreMsgTypes::NackReEncryptionKey;
-      client->Send(msg);
-      return;
+  // The producer a consumer's request is for: the one named in the
+  // request's body, else the one the consumer already has while it is still
+  // here, else the one that last sent a private key, which the consumer
+  // keeps from then on. Returns 0, with the request parked, if no producer
+  // has turned up yet.
+  uint32_t
+  ProducerFor(std::shared_ptr<olc::net::connection<PreMsgTypes>> client,
+              olc::net::message<PreMsgTypes> &request) {
+    uint32_t nID = client->GetID();
+    uint32_t nProducer = 0;
+    if (request.body.size() >= sizeof(nProducer)) {
+      request >> nProducer;
+    }
+    if (nProducer == 0) {
+      nProducer = BoundProducer(nID);
+    }
+    if (nProducer == 0) {
+      std::scoped_lock lock(m_muxLatest);
+      if (m_nLatestProducer == 0) {
+        std::cout << "[SERVER] parking " << request.header.id << " from ["
+                  << nID << "] until there is a producer\n";
+        m_waiting.Subscribe(WaitKey(request.header.id, 0), client,
+                            request.header);
+        return 0;
+      }
+      nProducer = m_nLatestProducer;
+    }
+    m_keystore.Update(nID,
+                      [&](PreParty &party) { party.nProducer = nProducer; });
+    return nProducer;
+  }
+
+  // The re-encryption key from producer nProducer, whose private key is
+  // producerPrivateKey, to the consumer nConsumer, with the reply that
+  // carries it. Taken from the cache when the pair has asked before with
+  // the same keys, else made and cached. nullptr if the consumer has sent
+  // no public key.
+  std::shared_ptr<const PreReKeyCache::Entry>
+  ReEncryptionKeyFor(uint32_t nConsumer, uint32_t nProducer,
+                     const PrivKey &producerPrivateKey,
+                     uint64_t nPrivateKeySerial) {
+    PubKey consumerPublicKey;
+    std::shared_ptr<const std::string> pPublicKeyBytes;
+    PreReKeyCache::Key cacheKey{nProducer, nPrivateKeySerial, 0};
+    m_keystore.Find(nConsumer, [&](PreParty &party) {
+      consumerPublicKey = party.publicKey;
+      pPublicKeyBytes = party.pPublicKeyBytes;
+      cacheKey.nPublicKeyHash = party.nPublicKeyHash;
+    });
+    if (!consumerPublicKey) {
+      return nullptr;
+    }
+
+    // this pair has asked before, with these same keys
+    if (auto pCached = m_rekeyCache.Find(cacheKey, *pPublicKeyBytes)) {
+      return pCached;
     }
 
     TimeVar t; // time benchmarking variable
     PROFILELOG("[SERVER]: making Reencryption Key");
     TIC(t);
     EvKey reencryptionKey =
-        m_serverCC->ReKeyGen(m_producerPrivateKey, m_consumerPublicKey);
+        m_serverCC->ReKeyGen(producerPrivateKey, consumerPublicKey);
     PROFILELOG("[SERVER]: elapsed time " << TOC_MS(t) << "msec.");
 
-    std::string s;
-    std::ostringstream os(s);
-    std::cout << "[SERVER] sending cryptocontext to [" << client->GetID()
+    olc::net::message<PreMsgTypes> msg;
+    {
+      olc::net::message_ostream<PreMsgTypes> os(msg);
+      Serial::Serialize(reencryptionKey, os, SerType::BINARY);
+    }
+    msg.header.id = PreMsgTypes::SendReEncryptionKey;
+
+    // the body is shared by the cache and every reply made from it
+    auto pEntry = std::make_shared<PreReKeyCache::Entry>();
+    pEntry->reencryptionKey = reencryptionKey;
+    pEntry->reply = olc::net::shared_message<PreMsgTypes>(std::move(msg));
+    pEntry->pPublicKeyBytes = pPublicKeyBytes;
+    m_rekeyCache.Insert(cacheKey, pEntry);
+    return pEntry;
+  }
+
+  void SendClientReEncryptionKey(
+      std::shared_ptr<olc::net::connection<PreMsgTypes>> client,
+      olc::net::message<PreMsgTypes> &request) {
+
+    uint32_t nProducer = ProducerFor(client, request);
+    if (nProducer == 0) {
+      return;
+    }
+
+    PrivKey producerPrivateKey;
+    uint64_t nPrivateKeySerial = 0;
+    bool bParked = false;
+    // take the key, ReKeyGen itself runs without the lock
+    bool bProducer = m_keystore.Find(nProducer, [&](PreParty &party) {
+      // if the PrivateKey does not yet exist, wait for it
+      if (!party.privateKey) {
+        std::cout << "[SERVER] parking RequestReEncryptionKey from ["
+                  << client->GetID() << "]\n";
+        m_waiting.Subscribe(
+            WaitKey(PreMsgTypes::RequestReEncryptionKey, nProducer), client,
+            request.header);
+        bParked = true;
+        return;
+      }
+      producerPrivateKey = party.privateKey;
+      nPrivateKeySerial = party.nPrivateKeySerial;
+    });
+    if (bParked) {
+      return;
+    }
+
+    // the producer has gone, or the consumer never sent its public key
+    std::shared_ptr<const PreReKeyCache::Entry> pKey;
+    if (bProducer) {
+      pKey = ReEncryptionKeyFor(client->GetID(), nProducer,
+                                producerPrivateKey, nPrivateKeySerial);
+    }
+    if (!pKey) {
+      std::cout << "[SERVER] no reencryption key from [" << nProducer
+                << "] for [" << client->GetID() << "]\n";
+      olc::net::message<PreMsgTypes> msg;
+      msg.header.id = PreMsgTypes::NackReEncryptionKey;
+      client->SendWait(msg);
+      return;
+    }
+
+    std::cout << "[SERVER] sending reencryption key to [" << client->GetID()
               << "]:\n";
-    Serial::Serialize(reencryptionKey, os, SerType::BINARY);
+    client->SendWait(pKey->reply);
+  }
 
-    msg.header.id = PreMsgTypes::SendReEncryptionKey;
-    msg << os.str(); // push the string onto the message.
-    client->Send(msg);
+  // Re-encrypts every CT the producer has queued for this consumer, on the
+  // re-encryption pool, and sends them back in one SendReEncryptedCT,
+  // oldest first. Waits for the producer's private key and a first CT.
+  void SendClientReEncryptedCTs(
+      std::shared_ptr<olc::net::connection<PreMsgTypes>> client,
+      olc::net::message<PreMsgTypes> &request) {
+
+    uint32_t nProducer = ProducerFor(client, request);
+    if (nProducer == 0) {
+      return;
+    }
+
+    PrivKey producerPrivateKey;
+    uint64_t nPrivateKeySerial = 0;
+    std::vector<CT> vCTs;
+    bool bParked = false;
+    bool bProducer = m_keystore.Find(nProducer, [&](PreParty &party) {
+      if (!party.privateKey || party.qCTs.empty()) {
+        std::cout << "[SERVER] parking RequestReEncryptedCT from ["
+                  << client->GetID() << "]\n";
+        m_waiting.Subscribe(
+            WaitKey(PreMsgTypes::RequestReEncryptedCT, nProducer), client,
+            request.header);
+        bParked = true;
+        return;
+      }
+      producerPrivateKey = party.privateKey;
+      nPrivateKeySerial = party.nPrivateKeySerial;
+      for (const Serialized<CT> &ct : party.qCTs) {
+        vCTs.push_back(ct.Get());
+      }
+    });
+    if (bParked) {
+      return;
+    }
+
+    std::shared_ptr<const PreReKeyCache::Entry> pKey;
+    if (bProducer) {
+      pKey = ReEncryptionKeyFor(client->GetID(), nProducer,
+                                producerPrivateKey, nPrivateKeySerial);
+    }
+    if (!pKey) {
+      std::cout << "[SERVER] no reencrypted CT from [" << nProducer
+                << "] for [" << client->GetID() << "]\n";
+      olc::net::message<PreMsgTypes> msg;
+      msg.header.id = PreMsgTypes::NackReEncryptedCT;
+      client->SendWait(msg);
+      return;
+    }
+
+    // the reply leaves from a pool thread, outside this handler's reply
+    // scope, so it is numbered by hand
+    uint32_t nCorrelation = request.header.correlation;
+    m_pReEncryptor->ReEncryptAsync(
+        std::move(vCTs), pKey->reencryptionKey,
+        [client, nCorrelation](std::vector<CT> vReEncrypted) {
+          olc::net::message<PreMsgTypes> msg;
+          {
+            olc::net::message_ostream<PreMsgTypes> os(msg);
+            Serial::Serialize(vReEncrypted, os, SerType::BINARY);
+          }
+          msg.header.id = PreMsgTypes::SendReEncryptedCT;
+          typename olc::net::connection<PreMsgTypes>::reply_scope scope(
+              client.get(), nCorrelation);
+          client->SendWait(std::move(msg));
+        });
+  }
+
+  void NotifyReEncryptedCT(uint32_t nProducer) {
+    m_waiting.Notify(WaitKey(PreMsgTypes::RequestReEncryptedCT, nProducer),
+                     [this](auto waiter, auto &request) {
+                       SendClientReEncryptedCTs(waiter, request);
+                     });
   }
 
   void RecvClientCT(std::shared_ptr<olc::net::connection<PreMsgTypes>> client,
                     olc::net::message<PreMsgTypes> &msg) {
     // receive the CT from this client,
-    // and store it in the data structure with this client as key
-    // note a more complex server could store the key in a
-    // data structure indexed by the client->GetID()
+    // and store it in the keystore under the client->GetID()
     unsigned int msgSize(msg.body.size());
 
     OPENFHE_DEBUG("[SERVER] read CT of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<PreMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
-    Serial::Deserialize(m_producerCT, is, SerType::BINARY);
+    CT ct;
+    {
+      // OpenFHE's context registry is not thread safe
+      std::scoped_lock lock(m_muxDeserialize);
+      Serial::Deserialize(ct, is, SerType::BINARY);
+    }
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
-    m_producerCTReceived = true; // ideally should be locked
+    // every RequestCT is answered with the bytes the CT arrived in
+    msg.header.id = PreMsgTypes::SendCT;
+    Serialized<CT> stored;
+    stored.Set(std::move(ct), std::move(msg));
+    m_keystore.Update(client->GetID(), [&](PreParty &party) {
+      party.PushCT(std::move(stored), msgSize);
+    });
   }
-  void SendClientCT(std::shared_ptr<olc::net::connection<PreMsgTypes>> client) {
-    olc::net::message<PreMsgTypes> msg;
-    // if the PrivateKey does not yet exist, send a Nack
-    if (!m_producerCTReceived) {
-      std::cout << "[SERVER] sending NackCT to [" << client->GetID() << "]:\n";
+  void SendClientCT(std::shared_ptr<olc::net::connection<PreMsgTypes>> client,
+                    olc::net::message<PreMsgTypes> &request) {
+    uint32_t nProducer = ProducerFor(client, request);
+    if (nProducer == 0) {
+      return;
+    }
+
+    olc::net::shared_message<PreMsgTypes> reply;
+    bool bParked = false;
+    bool bProducer = m_keystore.Find(nProducer, [&](PreParty &party) {
+      // if the CT does not yet exist, wait for it
+      if (party.qCTs.empty()) {
+        std::cout << "[SERVER] parking RequestCT from [" << client->GetID()
+                  << "]\n";
+        m_waiting.Subscribe(WaitKey(PreMsgTypes::RequestCT, nProducer), client,
+                            request.header);
+        bParked = true;
+        return;
+      }
+      reply = party.qCTs.back().Message();
+    });
+    if (bParked) {
+      return;
+    }
+    if (!bProducer) {
+      std::cout << "[SERVER] no CT from [" << nProducer << "] for ["
+                << client->GetID() << "]\n";
+      olc::net::message<PreMsgTypes> msg;
       msg.header.id = PreMsgTypes::NackCT;
-      client->Send(msg);
+      client->SendWait(msg);
       return;
     }
 
-    std::string s;
-    std::ostringstream os(s);
     OPENFHE_DEBUG("[SERVER]: sending CT to [" << client->GetID() << "]:");
-    Serial::Serialize(m_producerCT, os, SerType::BINARY);
-
-    msg.header.id = PreMsgTypes::SendCT;
-    msg << os.str(); // push the string onto the message.
-    OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
-    OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    client->Send(msg);
+    OPENFHE_DEBUG("[SERVER]: msg.size() " << reply.size());
+    // the body serialized when the CT arrived, shared
+    client->SendWait(reply);
   }
 
-  void
+  // Returns the producer the vector went to, 0 if there was none to take it
+  uint32_t
   RecvClientVecInt(std::shared_ptr<olc::net::connection<PreMsgTypes>> client,
                    olc::net::message<PreMsgTypes> &msg) {
-    // receive the CT from this client,
-    // and store it in the data structure with this client as key
-    // note a more complex server could store the key in a
-    // data structure indexed by the client->GetID()
-
+    // receive the vecInt from this client,
+    // and store it with the producer this consumer gets its CT from
     unsigned int msgSize(msg.body.size());
 
     OPENFHE_DEBUG("[SERVER] read vecInt of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<PreMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
-
-    Serial::Deserialize(m_consumerVecInt, is, SerType::BINARY);
+    vecInt vi;
+    {
+      // OpenFHE's context registry is not thread safe
+      std::scoped_lock lock(m_muxDeserialize);
+      Serial::Deserialize(vi, is, SerType::BINARY);
+    }
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
-    m_consumerVecIntReceived = true; // ideally should be locked
+    msg.header.id = PreMsgTypes::SendVecInt;
+    Serialized<vecInt> stored;
+    stored.Set(std::move(vi), std::move(msg));
+
+    uint32_t nProducer = BoundProducer(client->GetID());
+    if (nProducer == 0) {
+      std::scoped_lock lock(m_muxLatest);
+      nProducer = m_nLatestProducer;
+    }
+    bool bProducer = nProducer != 0 &&
+                     m_keystore.Find(nProducer, [&](PreParty &party) {
+                       party.vecIntBack = std::move(stored);
+                       party.nVecIntBytes = msgSize;
+                     });
+    if (!bProducer) {
+      std::cout << "[SERVER] no producer for the vecInt from ["
+                << client->GetID() << "]\n";
+      return 0;
+    }
+    return nProducer;
   }
   void
-  SendClientVecInt(std::shared_ptr<olc::net::connection<PreMsgTypes>> client) {
-    olc::net::message<PreMsgTypes> msg;
-    // if the CT does not yet exist, send a Nack
-    if (!m_consumerVecIntReceived) {
-      std::cout << "[SERVER] sending NackVecInt to [" << client->GetID()
-                << "]:\n";
-      msg.header.id = PreMsgTypes::NackVecInt;
-      client->Send(msg);
+  SendClientVecInt(std::shared_ptr<olc::net::connection<PreMsgTypes>> client,
+                   const olc::net::message_header<PreMsgTypes> &request) {
+    olc::net::shared_message<PreMsgTypes> reply;
+    bool bParked = false;
+    m_keystore.Update(client->GetID(), [&](PreParty &party) {
+      // if the vecInt does not yet exist, wait for it
+      if (!party.vecIntBack.IsSet()) {
+        std::cout << "[SERVER] parking RequestVecInt from [" << client->GetID()
+                  << "]\n";
+        m_waiting.Subscribe(
+            WaitKey(PreMsgTypes::RequestVecInt, client->GetID()), client,
+            request);
+        bParked = true;
+        return;
+      }
+      reply = party.vecIntBack.Message();
+    });
+    if (bParked) {
       return;
     }
 
     OPENFHE_DEBUG("[SERVER]: sending VecInt to [" << client->GetID() << "]:");
+    OPENFHE_DEBUG("[SERVER]: sending vecInt " << reply.size() << " bytes");
+    // the body serialized when the vecInt arrived, shared
+    client->SendWait(reply);
+  }
 
-    msg.header.id = PreMsgTypes::SendVecInt;
+  // The producer consumer nID is bound to, or 0 if it has none or that
+  // producer has left since. RemoveParty() leaves the consumers bound to a
+  // producer alone, they move on to the latest one when they next ask.
+  uint32_t BoundProducer(uint32_t nID) {
+    uint32_t nProducer = 0;
+    m_keystore.Find(nID,
+                    [&](PreParty &party) { nProducer = party.nProducer; });
+    if (nProducer != 0 && !m_keystore.Find(nProducer, [](PreParty &) {})) {
+      nProducer = 0;
+    }
+    return nProducer;
+  }
 
-    OPENFHE_DEBUG("[SERVER]: serializing vecInt");
-    std::string s;
-    std::ostringstream os(s);
-    Serial::Serialize(m_consumerVecInt, os, SerType::BINARY);
+  // Forgets a party. The requests of consumers waiting on it as their
+  // producer are handled again, and move on to the latest producer, or wait
+  // for one to turn up.
+  void RemoveParty(uint32_t nID) {
+    m_keystore.Erase(nID);
+    m_rekeyCache.Invalidate(nID);
+    {
+      std::scoped_lock lock(m_muxLatest);
+      if (m_nLatestProducer == nID) {
+        m_nLatestProducer = 0;
+      }
+    }
+    m_waiting.Notify(WaitKey(PreMsgTypes::RequestReEncryptionKey, nID),
+                     [this](auto waiter, auto &request) {
+                       SendClientReEncryptionKey(waiter, request);
+                     });
+    m_waiting.Notify(WaitKey(PreMsgTypes::RequestCT, nID),
+                     [this](auto waiter, auto &request) {
+                       SendClientCT(waiter, request);
+                     });
+    NotifyReEncryptedCT(nID);
+  }
 
-    msg << os.str();
-    OPENFHE_DEBUG("[SERVER]: final msg.body.size " << msg.body.size());
-    OPENFHE_DEBUG("[SERVER]: final msg.size " << msg.size());
-    OPENFHE_DEBUG("[SERVER]: sending vecInt " << msg.size() << " bytes");
-    client->Send(msg);
+  // requests waiting on producer nProducer are parked under this, those
+  // waiting for any producer at all under nProducer 0
+  static uint64_t WaitKey(PreMsgTypes id, uint32_t nProducer) {
+    return (uint64_t(id) << 32) | nProducer;
   }
 
 private:
-  // Server state
+  // Server state. m_serverCC and m_ccReply are only read after
+  // construction. The parties' keys and data are in m_keystore, which locks
+  // them shard by shard, as handlers for different clients may run at the
+  // same time on the worker pool
   CC m_serverCC;
-
-  // a full up server would have lists of producers and consumers,
-  // and their approved connections,
-  // but we will only keep track of one pair in this example
-
-  bool m_producerPrivateKeyReceived; // if true this has been received
-  PrivKey m_producerPrivateKey;
-
-  bool m_producerCTReceived;
-  CT m_producerCT;
-
-  PubKey m_consumerPublicKey;
-
-  bool m_consumerVecIntReceived;
-  vecInt m_consumerVecInt;
+  olc::net::shared_message<PreMsgTypes> m_ccReply; // SendCC
+  std::mutex m_muxDeserialize;
+  PreKeystore m_keystore;
+  std::atomic<uint64_t> m_nPrivateKeySerials{0};
+
+  // re-encryption keys by producer and consumer key, locked on its own
+  PreReKeyCache m_rekeyCache;
+
+  // runs ReEncrypt for RequestReEncryptedCT on threads of its own
+  std::unique_ptr<PreReEncryptor> m_pReEncryptor;
+
+  // the producer that last sent a private key, 0 for none, for consumers
+  // that don't say which producer they want. Guarded by m_muxLatest.
+  std::mutex m_muxLatest;
+  uint32_t m_nLatestProducer = 0;
+
+  // requests for data not received yet, keyed by WaitKey(). Parked while
+  // holding the lock the data is checked under, m_muxLatest or the
+  // producer's shard in m_keystore, so one can't slip in after the data
+  // arrives.
+  olc::net::subscriptions<PreMsgTypes, uint64_t> m_waiting;
 };
 
 #endif // PRE_SERVER_H
@@ -74,6 +74,9 @@ enum class PreMsgTypes : uint32_t {
   NackVecInt,
   DisconnectProducer,
   DisconnectConsumer,
+  RequestReEncryptedCT,
+  SendReEncryptedCT,
+  NackReEncryptedCT,
 };
 
 std::vector<std::string> PreMsgNames{
@@ -97,6 +100,9 @@ std::vector<std::string> PreMsgNames{
     "NackVecInt",
     "DisconnectProducer",
     "DisconnectConsumer",
+    "RequestReEncryptedCT",
+    "SendReEncryptedCT",
+    "NackReEncryptedCT",
 };
 
 // Code to convert from enum class to underlying int for reference.
@@ -107,6 +113,19 @@ std::ostream &operator<<(std::ostream &os, const PreMsgTypes &obj) {
   return os;
 }
 
+// Serializes an object the way the examples send it, for Serialized below
+struct BinarySerializer {
+  template <typename Obj>
+  void operator()(const Obj &obj, std::ostream &os) const {
+    Serial::Serialize(obj, os, SerType::BINARY);
+  }
+};
+
+// An object a server stores and sends on, kept with the message that
+// carries it so it is serialized once, when it is stored
+template <typename Obj>
+using Serialized = olc::net::serialized<PreMsgTypes, Obj, BinarySerializer>;
+
 /**
  * Take a powernap of (DEFAULT) 0.5 seconds
  * @param ms - number of milisec to nap
@@ -23,11 +23,9 @@ public:
     OPENFHE_DEBUG("Client: read CC of " << msgSize << " bytes");
     OPENFHE_DEBUG("Client: msg.size() " << msg.size());
     OPENFHE_DEBUG("Client: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("Client istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<PreMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("Client: Deserialize");
     Serial::Deserialize(cc, is, SerType::BINARY);
 
@@ -43,14 +41,12 @@ public:
   OPENFHE_DEBUG_FLAG(false); // true turns on OPENFHE_DEBUG() statements
 
   void SendPrivateKey(KPair &kp) {
-    std::string s;
-    std::ostringstream os(s);
+    olc::net::message<PreMsgTypes> msg;
     OPENFHE_DEBUG("Producer: serializing secret key");
+    olc::net::message_ostream<PreMsgTypes> os(msg);
     Serial::Serialize(kp.secretKey, os, SerType::BINARY);
     OPENFHE_DEBUG("Producer: done");
-    olc::net::message<PreMsgTypes> msg;
     msg.header.id = PreMsgTypes::SendPrivateKey;
-    msg << os.str();
     OPENFHE_DEBUG("Producer: final msg.body.size " << msg.body.size());
     OPENFHE_DEBUG("Producer: final msg.size " << msg.size());
     Send(msg);
@@ -58,12 +54,10 @@ public:
 
   void SendCT(CT &ct) {
     OPENFHE_DEBUG("Producer: serializing CT");
-    std::string s;
-    std::ostringstream os(s);
-    Serial::Serialize(ct, os, SerType::BINARY);
     olc::net::message<PreMsgTypes> msg;
+    olc::net::message_ostream<PreMsgTypes> os(msg);
+    Serial::Serialize(ct, os, SerType::BINARY);
     msg.header.id = PreMsgTypes::SendCT;
-    msg << os.str();
     OPENFHE_DEBUG("Producer: final msg.body.size " << msg.body.size());
     OPENFHE_DEBUG("Producer: final msg.size " << msg.size());
     Send(msg);
@@ -81,11 +75,9 @@ public:
     OPENFHE_DEBUG("Producer: read vecInt of " << msgSize << " bytes");
     OPENFHE_DEBUG("Producer: msg.size() " << msg.size());
     OPENFHE_DEBUG("Producer: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("Producer istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<PreMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("Producer: Deserialize");
     vecInt vi; // create the vector
     Serial::Deserialize(vi, is, SerType::BINARY);
@@ -102,13 +94,11 @@ public:
       false); // set to true to turn on OPENFHE_DEBUG() statements
 
   void SendPublicKey(KPair &kp) {
-    std::string s;
-    std::ostringstream os(s);
+    olc::net::message<PreMsgTypes> msg;
     OPENFHE_DEBUG("Consumer: serializing public key");
+    olc::net::message_ostream<PreMsgTypes> os(msg);
     Serial::Serialize(kp.publicKey, os, SerType::BINARY);
-    olc::net::message<PreMsgTypes> msg;
     msg.header.id = PreMsgTypes::SendPublicKey;
-    msg << os.str();
     OPENFHE_DEBUG("Consumer: final msg.body.size " << msg.body.size());
     OPENFHE_DEBUG("Consumer: final msg.size " << msg.size());
     Send(msg);
@@ -127,10 +117,8 @@ public:
     OPENFHE_DEBUG("CLIENT: read CC of " << msgSize << " bytes");
     OPENFHE_DEBUG("Client: msg.size() " << msg.size());
     OPENFHE_DEBUG("Client: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("CLIENT istringstream.str.size(): " << is.str().size());
-    // NOTE Deserialize needs a basic_istream<char>
+    // read the body in place, no copy is made
+    olc::net::message_istream<PreMsgTypes> is(msg);
     OPENFHE_DEBUG("CLIENT: Deserialize");
     Serial::Deserialize(reencKey, is, SerType::BINARY);
     return reencKey;
@@ -148,10 +136,8 @@ public:
     OPENFHE_DEBUG("CLIENT: read CT of " << msgSize << " bytes");
     OPENFHE_DEBUG("Client: msg.size() " << msg.size());
     OPENFHE_DEBUG("Client: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("CLIENT istringstream.str.size(): " << is.str().size());
-    // NOTE Deserialize needs a basic_istream<char>
+    // read the body in place, no copy is made
+    olc::net::message_istream<PreMsgTypes> is(msg);
     OPENFHE_DEBUG("CLIENT: Deserialize");
     Serial::Deserialize(ct, is, SerType::BINARY);
     return ct;
@@ -159,12 +145,10 @@ public:
 
   void SendVecInt(vecInt &vi) {
     OPENFHE_DEBUG("Consumer: serializing vecInt");
-    std::string s;
-    std::ostringstream os(s);
-    Serial::Serialize(vi, os, SerType::BINARY);
     olc::net::message<PreMsgTypes> msg;
+    olc::net::message_ostream<PreMsgTypes> os(msg);
+    Serial::Serialize(vi, os, SerType::BINARY);
     msg.header.id = PreMsgTypes::SendVecInt;
-    msg << os.str();
     OPENFHE_DEBUG("Consumer: final msg.body.size " << msg.body.size());
     OPENFHE_DEBUG("Consumer: final msg.size " << msg.size());
     OPENFHE_DEBUG("Consumer: sending vecInt " << msg.size() << " bytes");
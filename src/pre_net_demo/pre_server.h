@@ -10,8 +10,8 @@ class PreServer : public olc::net::server_interface<PreMsgTypes> {
 public:
   OPENFHE_DEBUG_FLAG(false);
 
-  PreServer(uint16_t nPort)
-      : olc::net::server_interface<PreMsgTypes>(nPort),
+  PreServer(uint16_t nPort, size_t nThreads = 1, size_t nWorkers = 0)
+      : olc::net::server_interface<PreMsgTypes>(nPort, nThreads, nWorkers),
         m_producerPrivateKeyReceived(false), m_producerCTReceived(false),
         m_consumerVecIntReceived(false) {
     // initialize CC and data structures.
@@ -20,6 +20,9 @@ public:
     InitializeCC();
   }
 
+  // handlers may still be running on the worker pool
+  virtual ~PreServer() { Stop(); }
+
 protected:
   virtual bool
   OnClientConnect(std::shared_ptr<olc::net::connection<PreMsgTypes>> client) {
@@ -85,8 +88,8 @@ protected:
     case PreMsgTypes::RequestReEncryptionKey:
 
       std::cout << "[" << client->GetID() << "]: RequestReEncryptionKey\n";
-      m_clientID = msg.header.SubType_ID;
-      SendClientReEncryptionKey(client); // this queues next task
+      // this queues next task
+      SendClientReEncryptionKey(client, msg.header.SubType_ID);
 
       break;
 
@@ -155,20 +158,23 @@ protected:
     m_serverCC->Enable(PRE);
 
     PROFILELOG("[SERVER]: elapsed time " << TOC_MS(t) << "msec.");
+
+    // the context does not change from here on, so it is serialized once
+    // and every RequestCC is answered with the same body
+    olc::net::message<PreMsgTypes> msg;
+    {
+      olc::net::message_ostream<PreMsgTypes> os(msg);
+      Serial::Serialize(m_serverCC, os, SerType::BINARY);
+    }
+    msg.header.id = PreMsgTypes::SendCC;
+    m_ccReply = olc::net::shared_message<PreMsgTypes>(std::move(msg));
   }
 
   void SendClientCC(std::shared_ptr<olc::net::connection<PreMsgTypes>> client) {
-    std::string s;
-    std::ostringstream os(s);
     OPENFHE_DEBUG("[SERVER]: sending cryptocontext to [" << client->GetID()
                                                          << "]:");
-    Serial::Serialize(m_serverCC, os, SerType::BINARY);
-
-    olc::net::message<PreMsgTypes> msg;
-    msg.header.id = PreMsgTypes::SendCC;
-    msg << os.str(); // push the string onto the message.
-
-    client->Send(msg);
+    // the body made by InitializeCC is shared, not copied
+    client->Send(m_ccReply);
   }
   void RecvClientPrivateKey(
       std::shared_ptr<olc::net::connection<PreMsgTypes>> client,
@@ -182,16 +188,23 @@ protected:
     OPENFHE_DEBUG("[SERVER] read privatekey of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<PreMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
-    Serial::Deserialize(m_producerPrivateKey, is, SerType::BINARY);
-    m_producerPrivateKeyReceived = true;
+    PrivKey privateKey;
+    {
+      // OpenFHE's context registry is not thread safe
+      std::scoped_lock lock(m_muxDeserialize);
+      Serial::Deserialize(privateKey, is, SerType::BINARY);
+    }
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
+    {
+      std::scoped_lock lock(m_muxState);
+      m_producerPrivateKey = privateKey;
+      m_producerPrivateKeyReceived = true;
+    }
   }
 
   void
@@ -206,47 +219,61 @@ protected:
     OPENFHE_DEBUG("[SERVER] read privatekey of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<PreMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
-    Serial::Deserialize(m_consumerPublicKey, is, SerType::BINARY);
+    PubKey publicKey;
+    {
+      // OpenFHE's context registry is not thread safe
+      std::scoped_lock lock(m_muxDeserialize);
+      Serial::Deserialize(publicKey, is, SerType::BINARY);
+    }
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
+    {
+      std::scoped_lock lock(m_muxState);
+      m_consumerPublicKey = publicKey;
+    }
   }
   void SendClientReEncryptionKey(
-      std::shared_ptr<olc::net::connection<PreMsgTypes>> client) {
+      std::shared_ptr<olc::net::connection<PreMsgTypes>> client,
+      unsigned int clientID) {
     olc::net::message<PreMsgTypes> msg;
-    // if the PrivateKey does not yet exist, send a Nack
-    if (!m_producerPrivateKeyReceived) {
-      std::cout << "[SERVER] sending NackReEncryptionKey to ["
-                << client->GetID() << "]:\n";
-      msg.header.id = PreMsgTypes::NackReEncryptionKey;
-      client->Send(msg);
-      return;
+    PrivKey producerPrivateKey;
+    PubKey consumerPublicKey;
+    {
+      std::scoped_lock lock(m_muxState);
+      // if the PrivateKey does not yet exist, send a Nack
+      if (!m_producerPrivateKeyReceived) {
+        std::cout << "[SERVER] sending NackReEncryptionKey to ["
+                  << client->GetID() << "]:\n";
+        msg.header.id = PreMsgTypes::NackReEncryptionKey;
+        client->Send(msg);
+        return;
+      }
+      // take the keys, ReKeyGen itself runs without the lock
+      producerPrivateKey = m_producerPrivateKey;
+      consumerPublicKey = m_consumerPublicKey;
     }
 
     TimeVar t; // time benchmarking variable
     EvKey reencryptionKey;
     PROFILELOG("[SERVER]: making Reencryption Key");
     TIC(t);
-    if (m_clientID == 0) {
+    if (clientID == 0) {
       reencryptionKey =
-          m_serverCC->ReKeyGen(m_producerPrivateKey, m_consumerPublicKey);
+          m_serverCC->ReKeyGen(producerPrivateKey, consumerPublicKey);
     }
 
     PROFILELOG("[SERVER]: elapsed time " << TOC_MS(t) << "msec.");
 
-    std::string s;
-    std::ostringstream os(s);
     std::cout << "[SERVER] sending cryptocontext to [" << client->GetID()
               << "]:\n";
+    olc::net::message_ostream<PreMsgTypes> os(msg);
     Serial::Serialize(reencryptionKey, os, SerType::BINARY);
 
     msg.header.id = PreMsgTypes::SendReEncryptionKey;
-    msg << os.str(); // push the string onto the message.
     client->Send(msg);
   }
 
@@ -261,37 +288,48 @@ protected:
     OPENFHE_DEBUG("[SERVER] read CT of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<PreMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
-    Serial::Deserialize(m_producerCT, is, SerType::BINARY);
+    CT ct;
+    {
+      // OpenFHE's context registry is not thread safe
+      std::scoped_lock lock(m_muxDeserialize);
+      Serial::Deserialize(ct, is, SerType::BINARY);
+    }
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
-    m_producerCTReceived = true; // ideally should be locked
+    // every RequestCT is answered with the bytes the CT arrived in
+    msg.header.id = PreMsgTypes::SendCT;
+    Serialized<CT> stored;
+    stored.Set(std::move(ct), std::move(msg));
+    {
+      std::scoped_lock lock(m_muxState);
+      m_producerCT = std::move(stored);
+      m_producerCTReceived = true;
+    }
   }
   void SendClientCT(std::shared_ptr<olc::net::connection<PreMsgTypes>> client) {
-    olc::net::message<PreMsgTypes> msg;
-    // if the PrivateKey does not yet exist, send a Nack
-    if (!m_producerCTReceived) {
-      std::cout << "[SERVER] sending NackCT to [" << client->GetID() << "]:\n";
-      msg.header.id = PreMsgTypes::NackCT;
-      client->Send(msg);
-      return;
+    olc::net::shared_message<PreMsgTypes> reply;
+    {
+      std::scoped_lock lock(m_muxState);
+      // if the PrivateKey does not yet exist, send a Nack
+      if (!m_producerCTReceived) {
+        std::cout << "[SERVER] sending NackCT to [" << client->GetID()
+                  << "]:\n";
+        olc::net::message<PreMsgTypes> msg;
+        msg.header.id = PreMsgTypes::NackCT;
+        client->Send(msg);
+        return;
+      }
+      reply = m_producerCT.Message();
     }
 
-    std::string s;
-    std::ostringstream os(s);
     OPENFHE_DEBUG("[SERVER]: sending CT to [" << client->GetID() << "]:");
-    Serial::Serialize(m_producerCT, os, SerType::BINARY);
-
-    msg.header.id = PreMsgTypes::SendCT;
-    msg << os.str(); // push the string onto the message.
-    OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
-    OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    client->Send(msg);
+    OPENFHE_DEBUG("[SERVER]: msg.size() " << reply.size());
+    // the body serialized when the CT arrived, shared
+    client->Send(reply);
   }
 
   void
@@ -307,49 +345,59 @@ protected:
     OPENFHE_DEBUG("[SERVER] read vecInt of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<PreMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
-
-    Serial::Deserialize(m_consumerVecInt, is, SerType::BINARY);
+    vecInt vi;
+    {
+      // OpenFHE's context registry is not thread safe
+      std::scoped_lock lock(m_muxDeserialize);
+      Serial::Deserialize(vi, is, SerType::BINARY);
+    }
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
-    m_consumerVecIntReceived = true; // ideally should be locked
+    msg.header.id = PreMsgTypes::SendVecInt;
+    Serialized<vecInt> stored;
+    stored.Set(std::move(vi), std::move(msg));
+    {
+      std::scoped_lock lock(m_muxState);
+      m_consumerVecInt = std::move(stored);
+      m_consumerVecIntReceived = true;
+    }
   }
   void
   SendClientVecInt(std::shared_ptr<olc::net::connection<PreMsgTypes>> client) {
-    olc::net::message<PreMsgTypes> msg;
-    // if the CT does not yet exist, send a Nack
-    if (!m_consumerVecIntReceived) {
-      std::cout << "[SERVER] sending NackVecInt to [" << client->GetID()
-                << "]:\n";
-      msg.header.id = PreMsgTypes::NackVecInt;
-      client->Send(msg);
-      return;
+    olc::net::shared_message<PreMsgTypes> reply;
+    {
+      std::scoped_lock lock(m_muxState);
+      // if the CT does not yet exist, send a Nack
+      if (!m_consumerVecIntReceived) {
+        std::cout << "[SERVER] sending NackVecInt to [" << client->GetID()
+                  << "]:\n";
+        olc::net::message<PreMsgTypes> msg;
+        msg.header.id = PreMsgTypes::NackVecInt;
+        client->Send(msg);
+        return;
+      }
+      reply = m_consumerVecInt.Message();
     }
 
     OPENFHE_DEBUG("[SERVER]: sending VecInt to [" << client->GetID() << "]:");
-
-    msg.header.id = PreMsgTypes::SendVecInt;
-
-    OPENFHE_DEBUG("[SERVER]: serializing vecInt");
-    std::string s;
-    std::ostringstream os(s);
-    Serial::Serialize(m_consumerVecInt, os, SerType::BINARY);
-
-    msg << os.str();
-    OPENFHE_DEBUG("[SERVER]: final msg.body.size " << msg.body.size());
-    OPENFHE_DEBUG("[SERVER]: final msg.size " << msg.size());
-    OPENFHE_DEBUG("[SERVER]: sending vecInt " << msg.size() << " bytes");
-    client->Send(msg);
+    OPENFHE_DEBUG("[SERVER]: sending vecInt " << reply.size() << " bytes");
+    // the body serialized when the vecInt arrived, shared
+    client->Send(reply);
   }
 
 private:
-  // Server state
+  // Server state. m_serverCC and m_ccReply are only read after
+  // construction, everything below them is guarded by m_muxState, as
+  // handlers for different clients may run at the same time on the worker
+  // pool
   CC m_serverCC;
+  olc::net::shared_message<PreMsgTypes> m_ccReply; // SendCC
+  std::mutex m_muxState;
+  std::mutex m_muxDeserialize;
 
   // a full up server would have lists of producers and consumers,
   // and their approved connections,
@@ -359,13 +407,12 @@ private:
   PrivKey m_producerPrivateKey;
 
   bool m_producerCTReceived;
-  CT m_producerCT;
+  Serialized<CT> m_producerCT;
 
   PubKey m_consumerPublicKey;
 
   bool m_consumerVecIntReceived;
-  vecInt m_consumerVecInt;
-  unsigned int m_clientID;
+  Serialized<vecInt> m_consumerVecInt;
 };
 
 #endif // PRE_SERVER_H
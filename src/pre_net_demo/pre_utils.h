@@ -108,6 +108,19 @@ std::ostream &operator<<(std::ostream &os, const PreMsgTypes &obj) {
   return os;
 }
 
+// Serializes an object the way the examples send it, for Serialized below
+struct BinarySerializer {
+  template <typename Obj>
+  void operator()(const Obj &obj, std::ostream &os) const {
+    Serial::Serialize(obj, os, SerType::BINARY);
+  }
+};
+
+// An object a server stores and sends on, kept with the message that
+// carries it so it is serialized once, when it is stored
+template <typename Obj>
+using Serialized = olc::net::serialized<PreMsgTypes, Obj, BinarySerializer>;
+
 /**
  * Take a powernap of (DEFAULT) 0.5 seconds
  * @param ms - number of milisec to nap
@@ -0,0 +1,166 @@
+// @file bench_reencrypt.cpp - Throughput of the PRE server's batch
+// re-encryption across threads
+// @author TPOC: contact@openfhe-crypto.org
+//
+// @copyright Copyright (c) 2020, 2023 Duality Technologies Inc.
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution. THIS SOFTWARE IS
+// PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+// IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+// EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// @section DESCRIPTION
+// Runs the PreReEncryptor that serves RequestReEncryptedCT, on the BFVrns
+// context of PreServer::InitializeCC, with pools of 1, 2, 4 ... threads up
+// to one per core, or the counts given. Each run hands the pool a number
+// of batches at once, as concurrent consumers would, each of a number of
+// producer CTs, and times until the last batch is done. For each pool it
+// prints the CTs re-encrypted, the seconds taken, CTs per second, and CTs
+// per second for each thread, i.e. each core, as CSV. A flat last column
+// means the pool scales with the cores. Set OMP_NUM_THREADS=1 to keep
+// OpenFHE's own threads out of the measure.
+
+#include <getopt.h>
+
+#include <sstream>
+
+#include "pre_reencryptor.h"
+
+static CC MakeCC(usint nRingDim) {
+  CCParams<CryptoContextBFVRNS> parameters;
+  parameters.SetPlaintextModulus(65537);
+  parameters.SetScalingModSize(60);
+  if (nRingDim) {
+    parameters.SetRingDim(nRingDim);
+  }
+  CC cc = GenCryptoContext(parameters);
+  cc->Enable(PKE);
+  cc->Enable(KEYSWITCH);
+  cc->Enable(LEVELEDSHE);
+  cc->Enable(PRE);
+  return cc;
+}
+
+// "1,2,4" to {1, 2, 4}
+static std::vector<size_t> ParseList(const std::string &s) {
+  std::vector<size_t> v;
+  std::stringstream ss(s);
+  std::string sItem;
+  while (std::getline(ss, sItem, ',')) {
+    v.push_back(std::stoul(sItem));
+  }
+  return v;
+}
+
+int main(int argc, char *argv[]) {
+  int opt;
+  std::string sThreads("");
+  size_t nBatches(8);
+  size_t nBatchCTs(16);
+  usint nRingDim(0);
+
+  while ((opt = getopt(argc, argv, "t:b:c:n:h")) != -1) {
+    switch (opt) {
+    case 't':
+      sThreads = optarg;
+      break;
+    case 'b':
+      nBatches = std::stoul(optarg);
+      break;
+    case 'c':
+      nBatchCTs = std::stoul(optarg);
+      break;
+    case 'n':
+      nRingDim = std::stoul(optarg);
+      break;
+    case 'h':
+    default: /* '?' */
+      std::cerr << "Usage: " << std::endl
+                << "arguments:" << std::endl
+                << "  -t thread counts to run, e.g. 1,8 (default 1, 2, 4 "
+                   "... up to one per core)"
+                << std::endl
+                << "  -b batches handed to the pool at once (default 8)"
+                << std::endl
+                << "  -c CTs in each batch (default 16)" << std::endl
+                << "  -n ring dimension (default the smallest secure one)"
+                << std::endl
+                << "  -h prints this message" << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  std::vector<size_t> vThreads = ParseList(sThreads);
+  if (vThreads.empty()) {
+    size_t nCores = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    for (size_t n = 1; n < nCores; n *= 2) {
+      vThreads.push_back(n);
+    }
+    vThreads.push_back(nCores);
+  }
+
+  CC cc = MakeCC(nRingDim);
+  unsigned int ringsize = cc->GetRingDimension();
+
+  // a producer's key and CTs, re-encrypted for a consumer
+  KeyPair<DCRTPoly> producer = cc->KeyGen();
+  KeyPair<DCRTPoly> consumer = cc->KeyGen();
+  EvKey reencryptionKey =
+      cc->ReKeyGen(producer.secretKey, consumer.publicKey);
+  vecInt vShorts;
+  for (unsigned int i = 0; i < ringsize; i++) {
+    vShorts.push_back(std::rand() % 65536);
+  }
+  PT pt = cc->MakePackedPlaintext(vShorts);
+  std::vector<CT> vCTs;
+  for (size_t i = 0; i < nBatchCTs; i++) {
+    vCTs.push_back(cc->Encrypt(producer.publicKey, pt));
+  }
+
+  std::cout << "threads,ring_dim,cts,seconds,cts_per_sec,cts_per_sec_per_core"
+            << std::endl;
+  for (size_t nThreads : vThreads) {
+    PreReEncryptor reencryptor(cc, nThreads);
+    // one batch first, so no run pays for starting the threads
+    reencryptor.ReEncrypt(vCTs, reencryptionKey);
+
+    // shared, as the last callback may still be in set_value()
+    auto pDone = std::make_shared<std::promise<void>>();
+    auto pLeft = std::make_shared<std::atomic<size_t>>(nBatches);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < nBatches; i++) {
+      reencryptor.ReEncryptAsync(vCTs, reencryptionKey,
+                                 [pDone, pLeft](std::vector<CT>) {
+                                   if (--*pLeft == 0) {
+                                     pDone->set_value();
+                                   }
+                                 });
+    }
+    if (nBatches) {
+      pDone->get_future().wait();
+    }
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+
+    size_t nCTs = nBatches * nBatchCTs;
+    double ctsPerSec = seconds > 0 ? nCTs / seconds : 0;
+    std::cout << nThreads << "," << ringsize << "," << nCTs << "," << seconds
+              << "," << ctsPerSec << "," << ctsPerSec / nThreads
+              << std::endl;
+  }
+  return 0;
+}
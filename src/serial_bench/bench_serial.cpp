@@ -0,0 +1,386 @@
+// @file bench_serial.cpp - Serialization of the OpenFHE objects the examples
+// send, across parameter sets
+// @author TPOC: contact@openfhe-crypto.org
+//
+// @copyright Copyright (c) 2020, 2023 Duality Technologies Inc.
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution. THIS SOFTWARE IS
+// PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+// IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+// EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// @section DESCRIPTION
+// Builds the crypto context of each example server, with the parameters it
+// uses or with the ring dimension, multiplicative depth and batch size
+// swept over the given values, and the keys and a ciphertext its clients
+// send: pre is the BFVrns context of PreServer::InitializeCC, thresh the
+// CKKS context of ThreshServer::InitializeCC and real the CKKS context of
+// the real_server Server. Each object is serialized into an olc_net
+// message with message_ostream and read back with message_istream, the
+// way the examples move them, several times over. For each it prints the
+// bytes on the wire, the median time to encode and to decode, and the
+// median number of heap allocations each made, as CSV.
+
+#include <getopt.h>
+
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <sstream>
+
+#include "openfhe.h"
+
+#include "ciphertext-ser.h"
+#include "cryptocontext-ser.h"
+#include "key/key-ser.h"
+#include "scheme/bfvrns/bfvrns-ser.h"
+#include "scheme/ckksrns/ckksrns-ser.h"
+
+#include <olc_net.h>
+
+using namespace lbcrypto;
+
+using CC = CryptoContext<DCRTPoly>;
+using CT = Ciphertext<DCRTPoly>;
+using EvKey = EvalKey<DCRTPoly>;
+using EvKeyMap = std::shared_ptr<std::map<usint, EvKey>>;
+
+static std::atomic<uint64_t> g_nHeapAllocs{0};
+
+// noinline keeps the compiler from pairing an inlined new with free()
+__attribute__((noinline)) void *operator new(size_t nBytes) {
+  g_nHeapAllocs.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(nBytes ? nBytes : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+  std::free(p);
+}
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept {
+  std::free(p);
+}
+
+enum class SerialMsgTypes : uint32_t {
+  Object,
+};
+
+// one parameter set; 0 leaves a value to OpenFHE or the example
+struct Case {
+  std::string sFamily;
+  usint nRingDim;
+  usint nDepth;
+  usint nBatch;
+};
+
+template <typename T> static T Median(std::vector<T> v) {
+  std::sort(v.begin(), v.end());
+  return v[v.size() / 2];
+}
+
+// serializes an object with fnEncode(ostream&) and reads it back with
+// fnDecode(istream&) nReps times, and prints a line for it
+template <typename Encode, typename Decode>
+static void Measure(const Case &c, usint nRingDim, const std::string &sObject,
+                    size_t nReps, Encode fnEncode, Decode fnDecode) {
+  std::vector<double> vEncode, vDecode;
+  std::vector<uint64_t> vEncodeAllocs, vDecodeAllocs;
+  size_t nBytes = 0;
+
+  for (size_t i = 0; i < nReps; i++) {
+    olc::net::message<SerialMsgTypes> msg;
+    msg.header.id = SerialMsgTypes::Object;
+
+    uint64_t nAllocs = g_nHeapAllocs;
+    auto start = std::chrono::steady_clock::now();
+    {
+      olc::net::message_ostream<SerialMsgTypes> os(msg);
+      fnEncode(os);
+    }
+    vEncode.push_back(std::chrono::duration<double, std::micro>(
+                          std::chrono::steady_clock::now() - start)
+                          .count());
+    vEncodeAllocs.push_back(g_nHeapAllocs - nAllocs);
+    nBytes = msg.size();
+
+    nAllocs = g_nHeapAllocs;
+    start = std::chrono::steady_clock::now();
+    {
+      olc::net::message_istream<SerialMsgTypes> is(msg);
+      fnDecode(is);
+    }
+    vDecode.push_back(std::chrono::duration<double, std::micro>(
+                          std::chrono::steady_clock::now() - start)
+                          .count());
+    vDecodeAllocs.push_back(g_nHeapAllocs - nAllocs);
+  }
+
+  std::cout << c.sFamily << "," << sObject << "," << nRingDim << ","
+            << c.nDepth << "," << c.nBatch << "," << nBytes << ","
+            << Median(vEncode) << "," << Median(vDecode) << ","
+            << Median(vEncodeAllocs) << "," << Median(vDecodeAllocs)
+            << std::endl;
+}
+
+// the values a sweep sets on top of an example's own parameters
+template <typename Params> static void Sweep(Params &parameters, const Case &c) {
+  if (c.nRingDim) {
+    parameters.SetRingDim(c.nRingDim);
+  }
+  if (c.nDepth) {
+    parameters.SetMultiplicativeDepth(c.nDepth);
+  }
+  if (c.nBatch) {
+    parameters.SetBatchSize(c.nBatch);
+  }
+}
+
+static CC MakeCC(const Case &c) {
+  CC cc;
+  if (c.sFamily == "pre") {
+    CCParams<CryptoContextBFVRNS> parameters;
+    parameters.SetPlaintextModulus(65537);
+    parameters.SetScalingModSize(60);
+    Sweep(parameters, c);
+    cc = GenCryptoContext(parameters);
+    cc->Enable(PKE);
+    cc->Enable(KEYSWITCH);
+    cc->Enable(LEVELEDSHE);
+    cc->Enable(PRE);
+  } else if (c.sFamily == "thresh") {
+    CCParams<CryptoContextCKKSRNS> parameters;
+    parameters.SetMultiplicativeDepth(3);
+    parameters.SetScalingModSize(50);
+    parameters.SetBatchSize(16);
+    Sweep(parameters, c);
+    cc = GenCryptoContext(parameters);
+    cc->Enable(PKE);
+    cc->Enable(KEYSWITCH);
+    cc->Enable(LEVELEDSHE);
+    cc->Enable(ADVANCEDSHE);
+    cc->Enable(MULTIPARTY);
+  } else {
+    CCParams<CryptoContextCKKSRNS> parameters;
+    parameters.SetMultiplicativeDepth(5);
+    parameters.SetScalingModSize(40);
+    parameters.SetBatchSize(32);
+    Sweep(parameters, c);
+    cc = GenCryptoContext(parameters);
+    cc->Enable(PKE);
+    cc->Enable(KEYSWITCH);
+    cc->Enable(LEVELEDSHE);
+  }
+  return cc;
+}
+
+static void Run(const Case &c, size_t nReps) {
+  CC cc;
+  try {
+    cc = MakeCC(c);
+  } catch (const std::exception &e) {
+    std::cerr << c.sFamily << " ring dimension " << c.nRingDim << " depth "
+              << c.nDepth << " batch " << c.nBatch
+              << " skipped: " << e.what() << std::endl;
+    return;
+  }
+  usint nRingDim = cc->GetRingDimension();
+
+  KeyPair<DCRTPoly> kp = cc->KeyGen();
+  cc->EvalMultKeyGen(kp.secretKey);
+  EvKey evalMultKey = cc->GetEvalMultKeyVector(kp.secretKey->GetKeyTag())[0];
+
+  Plaintext pt;
+  if (c.sFamily == "pre") {
+    std::vector<int64_t> vShorts;
+    for (usint i = 0; i < nRingDim; i++) {
+      vShorts.push_back(std::rand() % 65536);
+    }
+    pt = cc->MakePackedPlaintext(vShorts);
+  } else {
+    usint nSlots = c.nBatch ? c.nBatch : (c.sFamily == "thresh" ? 16 : 32);
+    std::vector<double> vReals(nSlots, 1.5);
+    pt = cc->MakeCKKSPackedPlaintext(vReals);
+  }
+  CT ct = cc->Encrypt(kp.publicKey, pt);
+
+  // a client deserializing a context has no copy of it yet
+  Measure(
+      c, nRingDim, "CryptoContext", nReps,
+      [&](std::ostream &os) { Serial::Serialize(cc, os, SerType::BINARY); },
+      [&](std::istream &is) {
+        CryptoContextFactory<DCRTPoly>::ReleaseAllContexts();
+        CC decoded;
+        Serial::Deserialize(decoded, is, SerType::BINARY);
+      });
+  Measure(
+      c, nRingDim, "PublicKey", nReps,
+      [&](std::ostream &os) {
+        Serial::Serialize(kp.publicKey, os, SerType::BINARY);
+      },
+      [&](std::istream &is) {
+        PublicKey<DCRTPoly> decoded;
+        Serial::Deserialize(decoded, is, SerType::BINARY);
+      });
+  Measure(
+      c, nRingDim, "PrivateKey", nReps,
+      [&](std::ostream &os) {
+        Serial::Serialize(kp.secretKey, os, SerType::BINARY);
+      },
+      [&](std::istream &is) {
+        PrivateKey<DCRTPoly> decoded;
+        Serial::Deserialize(decoded, is, SerType::BINARY);
+      });
+  Measure(
+      c, nRingDim, "EvalMultKey", nReps,
+      [&](std::ostream &os) {
+        Serial::Serialize(evalMultKey, os, SerType::BINARY);
+      },
+      [&](std::istream &is) {
+        EvKey decoded;
+        Serial::Deserialize(decoded, is, SerType::BINARY);
+      });
+
+  // the PRE server hands out a re-encryption key, the threshold parties
+  // swap maps of sum keys
+  if (c.sFamily == "pre") {
+    KeyPair<DCRTPoly> kpOther = cc->KeyGen();
+    EvKey reencryptionKey = cc->ReKeyGen(kp.secretKey, kpOther.publicKey);
+    Measure(
+        c, nRingDim, "ReEncryptionKey", nReps,
+        [&](std::ostream &os) {
+          Serial::Serialize(reencryptionKey, os, SerType::BINARY);
+        },
+        [&](std::istream &is) {
+          EvKey decoded;
+          Serial::Deserialize(decoded, is, SerType::BINARY);
+        });
+  } else if (c.sFamily == "thresh") {
+    cc->EvalSumKeyGen(kp.secretKey);
+    EvKeyMap evalSumKeys = std::make_shared<std::map<usint, EvKey>>(
+        cc->GetEvalSumKeyMap(kp.secretKey->GetKeyTag()));
+    Measure(
+        c, nRingDim, "EvalSumKeys", nReps,
+        [&](std::ostream &os) {
+          Serial::Serialize(evalSumKeys, os, SerType::BINARY);
+        },
+        [&](std::istream &is) {
+          EvKeyMap decoded;
+          Serial::Deserialize(decoded, is, SerType::BINARY);
+        });
+  }
+
+  Measure(
+      c, nRingDim, "Ciphertext", nReps,
+      [&](std::ostream &os) { Serial::Serialize(ct, os, SerType::BINARY); },
+      [&](std::istream &is) {
+        CT decoded;
+        Serial::Deserialize(decoded, is, SerType::BINARY);
+      });
+
+  CryptoContextImpl<DCRTPoly>::ClearEvalMultKeys();
+  CryptoContextImpl<DCRTPoly>::ClearEvalSumKeys();
+  CryptoContextFactory<DCRTPoly>::ReleaseAllContexts();
+}
+
+// "1,2,4" to {1, 2, 4}; an empty list is {0}, the example's own value
+static std::vector<usint> ParseList(const std::string &s) {
+  std::vector<usint> v;
+  std::stringstream ss(s);
+  std::string sItem;
+  while (std::getline(ss, sItem, ',')) {
+    v.push_back(std::stoul(sItem));
+  }
+  if (v.empty()) {
+    v.push_back(0);
+  }
+  return v;
+}
+
+int main(int argc, char *argv[]) {
+  int opt;
+  std::string sFamilies("pre,thresh,real");
+  std::string sRingDims("");
+  std::string sDepths("");
+  std::string sBatches("");
+  size_t nReps(10);
+
+  while ((opt = getopt(argc, argv, "s:n:d:b:r:h")) != -1) {
+    switch (opt) {
+    case 's':
+      sFamilies = optarg;
+      break;
+    case 'n':
+      sRingDims = optarg;
+      break;
+    case 'd':
+      sDepths = optarg;
+      break;
+    case 'b':
+      sBatches = optarg;
+      break;
+    case 'r':
+      nReps = std::stoul(optarg);
+      break;
+    case 'h':
+    default: /* '?' */
+      std::cerr << "Usage: " << std::endl
+                << "arguments:" << std::endl
+                << "  -s parameter sets, of pre, thresh and real "
+                   "(default pre,thresh,real)"
+                << std::endl
+                << "  -n ring dimensions to sweep, e.g. 8192,16384 "
+                   "(default the smallest secure one)"
+                << std::endl
+                << "  -d multiplicative depths to sweep (default the "
+                   "example's)"
+                << std::endl
+                << "  -b batch sizes to sweep, CKKS sets only (default "
+                   "the example's)"
+                << std::endl
+                << "  -r times each object is encoded and decoded "
+                   "(default 10)"
+                << std::endl
+                << "  -h prints this message" << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  std::cout << "params,object,ring_dim,mult_depth,batch_size,bytes,"
+               "encode_us,decode_us,encode_allocs,decode_allocs"
+            << std::endl;
+
+  std::stringstream ss(sFamilies);
+  std::string sFamily;
+  while (std::getline(ss, sFamily, ',')) {
+    if (sFamily != "pre" && sFamily != "thresh" && sFamily != "real") {
+      std::cerr << "unknown parameter set " << sFamily << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+    // PRE packs a full ring of shorts, its batch is the ring dimension
+    std::vector<usint> vBatches =
+        sFamily == "pre" ? std::vector<usint>{0} : ParseList(sBatches);
+    for (usint nRingDim : ParseList(sRingDims)) {
+      for (usint nDepth : ParseList(sDepths)) {
+        for (usint nBatch : vBatches) {
+          Run({sFamily, nRingDim, nDepth, nBatch}, nReps);
+        }
+      }
+    }
+  }
+  return 0;
+}
@@ -24,11 +24,9 @@ public:
     OPENFHE_DEBUG("Client: read CC of " << msgSize << " bytes");
     OPENFHE_DEBUG("Client: msg.size() " << msg.size());
     OPENFHE_DEBUG("Client: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("Client istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("Client: Deserialize");
     Serial::Deserialize(cc, is, SerType::BINARY);
 
@@ -43,10 +41,8 @@ public:
     OPENFHE_DEBUG("CLIENT: read CT of " << msgSize << " bytes");
     OPENFHE_DEBUG("Client: msg.size() " << msg.size());
     OPENFHE_DEBUG("Client: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("CLIENT istringstream.str.size(): " << is.str().size());
-    // NOTE Deserialize needs a basic_istream<char>
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
     OPENFHE_DEBUG("CLIENT: Deserialize");
     Serial::Deserialize(ct, is, SerType::BINARY);
     return ct;
@@ -58,6 +54,13 @@ public:
     msg.header.id = ThreshMsgTypes::DisconnectClient;
     Send(msg);
   }
+
+  // send round 2 keys as deltas against the round 1 keys they share their
+  // random parts with. Received keys are expanded either way.
+  void EnableDeltaKeys(bool bEnable) { m_bDeltaKeys = bEnable; }
+
+protected:
+  bool m_bDeltaKeys = false;
 };
 
 // Alice client methods
@@ -118,46 +121,42 @@ public:
     olc::net::message<ThreshMsgTypes> msg;
     OPENFHE_DEBUG("Client: Requesting ciphertext1");
     msg.header.id = ThreshMsgTypes::RequestCT1;
-    Send(msg);
+    Request(msg);
   }
 
   void RequestCT2(void) {
     olc::net::message<ThreshMsgTypes> msg;
     OPENFHE_DEBUG("Client: Requesting ciphertext2");
     msg.header.id = ThreshMsgTypes::RequestCT2;
-    Send(msg);
+    Request(msg);
   }
 
   void RequestCT3(void) {
     olc::net::message<ThreshMsgTypes> msg;
     OPENFHE_DEBUG("Client: Requesting ciphertext3");
     msg.header.id = ThreshMsgTypes::RequestCT3;
-    Send(msg);
+    Request(msg);
   }
 
   void SendRnd1PubKey(KPair &kp) {
-    std::string s;
-    std::ostringstream os(s);
+    olc::net::message<ThreshMsgTypes> msg;
     OPENFHE_DEBUG("Alice: serializing public key");
+    olc::net::message_ostream<ThreshMsgTypes> os(msg);
     Serial::Serialize(kp.publicKey, os, SerType::BINARY);
     OPENFHE_DEBUG("Alice: done");
-    olc::net::message<ThreshMsgTypes> msg;
     msg.header.id = ThreshMsgTypes::SendRnd1PubKey;
-    msg << os.str();
     OPENFHE_DEBUG("Alice: final msg.body.size " << msg.body.size());
     OPENFHE_DEBUG("Alice: final msg.size " << msg.size());
     Send(msg);
   }
 
   void SendRnd1evalMultKey(EvKey &EvalMultKey) {
-    std::string s;
-    std::ostringstream os(s);
+    olc::net::message<ThreshMsgTypes> msg;
     OPENFHE_DEBUG("Alice: serializing EvalMultkey");
+    olc::net::message_ostream<ThreshMsgTypes> os(msg);
     Serial::Serialize(EvalMultKey, os, SerType::BINARY);
     OPENFHE_DEBUG("Alice: done");
-    olc::net::message<ThreshMsgTypes> msg;
     msg.header.id = ThreshMsgTypes::SendRnd1evalMultKey;
-    msg << os.str();
     OPENFHE_DEBUG("Alice: final msg.body.size " << msg.body.size());
     OPENFHE_DEBUG("Alice: final msg.size " << msg.size());
     Send(msg);
@@ -165,58 +164,58 @@ public:
 
   void
   SendRnd1evalSumKeys(std::shared_ptr<std::map<usint, EvKey>> &EvalSumKeys) {
-    std::string s;
-    std::ostringstream os(s);
+    if (!IsConnected())
+      return;
+    // The key map is large, stream it out in chunks as it is serialized
     OPENFHE_DEBUG("Alice: serializing EvalSumkeys");
+    olc::net::message_chunk_ostream<ThreshMsgTypes> os(
+        *m_connection, ThreshMsgTypes::SendRnd1evalSumKeys);
     Serial::Serialize(EvalSumKeys, os, SerType::BINARY);
+    os.close();
     OPENFHE_DEBUG("Alice: done");
-    olc::net::message<ThreshMsgTypes> msg;
-    msg.header.id = ThreshMsgTypes::SendRnd1evalSumKeys;
-    msg << os.str();
-    OPENFHE_DEBUG("Alice: final msg.body.size " << msg.body.size());
-    OPENFHE_DEBUG("Alice: final msg.size " << msg.size());
-    Send(msg);
   }
 
   void SendRnd3EvalMultFinal(EvKey &EvalMultKey) {
-    std::string s;
-    std::ostringstream os(s);
+    olc::net::message<ThreshMsgTypes> msg;
     OPENFHE_DEBUG("Alice: serializing EvalMultFinal");
+    olc::net::message_ostream<ThreshMsgTypes> os(msg);
     Serial::Serialize(EvalMultKey, os, SerType::BINARY);
     OPENFHE_DEBUG("Alice: done");
-    olc::net::message<ThreshMsgTypes> msg;
     msg.header.id = ThreshMsgTypes::SendRnd3EvalMultFinal;
-    msg << os.str();
     OPENFHE_DEBUG("Alice: final msg.body.size " << msg.body.size());
     OPENFHE_DEBUG("Alice: final msg.size " << msg.size());
     Send(msg);
   }
 
-  PubKey RecvRnd2SharedKey(olc::net::message<ThreshMsgTypes> &msg) {
+  PubKey RecvRnd2SharedKey(olc::net::message<ThreshMsgTypes> &msg,
+                           PubKey &Rnd1PubKey) {
     PubKey Rnd2PubKey;
+    if (!ExpandDelta(msg, Rnd1PubKey)) {
+      throw std::runtime_error("Round 2 public key does not match ours");
+    }
     unsigned int msgSize(msg.body.size());
     OPENFHE_DEBUG("CLIENT: read public key of " << msgSize << " bytes");
     OPENFHE_DEBUG("Client: msg.size() " << msg.size());
     OPENFHE_DEBUG("Client: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("CLIENT istringstream.str.size(): " << is.str().size());
-    // NOTE Deserialize needs a basic_istream<char>
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
     OPENFHE_DEBUG("CLIENT: Deserialize");
     Serial::Deserialize(Rnd2PubKey, is, SerType::BINARY);
     return Rnd2PubKey;
   }
 
-  auto RecvRnd2evalMultAB(olc::net::message<ThreshMsgTypes> &msg) {
+  auto RecvRnd2evalMultAB(olc::net::message<ThreshMsgTypes> &msg,
+                          EvKey &Rnd1evalMultKey) {
     EvKey evalMultAB;
+    if (!ExpandDelta(msg, Rnd1evalMultKey)) {
+      throw std::runtime_error("Round 2 EvalMultAB does not match ours");
+    }
     unsigned int msgSize(msg.body.size());
     OPENFHE_DEBUG("CLIENT: read evalmultAB key of " << msgSize << " bytes");
     OPENFHE_DEBUG("Client: msg.size() " << msg.size());
     OPENFHE_DEBUG("Client: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("CLIENT istringstream.str.size(): " << is.str().size());
-    // NOTE Deserialize needs a basic_istream<char>
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
     OPENFHE_DEBUG("CLIENT: Deserialize");
     Serial::Deserialize(evalMultAB, is, SerType::BINARY);
     return evalMultAB;
@@ -228,10 +227,8 @@ public:
     OPENFHE_DEBUG("CLIENT: read evalmultBAB key of " << msgSize << " bytes");
     OPENFHE_DEBUG("Client: msg.size() " << msg.size());
     OPENFHE_DEBUG("Client: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("CLIENT istringstream.str.size(): " << is.str().size());
-    // NOTE Deserialize needs a basic_istream<char>
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
     OPENFHE_DEBUG("CLIENT: Deserialize");
     Serial::Deserialize(evalMultBAB, is, SerType::BINARY);
     return evalMultBAB;
@@ -243,10 +240,8 @@ public:
     OPENFHE_DEBUG("CLIENT: read evalsumkeysjoin of " << msgSize << " bytes");
     OPENFHE_DEBUG("Client: msg.size() " << msg.size());
     OPENFHE_DEBUG("Client: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("CLIENT istringstream.str.size(): " << is.str().size());
-    // NOTE Deserialize needs a basic_istream<char>
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
     OPENFHE_DEBUG("CLIENT: Deserialize");
     Serial::Deserialize(evalSumKeysJoin, is, SerType::BINARY);
     return evalSumKeysJoin;
@@ -254,12 +249,10 @@ public:
 
   void SendCTPartialAdd(CT &ct) {
     OPENFHE_DEBUG("Client: serializing add lead partial decrypt ct");
-    std::string s;
-    std::ostringstream os(s);
-    Serial::Serialize(ct, os, SerType::BINARY);
     olc::net::message<ThreshMsgTypes> msg;
+    olc::net::message_ostream<ThreshMsgTypes> os(msg);
+    Serial::Serialize(ct, os, SerType::BINARY);
     msg.header.id = ThreshMsgTypes::SendDecryptPartialLeadAdd;
-    msg << os.str();
     OPENFHE_DEBUG("Client: final msg.body.size " << msg.body.size());
     OPENFHE_DEBUG("Client: final msg.size " << msg.size());
     Send(msg);
@@ -267,12 +260,10 @@ public:
 
   void SendCTPartialMult(CT &ct) {
     OPENFHE_DEBUG("Client: serializing mult lead partial decrypt ct");
-    std::string s;
-    std::ostringstream os(s);
-    Serial::Serialize(ct, os, SerType::BINARY);
     olc::net::message<ThreshMsgTypes> msg;
+    olc::net::message_ostream<ThreshMsgTypes> os(msg);
+    Serial::Serialize(ct, os, SerType::BINARY);
     msg.header.id = ThreshMsgTypes::SendDecryptPartialLeadMult;
-    msg << os.str();
     OPENFHE_DEBUG("Client: final msg.body.size " << msg.body.size());
     OPENFHE_DEBUG("Client: final msg.size " << msg.size());
     Send(msg);
@@ -280,12 +271,10 @@ public:
 
   void SendCTPartialSum(CT &ct) {
     OPENFHE_DEBUG("Client: serializing sum lead partial decrypt ct");
-    std::string s;
-    std::ostringstream os(s);
-    Serial::Serialize(ct, os, SerType::BINARY);
     olc::net::message<ThreshMsgTypes> msg;
+    olc::net::message_ostream<ThreshMsgTypes> os(msg);
+    Serial::Serialize(ct, os, SerType::BINARY);
     msg.header.id = ThreshMsgTypes::SendDecryptPartialLeadSum;
-    msg << os.str();
     OPENFHE_DEBUG("Client: final msg.body.size " << msg.body.size());
     OPENFHE_DEBUG("Client: final msg.size " << msg.size());
     Send(msg);
@@ -352,10 +341,8 @@ public:
     OPENFHE_DEBUG("CLIENT: read public key of " << msgSize << " bytes");
     OPENFHE_DEBUG("Client: msg.size() " << msg.size());
     OPENFHE_DEBUG("Client: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("CLIENT istringstream.str.size(): " << is.str().size());
-    // NOTE Deserialize needs a basic_istream<char>
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
     OPENFHE_DEBUG("CLIENT: Deserialize");
     Serial::Deserialize(Rnd1PubKey, is, SerType::BINARY);
     return Rnd1PubKey;
@@ -367,10 +354,8 @@ public:
     OPENFHE_DEBUG("CLIENT: read evalmult key of " << msgSize << " bytes");
     OPENFHE_DEBUG("Client: msg.size() " << msg.size());
     OPENFHE_DEBUG("Client: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("CLIENT istringstream.str.size(): " << is.str().size());
-    // NOTE Deserialize needs a basic_istream<char>
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
     OPENFHE_DEBUG("CLIENT: Deserialize");
     Serial::Deserialize(evalMultKey, is, SerType::BINARY);
     return evalMultKey;
@@ -382,10 +367,8 @@ public:
     OPENFHE_DEBUG("CLIENT: read evalsumkeys key of " << msgSize << " bytes");
     OPENFHE_DEBUG("Client: msg.size() " << msg.size());
     OPENFHE_DEBUG("Client: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("CLIENT istringstream.str.size(): " << is.str().size());
-    // NOTE Deserialize needs a basic_istream<char>
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
     OPENFHE_DEBUG("CLIENT: Deserialize");
     Serial::Deserialize(evalSumKeys, is, SerType::BINARY);
     return evalSumKeys;
@@ -397,49 +380,48 @@ public:
     OPENFHE_DEBUG("CLIENT: read evalmultfinal key of " << msgSize << " bytes");
     OPENFHE_DEBUG("Client: msg.size() " << msg.size());
     OPENFHE_DEBUG("Client: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("CLIENT istringstream.str.size(): " << is.str().size());
-    // NOTE Deserialize needs a basic_istream<char>
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
     OPENFHE_DEBUG("CLIENT: Deserialize");
     Serial::Deserialize(evalMultKey, is, SerType::BINARY);
     return evalMultKey;
   }
 
-  void SendRnd2SharedKey(KPair &kp) {
-    std::string s;
-    std::ostringstream os(s);
+  void SendRnd2SharedKey(KPair &kp, PubKey &Rnd1PubKey) {
+    olc::net::message<ThreshMsgTypes> msg;
     OPENFHE_DEBUG("Bob: serializing shared public key");
+    olc::net::message_ostream<ThreshMsgTypes> os(msg);
     Serial::Serialize(kp.publicKey, os, SerType::BINARY);
-    olc::net::message<ThreshMsgTypes> msg;
+    if (m_bDeltaKeys) {
+      // same "a" polynomial as Alice's key, which the server has
+      CompressDelta(msg, Rnd1PubKey);
+    }
     msg.header.id = ThreshMsgTypes::SendRnd2SharedKey;
-    msg << os.str();
     OPENFHE_DEBUG("Bob: final msg.body.size " << msg.body.size());
     OPENFHE_DEBUG("Bob: final msg.size " << msg.size());
     Send(msg);
   }
 
-  void SendRnd2EvalMultAB(EvKey &EvalMultAB) {
-    std::string s;
-    std::ostringstream os(s);
+  void SendRnd2EvalMultAB(EvKey &EvalMultAB, EvKey &Rnd1evalMultKey) {
+    olc::net::message<ThreshMsgTypes> msg;
     OPENFHE_DEBUG("Bob: serializing Round 2 EvalMultAB key");
+    olc::net::message_ostream<ThreshMsgTypes> os(msg);
     Serial::Serialize(EvalMultAB, os, SerType::BINARY);
-    olc::net::message<ThreshMsgTypes> msg;
+    if (m_bDeltaKeys) {
+      CompressDelta(msg, Rnd1evalMultKey);
+    }
     msg.header.id = ThreshMsgTypes::SendRnd2EvalMultAB;
-    msg << os.str();
     OPENFHE_DEBUG("Bob: final msg.body.size " << msg.body.size());
     OPENFHE_DEBUG("Bob: final msg.size " << msg.size());
     Send(msg);
   }
 
   void SendRnd2EvalMultBAB(EvKey &EvalMultBAB) {
-    std::string s;
-    std::ostringstream os(s);
+    olc::net::message<ThreshMsgTypes> msg;
     OPENFHE_DEBUG("Bob: serializing Round 2 EvalMultBAB key");
+    olc::net::message_ostream<ThreshMsgTypes> os(msg);
     Serial::Serialize(EvalMultBAB, os, SerType::BINARY);
-    olc::net::message<ThreshMsgTypes> msg;
     msg.header.id = ThreshMsgTypes::SendRnd2EvalMultBAB;
-    msg << os.str();
     OPENFHE_DEBUG("Bob: final msg.body.size " << msg.body.size());
     OPENFHE_DEBUG("Bob: final msg.size " << msg.size());
     Send(msg);
@@ -447,26 +429,21 @@ public:
 
   void SendRnd2EvalSumKeysJoin(
       std::shared_ptr<std::map<usint, EvKey>> &EvalSumKeysJoin) {
-    std::string s;
-    std::ostringstream os(s);
+    if (!IsConnected())
+      return;
     OPENFHE_DEBUG("Bob: serializing Round 2 EvalSumKeysJoin");
+    olc::net::message_chunk_ostream<ThreshMsgTypes> os(
+        *m_connection, ThreshMsgTypes::SendRnd2EvalSumKeysJoin);
     Serial::Serialize(EvalSumKeysJoin, os, SerType::BINARY);
-    olc::net::message<ThreshMsgTypes> msg;
-    msg.header.id = ThreshMsgTypes::SendRnd2EvalSumKeysJoin;
-    msg << os.str();
-    OPENFHE_DEBUG("Bob: final msg.body.size " << msg.body.size());
-    OPENFHE_DEBUG("Bob: final msg.size " << msg.size());
-    Send(msg);
+    os.close();
   }
 
   void SendCT1(CT &ct, unsigned int num) {
     OPENFHE_DEBUG("Client: serializing CT1");
-    std::string s;
-    std::ostringstream os(s);
-    Serial::Serialize(ct, os, SerType::BINARY);
     olc::net::message<ThreshMsgTypes> msg;
+    olc::net::message_ostream<ThreshMsgTypes> os(msg);
+    Serial::Serialize(ct, os, SerType::BINARY);
     msg.header.id = ThreshMsgTypes::SendCT1;
-    msg << os.str();
     OPENFHE_DEBUG("Client: final msg.body.size " << msg.body.size());
     OPENFHE_DEBUG("Client: final msg.size " << msg.size());
     Send(msg);
@@ -474,12 +451,10 @@ public:
 
   void SendCT2(CT &ct, unsigned int num) {
     OPENFHE_DEBUG("Client: serializing CT2");
-    std::string s;
-    std::ostringstream os(s);
-    Serial::Serialize(ct, os, SerType::BINARY);
     olc::net::message<ThreshMsgTypes> msg;
+    olc::net::message_ostream<ThreshMsgTypes> os(msg);
+    Serial::Serialize(ct, os, SerType::BINARY);
     msg.header.id = ThreshMsgTypes::SendCT2;
-    msg << os.str();
     OPENFHE_DEBUG("Client: final msg.body.size " << msg.body.size());
     OPENFHE_DEBUG("Client: final msg.size " << msg.size());
     Send(msg);
@@ -487,12 +462,10 @@ public:
 
   void SendCT3(CT &ct, unsigned int num) {
     OPENFHE_DEBUG("Client: serializing CT3");
-    std::string s;
-    std::ostringstream os(s);
-    Serial::Serialize(ct, os, SerType::BINARY);
     olc::net::message<ThreshMsgTypes> msg;
+    olc::net::message_ostream<ThreshMsgTypes> os(msg);
+    Serial::Serialize(ct, os, SerType::BINARY);
     msg.header.id = ThreshMsgTypes::SendCT3;
-    msg << os.str();
     OPENFHE_DEBUG("Client: final msg.body.size " << msg.body.size());
     OPENFHE_DEBUG("Client: final msg.size " << msg.size());
     Send(msg);
@@ -500,12 +473,10 @@ public:
 
   void SendCTPartialAdd(CT &ct) {
     OPENFHE_DEBUG("Client: serializing add main partial decrypt ct");
-    std::string s;
-    std::ostringstream os(s);
-    Serial::Serialize(ct, os, SerType::BINARY);
     olc::net::message<ThreshMsgTypes> msg;
+    olc::net::message_ostream<ThreshMsgTypes> os(msg);
+    Serial::Serialize(ct, os, SerType::BINARY);
     msg.header.id = ThreshMsgTypes::SendDecryptPartialMainAdd;
-    msg << os.str();
     OPENFHE_DEBUG("Client: final msg.body.size " << msg.body.size());
     OPENFHE_DEBUG("Client: final msg.size " << msg.size());
     Send(msg);
@@ -513,12 +484,10 @@ public:
 
   void SendCTPartialMult(CT &ct) {
     OPENFHE_DEBUG("Client: serializing mult main partial decrypt ct");
-    std::string s;
-    std::ostringstream os(s);
-    Serial::Serialize(ct, os, SerType::BINARY);
     olc::net::message<ThreshMsgTypes> msg;
+    olc::net::message_ostream<ThreshMsgTypes> os(msg);
+    Serial::Serialize(ct, os, SerType::BINARY);
     msg.header.id = ThreshMsgTypes::SendDecryptPartialMainMult;
-    msg << os.str();
     OPENFHE_DEBUG("Client: final msg.body.size " << msg.body.size());
     OPENFHE_DEBUG("Client: final msg.size " << msg.size());
     Send(msg);
@@ -526,12 +495,10 @@ public:
 
   void SendCTPartialSum(CT &ct) {
     OPENFHE_DEBUG("Client: serializing sum main partial decrypt ct");
-    std::string s;
-    std::ostringstream os(s);
-    Serial::Serialize(ct, os, SerType::BINARY);
     olc::net::message<ThreshMsgTypes> msg;
+    olc::net::message_ostream<ThreshMsgTypes> os(msg);
+    Serial::Serialize(ct, os, SerType::BINARY);
     msg.header.id = ThreshMsgTypes::SendDecryptPartialMainSum;
-    msg << os.str();
     OPENFHE_DEBUG("Client: final msg.body.size " << msg.body.size());
     OPENFHE_DEBUG("Client: final msg.size " << msg.size());
     Send(msg);
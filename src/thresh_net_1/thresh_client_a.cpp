@@ -62,6 +62,7 @@ enum class ClientAStates : uint64_t {
   RequestRnd2evalMultBAB,
   RequestRnd2evalSumKeysJoin,
   GenFinalSharedKeys,
+  RequestCTs,
   RequestCT1,
   RequestCT2,
   RequestCT3,
@@ -196,14 +197,13 @@ int main(int argc, char *argv[]) {
             break;
           case ThreshMsgTypes::AckRnd1evalSumKeys:
             PROFILELOG(myName << ": Acknowledged Round 1 EvalSumKeys");
-            nap(100); // sleep until Round 2 key generation is done.
             state = ClientAStates::RequestRnd2SharedKey;
             break;
 
           case ThreshMsgTypes::SendRnd2SharedKey:
             PROFILELOG(myName << ": Reading Round 2 Shared key");
             TIC(t);
-            Rnd2SharedKey = c.RecvRnd2SharedKey(msg);
+            Rnd2SharedKey = c.RecvRnd2SharedKey(msg, keyPair.publicKey);
             PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
             state = ClientAStates::RequestRnd2evalMultAB;
             break;
@@ -211,7 +211,7 @@ int main(int argc, char *argv[]) {
           case ThreshMsgTypes::SendRnd2EvalMultAB:
             PROFILELOG(myName << ": Reading Round 2 EvalMultAB");
             TIC(t);
-            Rnd2EvalMultAB = c.RecvRnd2evalMultAB(msg);
+            Rnd2EvalMultAB = c.RecvRnd2evalMultAB(msg, evalMultKey);
             PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
             state = ClientAStates::RequestRnd2evalMultBAB;
             break;
@@ -234,27 +234,32 @@ int main(int argc, char *argv[]) {
 
           case ThreshMsgTypes::AckRnd3EvalMultFinal:
             PROFILELOG(myName << ": Acknowledged Round 3 EvalMultFinal");
-            nap(1000);
-            state = ClientAStates::RequestCT1;
+            state = ClientAStates::RequestCTs;
             break;
 
+          // the three ciphertexts are requested together and may come back
+          // in any order, carry on once all of them are here
           case ThreshMsgTypes::SendCT1:
             ciphertext1 = c.RecvCT(msg);
             PROFILELOG(myName << ": reading ciphertext1");
-            nap(1000);
-            state = ClientAStates::RequestCT2;
+            if (ciphertext1 && ciphertext2 && ciphertext3) {
+              state = ClientAStates::DecryptLeadPartialAdd;
+            }
             break;
           case ThreshMsgTypes::SendCT2:
             PROFILELOG(myName << ": reading ciphertext2");
             ciphertext2 = c.RecvCT(msg);
-            nap(1000);
-            state = ClientAStates::RequestCT3;
+            if (ciphertext1 && ciphertext2 && ciphertext3) {
+              state = ClientAStates::DecryptLeadPartialAdd;
+            }
             break;
 
           case ThreshMsgTypes::SendCT3:
             PROFILELOG(myName << ": reading ciphertext3");
             ciphertext3 = c.RecvCT(msg);
-            state = ClientAStates::DecryptLeadPartialAdd;
+            if (ciphertext1 && ciphertext2 && ciphertext3) {
+              state = ClientAStates::DecryptLeadPartialAdd;
+            }
             break;
 
           case ThreshMsgTypes::AckPartialLeadAdd:
@@ -514,6 +519,17 @@ int main(int argc, char *argv[]) {
 
         break;
 
+      case ClientAStates::RequestCTs:
+        TIC(t);
+        PROFILELOG(myName << ": Requesting ciphertexts 1, 2 and 3");
+        // no need to wait for each reply before asking for the next
+        c.RequestCT1();
+        c.RequestCT2();
+        c.RequestCT3();
+        PROFILELOG(myName << ":elapsed time " << TOC_MS(t) << "msec.");
+        state = ClientAStates::GetMessage;
+        break;
+
       case ClientAStates::RequestCT1:
         TIC(t);
         PROFILELOG(myName << ": Requesting ciphertext1");
@@ -82,8 +82,9 @@ int main(int argc, char *argv[]) {
   std::string myName(""); // name of client to run
   uint32_t port(0);
   std::string hostName(""); // name of server host
+  bool bDeltaKeys(false);
 
-  while ((opt = getopt(argc, argv, "i:n:p:h")) != -1) {
+  while ((opt = getopt(argc, argv, "i:n:p:dh")) != -1) {
     switch (opt) {
     case 'i':
       hostName = optarg;
@@ -97,6 +98,9 @@ int main(int argc, char *argv[]) {
       port = atoi(optarg);
       std::cout << "host port " << port << std::endl;
       break;
+    case 'd':
+      bDeltaKeys = true;
+      break;
     case 'h':
     default: /* '?' */
       std::cerr << "Usage: " << std::endl
@@ -104,11 +108,14 @@ int main(int argc, char *argv[]) {
                 << "  -n name of the client" << std::endl
                 << "  -i IP or hostname of the server" << std::endl
                 << "  -p port of the server" << std::endl
+                << "  -d send round 2 keys as deltas against round 1 keys"
+                << std::endl
                 << "  -h prints this message" << std::endl;
       std::exit(EXIT_FAILURE);
     }
   }
   ClientB c;
+  c.EnableDeltaKeys(bDeltaKeys);
   // connect to the server
   PROFILELOG(myName << ": Connecing to server at " << hostName << ":" << port);
   c.Connect(hostName, port);
@@ -250,6 +257,20 @@ int main(int argc, char *argv[]) {
             state = ClientBStates::SendRnd2evalMultBAB;
             break;
 
+          case ThreshMsgTypes::NackRnd2SharedKey:
+            // Server could not rebuild the key from our delta, send it in
+            // full
+            PROFILELOG("Server NackRnd2SharedKey");
+            c.EnableDeltaKeys(false);
+            c.SendRnd2SharedKey(keyPair, Rnd1Pubkey);
+            break;
+
+          case ThreshMsgTypes::NackRnd2EvalMultAB:
+            PROFILELOG("Server NackRnd2EvalMultAB");
+            c.EnableDeltaKeys(false);
+            state = ClientBStates::SendRnd2evalMultAB;
+            break;
+
           case ThreshMsgTypes::AckRnd2EvalMultBAB:
             PROFILELOG(myName << ": Acknowledged Round 2 EvalMultBAB");
             state = ClientBStates::SendRnd2evalSumKeysJoin;
@@ -451,7 +472,7 @@ int main(int argc, char *argv[]) {
         evalMultBAB = clientCC->MultiMultEvalKey(
             keyPair.secretKey, evalMultAB, keyPair.publicKey->GetKeyTag());
 
-        c.SendRnd2SharedKey(keyPair);
+        c.SendRnd2SharedKey(keyPair, Rnd1Pubkey);
 
         evalSumKeysB = clientCC->MultiEvalSumKeyGen(
             keyPair.secretKey, Rnd1evalSumKeys, keyPair.publicKey->GetKeyTag());
@@ -471,7 +492,7 @@ int main(int argc, char *argv[]) {
       case ClientBStates::SendRnd2evalMultAB:
         PROFILELOG(myName << ": Serializing and sending Round 2 EvalMultAB");
         TIC(t);
-        c.SendRnd2EvalMultAB(evalMultAB);
+        c.SendRnd2EvalMultAB(evalMultAB, Rnd1evalMultKey);
         PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
         state = ClientBStates::GetMessage;
         break;
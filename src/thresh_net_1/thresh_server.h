@@ -10,8 +10,8 @@ class ThreshServer : public olc::net::server_interface<ThreshMsgTypes> {
 public:
   OPENFHE_DEBUG_FLAG(false);
 
-  ThreshServer(uint16_t nPort)
-      : olc::net::server_interface<ThreshMsgTypes>(nPort),
+  ThreshServer(uint16_t nPort, size_t nThreads = 1, size_t nWorkers = 0)
+      : olc::net::server_interface<ThreshMsgTypes>(nPort, nThreads, nWorkers),
         A_Rnd1PubKeyRecd(false), A_evalMultKeyRecd(false),
         B_Rnd2PublicKeyRecd(false), B_evalMultKeyABRecd(false),
         B_evalMultKeyBABRecd(false), A_evalMultFinalRecd(false) {
@@ -20,6 +20,13 @@ public:
     InitializeCC();
   }
 
+  // handlers may still be running on the worker pool
+  virtual ~ThreshServer() { Stop(); }
+
+  // send round 2 keys as deltas against the round 1 keys the client holds.
+  // Keys from clients are expanded either way.
+  void EnableDeltaKeys(bool bEnable) { m_bDeltaKeys = bEnable; }
+
 protected:
   virtual bool OnClientConnect(
       std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
@@ -46,6 +53,21 @@ protected:
   virtual void
   OnMessage(std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
             olc::net::message<ThreshMsgTypes> &msg) {
+    // handlers for different clients may run at once on the worker pool,
+    // so the server state is guarded by m_muxState as a whole. The large
+    // key maps are read and streamed with it released.
+    std::unique_lock<std::mutex> lock(m_muxState);
+    ProcessMessage(client, msg, lock);
+  }
+
+  // A request for something not received yet is parked, and handled again
+  // by Notify() when it arrives, instead of being nacked for the client to
+  // ask again later. Called holding m_muxState through lock, and may return
+  // with it released.
+  void
+  ProcessMessage(std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+                 olc::net::message<ThreshMsgTypes> &msg,
+                 std::unique_lock<std::mutex> &lock) {
     switch (msg.header.id) {
     case ThreshMsgTypes::RequestCC:
       std::cout << "[" << client->GetID() << "]: RequestCC\n";
@@ -66,6 +88,7 @@ protected:
         client->Send(ackMsg);
       }
 
+      Notify(ThreshMsgTypes::RequestRnd1PubKey, lock);
       break;
 
     case ThreshMsgTypes::SendRnd1evalMultKey:
@@ -82,6 +105,7 @@ protected:
         client->Send(ackMsg);
       }
 
+      Notify(ThreshMsgTypes::RequestRnd1evalMultKey, lock);
       break;
 
     case ThreshMsgTypes::SendRnd1evalSumKeys:
@@ -89,13 +113,14 @@ protected:
       std::cout << "[" << client->GetID() << "]: SendRnd1EvalSumKeys\n";
       // receive the evalsumkeys from this client,
 
-      RecvClientAevalSumKeys(client, msg);
+      RecvClientAevalSumKeys(client, msg, lock);
       {
         // send acknowledgement
         olc::net::message<ThreshMsgTypes> ackMsg;
         ackMsg.header.id = ThreshMsgTypes::AckRnd1evalSumKeys;
         client->Send(ackMsg);
       }
+      Notify(ThreshMsgTypes::RequestRnd1evalSumKeys, lock);
       break;
 
     case ThreshMsgTypes::SendRnd2SharedKey:
@@ -104,13 +129,21 @@ protected:
       // receive the public key from this client, this is the shared public
       // key that the plaintexts will be encrypted with.
 
-      RecvClientBPublicKey(client, msg);
+      if (!RecvClientBPublicKey(client, msg)) {
+        // a delta that does not fit the round 1 key we hold, the client
+        // sends the key again in full
+        olc::net::message<ThreshMsgTypes> nackMsg;
+        nackMsg.header.id = ThreshMsgTypes::NackRnd2SharedKey;
+        client->Send(nackMsg);
+        break;
+      }
       {
         // send acknowledgement
         olc::net::message<ThreshMsgTypes> ackMsg;
         ackMsg.header.id = ThreshMsgTypes::AckRnd2SharedKey;
         client->Send(ackMsg);
       }
+      Notify(ThreshMsgTypes::RequestRnd2SharedKey, lock);
       break;
 
     case ThreshMsgTypes::SendRnd2EvalMultAB:
@@ -119,13 +152,21 @@ protected:
       // receive the evalmultAB key from this client, send this to other
       // client for Round 3 key generation of evalMultFinal
 
-      RecvClientBevalMultKeyAB(client, msg);
+      if (!RecvClientBevalMultKeyAB(client, msg)) {
+        // a delta that does not fit the round 1 key we hold, the client
+        // sends the key again in full
+        olc::net::message<ThreshMsgTypes> nackMsg;
+        nackMsg.header.id = ThreshMsgTypes::NackRnd2EvalMultAB;
+        client->Send(nackMsg);
+        break;
+      }
       {
         // send acknowledgement
         olc::net::message<ThreshMsgTypes> ackMsg;
         ackMsg.header.id = ThreshMsgTypes::AckRnd2EvalMultAB;
         client->Send(ackMsg);
       }
+      Notify(ThreshMsgTypes::RequestRnd2EvalMultAB, lock);
       break;
 
     case ThreshMsgTypes::SendRnd2EvalMultBAB:
@@ -141,6 +182,7 @@ protected:
         ackMsg.header.id = ThreshMsgTypes::AckRnd2EvalMultBAB;
         client->Send(ackMsg);
       }
+      Notify(ThreshMsgTypes::RequestRnd2EvalMultBAB, lock);
       break;
 
     case ThreshMsgTypes::SendRnd2EvalSumKeysJoin:
@@ -149,13 +191,14 @@ protected:
       // receive the evalsumkeysjoin from this client. This is the final
       // evaluation key for vector sum
 
-      RecvClientBevalSumKeysJoin(client, msg);
+      RecvClientBevalSumKeysJoin(client, msg, lock);
       {
         // send acknowledgement
         olc::net::message<ThreshMsgTypes> ackMsg;
         ackMsg.header.id = ThreshMsgTypes::AckRnd2EvalSumKeysJoin;
         client->Send(ackMsg);
       }
+      Notify(ThreshMsgTypes::RequestRnd2EvalSumKeysJoin, lock);
       break;
 
     case ThreshMsgTypes::SendRnd3EvalMultFinal:
@@ -171,46 +214,49 @@ protected:
         ackMsg.header.id = ThreshMsgTypes::AckRnd3EvalMultFinal;
         client->Send(ackMsg);
       }
+      Notify(ThreshMsgTypes::RequestRnd3EvalMultFinal, lock);
       break;
 
     case ThreshMsgTypes::RequestRnd1PubKey:
       std::cout << "[" << client->GetID() << "]: RequestRnd1PubKey\n";
-      SendClientRnd1PubKey(client); // this queues next task
+      SendClientRnd1PubKey(client, msg.header); // this queues next task
       break;
 
     case ThreshMsgTypes::RequestRnd1evalMultKey:
       std::cout << "[" << client->GetID() << "]: RequestRnd1evalMultKey\n";
-      SendClientRnd1evalMultKey(client); // this queues next task
+      SendClientRnd1evalMultKey(client, msg.header); // this queues next task
       break;
 
     case ThreshMsgTypes::RequestRnd1evalSumKeys:
       std::cout << "[" << client->GetID() << "]: RequestRnd1evalSumKeys\n";
-      SendClientRnd1evalSumKeys(client); // this queues next task
+      // this queues next task
+      SendClientRnd1evalSumKeys(client, msg.header, lock);
       break;
 
     case ThreshMsgTypes::RequestRnd2SharedKey:
       std::cout << "[" << client->GetID() << "]: RequestRnd2SharedKey\n";
-      SendClientRnd2PubKey(client); // this queues next task
+      SendClientRnd2PubKey(client, msg.header); // this queues next task
       break;
 
     case ThreshMsgTypes::RequestRnd2EvalMultAB:
       std::cout << "[" << client->GetID() << "]: RequestRnd2EvalMultAB\n";
-      SendClientRnd2evalMultKeyAB(client); // this queues next task
+      SendClientRnd2evalMultKeyAB(client, msg.header); // this queues next task
       break;
 
     case ThreshMsgTypes::RequestRnd2EvalMultBAB:
       std::cout << "[" << client->GetID() << "]: RequestRnd2EvalMultBAB\n";
-      SendClientRnd2evalMultKeyBAB(client); // this queues next task
+      SendClientRnd2evalMultKeyBAB(client, msg.header); // this queues next task
       break;
 
     case ThreshMsgTypes::RequestRnd2EvalSumKeysJoin:
       std::cout << "[" << client->GetID() << "]: RequestRnd2EvalSumKeysJoin\n";
-      SendClientRnd2evalSumKeysJoin(client); // this queues next task
+      // this queues next task
+      SendClientRnd2evalSumKeysJoin(client, msg.header, lock);
       break;
 
     case ThreshMsgTypes::RequestRnd3EvalMultFinal:
       std::cout << "[" << client->GetID() << "]: RequestRnd3evalMultFinal\n";
-      SendClientRnd3evalMultFinal(client); // this queues next task
+      SendClientRnd3evalMultFinal(client, msg.header); // this queues next task
       break;
 
     case ThreshMsgTypes::SendCT1:
@@ -226,6 +272,7 @@ protected:
         ackMsg.header.id = ThreshMsgTypes::AckCT1;
         client->Send(ackMsg);
       }
+      NotifyCTs(lock);
       break;
 
     case ThreshMsgTypes::SendCT2:
@@ -240,6 +287,7 @@ protected:
         ackMsg.header.id = ThreshMsgTypes::AckCT2;
         client->Send(ackMsg);
       }
+      NotifyCTs(lock);
       break;
 
     case ThreshMsgTypes::SendCT3:
@@ -254,51 +302,52 @@ protected:
         ackMsg.header.id = ThreshMsgTypes::AckCT3;
         client->Send(ackMsg);
       }
+      NotifyCTs(lock);
       break;
 
     case ThreshMsgTypes::RequestCT1:
       std::cout << "[" << client->GetID() << "]: RequestCT1\n";
-      SendClientCT(client, 0); // this queues next task
+      SendClientCT(client, msg.header, 0); // this queues next task
       break;
 
     case ThreshMsgTypes::RequestCT2:
       std::cout << "[" << client->GetID() << "]: RequestCT2\n";
-      SendClientCT(client, 1); // this queues next task
+      SendClientCT(client, msg.header, 1); // this queues next task
       break;
 
     case ThreshMsgTypes::RequestCT3:
       std::cout << "[" << client->GetID() << "]: RequestCT3\n";
-      SendClientCT(client, 2); // this queues next task
+      SendClientCT(client, msg.header, 2); // this queues next task
       break;
 
     case ThreshMsgTypes::RequestDecryptLeadAdd:
       std::cout << "[" << client->GetID() << "]: RequestDecryptLeadAdd\n";
-      SendClientDecryptLeadAdd(client);
+      SendClientDecryptLeadAdd(client, msg.header);
       break;
 
     case ThreshMsgTypes::RequestDecryptLeadMult:
       std::cout << "[" << client->GetID() << "]: RequestDecryptLeadMult\n";
-      SendClientDecryptLeadMult(client);
+      SendClientDecryptLeadMult(client, msg.header);
       break;
 
     case ThreshMsgTypes::RequestDecryptLeadSum:
       std::cout << "[" << client->GetID() << "]: RequestDecryptLeadSum\n";
-      SendClientDecryptLeadSum(client);
+      SendClientDecryptLeadSum(client, msg.header);
       break;
 
     case ThreshMsgTypes::RequestDecryptMainAdd:
       std::cout << "[" << client->GetID() << "]: RequestDecryptMainAdd\n";
-      SendClientDecryptMainAdd(client);
+      SendClientDecryptMainAdd(client, msg.header);
       break;
 
     case ThreshMsgTypes::RequestDecryptMainMult:
       std::cout << "[" << client->GetID() << "]: RequestDecryptMainMult\n";
-      SendClientDecryptMainMult(client);
+      SendClientDecryptMainMult(client, msg.header);
       break;
 
     case ThreshMsgTypes::RequestDecryptMainSum:
       std::cout << "[" << client->GetID() << "]: RequestDecryptMainSum\n";
-      SendClientDecryptMainSum(client);
+      SendClientDecryptMainSum(client, msg.header);
       break;
 
     case ThreshMsgTypes::SendDecryptPartialMainAdd:
@@ -313,6 +362,7 @@ protected:
         ackMsg.header.id = ThreshMsgTypes::AckPartialMainAdd;
         client->Send(ackMsg);
       }
+      Notify(ThreshMsgTypes::RequestDecryptMainAdd, lock);
       break;
     case ThreshMsgTypes::SendDecryptPartialLeadAdd:
 
@@ -326,6 +376,7 @@ protected:
         ackMsg.header.id = ThreshMsgTypes::AckPartialLeadAdd;
         client->Send(ackMsg);
       }
+      Notify(ThreshMsgTypes::RequestDecryptLeadAdd, lock);
       break;
 
     case ThreshMsgTypes::SendDecryptPartialMainMult:
@@ -340,6 +391,7 @@ protected:
         ackMsg.header.id = ThreshMsgTypes::AckPartialMainMult;
         client->Send(ackMsg);
       }
+      Notify(ThreshMsgTypes::RequestDecryptMainMult, lock);
       break;
 
     case ThreshMsgTypes::SendDecryptPartialLeadMult:
@@ -354,6 +406,7 @@ protected:
         ackMsg.header.id = ThreshMsgTypes::AckPartialLeadMult;
         client->Send(ackMsg);
       }
+      Notify(ThreshMsgTypes::RequestDecryptLeadMult, lock);
       break;
 
     case ThreshMsgTypes::SendDecryptPartialMainSum:
@@ -368,6 +421,7 @@ protected:
         ackMsg.header.id = ThreshMsgTypes::AckPartialMainSum;
         client->Send(ackMsg);
       }
+      Notify(ThreshMsgTypes::RequestDecryptMainSum, lock);
       break;
 
     case ThreshMsgTypes::SendDecryptPartialLeadSum:
@@ -382,6 +436,7 @@ protected:
         ackMsg.header.id = ThreshMsgTypes::AckPartialLeadSum;
         client->Send(ackMsg);
       }
+      Notify(ThreshMsgTypes::RequestDecryptLeadSum, lock);
       break;
     case ThreshMsgTypes::DisconnectClient:
 
@@ -395,6 +450,34 @@ protected:
     }
   }
 
+  // holds on to a request until Notify() for its id
+  void Park(std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+            const olc::net::message_header<ThreshMsgTypes> &request) {
+    std::cout << "[SERVER] parking " << request.id << " from ["
+              << client->GetID() << "]\n";
+    m_waiting.Subscribe(request.id, client, request);
+  }
+
+  // handles the requests parked waiting for what just arrived
+  // handles the requests parked waiting for what just arrived. A request
+  // may return with the lock released, take it back before the next one.
+  void Notify(ThreshMsgTypes request, std::unique_lock<std::mutex> &lock) {
+    m_waiting.Notify(request, [this, &lock](auto waiter, auto &msg) {
+      if (!lock.owns_lock()) {
+        lock.lock();
+      }
+      ProcessMessage(waiter, msg, lock);
+    });
+  }
+
+  // CTs are numbered in the order they arrive, so a new one may answer
+  // any CT request
+  void NotifyCTs(std::unique_lock<std::mutex> &lock) {
+    Notify(ThreshMsgTypes::RequestCT1, lock);
+    Notify(ThreshMsgTypes::RequestCT2, lock);
+    Notify(ThreshMsgTypes::RequestCT3, lock);
+  }
+
   void InitializeCC(void) {
     PROFILELOG("[SERVER] Initializing");
     TimeVar t; // time benchmarking variables
@@ -417,247 +500,162 @@ protected:
     m_serverCC->Enable(MULTIPARTY);
 
     PROFILELOG("[SERVER]: elapsed time " << TOC_MS(t) << "msec.");
+
+    // the context does not change from here on, so it is serialized once
+    // and every RequestCC is answered with the same body
+    olc::net::message<ThreshMsgTypes> msg;
+    {
+      olc::net::message_ostream<ThreshMsgTypes> os(msg);
+      Serial::Serialize(m_serverCC, os, SerType::BINARY);
+    }
+    msg.header.id = ThreshMsgTypes::SendCC;
+    m_ccReply = olc::net::shared_message<ThreshMsgTypes>(std::move(msg));
   }
 
   void
   SendClientCC(std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    std::string s;
-    std::ostringstream os(s);
     OPENFHE_DEBUG("[SERVER]: sending cryptocontext to [" << client->GetID()
                                                          << "]:");
-    Serial::Serialize(m_serverCC, os, SerType::BINARY);
-
-    olc::net::message<ThreshMsgTypes> msg;
-    msg.header.id = ThreshMsgTypes::SendCC;
-    msg << os.str(); // push the string onto the message.
-
-    client->Send(msg);
+    // the body made by InitializeCC is shared, not copied
+    client->Send(m_ccReply);
   }
 
   void SendClientRnd1PubKey(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    std::string s;
-    std::ostringstream os(s);
-    olc::net::message<ThreshMsgTypes> msg;
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request) {
     if (!A_Rnd1PubKeyRecd) {
-      std::cout << "[SERVER] sending NackRnd1PubKey to [" << client->GetID()
-                << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackRnd1PubKey;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
     OPENFHE_DEBUG("[SERVER]: sending Round 1 Public Key to [" << client->GetID()
                                                               << "]:");
-    Serial::Serialize(A_Rnd1PublicKey, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendRnd1PubKey;
-    msg << os.str(); // push the string onto the message.
-
-    client->Send(msg);
+    client->Send(A_Rnd1PublicKey.Message());
   }
 
   void SendClientRnd1evalMultKey(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    std::string s;
-    std::ostringstream os(s);
-    olc::net::message<ThreshMsgTypes> msg;
-
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request) {
     if (!A_evalMultKeyRecd) {
-      std::cout << "[SERVER] sending NackRnd1evalMultKey to ["
-                << client->GetID() << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackRnd1evalMultKey;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
     OPENFHE_DEBUG("[SERVER]: sending Round 1 EvalMultKey to ["
                   << client->GetID() << "]:");
-    Serial::Serialize(A_evalMultKey, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendRnd1evalMultKey;
-    msg << os.str(); // push the string onto the message.
-
-    client->Send(msg);
+    client->Send(A_evalMultKey.Message());
   }
 
   void SendClientRnd1evalSumKeys(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    std::string s;
-    std::ostringstream os(s);
-    olc::net::message<ThreshMsgTypes> msg;
-
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request,
+      std::unique_lock<std::mutex> &lock) {
     if (!A_evalSumKeys) {
-      std::cout << "[SERVER] sending NackRnd1evalSumKeys to ["
-                << client->GetID() << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackRnd1evalSumKeys;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
+    // the map is never changed once stored, stream our own reference to it
+    // without holding up the other clients while this one drains it
+    auto keys = A_evalSumKeys;
+    lock.unlock();
+
     OPENFHE_DEBUG("[SERVER]: sending Round 1 EvalSumKeys to ["
                   << client->GetID() << "]:");
-    Serial::Serialize(A_evalSumKeys, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendRnd1evalSumKeys;
-    msg << os.str(); // push the string onto the message.
-
-    client->Send(msg);
+    // The key map is large, stream it out in chunks as it is serialized
+    olc::net::message_chunk_ostream<ThreshMsgTypes> os(
+        *client, ThreshMsgTypes::SendRnd1evalSumKeys);
+    Serial::Serialize(keys, os, SerType::BINARY);
+    os.close();
   }
 
   void SendClientRnd2PubKey(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    std::string s;
-    std::ostringstream os(s);
-    olc::net::message<ThreshMsgTypes> msg;
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request) {
     if (!B_Rnd2PublicKeyRecd) {
-      std::cout << "[SERVER] sending NackRnd2SharedKey to [" << client->GetID()
-                << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackRnd2SharedKey;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
     OPENFHE_DEBUG("[SERVER]: sending Round 2 Public Key to [" << client->GetID()
                                                               << "]:");
-    Serial::Serialize(B_Rnd2PublicKey, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendRnd2SharedKey;
-    msg << os.str(); // push the string onto the message.
-
-    client->Send(msg);
+    client->Send(B_Rnd2PublicKey.Message());
   }
 
   void SendClientRnd2evalMultKeyAB(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    std::string s;
-    std::ostringstream os(s);
-    olc::net::message<ThreshMsgTypes> msg;
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request) {
     if (!B_evalMultKeyABRecd) {
-      std::cout << "[SERVER] sending NackRnd2EvalMultAB to [" << client->GetID()
-                << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackRnd2EvalMultAB;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
     OPENFHE_DEBUG("[SERVER]: sending Round 2 EvalMultKeyAB to ["
                   << client->GetID() << "]:");
-    Serial::Serialize(B_evalMultKeyAB, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendRnd2EvalMultAB;
-    msg << os.str(); // push the string onto the message.
-
-    client->Send(msg);
+    client->Send(B_evalMultKeyAB.Message());
   }
 
   void SendClientRnd2evalMultKeyBAB(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    std::string s;
-    std::ostringstream os(s);
-    olc::net::message<ThreshMsgTypes> msg;
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request) {
     if (!B_evalMultKeyBABRecd) {
-      std::cout << "[SERVER] sending NackRnd2EvalMultBAB to ["
-                << client->GetID() << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackRnd2EvalMultBAB;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
     OPENFHE_DEBUG("[SERVER]: sending Round 2 EvalMultKeyBAB to ["
                   << client->GetID() << "]:");
-    Serial::Serialize(B_evalMultKeyBAB, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendRnd2EvalMultBAB;
-    msg << os.str(); // push the string onto the message.
-
-    client->Send(msg);
+    client->Send(B_evalMultKeyBAB.Message());
   }
 
   void SendClientRnd2evalSumKeysJoin(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    std::string s;
-    std::ostringstream os(s);
-    olc::net::message<ThreshMsgTypes> msg;
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request,
+      std::unique_lock<std::mutex> &lock) {
     if (!B_evalSumKeysJoin) {
-      std::cout << "[SERVER] sending NackRnd2EvalSumKeysJoin to ["
-                << client->GetID() << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackRnd2EvalSumKeysJoin;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
+    // the map is never changed once stored, stream our own reference to it
+    // without holding up the other clients while this one drains it
+    auto keys = B_evalSumKeysJoin;
+    lock.unlock();
+
     OPENFHE_DEBUG("[SERVER]: sending Round 2 EvalSumKeysJoin to ["
                   << client->GetID() << "]:");
-    Serial::Serialize(B_evalSumKeysJoin, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendRnd2EvalSumKeysJoin;
-    msg << os.str(); // push the string onto the message.
-
-    client->Send(msg);
+    olc::net::message_chunk_ostream<ThreshMsgTypes> os(
+        *client, ThreshMsgTypes::SendRnd2EvalSumKeysJoin);
+    Serial::Serialize(keys, os, SerType::BINARY);
+    os.close();
   }
 
   void SendClientRnd3evalMultFinal(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    std::string s;
-    std::ostringstream os(s);
-    olc::net::message<ThreshMsgTypes> msg;
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request) {
     if (!A_evalMultFinalRecd) {
-      std::cout << "[SERVER] sending NackRnd3evalMultFinal to ["
-                << client->GetID() << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackRnd3evalMultFinal;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
     OPENFHE_DEBUG("[SERVER]: sending Round 3 evalMultFinal to ["
                   << client->GetID() << "]:");
-    Serial::Serialize(A_evalMultFinal, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendRnd3EvalMultFinal;
-    msg << os.str(); // push the string onto the message.
-
-    client->Send(msg);
+    client->Send(A_evalMultFinal.Message());
   }
 
   void
   SendClientCT(std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+               const olc::net::message_header<ThreshMsgTypes> &request,
                int num) {
-    std::string s;
-    std::ostringstream os(s);
-    olc::net::message<ThreshMsgTypes> msg;
-    if (!B_CTreceived[num]) {
-      if (num == 0) {
-        std::cout << "[SERVER] sending NackCT1 to [" << client->GetID()
-                  << "]:\n";
-        msg.header.id = ThreshMsgTypes::NackCT1;
-      } else if (num == 1) {
-        std::cout << "[SERVER] sending NackCT2 to [" << client->GetID()
-                  << "]:\n";
-        msg.header.id = ThreshMsgTypes::NackCT2;
-      } else if (num == 2) {
-        std::cout << "[SERVER] sending NackCT3 to [" << client->GetID()
-                  << "]:\n";
-        msg.header.id = ThreshMsgTypes::NackCT3;
-      }
-      client->Send(msg);
+    // CTs are numbered in the order they arrived
+    if (size_t(num) >= B_CTreceived.size() || !B_CTreceived[num]) {
+      Park(client, request);
       return;
     }
 
     OPENFHE_DEBUG("[SERVER]: sending CT" << num << " to [" << client->GetID()
                                          << "]:");
-    Serial::Serialize(B_CipherTexts[num], os, SerType::BINARY);
-
-    if (num == 0) {
-      msg.header.id = ThreshMsgTypes::SendCT1;
-    } else if (num == 1) {
-      msg.header.id = ThreshMsgTypes::SendCT2;
-    } else if (num == 2) {
-      msg.header.id = ThreshMsgTypes::SendCT3;
-    }
-    msg << os.str(); // push the string onto the message.
-
-    client->Send(msg);
+    client->Send(B_CipherTexts[num].Message());
   }
 
   void RecvClientAPublicKey(
@@ -672,13 +670,17 @@ protected:
     OPENFHE_DEBUG("[SERVER] read Rnd1 public key of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
-    Serial::Deserialize(A_Rnd1PublicKey, is, SerType::BINARY);
+    PubKey publicKey;
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(publicKey, is, SerType::BINARY);
+    }
+    msg.header.id = ThreshMsgTypes::SendRnd1PubKey;
+    A_Rnd1PublicKey.Set(std::move(publicKey), std::move(msg));
     A_Rnd1PubKeyRecd = true;
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
@@ -696,13 +698,17 @@ protected:
     OPENFHE_DEBUG("[SERVER] read Rnd1 evalmultkey of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
-    Serial::Deserialize(A_evalMultKey, is, SerType::BINARY);
+    EvKey evalKey;
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(evalKey, is, SerType::BINARY);
+    }
+    msg.header.id = ThreshMsgTypes::SendRnd1evalMultKey;
+    A_evalMultKey.Set(std::move(evalKey), std::move(msg));
     A_evalMultKeyRecd = true;
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
@@ -710,7 +716,8 @@ protected:
 
   void RecvClientAevalSumKeys(
       std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
-      olc::net::message<ThreshMsgTypes> &msg) {
+      olc::net::message<ThreshMsgTypes> &msg,
+      std::unique_lock<std::mutex> &lock) {
     // receive the evalsumkeys from this client,
     // and store it in the data structure
     // note a more complex server could store the key in a
@@ -720,18 +727,25 @@ protected:
     OPENFHE_DEBUG("[SERVER] read Rnd1 evalsumkeys of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
+    // deserializing the map takes a while, the other clients only wait for
+    // it to deserialize something of their own
+    std::shared_ptr<std::map<usint, EvKey>> keys;
+    lock.unlock();
     OPENFHE_DEBUG("[SERVER] Deserialize");
-    Serial::Deserialize(A_evalSumKeys, is, SerType::BINARY);
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(keys, is, SerType::BINARY);
+    }
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
+    lock.lock();
+    A_evalSumKeys = keys;
   }
 
-  void RecvClientBPublicKey(
+  bool RecvClientBPublicKey(
       std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
       olc::net::message<ThreshMsgTypes> &msg) {
     // receive the public key from this client,
@@ -744,19 +758,32 @@ protected:
                                                          << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // the key may come as a delta against the round 1 key we hold
+    if (!ExpandDelta(msg, A_Rnd1PublicKey.Bytes())) {
+      return false;
+    }
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
-    Serial::Deserialize(B_Rnd2PublicKey, is, SerType::BINARY);
+    PubKey publicKey;
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(publicKey, is, SerType::BINARY);
+    }
+    msg.header.id = ThreshMsgTypes::SendRnd2SharedKey;
+    B_Rnd2PublicKey.Set(std::move(publicKey), std::move(msg));
+    if (m_bDeltaKeys) {
+      // same "a" polynomial as the round 1 key the clients have
+      B_Rnd2PublicKey.DeltaCompress(A_Rnd1PublicKey.Bytes());
+    }
     B_Rnd2PublicKeyRecd = true;
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
+    return true;
   }
 
-  void RecvClientBevalMultKeyAB(
+  bool RecvClientBevalMultKeyAB(
       std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
       olc::net::message<ThreshMsgTypes> &msg) {
     // receive the evalMultAB key from this client,
@@ -769,16 +796,29 @@ protected:
                                                                 << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // the key may come as a delta against the round 1 key we hold
+    if (!ExpandDelta(msg, A_evalMultKey.Bytes())) {
+      return false;
+    }
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
-    Serial::Deserialize(B_evalMultKeyAB, is, SerType::BINARY);
+    EvKey evalKey;
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(evalKey, is, SerType::BINARY);
+    }
+    msg.header.id = ThreshMsgTypes::SendRnd2EvalMultAB;
+    B_evalMultKeyAB.Set(std::move(evalKey), std::move(msg));
+    if (m_bDeltaKeys) {
+      // same "a" vector as the round 1 key the clients have
+      B_evalMultKeyAB.DeltaCompress(A_evalMultKey.Bytes());
+    }
     B_evalMultKeyABRecd = true;
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
+    return true;
   }
 
   void RecvClientBevalMultKeyBAB(
@@ -794,13 +834,17 @@ protected:
                                                              << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
-    Serial::Deserialize(B_evalMultKeyBAB, is, SerType::BINARY);
+    EvKey evalKey;
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(evalKey, is, SerType::BINARY);
+    }
+    msg.header.id = ThreshMsgTypes::SendRnd2EvalMultBAB;
+    B_evalMultKeyBAB.Set(std::move(evalKey), std::move(msg));
     B_evalMultKeyBABRecd = true;
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
@@ -808,7 +852,8 @@ protected:
 
   void RecvClientBevalSumKeysJoin(
       std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
-      olc::net::message<ThreshMsgTypes> &msg) {
+      olc::net::message<ThreshMsgTypes> &msg,
+      std::unique_lock<std::mutex> &lock) {
     // receive the evalsumkeysjoin from this client,
     // and store it in the data structure
     // note a more complex server could store the key in a
@@ -819,15 +864,22 @@ protected:
                                                               << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
+    // deserializing the map takes a while, the other clients only wait for
+    // it to deserialize something of their own
+    std::shared_ptr<std::map<usint, EvKey>> keys;
+    lock.unlock();
     OPENFHE_DEBUG("[SERVER] Deserialize");
-    Serial::Deserialize(B_evalSumKeysJoin, is, SerType::BINARY);
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(keys, is, SerType::BINARY);
+    }
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
+    lock.lock();
+    B_evalSumKeysJoin = keys;
   }
 
   void RecvClientAevalMultFinal(
@@ -843,13 +895,17 @@ protected:
                                                             << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
-    Serial::Deserialize(A_evalMultFinal, is, SerType::BINARY);
+    EvKey evalKey;
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(evalKey, is, SerType::BINARY);
+    }
+    msg.header.id = ThreshMsgTypes::SendRnd3EvalMultFinal;
+    A_evalMultFinal.Set(std::move(evalKey), std::move(msg));
     A_evalMultFinalRecd = true;
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
@@ -867,16 +923,29 @@ protected:
     OPENFHE_DEBUG("[SERVER] read CT of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
 
-    Serial::Deserialize(ct, is, SerType::BINARY);
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(ct, is, SerType::BINARY);
+    }
 
-    B_CipherTexts.push_back(ct);
+    // sent on as CT1, CT2 and CT3, in the order they arrived
+    ThreshMsgTypes id{};
+    size_t num = B_CipherTexts.size();
+    if (num == 0) {
+      id = ThreshMsgTypes::SendCT1;
+    } else if (num == 1) {
+      id = ThreshMsgTypes::SendCT2;
+    } else if (num == 2) {
+      id = ThreshMsgTypes::SendCT3;
+    }
+    B_CipherTexts.emplace_back();
+    msg.header.id = id;
+    B_CipherTexts.back().Set(std::move(ct), std::move(msg));
 
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
@@ -884,153 +953,87 @@ protected:
   }
 
   void SendClientDecryptMainMult(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    olc::net::message<ThreshMsgTypes> msg;
-    // if the partial decrypt does not yet exist, send a Nack
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request) {
+    // if the partial decrypt does not yet exist, wait for it
     if (!Partial_MainMultRecd) {
-      std::cout << "[SERVER] sending NackPartialMainMult to ["
-                << client->GetID() << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackPartialMainMult;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
-    std::string s;
-    std::ostringstream os(s);
     OPENFHE_DEBUG("[SERVER]: sending partial decrypt main mult to ["
                   << client->GetID() << "]:");
-    Serial::Serialize(Partial_MainMult, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendDecryptMainMult;
-    msg << os.str(); // push the string onto the message.
-    OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
-    OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    client->Send(msg);
+    client->Send(Partial_MainMult.Message());
   }
 
   void SendClientDecryptLeadMult(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    olc::net::message<ThreshMsgTypes> msg;
-    // if the partial decrypt does not yet exist, send a Nack
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request) {
+    // if the partial decrypt does not yet exist, wait for it
     if (!Partial_LeadMultRecd) {
-      std::cout << "[SERVER] sending NackPartialLeadMult to ["
-                << client->GetID() << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackPartialLeadMult;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
-    std::string s;
-    std::ostringstream os(s);
     OPENFHE_DEBUG("[SERVER]: sending partial decrypt lead mult to ["
                   << client->GetID() << "]:");
-    Serial::Serialize(Partial_LeadMult, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendDecryptLeadMult;
-    msg << os.str(); // push the string onto the message.
-    OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
-    OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    client->Send(msg);
+    client->Send(Partial_LeadMult.Message());
   }
 
   void SendClientDecryptMainAdd(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    olc::net::message<ThreshMsgTypes> msg;
-    // if the partial decrypt does not yet exist, send a Nack
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request) {
+    // if the partial decrypt does not yet exist, wait for it
     if (!Partial_MainAddRecd) {
-      std::cout << "[SERVER] sending NackPartialMainAdd to [" << client->GetID()
-                << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackPartialMainAdd;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
-    std::string s;
-    std::ostringstream os(s);
     OPENFHE_DEBUG("[SERVER]: sending partial decrypt main add to ["
                   << client->GetID() << "]:");
-    Serial::Serialize(Partial_MainAdd, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendDecryptMainAdd;
-    msg << os.str(); // push the string onto the message.
-    OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
-    OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    client->Send(msg);
+    client->Send(Partial_MainAdd.Message());
   }
 
   void SendClientDecryptLeadAdd(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    olc::net::message<ThreshMsgTypes> msg;
-    // if the partial decrypt does not yet exist, send a Nack
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request) {
+    // if the partial decrypt does not yet exist, wait for it
     if (!Partial_LeadAddRecd) {
-      std::cout << "[SERVER] sending NackPartialLeadAdd to [" << client->GetID()
-                << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackPartialLeadAdd;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
-    std::string s;
-    std::ostringstream os(s);
     OPENFHE_DEBUG("[SERVER]: sending partial decrypt lead add to ["
                   << client->GetID() << "]:");
-    Serial::Serialize(Partial_LeadAdd, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendDecryptLeadAdd;
-    msg << os.str(); // push the string onto the message.
-    OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
-    OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    client->Send(msg);
+    client->Send(Partial_LeadAdd.Message());
   }
 
   void SendClientDecryptMainSum(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    olc::net::message<ThreshMsgTypes> msg;
-    // if the partial decrypt does not yet exist, send a Nack
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request) {
+    // if the partial decrypt does not yet exist, wait for it
     if (!Partial_MainSumRecd) {
-      std::cout << "[SERVER] sending NackPartialMainSum to [" << client->GetID()
-                << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackPartialMainSum;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
-    std::string s;
-    std::ostringstream os(s);
     OPENFHE_DEBUG("[SERVER]: sending partial decrypt main sum to ["
                   << client->GetID() << "]:");
-    Serial::Serialize(Partial_MainSum, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendDecryptMainSum;
-    msg << os.str(); // push the string onto the message.
-    OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
-    OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    client->Send(msg);
+    client->Send(Partial_MainSum.Message());
   }
 
   void SendClientDecryptLeadSum(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    olc::net::message<ThreshMsgTypes> msg;
-    // if the partial decrypt does not yet exist, send a Nack
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request) {
+    // if the partial decrypt does not yet exist, wait for it
     if (!Partial_LeadSumRecd) {
-      std::cout << "[SERVER] sending NackPartialLeadSum to [" << client->GetID()
-                << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackPartialLeadSum;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
-    std::string s;
-    std::ostringstream os(s);
     OPENFHE_DEBUG("[SERVER]: sending partial decrypt lead sum to ["
                   << client->GetID() << "]:");
-    Serial::Serialize(Partial_LeadSum, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendDecryptLeadSum;
-    msg << os.str(); // push the string onto the message.
-    OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
-    OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    client->Send(msg);
+    client->Send(Partial_LeadSum.Message());
   }
 
   void RecvClientPartialMainAddCT(
@@ -1045,14 +1048,18 @@ protected:
     OPENFHE_DEBUG("[SERVER] read CT of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
 
-    Serial::Deserialize(Partial_MainAdd, is, SerType::BINARY);
+    CT ct;
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(ct, is, SerType::BINARY);
+    }
+    msg.header.id = ThreshMsgTypes::SendDecryptMainAdd;
+    Partial_MainAdd.Set(std::move(ct), std::move(msg));
 
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
@@ -1070,14 +1077,18 @@ protected:
     OPENFHE_DEBUG("[SERVER] read CT of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
 
-    Serial::Deserialize(Partial_MainMult, is, SerType::BINARY);
+    CT ct;
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(ct, is, SerType::BINARY);
+    }
+    msg.header.id = ThreshMsgTypes::SendDecryptMainMult;
+    Partial_MainMult.Set(std::move(ct), std::move(msg));
 
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
@@ -1095,14 +1106,18 @@ protected:
     OPENFHE_DEBUG("[SERVER] read CT of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
 
-    Serial::Deserialize(Partial_MainSum, is, SerType::BINARY);
+    CT ct;
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(ct, is, SerType::BINARY);
+    }
+    msg.header.id = ThreshMsgTypes::SendDecryptMainSum;
+    Partial_MainSum.Set(std::move(ct), std::move(msg));
 
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
@@ -1121,14 +1136,18 @@ protected:
     OPENFHE_DEBUG("[SERVER] read CT of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
 
-    Serial::Deserialize(Partial_LeadAdd, is, SerType::BINARY);
+    CT ct;
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(ct, is, SerType::BINARY);
+    }
+    msg.header.id = ThreshMsgTypes::SendDecryptLeadAdd;
+    Partial_LeadAdd.Set(std::move(ct), std::move(msg));
 
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
@@ -1146,14 +1165,18 @@ protected:
     OPENFHE_DEBUG("[SERVER] read CT of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
 
-    Serial::Deserialize(Partial_LeadMult, is, SerType::BINARY);
+    CT ct;
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(ct, is, SerType::BINARY);
+    }
+    msg.header.id = ThreshMsgTypes::SendDecryptLeadMult;
+    Partial_LeadMult.Set(std::move(ct), std::move(msg));
 
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
@@ -1171,14 +1194,18 @@ protected:
     OPENFHE_DEBUG("[SERVER] read CT of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
 
-    Serial::Deserialize(Partial_LeadSum, is, SerType::BINARY);
+    CT ct;
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(ct, is, SerType::BINARY);
+    }
+    msg.header.id = ThreshMsgTypes::SendDecryptLeadSum;
+    Partial_LeadSum.Set(std::move(ct), std::move(msg));
 
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
@@ -1186,13 +1213,13 @@ protected:
   }
 
   void incrementNumClients(void) {
-    numClient++;
-    std::cout << "[Server] Incrementing # clients, now " << numClient << "\n";
+    usint n = ++numClient;
+    std::cout << "[Server] Incrementing # clients, now " << n << "\n";
   }
 
   void decrementNumClients(void) {
-    numClient--;
-    std::cout << "[Server] Decrementing # clients, now " << numClient << "\n";
+    usint n = --numClient;
+    std::cout << "[Server] Decrementing # clients, now " << n << "\n";
   }
   void exitIfNoClients(void) {
     if (!numClient) {
@@ -1202,22 +1229,37 @@ protected:
   }
 
 private:
-  // Server state
+  // Server state, guarded by m_muxState. m_serverCC and m_ccReply are only
+  // read after construction
   CC m_serverCC;
-
-  usint numClient =
-      0; // keeps track of # clients, and when it goes back to zero, exits
+  olc::net::shared_message<ThreshMsgTypes> m_ccReply; // SendCC
+  std::mutex m_muxState;
+  // OpenFHE's context registry is not thread safe, every Deserialize() takes
+  // this, after m_muxState if it holds that too
+  std::mutex m_muxDeserialize;
+  olc::net::subscriptions<ThreshMsgTypes> m_waiting; // requests by id
+  bool m_bDeltaKeys = false; // set before Start()
+
+  // keeps track of # clients, and when it goes back to zero, exits.
+  // OnClientConnect() runs on the I/O threads, so this is atomic
+  std::atomic<usint> numClient{0};
 
   // a full up server would have lists of all the clients,
   // and their approved connections,
   // but we will only keep track of one pair in this example
 
+  // The keys and ciphertexts the clients send are passed on to the other
+  // client as they are, so each is kept serialized too, from when it
+  // arrives. Round 2 keys are kept as deltas against round 1 keys when
+  // delta keys are on.
+
   // public keys of Clients Alice and Bob
-  PubKey A_Rnd1PublicKey, B_Rnd2PublicKey;
+  Serialized<PubKey> A_Rnd1PublicKey, B_Rnd2PublicKey;
 
   // evaluation keys for multiplication in rounds1,2,3 from Alice and Bob and
   // flags for marking received
-  EvKey A_evalMultKey, B_evalMultKeyAB, B_evalMultKeyBAB, A_evalMultFinal;
+  Serialized<EvKey> A_evalMultKey, B_evalMultKeyAB, B_evalMultKeyBAB,
+      A_evalMultFinal;
   bool A_Rnd1PubKeyRecd, A_evalMultKeyRecd, B_Rnd2PublicKeyRecd,
       B_evalMultKeyABRecd, B_evalMultKeyBABRecd, A_evalMultFinalRecd;
 
@@ -1225,11 +1267,11 @@ private:
   std::shared_ptr<std::map<usint, EvKey>> A_evalSumKeys, B_evalSumKeysJoin;
 
   // ciphertexts from Bob and flags for receiving the ciphertexts
-  std::vector<CT> B_CipherTexts;
+  std::vector<Serialized<CT>> B_CipherTexts;
   std::vector<bool> B_CTreceived;
 
-  CT Partial_LeadAdd, Partial_MainAdd, Partial_LeadMult, Partial_MainMult,
-      Partial_LeadSum, Partial_MainSum;
+  Serialized<CT> Partial_LeadAdd, Partial_MainAdd, Partial_LeadMult,
+      Partial_MainMult, Partial_LeadSum, Partial_MainSum;
   bool Partial_LeadAddRecd = false, Partial_MainAddRecd = false,
        Partial_LeadMultRecd = false, Partial_MainMultRecd = false;
   bool Partial_LeadSumRecd = false, Partial_MainSumRecd = false;
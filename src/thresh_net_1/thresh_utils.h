@@ -226,6 +226,58 @@ std::ostream &operator<<(std::ostream &os, const ThreshMsgTypes &obj) {
   return os;
 }
 
+// Serializes an object the way the examples send it, for Serialized below
+struct BinarySerializer {
+  template <typename Obj>
+  void operator()(const Obj &obj, std::ostream &os) const {
+    Serial::Serialize(obj, os, SerType::BINARY);
+  }
+};
+
+// An object a server stores and sends on, kept with the message that
+// carries it so it is serialized once, when it is stored
+template <typename Obj>
+using Serialized = olc::net::serialized<ThreshMsgTypes, Obj, BinarySerializer>;
+
+// The bytes an object serializes to. Round 2 keys are delta encoded
+// against the serialized round 1 key they were built from, which both ends
+// hold (see olc_net/net_delta.h).
+template <typename Obj>
+olc::net::message_body SerializeToBytes(const Obj &obj) {
+  olc::net::message<ThreshMsgTypes> msg;
+  olc::net::message_ostream<ThreshMsgTypes> os(msg);
+  Serial::Serialize(obj, os, SerType::BINARY);
+  return std::move(msg.body);
+}
+
+// Sends msg as a delta against ref when that makes it smaller
+template <typename Obj>
+void CompressDelta(olc::net::message<ThreshMsgTypes> &msg, const Obj &ref) {
+  olc::net::delta_compress(msg, SerializeToBytes(ref));
+}
+
+// Rebuilds a delta encoded msg from our own copy of ref, already
+// serialized, a plain one is left alone. Returns false, leaving msg as it
+// was, if the delta does not fit ref, e.g. a stale or malformed upload; a
+// server answers that with a Nack rather than going down.
+bool ExpandDelta(olc::net::message<ThreshMsgTypes> &msg,
+                 const olc::net::message_body &ref) {
+  if (!olc::net::delta_expand(msg, ref)) {
+    std::cerr << "delta encoded " << msg.header.id
+              << " does not match its reference\n";
+    return false;
+  }
+  return true;
+}
+
+// as above, serializing ref only if msg needs it
+template <typename Obj>
+bool ExpandDelta(olc::net::message<ThreshMsgTypes> &msg, const Obj &ref) {
+  if (!(msg.header.flags & olc::net::message_flags::delta))
+    return true;
+  return ExpandDelta(msg, SerializeToBytes(ref));
+}
+
 /**
  * Take a powernap of (DEFAULT) 0.5 seconds
  * @param ms - number of milisec to nap
@@ -198,14 +198,13 @@ int main(int argc, char *argv[]) {
             break;
           case ThreshMsgTypes::AckRnd1evalSumKeys:
             PROFILELOG(myName << ": Acknowledged Round 1 EvalSumKeys");
-            nap(100); // sleep until Round 2 key generation is done.
             state = ClientAStates::RequestRnd2SharedKey;
             break;
 
           case ThreshMsgTypes::SendRnd2SharedKey:
             PROFILELOG(myName << ": Reading Round 2 Shared key");
             TIC(t);
-            Rnd2SharedKey = c.RecvRnd2SharedKey(msg);
+            Rnd2SharedKey = c.RecvRnd2SharedKey(msg, keyPair.publicKey);
             PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
             state = ClientAStates::RequestRnd2evalMultAB;
             break;
@@ -213,7 +212,7 @@ int main(int argc, char *argv[]) {
           case ThreshMsgTypes::SendRnd2EvalMultAB:
             PROFILELOG(myName << ": Reading Round 2 EvalMultAB");
             TIC(t);
-            Rnd2EvalMultAB = c.RecvRnd2evalMultAB(msg);
+            Rnd2EvalMultAB = c.RecvRnd2evalMultAB(msg, evalMultKey);
             PROFILELOG(myName << ": elapsed time " << TOC_MS(t) << "msec.");
             state = ClientAStates::RequestRnd2evalMultBAB;
             break;
@@ -236,7 +235,6 @@ int main(int argc, char *argv[]) {
 
           case ThreshMsgTypes::AckRnd3EvalMultFinal:
             PROFILELOG(myName << ": Acknowledged Round 3 EvalMultFinal");
-            nap(1000);
             state = ClientAStates::RequestAddCT;
             break;
 
@@ -55,19 +55,37 @@ int main(int argc, char *argv[]) {
   ////////////////////////////////////////////////////////////
   int opt;
   uint32_t port(0);
+  size_t nThreads(1);
+  size_t nWorkers(0);
+  bool bDeltaKeys(false);
   std::cout << "here debug";
 
-  while ((opt = getopt(argc, argv, "p:h")) != -1) {
+  while ((opt = getopt(argc, argv, "p:t:w:dh")) != -1) {
     switch (opt) {
     case 'p':
       port = atoi(optarg);
       std::cout << "host port " << port << std::endl;
       break;
+    case 't':
+      nThreads = std::stoul(optarg);
+      break;
+    case 'w':
+      nWorkers = std::stoul(optarg);
+      break;
+    case 'd':
+      bDeltaKeys = true;
+      break;
     case 'h':
     default: /* '?' */
       std::cerr << "Usage: " << std::endl
                 << "arguments:" << std::endl
                 << "  -p port of the server" << std::endl
+                << "  -t number of I/O threads (default 1)" << std::endl
+                << "  -w number of message handler threads (default 0, "
+                   "handle messages on the main thread)"
+                << std::endl
+                << "  -d send round 2 keys as deltas against round 1 keys"
+                << std::endl
                 << "  -h prints this message" << std::endl;
       std::exit(EXIT_FAILURE);
     }
@@ -81,7 +99,8 @@ int main(int argc, char *argv[]) {
 
   PROFILELOG("SERVER: Initializing");
 
-  ThreshServer server(port);
+  ThreshServer server(port, nThreads, nWorkers);
+  server.EnableDeltaKeys(bDeltaKeys);
   server.Start();
 
   while (1) {
@@ -10,8 +10,8 @@ class ThreshServer : public olc::net::server_interface<ThreshMsgTypes> {
 public:
   OPENFHE_DEBUG_FLAG(false);
 
-  ThreshServer(uint16_t nPort)
-      : olc::net::server_interface<ThreshMsgTypes>(nPort),
+  ThreshServer(uint16_t nPort, size_t nThreads = 1, size_t nWorkers = 0)
+      : olc::net::server_interface<ThreshMsgTypes>(nPort, nThreads, nWorkers),
         A_Rnd1PubKeyRecd(false), A_evalMultKeyRecd(false),
         B_Rnd2PublicKeyRecd(false), B_evalMultKeyABRecd(false),
         B_evalMultKeyBABRecd(false), A_evalMultFinalRecd(false) {
@@ -20,6 +20,13 @@ public:
     InitializeCC();
   }
 
+  // handlers may still be running on the worker pool
+  virtual ~ThreshServer() { Stop(); }
+
+  // send round 2 keys as deltas against the round 1 keys the client holds.
+  // Keys from clients are expanded either way.
+  void EnableDeltaKeys(bool bEnable) { m_bDeltaKeys = bEnable; }
+
 protected:
   virtual bool OnClientConnect(
       std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
@@ -46,6 +53,21 @@ protected:
   virtual void
   OnMessage(std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
             olc::net::message<ThreshMsgTypes> &msg) {
+    // handlers for different clients may run at once on the worker pool,
+    // so the server state is guarded by m_muxState as a whole. The
+    // evaluations let go of it while they compute, and the large key maps
+    // are read and streamed with it released.
+    std::unique_lock<std::mutex> lock(m_muxState);
+    ProcessMessage(client, msg, lock);
+  }
+
+  // A request for something not received yet is parked, and handled again
+  // by Notify() when it arrives, instead of being nacked for the client to
+  // ask again later. Called holding m_muxState through lock.
+  void
+  ProcessMessage(std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+                 olc::net::message<ThreshMsgTypes> &msg,
+                 std::unique_lock<std::mutex> &lock) {
     switch (msg.header.id) {
     case ThreshMsgTypes::RequestCC:
       std::cout << "[" << client->GetID() << "]: RequestCC\n";
@@ -65,6 +87,7 @@ protected:
         ackMsg.header.id = ThreshMsgTypes::AckRnd1PubKey;
         client->Send(ackMsg);
       }
+      Notify(ThreshMsgTypes::RequestRnd1PubKey, lock);
       break;
 
     case ThreshMsgTypes::SendRnd1evalMultKey:
@@ -80,6 +103,7 @@ protected:
         ackMsg.header.id = ThreshMsgTypes::AckRnd1evalMultKey;
         client->Send(ackMsg);
       }
+      Notify(ThreshMsgTypes::RequestRnd1evalMultKey, lock);
       break;
 
     case ThreshMsgTypes::SendRnd1evalSumKeys:
@@ -87,13 +111,14 @@ protected:
       std::cout << "[" << client->GetID() << "]: SendRnd1EvalSumKeys\n";
       // receive the evalsumkeys from this client,
 
-      RecvClientAevalSumKeys(client, msg);
+      RecvClientAevalSumKeys(client, msg, lock);
       {
         // send acknowledgement
         olc::net::message<ThreshMsgTypes> ackMsg;
         ackMsg.header.id = ThreshMsgTypes::AckRnd1evalSumKeys;
         client->Send(ackMsg);
       }
+      Notify(ThreshMsgTypes::RequestRnd1evalSumKeys, lock);
       break;
 
     case ThreshMsgTypes::SendRnd2SharedKey:
@@ -102,13 +127,21 @@ protected:
       // receive the public key from this client, this is the shared public
       // key that the plaintexts will be encrypted with.
 
-      RecvClientBPublicKey(client, msg);
+      if (!RecvClientBPublicKey(client, msg)) {
+        // a delta that does not fit the round 1 key we hold, the client
+        // sends the key again in full
+        olc::net::message<ThreshMsgTypes> nackMsg;
+        nackMsg.header.id = ThreshMsgTypes::NackRnd2SharedKey;
+        client->Send(nackMsg);
+        break;
+      }
       {
         // send acknowledgement
         olc::net::message<ThreshMsgTypes> ackMsg;
         ackMsg.header.id = ThreshMsgTypes::AckRnd2SharedKey;
         client->Send(ackMsg);
       }
+      Notify(ThreshMsgTypes::RequestRnd2SharedKey, lock);
       break;
 
     case ThreshMsgTypes::SendRnd2EvalMultAB:
@@ -117,13 +150,21 @@ protected:
       // receive the evalmultAB key from this client, send this to other
       // client for Round 3 key generation of evalMultFinal
 
-      RecvClientBevalMultKeyAB(client, msg);
+      if (!RecvClientBevalMultKeyAB(client, msg)) {
+        // a delta that does not fit the round 1 key we hold, the client
+        // sends the key again in full
+        olc::net::message<ThreshMsgTypes> nackMsg;
+        nackMsg.header.id = ThreshMsgTypes::NackRnd2EvalMultAB;
+        client->Send(nackMsg);
+        break;
+      }
       {
         // send acknowledgement
         olc::net::message<ThreshMsgTypes> ackMsg;
         ackMsg.header.id = ThreshMsgTypes::AckRnd2EvalMultAB;
         client->Send(ackMsg);
       }
+      Notify(ThreshMsgTypes::RequestRnd2EvalMultAB, lock);
       break;
 
     case ThreshMsgTypes::SendRnd2EvalMultBAB:
@@ -139,6 +180,7 @@ protected:
         ackMsg.header.id = ThreshMsgTypes::AckRnd2EvalMultBAB;
         client->Send(ackMsg);
       }
+      Notify(ThreshMsgTypes::RequestRnd2EvalMultBAB, lock);
       break;
 
     case ThreshMsgTypes::SendRnd2EvalSumKeysJoin:
@@ -147,13 +189,15 @@ protected:
       // receive the evalsumkeysjoin from this client. This is the final
       // evaluation key for vector sum
 
-      RecvClientBevalSumKeysJoin(client, msg);
+      RecvClientBevalSumKeysJoin(client, msg, lock);
       {
         // send acknowledgement
         olc::net::message<ThreshMsgTypes> ackMsg;
         ackMsg.header.id = ThreshMsgTypes::AckRnd2EvalSumKeysJoin;
         client->Send(ackMsg);
       }
+      Notify(ThreshMsgTypes::RequestRnd2EvalSumKeysJoin, lock);
+      Notify(ThreshMsgTypes::RequestSumCT, lock);
       break;
 
     case ThreshMsgTypes::SendRnd3EvalMultFinal:
@@ -169,46 +213,50 @@ protected:
         ackMsg.header.id = ThreshMsgTypes::AckRnd3EvalMultFinal;
         client->Send(ackMsg);
       }
+      Notify(ThreshMsgTypes::RequestRnd3EvalMultFinal, lock);
+      Notify(ThreshMsgTypes::RequestMultCT, lock);
       break;
 
     case ThreshMsgTypes::RequestRnd1PubKey:
       std::cout << "[" << client->GetID() << "]: RequestRnd1PubKey\n";
-      SendClientRnd1PubKey(client); // this queues next task
+      SendClientRnd1PubKey(client, msg.header); // this queues next task
       break;
 
     case ThreshMsgTypes::RequestRnd1evalMultKey:
       std::cout << "[" << client->GetID() << "]: RequestRnd1evalMultKey\n";
-      SendClientRnd1evalMultKey(client); // this queues next task
+      SendClientRnd1evalMultKey(client, msg.header); // this queues next task
       break;
 
     case ThreshMsgTypes::RequestRnd1evalSumKeys:
       std::cout << "[" << client->GetID() << "]: RequestRnd1evalSumKeys\n";
-      SendClientRnd1evalSumKeys(client); // this queues next task
+      // this queues next task
+      SendClientRnd1evalSumKeys(client, msg.header, lock);
       break;
 
     case ThreshMsgTypes::RequestRnd2SharedKey:
       std::cout << "[" << client->GetID() << "]: RequestRnd2SharedKey\n";
-      SendClientRnd2PubKey(client); // this queues next task
+      SendClientRnd2PubKey(client, msg.header); // this queues next task
       break;
 
     case ThreshMsgTypes::RequestRnd2EvalMultAB:
       std::cout << "[" << client->GetID() << "]: RequestRnd2EvalMultAB\n";
-      SendClientRnd2evalMultKeyAB(client); // this queues next task
+      SendClientRnd2evalMultKeyAB(client, msg.header); // this queues next task
       break;
 
     case ThreshMsgTypes::RequestRnd2EvalMultBAB:
       std::cout << "[" << client->GetID() << "]: RequestRnd2EvalMultBAB\n";
-      SendClientRnd2evalMultKeyBAB(client); // this queues next task
+      SendClientRnd2evalMultKeyBAB(client, msg.header); // this queues next task
       break;
 
     case ThreshMsgTypes::RequestRnd2EvalSumKeysJoin:
       std::cout << "[" << client->GetID() << "]: RequestRnd2EvalSumKeysJoin\n";
-      SendClientRnd2evalSumKeysJoin(client); // this queues next task
+      // this queues next task
+      SendClientRnd2evalSumKeysJoin(client, msg.header, lock);
       break;
 
     case ThreshMsgTypes::RequestRnd3EvalMultFinal:
       std::cout << "[" << client->GetID() << "]: RequestRnd3evalMultFinal\n";
-      SendClientRnd3evalMultFinal(client); // this queues next task
+      SendClientRnd3evalMultFinal(client, msg.header); // this queues next task
       break;
 
     case ThreshMsgTypes::SendCT1:
@@ -224,6 +272,7 @@ protected:
         ackMsg.header.id = ThreshMsgTypes::AckCT1;
         client->Send(ackMsg);
       }
+      NotifyCTs(lock);
       break;
 
     case ThreshMsgTypes::SendCT2:
@@ -238,6 +287,7 @@ protected:
         ackMsg.header.id = ThreshMsgTypes::AckCT2;
         client->Send(ackMsg);
       }
+      NotifyCTs(lock);
       break;
 
     case ThreshMsgTypes::SendCT3:
@@ -252,52 +302,53 @@ protected:
         ackMsg.header.id = ThreshMsgTypes::AckCT3;
         client->Send(ackMsg);
       }
+      NotifyCTs(lock);
       break;
 
     case ThreshMsgTypes::RequestAddCT:
       std::cout << "[" << client->GetID() << "]: RequestAddCT\n";
       // Compute the addition ciphertext and send it.
-      SendClientAddCT(client);
+      SendClientAddCT(client, msg.header);
       break;
 
     case ThreshMsgTypes::RequestMultCT:
       std::cout << "[" << client->GetID() << "]: RequestMultCT\n";
-      SendClientMultCT(client);
+      SendClientMultCT(client, msg.header, lock);
       break;
 
     case ThreshMsgTypes::RequestSumCT:
       std::cout << "[" << client->GetID() << "]: RequestSumCT\n";
-      SendClientSumCT(client);
+      SendClientSumCT(client, msg.header, lock);
       break;
 
     case ThreshMsgTypes::RequestDecryptLeadAdd:
       std::cout << "[" << client->GetID() << "]: RequestDecryptLeadAdd\n";
-      SendClientDecryptLeadAdd(client);
+      SendClientDecryptLeadAdd(client, msg.header);
       break;
 
     case ThreshMsgTypes::RequestDecryptLeadMult:
       std::cout << "[" << client->GetID() << "]: RequestDecryptLeadMult\n";
-      SendClientDecryptLeadMult(client);
+      SendClientDecryptLeadMult(client, msg.header);
       break;
 
     case ThreshMsgTypes::RequestDecryptLeadSum:
       std::cout << "[" << client->GetID() << "]: RequestDecryptLeadSum\n";
-      SendClientDecryptLeadSum(client);
+      SendClientDecryptLeadSum(client, msg.header);
       break;
 
     case ThreshMsgTypes::RequestDecryptMainAdd:
       std::cout << "[" << client->GetID() << "]: RequestDecryptMainAdd\n";
-      SendClientDecryptMainAdd(client);
+      SendClientDecryptMainAdd(client, msg.header);
       break;
 
     case ThreshMsgTypes::RequestDecryptMainMult:
       std::cout << "[" << client->GetID() << "]: RequestDecryptMainMult\n";
-      SendClientDecryptMainMult(client);
+      SendClientDecryptMainMult(client, msg.header);
       break;
 
     case ThreshMsgTypes::RequestDecryptMainSum:
       std::cout << "[" << client->GetID() << "]: RequestDecryptMainSum\n";
-      SendClientDecryptMainSum(client);
+      SendClientDecryptMainSum(client, msg.header);
       break;
 
     case ThreshMsgTypes::SendDecryptPartialMainAdd:
@@ -312,6 +363,7 @@ protected:
         ackMsg.header.id = ThreshMsgTypes::AckPartialMainAdd;
         client->Send(ackMsg);
       }
+      Notify(ThreshMsgTypes::RequestDecryptMainAdd, lock);
       break;
     case ThreshMsgTypes::SendDecryptPartialLeadAdd:
 
@@ -325,6 +377,7 @@ protected:
         ackMsg.header.id = ThreshMsgTypes::AckPartialLeadAdd;
         client->Send(ackMsg);
       }
+      Notify(ThreshMsgTypes::RequestDecryptLeadAdd, lock);
       break;
 
     case ThreshMsgTypes::SendDecryptPartialMainMult:
@@ -339,6 +392,7 @@ protected:
         ackMsg.header.id = ThreshMsgTypes::AckPartialMainMult;
         client->Send(ackMsg);
       }
+      Notify(ThreshMsgTypes::RequestDecryptMainMult, lock);
       break;
 
     case ThreshMsgTypes::SendDecryptPartialLeadMult:
@@ -353,6 +407,7 @@ protected:
         ackMsg.header.id = ThreshMsgTypes::AckPartialLeadMult;
         client->Send(ackMsg);
       }
+      Notify(ThreshMsgTypes::RequestDecryptLeadMult, lock);
       break;
 
     case ThreshMsgTypes::SendDecryptPartialMainSum:
@@ -367,6 +422,7 @@ protected:
         ackMsg.header.id = ThreshMsgTypes::AckPartialMainSum;
         client->Send(ackMsg);
       }
+      Notify(ThreshMsgTypes::RequestDecryptMainSum, lock);
       break;
 
     case ThreshMsgTypes::SendDecryptPartialLeadSum:
@@ -381,6 +437,7 @@ protected:
         ackMsg.header.id = ThreshMsgTypes::AckPartialLeadSum;
         client->Send(ackMsg);
       }
+      Notify(ThreshMsgTypes::RequestDecryptLeadSum, lock);
       break;
 
     case ThreshMsgTypes::DisconnectClient:
@@ -395,6 +452,33 @@ protected:
     }
   }
 
+  // holds on to a request until Notify() for its id
+  void Park(std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+            const olc::net::message_header<ThreshMsgTypes> &request) {
+    std::cout << "[SERVER] parking " << request.id << " from ["
+              << client->GetID() << "]\n";
+    m_waiting.Subscribe(request.id, client, request);
+  }
+
+  // handles the requests parked waiting for what just arrived. An
+  // evaluation may return with the lock released, take it back before the
+  // next one.
+  void Notify(ThreshMsgTypes request, std::unique_lock<std::mutex> &lock) {
+    m_waiting.Notify(request, [this, &lock](auto waiter, auto &msg) {
+      if (!lock.owns_lock()) {
+        lock.lock();
+      }
+      ProcessMessage(waiter, msg, lock);
+    });
+  }
+
+  // the evaluations need all three CTs, try them again as each one arrives
+  void NotifyCTs(std::unique_lock<std::mutex> &lock) {
+    Notify(ThreshMsgTypes::RequestAddCT, lock);
+    Notify(ThreshMsgTypes::RequestMultCT, lock);
+    Notify(ThreshMsgTypes::RequestSumCT, lock);
+  }
+
   void InitializeCC(void) {
     PROFILELOG("[SERVER] Initializing");
     TimeVar t; // time benchmarking variables
@@ -418,247 +502,162 @@ protected:
     m_serverCC->Enable(MULTIPARTY);
 
     PROFILELOG("[SERVER]: elapsed time " << TOC_MS(t) << "msec.");
+
+    // the context does not change from here on, so it is serialized once
+    // and every RequestCC is answered with the same body
+    olc::net::message<ThreshMsgTypes> msg;
+    {
+      olc::net::message_ostream<ThreshMsgTypes> os(msg);
+      Serial::Serialize(m_serverCC, os, SerType::BINARY);
+    }
+    msg.header.id = ThreshMsgTypes::SendCC;
+    m_ccReply = olc::net::shared_message<ThreshMsgTypes>(std::move(msg));
   }
 
   void
   SendClientCC(std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    std::string s;
-    std::ostringstream os(s);
     OPENFHE_DEBUG("[SERVER]: sending cryptocontext to [" << client->GetID()
                                                          << "]:");
-    Serial::Serialize(m_serverCC, os, SerType::BINARY);
-
-    olc::net::message<ThreshMsgTypes> msg;
-    msg.header.id = ThreshMsgTypes::SendCC;
-    msg << os.str(); // push the string onto the message.
-
-    client->Send(msg);
+    // the body made by InitializeCC is shared, not copied
+    client->Send(m_ccReply);
   }
 
   void SendClientRnd1PubKey(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    std::string s;
-    std::ostringstream os(s);
-    olc::net::message<ThreshMsgTypes> msg;
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request) {
     if (!A_Rnd1PubKeyRecd) {
-      std::cout << "[SERVER] sending NackRnd1PubKey to [" << client->GetID()
-                << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackRnd1PubKey;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
     OPENFHE_DEBUG("[SERVER]: sending Round 1 Public Key to [" << client->GetID()
                                                               << "]:");
-    Serial::Serialize(A_Rnd1PublicKey, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendRnd1PubKey;
-    msg << os.str(); // push the string onto the message.
-
-    client->Send(msg);
+    client->Send(A_Rnd1PublicKey.Message());
   }
 
   void SendClientRnd1evalMultKey(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    std::string s;
-    std::ostringstream os(s);
-    olc::net::message<ThreshMsgTypes> msg;
-
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request) {
     if (!A_evalMultKeyRecd) {
-      std::cout << "[SERVER] sending NackRnd1evalMultKey to ["
-                << client->GetID() << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackRnd1evalMultKey;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
     OPENFHE_DEBUG("[SERVER]: sending Round 1 EvalMultKey to ["
                   << client->GetID() << "]:");
-    Serial::Serialize(A_evalMultKey, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendRnd1evalMultKey;
-    msg << os.str(); // push the string onto the message.
-
-    client->Send(msg);
+    client->Send(A_evalMultKey.Message());
   }
 
   void SendClientRnd1evalSumKeys(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    std::string s;
-    std::ostringstream os(s);
-    olc::net::message<ThreshMsgTypes> msg;
-
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request,
+      std::unique_lock<std::mutex> &lock) {
     if (!A_evalSumKeys) {
-      std::cout << "[SERVER] sending NackRnd1evalSumKeys to ["
-                << client->GetID() << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackRnd1evalSumKeys;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
+    // the map is never changed once stored, stream our own reference to it
+    // without holding up the other clients while this one drains it
+    auto keys = A_evalSumKeys;
+    lock.unlock();
+
     OPENFHE_DEBUG("[SERVER]: sending Round 1 EvalSumKeys to ["
                   << client->GetID() << "]:");
-    Serial::Serialize(A_evalSumKeys, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendRnd1evalSumKeys;
-    msg << os.str(); // push the string onto the message.
-
-    client->Send(msg);
+    // The key map is large, stream it out in chunks as it is serialized
+    olc::net::message_chunk_ostream<ThreshMsgTypes> os(
+        *client, ThreshMsgTypes::SendRnd1evalSumKeys);
+    Serial::Serialize(keys, os, SerType::BINARY);
+    os.close();
   }
 
   void SendClientRnd2PubKey(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    std::string s;
-    std::ostringstream os(s);
-    olc::net::message<ThreshMsgTypes> msg;
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request) {
     if (!B_Rnd2PublicKeyRecd) {
-      std::cout << "[SERVER] sending NackRnd2SharedKey to [" << client->GetID()
-                << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackRnd2SharedKey;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
     OPENFHE_DEBUG("[SERVER]: sending Round 2 Public Key to [" << client->GetID()
                                                               << "]:");
-    Serial::Serialize(B_Rnd2PublicKey, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendRnd2SharedKey;
-    msg << os.str(); // push the string onto the message.
-
-    client->Send(msg);
+    client->Send(B_Rnd2PublicKey.Message());
   }
 
   void SendClientRnd2evalMultKeyAB(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    std::string s;
-    std::ostringstream os(s);
-    olc::net::message<ThreshMsgTypes> msg;
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request) {
     if (!B_evalMultKeyABRecd) {
-      std::cout << "[SERVER] sending NackRnd2EvalMultAB to [" << client->GetID()
-                << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackRnd2EvalMultAB;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
     OPENFHE_DEBUG("[SERVER]: sending Round 2 EvalMultKeyAB to ["
                   << client->GetID() << "]:");
-    Serial::Serialize(B_evalMultKeyAB, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendRnd2EvalMultAB;
-    msg << os.str(); // push the string onto the message.
-
-    client->Send(msg);
+    client->Send(B_evalMultKeyAB.Message());
   }
 
   void SendClientRnd2evalMultKeyBAB(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    std::string s;
-    std::ostringstream os(s);
-    olc::net::message<ThreshMsgTypes> msg;
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request) {
     if (!B_evalMultKeyBABRecd) {
-      std::cout << "[SERVER] sending NackRnd2EvalMultBAB to ["
-                << client->GetID() << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackRnd2EvalMultBAB;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
     OPENFHE_DEBUG("[SERVER]: sending Round 2 EvalMultKeyBAB to ["
                   << client->GetID() << "]:");
-    Serial::Serialize(B_evalMultKeyBAB, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendRnd2EvalMultBAB;
-    msg << os.str(); // push the string onto the message.
-
-    client->Send(msg);
+    client->Send(B_evalMultKeyBAB.Message());
   }
 
   void SendClientRnd2evalSumKeysJoin(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    std::string s;
-    std::ostringstream os(s);
-    olc::net::message<ThreshMsgTypes> msg;
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request,
+      std::unique_lock<std::mutex> &lock) {
     if (!B_evalSumKeysJoin) {
-      std::cout << "[SERVER] sending NackRnd2EvalSumKeysJoin to ["
-                << client->GetID() << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackRnd2EvalSumKeysJoin;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
+    // the map is never changed once stored, stream our own reference to it
+    // without holding up the other clients while this one drains it
+    auto keys = B_evalSumKeysJoin;
+    lock.unlock();
+
     OPENFHE_DEBUG("[SERVER]: sending Round 2 EvalSumKeysJoin to ["
                   << client->GetID() << "]:");
-    Serial::Serialize(B_evalSumKeysJoin, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendRnd2EvalSumKeysJoin;
-    msg << os.str(); // push the string onto the message.
-
-    client->Send(msg);
+    olc::net::message_chunk_ostream<ThreshMsgTypes> os(
+        *client, ThreshMsgTypes::SendRnd2EvalSumKeysJoin);
+    Serial::Serialize(keys, os, SerType::BINARY);
+    os.close();
   }
 
   void SendClientRnd3evalMultFinal(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    std::string s;
-    std::ostringstream os(s);
-    olc::net::message<ThreshMsgTypes> msg;
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request) {
     if (!A_evalMultFinalRecd) {
-      std::cout << "[SERVER] sending NackRnd3evalMultFinal to ["
-                << client->GetID() << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackRnd3evalMultFinal;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
     OPENFHE_DEBUG("[SERVER]: sending Round 3 evalMultFinal to ["
                   << client->GetID() << "]:");
-    Serial::Serialize(A_evalMultFinal, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendRnd3EvalMultFinal;
-    msg << os.str(); // push the string onto the message.
-
-    client->Send(msg);
+    client->Send(A_evalMultFinal.Message());
   }
 
   void
   SendClientCT(std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+               const olc::net::message_header<ThreshMsgTypes> &request,
                int num) {
-    std::string s;
-    std::ostringstream os(s);
-    olc::net::message<ThreshMsgTypes> msg;
-    if (!B_CTreceived[num]) {
-      if (num == 0) {
-        std::cout << "[SERVER] sending NackCT1 to [" << client->GetID()
-                  << "]:\n";
-        msg.header.id = ThreshMsgTypes::NackCT1;
-      } else if (num == 1) {
-        std::cout << "[SERVER] sending NackCT2 to [" << client->GetID()
-                  << "]:\n";
-        msg.header.id = ThreshMsgTypes::NackCT2;
-      } else if (num == 2) {
-        std::cout << "[SERVER] sending NackCT3 to [" << client->GetID()
-                  << "]:\n";
-        msg.header.id = ThreshMsgTypes::NackCT3;
-      }
-      client->Send(msg);
+    // CTs are numbered in the order they arrived
+    if (size_t(num) >= B_CTreceived.size() || !B_CTreceived[num]) {
+      Park(client, request);
       return;
     }
 
     OPENFHE_DEBUG("[SERVER]: sending CT" << num << " to [" << client->GetID()
                                          << "]:");
-    Serial::Serialize(B_CipherTexts[num], os, SerType::BINARY);
-
-    if (num == 0) {
-      msg.header.id = ThreshMsgTypes::SendCT1;
-    } else if (num == 1) {
-      msg.header.id = ThreshMsgTypes::SendCT2;
-    } else if (num == 2) {
-      msg.header.id = ThreshMsgTypes::SendCT3;
-    }
-    msg << os.str(); // push the string onto the message.
-
-    client->Send(msg);
+    client->Send(B_CipherTexts[num].Message());
   }
 
   void RecvClientAPublicKey(
@@ -673,13 +672,17 @@ protected:
     OPENFHE_DEBUG("[SERVER] read Rnd1 public key of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
-    Serial::Deserialize(A_Rnd1PublicKey, is, SerType::BINARY);
+    PubKey publicKey;
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(publicKey, is, SerType::BINARY);
+    }
+    msg.header.id = ThreshMsgTypes::SendRnd1PubKey;
+    A_Rnd1PublicKey.Set(std::move(publicKey), std::move(msg));
     A_Rnd1PubKeyRecd = true;
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
@@ -697,13 +700,17 @@ protected:
     OPENFHE_DEBUG("[SERVER] read Rnd1 evalmultkey of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
-    Serial::Deserialize(A_evalMultKey, is, SerType::BINARY);
+    EvKey evalKey;
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(evalKey, is, SerType::BINARY);
+    }
+    msg.header.id = ThreshMsgTypes::SendRnd1evalMultKey;
+    A_evalMultKey.Set(std::move(evalKey), std::move(msg));
     A_evalMultKeyRecd = true;
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
@@ -711,7 +718,8 @@ protected:
 
   void RecvClientAevalSumKeys(
       std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
-      olc::net::message<ThreshMsgTypes> &msg) {
+      olc::net::message<ThreshMsgTypes> &msg,
+      std::unique_lock<std::mutex> &lock) {
     // receive the evalsumkeys from this client,
     // and store it in the data structure
     // note a more complex server could store the key in a
@@ -721,18 +729,25 @@ protected:
     OPENFHE_DEBUG("[SERVER] read Rnd1 evalsumkeys of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
+    // deserializing the map takes a while, the other clients only wait for
+    // it to deserialize something of their own
+    std::shared_ptr<std::map<usint, EvKey>> keys;
+    lock.unlock();
     OPENFHE_DEBUG("[SERVER] Deserialize");
-    Serial::Deserialize(A_evalSumKeys, is, SerType::BINARY);
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(keys, is, SerType::BINARY);
+    }
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
+    lock.lock();
+    A_evalSumKeys = keys;
   }
 
-  void RecvClientBPublicKey(
+  bool RecvClientBPublicKey(
       std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
       olc::net::message<ThreshMsgTypes> &msg) {
     // receive the public key from this client,
@@ -745,19 +760,32 @@ protected:
                                                          << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // the key may come as a delta against the round 1 key we hold
+    if (!ExpandDelta(msg, A_Rnd1PublicKey.Bytes())) {
+      return false;
+    }
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
-    Serial::Deserialize(B_Rnd2PublicKey, is, SerType::BINARY);
+    PubKey publicKey;
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(publicKey, is, SerType::BINARY);
+    }
+    msg.header.id = ThreshMsgTypes::SendRnd2SharedKey;
+    B_Rnd2PublicKey.Set(std::move(publicKey), std::move(msg));
+    if (m_bDeltaKeys) {
+      // same "a" polynomial as the round 1 key the clients have
+      B_Rnd2PublicKey.DeltaCompress(A_Rnd1PublicKey.Bytes());
+    }
     B_Rnd2PublicKeyRecd = true;
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
+    return true;
   }
 
-  void RecvClientBevalMultKeyAB(
+  bool RecvClientBevalMultKeyAB(
       std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
       olc::net::message<ThreshMsgTypes> &msg) {
     // receive the evalMultAB key from this client,
@@ -770,16 +798,29 @@ protected:
                                                                 << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // the key may come as a delta against the round 1 key we hold
+    if (!ExpandDelta(msg, A_evalMultKey.Bytes())) {
+      return false;
+    }
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
-    Serial::Deserialize(B_evalMultKeyAB, is, SerType::BINARY);
+    EvKey evalKey;
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(evalKey, is, SerType::BINARY);
+    }
+    msg.header.id = ThreshMsgTypes::SendRnd2EvalMultAB;
+    B_evalMultKeyAB.Set(std::move(evalKey), std::move(msg));
+    if (m_bDeltaKeys) {
+      // same "a" vector as the round 1 key the clients have
+      B_evalMultKeyAB.DeltaCompress(A_evalMultKey.Bytes());
+    }
     B_evalMultKeyABRecd = true;
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
+    return true;
   }
 
   void RecvClientBevalMultKeyBAB(
@@ -795,13 +836,17 @@ protected:
                                                              << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
-    Serial::Deserialize(B_evalMultKeyBAB, is, SerType::BINARY);
+    EvKey evalKey;
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(evalKey, is, SerType::BINARY);
+    }
+    msg.header.id = ThreshMsgTypes::SendRnd2EvalMultBAB;
+    B_evalMultKeyBAB.Set(std::move(evalKey), std::move(msg));
     B_evalMultKeyBABRecd = true;
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
@@ -809,7 +854,8 @@ protected:
 
   void RecvClientBevalSumKeysJoin(
       std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
-      olc::net::message<ThreshMsgTypes> &msg) {
+      olc::net::message<ThreshMsgTypes> &msg,
+      std::unique_lock<std::mutex> &lock) {
     // receive the evalsumkeysjoin from this client,
     // and store it in the data structure
     // note a more complex server could store the key in a
@@ -820,15 +866,22 @@ protected:
                                                               << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
+    // deserializing the map takes a while, the other clients only wait for
+    // it to deserialize something of their own
+    std::shared_ptr<std::map<usint, EvKey>> keys;
+    lock.unlock();
     OPENFHE_DEBUG("[SERVER] Deserialize");
-    Serial::Deserialize(B_evalSumKeysJoin, is, SerType::BINARY);
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(keys, is, SerType::BINARY);
+    }
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
+    lock.lock();
+    B_evalSumKeysJoin = keys;
   }
 
   void RecvClientAevalMultFinal(
@@ -844,13 +897,17 @@ protected:
                                                             << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
-    Serial::Deserialize(A_evalMultFinal, is, SerType::BINARY);
+    EvKey evalKey;
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(evalKey, is, SerType::BINARY);
+    }
+    msg.header.id = ThreshMsgTypes::SendRnd3EvalMultFinal;
+    A_evalMultFinal.Set(std::move(evalKey), std::move(msg));
     A_evalMultFinalRecd = true;
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
@@ -869,16 +926,29 @@ protected:
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
 
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
 
-    Serial::Deserialize(ct, is, SerType::BINARY);
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(ct, is, SerType::BINARY);
+    }
 
-    B_CipherTexts.push_back(ct);
+    // sent on as CT1, CT2 and CT3, in the order they arrived
+    ThreshMsgTypes id{};
+    size_t num = B_CipherTexts.size();
+    if (num == 0) {
+      id = ThreshMsgTypes::SendCT1;
+    } else if (num == 1) {
+      id = ThreshMsgTypes::SendCT2;
+    } else if (num == 2) {
+      id = ThreshMsgTypes::SendCT3;
+    }
+    B_CipherTexts.emplace_back();
+    msg.header.id = id;
+    B_CipherTexts.back().Set(std::move(ct), std::move(msg));
 
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
@@ -889,26 +959,14 @@ protected:
       std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
     CT ciphertextAdd12;
     CT ciphertextAdd123;
-    olc::net::message<ThreshMsgTypes> msg;
-    if (!B_CTreceived[0]) {
-      std::cout << "[SERVER] sending NackCT1 to [" << client->GetID() << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackCT1;
-      client->Send(msg);
-      return ciphertextAdd123;
-    } else if (!B_CTreceived[1]) {
-      std::cout << "[SERVER] sending NackCT2 to [" << client->GetID() << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackCT2;
-      client->Send(msg);
-      return ciphertextAdd123;
-
-    } else if (!B_CTreceived[2]) {
-      std::cout << "[SERVER] sending NackCT3 to [" << client->GetID() << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackCT3;
-      client->Send(msg);
+    // wait for all three, SendClientAddCT() parks the request until then
+    if (B_CipherTexts.size() < 3) {
       return ciphertextAdd123;
     }
-    ciphertextAdd12 = m_serverCC->EvalAdd(B_CipherTexts[0], B_CipherTexts[1]);
-    ciphertextAdd123 = m_serverCC->EvalAdd(ciphertextAdd12, B_CipherTexts[2]);
+    ciphertextAdd12 = m_serverCC->EvalAdd(B_CipherTexts[0].Get(),
+                                           B_CipherTexts[1].Get());
+    ciphertextAdd123 = m_serverCC->EvalAdd(ciphertextAdd12,
+                                           B_CipherTexts[2].Get());
 
     EvalAddCTDone = true;
     // auto ciphertextEvalSum = cc->EvalSum(ciphertext3, batchSize);
@@ -916,256 +974,209 @@ protected:
   }
 
   CT EvaluateMultCiphertext(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    m_serverCC->InsertEvalMultKey({ThreshServer::A_evalMultFinal});
-
-    auto ciphertextMultTemp =
-        m_serverCC->EvalMult(B_CipherTexts[0], B_CipherTexts[2]);
-    auto ciphertextMult = m_serverCC->ModReduce(ciphertextMultTemp);
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      std::unique_lock<std::mutex> &lock) {
+    // take the inputs, then let the other clients carry on while we compute
+    EvKey evalMultFinal = A_evalMultFinal.Get();
+    CT ciphertext1 = B_CipherTexts[0].Get();
+    CT ciphertext3 = B_CipherTexts[2].Get();
+    lock.unlock();
+
+    CT ciphertextMult;
+    {
+      // the eval keys live in a map inside OpenFHE
+      std::scoped_lock evalLock(m_muxEval);
+      m_serverCC->InsertEvalMultKey({evalMultFinal});
+
+      auto ciphertextMultTemp = m_serverCC->EvalMult(ciphertext1, ciphertext3);
+      ciphertextMult = m_serverCC->ModReduce(ciphertextMultTemp);
+    }
 
+    lock.lock();
     EvalMultCTDone = true;
     // auto ciphertextEvalSum = cc->EvalSum(ciphertext3, batchSize);
     return ciphertextMult;
   }
 
   void SendClientAddCT(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request) {
     olc::net::message<ThreshMsgTypes> msg;
-    // if the PrivateKey does not yet exist, send a Nack
-
+    // if the ciphertexts do not yet exist, wait for them
     EvalAddCT = EvaluateAddCiphertext(client);
     if (!EvalAddCTDone) {
-      std::cout << "[SERVER] sending NackAddCT to [" << client->GetID()
-                << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackAddCT;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
-    std::string s;
-    std::ostringstream os(s);
     OPENFHE_DEBUG("[SERVER]: sending eval add CT to [" << client->GetID()
                                                        << "]:");
+    olc::net::message_ostream<ThreshMsgTypes> os(msg);
     Serial::Serialize(EvalAddCT, os, SerType::BINARY);
 
     msg.header.id = ThreshMsgTypes::SendAddCT;
-    msg << os.str(); // push the string onto the message.
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
     client->Send(msg);
   }
 
   void SendClientMultCT(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request,
+      std::unique_lock<std::mutex> &lock) {
     olc::net::message<ThreshMsgTypes> msg;
-    // if the PrivateKey does not yet exist, send a Nack
-    EvalMultCT = EvaluateMultCiphertext(client);
-    if (!EvalMultCTDone) {
-      std::cout << "[SERVER] sending NackMultCT to [" << client->GetID()
-                << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackMultCT;
-      client->Send(msg);
+    // if the final eval mult key or the ciphertexts do not yet exist, wait
+    // for them
+    if (!A_evalMultFinalRecd || B_CipherTexts.size() < 3) {
+      Park(client, request);
       return;
     }
+    EvalMultCT = EvaluateMultCiphertext(client, lock);
 
-    std::string s;
-    std::ostringstream os(s);
     OPENFHE_DEBUG("[SERVER]: sending eval mult CT to [" << client->GetID()
                                                         << "]:");
-    Serial::Serialize(EvalMultCT, os, SerType::BINARY);
+    olc::net::message_ostream<ThreshMsgTypes> os(msg);
+    CT evalMultCT = EvalMultCT;
+    lock.unlock();
+    Serial::Serialize(evalMultCT, os, SerType::BINARY);
 
     msg.header.id = ThreshMsgTypes::SendMultCT;
-    msg << os.str(); // push the string onto the message.
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
     client->Send(msg);
   }
 
   CT EvaluateSumCiphertext(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    m_serverCC->InsertEvalSumKey(B_evalSumKeysJoin);
-
-    // compute ciphertextSum[0] = ciphertext3[0]+...+ciphertext[batchsize-1]
-    // compute ciphertextSum[1] = ciphertext3[1]+...+ciphertext3[batchsize] and
-    // so on.
-    auto ciphertextEvalSum = m_serverCC->EvalSum(B_CipherTexts[2], batchSize);
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      std::unique_lock<std::mutex> &lock) {
+    // take the inputs, then let the other clients carry on while we compute
+    auto evalSumKeysJoin = B_evalSumKeysJoin;
+    CT ciphertext3 = B_CipherTexts[2].Get();
+    lock.unlock();
+
+    CT ciphertextEvalSum;
+    {
+      // the eval keys live in a map inside OpenFHE
+      std::scoped_lock evalLock(m_muxEval);
+      m_serverCC->InsertEvalSumKey(evalSumKeysJoin);
+
+      // compute ciphertextSum[0] = ciphertext3[0]+...+ciphertext[batchsize-1]
+      // compute ciphertextSum[1] = ciphertext3[1]+...+ciphertext3[batchsize]
+      // and so on.
+      ciphertextEvalSum = m_serverCC->EvalSum(ciphertext3, batchSize);
+    }
 
+    lock.lock();
     EvalSumCTDone = true;
     return ciphertextEvalSum;
   }
 
   void SendClientSumCT(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request,
+      std::unique_lock<std::mutex> &lock) {
     olc::net::message<ThreshMsgTypes> msg;
-    // if the PrivateKey does not yet exist, send a Nack
-    EvalSumCT = EvaluateSumCiphertext(client);
-    if (!EvalSumCTDone) {
-      std::cout << "[SERVER] sending NackSumCT to [" << client->GetID()
-                << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackSumCT;
-      client->Send(msg);
+    // if the joint eval sum keys or the ciphertexts do not yet exist, wait
+    // for them
+    if (!B_evalSumKeysJoin || B_CipherTexts.size() < 3) {
+      Park(client, request);
       return;
     }
+    EvalSumCT = EvaluateSumCiphertext(client, lock);
 
-    std::string s;
-    std::ostringstream os(s);
     OPENFHE_DEBUG("[SERVER]: sending eval sum CT to [" << client->GetID()
                                                        << "]:");
-    Serial::Serialize(EvalSumCT, os, SerType::BINARY);
+    olc::net::message_ostream<ThreshMsgTypes> os(msg);
+    CT evalSumCT = EvalSumCT;
+    lock.unlock();
+    Serial::Serialize(evalSumCT, os, SerType::BINARY);
 
     msg.header.id = ThreshMsgTypes::SendSumCT;
-    msg << os.str(); // push the string onto the message.
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
     client->Send(msg);
   }
   void SendClientDecryptMainMult(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    olc::net::message<ThreshMsgTypes> msg;
-    // if the partial decrypt does not yet exist, send a Nack
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request) {
+    // if the partial decrypt does not yet exist, wait for it
     if (!Partial_MainMultRecd) {
-      std::cout << "[SERVER] sending NackPartialMainMult to ["
-                << client->GetID() << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackPartialMainMult;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
-    std::string s;
-    std::ostringstream os(s);
     OPENFHE_DEBUG("[SERVER]: sending partial decrypt main mult to ["
                   << client->GetID() << "]:");
-    Serial::Serialize(Partial_MainMult, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendDecryptMainMult;
-    msg << os.str(); // push the string onto the message.
-    OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
-    OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    client->Send(msg);
+    client->Send(Partial_MainMult.Message());
   }
 
   void SendClientDecryptLeadMult(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    olc::net::message<ThreshMsgTypes> msg;
-    // if the partial decrypt does not yet exist, send a Nack
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request) {
+    // if the partial decrypt does not yet exist, wait for it
     if (!Partial_LeadMultRecd) {
-      std::cout << "[SERVER] sending NackPartialLeadMult to ["
-                << client->GetID() << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackPartialLeadMult;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
-    std::string s;
-    std::ostringstream os(s);
     OPENFHE_DEBUG("[SERVER]: sending partial decrypt lead mult to ["
                   << client->GetID() << "]:");
-    Serial::Serialize(Partial_LeadMult, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendDecryptLeadMult;
-    msg << os.str(); // push the string onto the message.
-    OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
-    OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    client->Send(msg);
+    client->Send(Partial_LeadMult.Message());
   }
 
   void SendClientDecryptMainAdd(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    olc::net::message<ThreshMsgTypes> msg;
-    // if the partial decrypt does not yet exist, send a Nack
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request) {
+    // if the partial decrypt does not yet exist, wait for it
     if (!Partial_MainAddRecd) {
-      std::cout << "[SERVER] sending NackPartialMainAdd to [" << client->GetID()
-                << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackPartialMainAdd;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
-    std::string s;
-    std::ostringstream os(s);
     OPENFHE_DEBUG("[SERVER]: sending partial decrypt main add to ["
                   << client->GetID() << "]:");
-    Serial::Serialize(Partial_MainAdd, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendDecryptMainAdd;
-    msg << os.str(); // push the string onto the message.
-    OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
-    OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    client->Send(msg);
+    client->Send(Partial_MainAdd.Message());
   }
 
   void SendClientDecryptLeadAdd(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    olc::net::message<ThreshMsgTypes> msg;
-    // if the partial decrypt does not yet exist, send a Nack
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request) {
+    // if the partial decrypt does not yet exist, wait for it
     if (!Partial_LeadAddRecd) {
-      std::cout << "[SERVER] sending NackPartialLeadAdd to [" << client->GetID()
-                << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackPartialLeadAdd;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
-    std::string s;
-    std::ostringstream os(s);
     OPENFHE_DEBUG("[SERVER]: sending partial decrypt lead add to ["
                   << client->GetID() << "]:");
-    Serial::Serialize(Partial_LeadAdd, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendDecryptLeadAdd;
-    msg << os.str(); // push the string onto the message.
-    OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
-    OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    client->Send(msg);
+    client->Send(Partial_LeadAdd.Message());
   }
 
   void SendClientDecryptMainSum(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    olc::net::message<ThreshMsgTypes> msg;
-    // if the partial decrypt does not yet exist, send a Nack
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request) {
+    // if the partial decrypt does not yet exist, wait for it
     if (!Partial_MainSumRecd) {
-      std::cout << "[SERVER] sending NackPartialMainSum to [" << client->GetID()
-                << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackPartialMainSum;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
-    std::string s;
-    std::ostringstream os(s);
     OPENFHE_DEBUG("[SERVER]: sending partial decrypt main sum to ["
                   << client->GetID() << "]:");
-    Serial::Serialize(Partial_MainSum, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendDecryptMainSum;
-    msg << os.str(); // push the string onto the message.
-    OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
-    OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    client->Send(msg);
+    client->Send(Partial_MainSum.Message());
   }
 
   void SendClientDecryptLeadSum(
-      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client) {
-    olc::net::message<ThreshMsgTypes> msg;
-    // if the partial decrypt does not yet exist, send a Nack
+      std::shared_ptr<olc::net::connection<ThreshMsgTypes>> client,
+      const olc::net::message_header<ThreshMsgTypes> &request) {
+    // if the partial decrypt does not yet exist, wait for it
     if (!Partial_LeadSumRecd) {
-      std::cout << "[SERVER] sending NackPartialLeadSum to [" << client->GetID()
-                << "]:\n";
-      msg.header.id = ThreshMsgTypes::NackPartialLeadSum;
-      client->Send(msg);
+      Park(client, request);
       return;
     }
 
-    std::string s;
-    std::ostringstream os(s);
     OPENFHE_DEBUG("[SERVER]: sending partial decrypt lead sum to ["
                   << client->GetID() << "]:");
-    Serial::Serialize(Partial_LeadSum, os, SerType::BINARY);
-
-    msg.header.id = ThreshMsgTypes::SendDecryptLeadSum;
-    msg << os.str(); // push the string onto the message.
-    OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
-    OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    client->Send(msg);
+    client->Send(Partial_LeadSum.Message());
   }
 
   void RecvClientPartialMainAddCT(
@@ -1180,14 +1191,18 @@ protected:
     OPENFHE_DEBUG("[SERVER] read CT of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
 
-    Serial::Deserialize(Partial_MainAdd, is, SerType::BINARY);
+    CT ct;
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(ct, is, SerType::BINARY);
+    }
+    msg.header.id = ThreshMsgTypes::SendDecryptMainAdd;
+    Partial_MainAdd.Set(std::move(ct), std::move(msg));
 
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
@@ -1205,14 +1220,18 @@ protected:
     OPENFHE_DEBUG("[SERVER] read CT of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
 
-    Serial::Deserialize(Partial_MainMult, is, SerType::BINARY);
+    CT ct;
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(ct, is, SerType::BINARY);
+    }
+    msg.header.id = ThreshMsgTypes::SendDecryptMainMult;
+    Partial_MainMult.Set(std::move(ct), std::move(msg));
 
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
@@ -1230,14 +1249,18 @@ protected:
     OPENFHE_DEBUG("[SERVER] read CT of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
 
-    Serial::Deserialize(Partial_MainSum, is, SerType::BINARY);
+    CT ct;
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(ct, is, SerType::BINARY);
+    }
+    msg.header.id = ThreshMsgTypes::SendDecryptMainSum;
+    Partial_MainSum.Set(std::move(ct), std::move(msg));
 
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
@@ -1256,14 +1279,18 @@ protected:
     OPENFHE_DEBUG("[SERVER] read CT of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
 
-    Serial::Deserialize(Partial_LeadAdd, is, SerType::BINARY);
+    CT ct;
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(ct, is, SerType::BINARY);
+    }
+    msg.header.id = ThreshMsgTypes::SendDecryptLeadAdd;
+    Partial_LeadAdd.Set(std::move(ct), std::move(msg));
 
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
@@ -1281,14 +1308,18 @@ protected:
     OPENFHE_DEBUG("[SERVER] read CT of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
 
-    Serial::Deserialize(Partial_LeadMult, is, SerType::BINARY);
+    CT ct;
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(ct, is, SerType::BINARY);
+    }
+    msg.header.id = ThreshMsgTypes::SendDecryptLeadMult;
+    Partial_LeadMult.Set(std::move(ct), std::move(msg));
 
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
@@ -1306,14 +1337,18 @@ protected:
     OPENFHE_DEBUG("[SERVER] read CT of " << msgSize << " bytes");
     OPENFHE_DEBUG("[SERVER]: msg.size() " << msg.size());
     OPENFHE_DEBUG("[SERVER]: msg.body.size() " << msg.body.size());
-    // make an istringstream from the message
-    std::istringstream is(std::string(msg.body.begin(), msg.body.end()));
-    OPENFHE_DEBUG("SERVER istringstream.str.size(): " << is.str().size());
+    // read the body in place, no copy is made
+    olc::net::message_istream<ThreshMsgTypes> is(msg);
 
-    // NOTE Deserialize needs a basic_istream<char>
     OPENFHE_DEBUG("[SERVER] Deserialize");
 
-    Serial::Deserialize(Partial_LeadSum, is, SerType::BINARY);
+    CT ct;
+    {
+      std::scoped_lock lockDeserialize(m_muxDeserialize);
+      Serial::Deserialize(ct, is, SerType::BINARY);
+    }
+    msg.header.id = ThreshMsgTypes::SendDecryptLeadSum;
+    Partial_LeadSum.Set(std::move(ct), std::move(msg));
 
     OPENFHE_DEBUG("[SERVER] Done");
     assert(is.good());
@@ -1321,13 +1356,13 @@ protected:
   }
 
   void incrementNumClients(void) {
-    numClient++;
-    std::cout << "[Server] Incrementing # clients, now " << numClient << "\n";
+    usint n = ++numClient;
+    std::cout << "[Server] Incrementing # clients, now " << n << "\n";
   }
 
   void decrementNumClients(void) {
-    numClient--;
-    std::cout << "[Server] Decrementing # clients, now " << numClient << "\n";
+    usint n = --numClient;
+    std::cout << "[Server] Decrementing # clients, now " << n << "\n";
   }
   void exitIfNoClients(void) {
     if (!numClient) {
@@ -1337,10 +1372,21 @@ protected:
   }
 
 private:
-  // Server state
+  // Server state, guarded by m_muxState. m_serverCC and m_ccReply are only
+  // read after construction
   CC m_serverCC;
-  usint numClient =
-      0; // keeps track of # clients, and when it goes back to zero, exits
+  olc::net::shared_message<ThreshMsgTypes> m_ccReply; // SendCC
+  std::mutex m_muxState;
+  // OpenFHE's context registry is not thread safe, every Deserialize() takes
+  // this, after m_muxState if it holds that too
+  std::mutex m_muxDeserialize;
+  olc::net::subscriptions<ThreshMsgTypes> m_waiting; // requests by id
+  bool m_bDeltaKeys = false; // set before Start()
+  std::mutex m_muxEval; // held while the server runs EvalMult or EvalSum
+
+  // keeps track of # clients, and when it goes back to zero, exits.
+  // OnClientConnect() runs on the I/O threads, so this is atomic
+  std::atomic<usint> numClient{0};
 
   usint batchSize = 16; // batch size for vector sum computation
 
@@ -1348,12 +1394,18 @@ private:
   // and their approved connections,
   // but we will only keep track of one pair in this example
 
+  // The keys and ciphertexts the clients send are passed on to the other
+  // client as they are, so each is kept serialized too, from when it
+  // arrives. Round 2 keys are kept as deltas against round 1 keys when
+  // delta keys are on.
+
   // public keys of Clients Alice and Bob
-  PubKey A_Rnd1PublicKey, B_Rnd2PublicKey;
+  Serialized<PubKey> A_Rnd1PublicKey, B_Rnd2PublicKey;
 
   // evaluation keys for multiplication in rounds1,2,3 from Alice and Bob and
   // flags for marking received
-  EvKey A_evalMultKey, B_evalMultKeyAB, B_evalMultKeyBAB, A_evalMultFinal;
+  Serialized<EvKey> A_evalMultKey, B_evalMultKeyAB, B_evalMultKeyBAB,
+      A_evalMultFinal;
   bool A_Rnd1PubKeyRecd, A_evalMultKeyRecd, B_Rnd2PublicKeyRecd,
       B_evalMultKeyABRecd, B_evalMultKeyBABRecd, A_evalMultFinalRecd;
 
@@ -1361,14 +1413,14 @@ private:
   std::shared_ptr<std::map<usint, EvKey>> A_evalSumKeys, B_evalSumKeysJoin;
 
   // ciphertexts from Bob and flags for receiving the ciphertexts
-  std::vector<CT> B_CipherTexts;
+  std::vector<Serialized<CT>> B_CipherTexts;
   std::vector<bool> B_CTreceived;
 
   // evaluation ciphertexts if the server does the computation
   CT EvalAddCT, EvalMultCT, EvalSumCT;
 
-  CT Partial_LeadAdd, Partial_MainAdd, Partial_LeadMult, Partial_MainMult,
-      Partial_LeadSum, Partial_MainSum;
+  Serialized<CT> Partial_LeadAdd, Partial_MainAdd, Partial_LeadMult,
+      Partial_MainMult, Partial_LeadSum, Partial_MainSum;
   bool EvalAddCTDone = false, EvalMultCTDone = false, EvalSumCTDone = false;
   bool Partial_LeadAddRecd = false, Partial_MainAddRecd = false,
        Partial_LeadMultRecd = false, Partial_MainMultRecd = false;